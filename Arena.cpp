@@ -0,0 +1,55 @@
+//------------------------------------------------------------------------------
+// Arena.cpp
+//------------------------------------------------------------------------------
+
+#include "Arena.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+ll::Arena::Arena() {
+    _pages.reserve(16);
+}
+
+std::string_view ll::Arena::copy(std::string_view str) {
+    if (str.empty()) {
+        return {};
+    }
+
+    auto memory = static_cast<char*>(allocate(str.size(), 1));
+    std::memcpy(memory, str.data(), str.size());
+    return std::string_view(memory, str.size());
+}
+
+void* ll::Arena::do_allocate(std::size_t bytes, std::size_t alignment) {
+    auto aligned = [this, alignment] () {
+        auto address = reinterpret_cast<std::uintptr_t>(_cursor);
+        auto adjust = (alignment - (address % alignment)) % alignment;
+        return _cursor + adjust;
+    };
+
+    if (_cursor == nullptr || aligned() + bytes > _end) {
+        new_page(bytes + alignment);
+    }
+
+    auto result = aligned();
+    _cursor = result + bytes;
+    _bytesAllocated += bytes;
+    _allocations++;
+    return result;
+}
+
+void ll::Arena::do_deallocate(void*, std::size_t, std::size_t) {
+    //memory is released with the arena
+}
+
+bool ll::Arena::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+    return this == &other;
+}
+
+void ll::Arena::new_page(std::size_t minimum) {
+    auto size = std::max(minimum, PageSize);
+    _pages.push_back(std::make_unique_for_overwrite<std::byte[]>(size));
+    _cursor = _pages.back().get();
+    _end = _cursor + size;
+}
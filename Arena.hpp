@@ -0,0 +1,58 @@
+//------------------------------------------------------------------------------
+// Arena.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <string_view>
+#include <vector>
+
+namespace ll {
+
+//Bump allocator for AST nodes. Memory is carved out of fixed size pages and is
+//only ever given back when the arena itself is destroyed, so nodes created here
+//never have their destructors run. Containers inside nodes are std::pmr types
+//that draw from the same arena.
+class Arena : public std::pmr::memory_resource {
+public:
+    static constexpr std::size_t PageSize = 64 * 1024;
+
+private:
+    std::vector<std::unique_ptr<std::byte[]>> _pages;
+    std::byte* _cursor = nullptr;
+    std::byte* _end = nullptr;
+    std::size_t _bytesAllocated = 0;
+    std::size_t _allocations = 0;
+
+public:
+    Arena();
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    template<typename T, typename... Args>
+    T* make(Args&&... args) {
+        void* memory = allocate(sizeof(T), alignof(T));
+        return std::uninitialized_construct_using_allocator(
+            static_cast<T*>(memory),
+            std::pmr::polymorphic_allocator<>(this),
+            std::forward<Args>(args)...);
+    }
+
+    std::string_view copy(std::string_view str);
+
+    std::size_t page_count() const { return _pages.size(); }
+    std::size_t bytes_allocated() const { return _bytesAllocated; }
+    std::size_t allocation_count() const { return _allocations; }
+
+private:
+    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+
+    void new_page(std::size_t minimum);
+};
+
+}
@@ -0,0 +1,141 @@
+//------------------------------------------------------------------------------
+// Arena.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "Arena.hpp"
+
+#include "Parser.hpp"
+#include "TranslationUnit.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <gtest/gtest.h>
+
+namespace {
+    std::atomic<size_t> heapAllocations = 0;
+
+    const std::string_view fizzbuzz_block = R"(
+    int64 counter;
+    counter = 1;
+    while (counter < 100) {
+        int64 mod3;
+        mod3 = counter % 3;
+
+        int64 mod5;
+        mod5 = counter % 5;
+        if (mod3 == 0) {
+            if (mod5 == 0) {
+                printf("FizzBuzz");
+            } else {
+                printf("Fizz");
+            }
+        } else if (mod5 == 0) {
+            printf("Buzz");
+        } else {
+            printf("%i", counter);
+        }
+        counter = counter + 1;
+        puts("");
+    }
+    )";
+}
+
+//counts every heap allocation made by the test binary
+void* operator new(std::size_t size) {
+    heapAllocations++;
+    if (auto p = std::malloc(size == 0 ? 1 : size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+TEST(Arena, make_sets_kind) {
+    ll::Arena arena;
+    auto param = arena.make<Int64Param>();
+    param->content = 4;
+
+    EXPECT_EQ(param->kind, NodeKind::Int64Param);
+    EXPECT_EQ(param->content, 4);
+    EXPECT_EQ(arena.page_count(), 1);
+    EXPECT_EQ(arena.allocation_count(), 1);
+}
+
+TEST(Arena, make_alignment) {
+    ll::Arena arena;
+    arena.copy("a");
+    auto param = arena.make<Int64Param>();
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(param) % alignof(Int64Param), 0);
+}
+
+TEST(Arena, containers_use_arena) {
+    ll::Arena arena;
+    auto call = arena.make<FunctionCall>();
+    EXPECT_EQ(call->params.get_allocator().resource(), &arena);
+
+    auto block = arena.make<Block>();
+    EXPECT_EQ(block->statements.get_allocator().resource(), &arena);
+    EXPECT_EQ(block->vars.get_allocator().resource(), &arena);
+
+    auto before = arena.allocation_count();
+    block->statements.push_back(call);
+    EXPECT_GT(arena.allocation_count(), before);
+}
+
+TEST(Arena, copy_string) {
+    ll::Arena arena;
+    std::string source = "printf";
+    auto copy = arena.copy(source);
+    source[0] = 'x';
+
+    EXPECT_EQ(copy, "printf");
+    EXPECT_TRUE(arena.copy("").empty());
+}
+
+TEST(Arena, large_allocation_gets_own_page) {
+    ll::Arena arena;
+    arena.copy("a");
+    std::string big(ll::Arena::PageSize * 2, 'b');
+    auto copy = arena.copy(big);
+
+    EXPECT_EQ(copy, big);
+    EXPECT_EQ(arena.page_count(), 2);
+}
+
+TEST(Arena, parse_fizzbuzz_heap_allocations) {
+    ll::Arena arena;
+
+    auto before = heapAllocations.load();
+    Parser parser(arena);
+    parser.parse_block(fizzbuzz_block);
+    auto after = heapAllocations.load();
+
+    //with std::make_unique nodes, std::string names and std::vector children
+    //this parse made 82 heap allocations. Now only the token stream (which may
+    //grow once past its size estimate) and the arena page allocate.
+    EXPECT_LE(after - before, 4);
+    EXPECT_EQ(arena.page_count(), 1);
+    EXPECT_EQ(parser.block->statements.size(), 2);
+}
+
+TEST(Arena, translation_unit_owns_nodes) {
+    std::string program = R"(fn main() { int64 a; a = 1 + 2; puts("a"); })";
+    std::string_view sv = program;
+    auto tu = ll::TranslationUnit::parse_translation_unit(sv);
+
+    program.assign(program.size(), ' ');
+
+    ASSERT_EQ(tu->functions.size(), 1);
+    EXPECT_EQ(tu->functions.front()->name, "main");
+    EXPECT_EQ(tu->functions.front()->block->vars.front().name, "a");
+    EXPECT_GT(tu->arena.allocation_count(), 0);
+}
@@ -0,0 +1,323 @@
+//------------------------------------------------------------------------------
+// CodeCache.cpp
+//------------------------------------------------------------------------------
+
+#include "CodeCache.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <span>
+#include <sstream>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr char Magic[4] = {'L', 'L', 'C', 'C'};
+
+    struct Header {
+        char magic[4];
+        std::uint32_t version;
+        std::uint64_t key;
+        std::uint64_t codeSize;
+        std::uint32_t symbolCount;
+        std::uint32_t cstringCount;
+        std::uint32_t externCount;
+        std::uint32_t importCount;
+        std::uint32_t statementCount;
+    };
+
+    //file is a Header, the code, then symbols, cstrings, externs and imports
+    //each as a length prefixed string followed by its offset in the code, then
+    //the statement marks
+    class Writer {
+        std::ostream& _os;
+
+    public:
+        Writer(std::ostream& os) : _os(os) {}
+
+        template<typename T>
+        void value(const T& value) {
+            _os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+        }
+
+        void entry(std::string_view name, std::uint64_t offset) {
+            value(static_cast<std::uint32_t>(name.size()));
+            _os.write(name.data(), name.size());
+            value(offset);
+        }
+    };
+
+    class Reader {
+        std::span<const std::byte> _data;
+        std::size_t _position = 0;
+
+    public:
+        Reader(std::span<const std::byte> data) : _data(data) {}
+
+        bool read(void* out, std::size_t size) {
+            if (_data.size() - _position < size) {
+                return false;
+            }
+            std::memcpy(out, _data.data() + _position, size);
+            _position += size;
+            return true;
+        }
+
+        const std::byte* take(std::size_t size) {
+            if (_data.size() - _position < size) {
+                return nullptr;
+            }
+            auto result = _data.data() + _position;
+            _position += size;
+            return result;
+        }
+
+        bool entry(std::string& name, std::uint64_t& offset) {
+            std::uint32_t length;
+            if (!read(&length, sizeof(length))) {
+                return false;
+            }
+            auto chars = take(length);
+            if (!chars) {
+                return false;
+            }
+            name.assign(reinterpret_cast<const char*>(chars), length);
+            return read(&offset, sizeof(offset));
+        }
+
+        bool at_end() const { return _position == _data.size(); }
+    };
+
+    //read only private mapping of a whole file, unmapped when destroyed
+    class Mapping {
+        void* _address = MAP_FAILED;
+        std::size_t _size = 0;
+
+    public:
+        Mapping(const std::filesystem::path& path) {
+            int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                return;
+            }
+
+            struct stat st;
+            if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+                _size = static_cast<std::size_t>(st.st_size);
+                _address = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+            }
+            ::close(fd);
+        }
+
+        ~Mapping() {
+            if (_address != MAP_FAILED) {
+                ::munmap(_address, _size);
+            }
+        }
+
+        Mapping(const Mapping&) = delete;
+        Mapping& operator=(const Mapping&) = delete;
+
+        explicit operator bool() const { return _address != MAP_FAILED; }
+
+        std::span<const std::byte> data() const {
+            return {static_cast<const std::byte*>(_address), _size};
+        }
+    };
+
+    bool patch_address(std::vector<std::uint8_t>& code, std::uint64_t location, std::uint64_t address) {
+        if (location > code.size() || code.size() - location < sizeof(address)) {
+            return false;
+        }
+        std::memcpy(&code[location], &address, sizeof(address));
+        return true;
+    }
+}
+
+ll::CodeCache::CodeCache(std::filesystem::path directory)
+: _directory(std::move(directory))
+{
+}
+
+std::uint64_t ll::CodeCache::key(std::string_view source) {
+    //FNV-1a
+    std::uint64_t hash = 0xcbf29ce484222325;
+    auto mix = [&hash] (std::string_view bytes) {
+        for (unsigned char c : bytes) {
+            hash ^= c;
+            hash *= 0x100000001b3;
+        }
+    };
+
+    mix(CompilerVersion);
+    mix(std::string_view("\0", 1));
+    mix(source);
+    return hash;
+}
+
+std::filesystem::path ll::CodeCache::path_for(std::uint64_t key) const {
+    std::stringstream ss;
+    ss << std::hex;
+    ss.width(16);
+    ss.fill('0');
+    ss << key << ".llc";
+    return _directory / ss.str();
+}
+
+std::optional<ll::Object> ll::CodeCache::load(std::uint64_t key, SymbolResolver& resolver) {
+    auto miss = [this] () -> std::optional<Object> {
+        _misses++;
+        return std::nullopt;
+    };
+
+    Mapping mapping(path_for(key));
+    if (!mapping) {
+        return miss();
+    }
+
+    Reader reader(mapping.data());
+    Header header;
+    if (!reader.read(&header, sizeof(header))
+        || std::memcmp(header.magic, Magic, sizeof(Magic)) != 0
+        || header.version != FormatVersion
+        || header.key != key) {
+        return miss();
+    }
+
+    auto code = reader.take(header.codeSize);
+    if (!code) {
+        return miss();
+    }
+
+    Object object;
+    auto& buffer = object.buff.buffer();
+    buffer.assign(reinterpret_cast<const std::uint8_t*>(code), reinterpret_cast<const std::uint8_t*>(code) + header.codeSize);
+
+    std::string name;
+    std::uint64_t offset;
+
+    for (std::uint32_t i = 0; i < header.symbolCount; i++) {
+        if (!reader.entry(name, offset) || offset > buffer.size()) {
+            return miss();
+        }
+        object.symbols.push_back({.name = name, .offset = offset});
+    }
+
+    for (std::uint32_t i = 0; i < header.cstringCount; i++) {
+        if (!reader.entry(name, offset)) {
+            return miss();
+        }
+        auto address = object.buff.add_cstring(name, offset);
+        if (!patch_address(buffer, offset, address)) {
+            return miss();
+        }
+    }
+
+    for (std::uint32_t i = 0; i < header.externCount; i++) {
+        if (!reader.entry(name, offset) || offset > buffer.size()) {
+            return miss();
+        }
+        object.buff._externFuncs.push_back({.symbol = name, .location = offset});
+    }
+
+    for (std::uint32_t i = 0; i < header.importCount; i++) {
+        if (!reader.entry(name, offset)) {
+            return miss();
+        }
+        auto address = resolver.resolve(name);
+        if (!address || !patch_address(buffer, offset, reinterpret_cast<std::uint64_t>(address))) {
+            return miss();
+        }
+        object.buff._jitImports.push_back({.symbol = name, .location = offset});
+    }
+
+    for (std::uint32_t i = 0; i < header.statementCount; i++) {
+        std::uint32_t statement;
+        std::uint32_t line;
+        if (!reader.read(&statement, sizeof(statement)) || !reader.read(&line, sizeof(line))
+            || !reader.read(&offset, sizeof(offset)) || offset > buffer.size()) {
+            return miss();
+        }
+        object.buff._statements.push_back({.location = offset, .statement = statement, .line = line});
+    }
+
+    if (!reader.at_end()) {
+        return miss();
+    }
+
+    _hits++;
+    return object;
+}
+
+bool ll::CodeCache::store(std::uint64_t key, const Object& object) {
+    std::error_code ec;
+    std::filesystem::create_directories(_directory, ec);
+    if (ec) {
+        return false;
+    }
+
+    //written aside then renamed so a reader never sees a partial entry
+    auto path = path_for(key);
+    auto temporary = path;
+    temporary += "." + std::to_string(::getpid()) + ".tmp";
+
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        auto& buff = object.buff;
+        auto& code = buff.buffer();
+
+        Header header{};
+        std::memcpy(header.magic, Magic, sizeof(Magic));
+        header.version = FormatVersion;
+        header.key = key;
+        header.codeSize = code.size();
+        header.symbolCount = static_cast<std::uint32_t>(object.symbols.size());
+        header.cstringCount = static_cast<std::uint32_t>(buff._cstrings.size());
+        header.externCount = static_cast<std::uint32_t>(buff._externFuncs.size());
+        header.importCount = static_cast<std::uint32_t>(buff._jitImports.size());
+        header.statementCount = static_cast<std::uint32_t>(buff._statements.size());
+
+        Writer writer(file);
+        writer.value(header);
+        file.write(reinterpret_cast<const char*>(code.data()), code.size());
+
+        for (auto& symbol : object.symbols) {
+            writer.entry(symbol.name, symbol.offset);
+        }
+        for (auto& cstr : buff._cstrings) {
+            writer.entry(cstr->string, cstr->location);
+        }
+        for (auto& externFunc : buff._externFuncs) {
+            writer.entry(externFunc.symbol, externFunc.location);
+        }
+        for (auto& import : buff._jitImports) {
+            writer.entry(import.symbol, import.location);
+        }
+        for (auto& mark : buff._statements) {
+            writer.value(mark.statement);
+            writer.value(mark.line);
+            writer.value(static_cast<std::uint64_t>(mark.location));
+        }
+
+        if (!file.good()) {
+            file.close();
+            std::filesystem::remove(temporary, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temporary, path, ec);
+    if (ec) {
+        std::filesystem::remove(temporary, ec);
+        return false;
+    }
+
+    return true;
+}
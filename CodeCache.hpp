@@ -0,0 +1,50 @@
+//------------------------------------------------------------------------------
+// CodeCache.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Linker.hpp"
+#include "SymbolResolver.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+namespace ll {
+
+//On disk cache of JIT compiled objects keyed by a hash of the program source
+//and the compiler version. An entry holds the machine code, symbols, string
+//constants, unresolved calls, statement marks and the locations of resolved
+//process calls. The process addresses are not stored, they are resolved again
+//and patched in on load as are the string constant addresses.
+class CodeCache {
+public:
+    //bump whenever code generation changes so stale entries are never loaded
+    static constexpr std::string_view CompilerVersion = "littlelang-x64-21";
+    static constexpr std::uint32_t FormatVersion = 3;
+
+private:
+    std::filesystem::path _directory;
+    std::size_t _hits = 0;
+    std::size_t _misses = 0;
+
+public:
+    explicit CodeCache(std::filesystem::path directory);
+
+    static std::uint64_t key(std::string_view source);
+    std::filesystem::path path_for(std::uint64_t key) const;
+
+    //nullopt when there is no entry, it is corrupt or a process call no longer
+    //resolves
+    std::optional<Object> load(std::uint64_t key, SymbolResolver& resolver = SymbolResolver::process());
+
+    //object must be compiled in JIT mode, false if the entry couldn't be written
+    bool store(std::uint64_t key, const Object& object);
+
+    std::size_t hits() const { return _hits; }
+    std::size_t misses() const { return _misses; }
+};
+
+}
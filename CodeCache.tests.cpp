@@ -0,0 +1,117 @@
+//------------------------------------------------------------------------------
+// CodeCache.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "CodeCache.hpp"
+
+#include "JitModule.hpp"
+#include "TestPrograms.hpp"
+
+#include <fstream>
+
+#include <gtest/gtest.h>
+
+using namespace ll;
+
+namespace {
+    const std::string_view program = R"(
+    fn helper() { printf("h"); }
+    fn main() { int64 a; a = 1 + 2; printf("%i", a); helper(); }
+    )";
+
+    class CodeCacheTests : public testing::Test {
+    protected:
+        std::filesystem::path directory;
+
+        void SetUp() override {
+            directory = std::filesystem::temp_directory_path() / ("ll_cache_" + std::to_string(::getpid()));
+            std::filesystem::remove_all(directory);
+        }
+
+        void TearDown() override {
+            std::filesystem::remove_all(directory);
+        }
+    };
+}
+
+TEST(CodeCache, key_depends_on_source) {
+    EXPECT_EQ(CodeCache::key(program), CodeCache::key(program));
+    EXPECT_NE(CodeCache::key(program), CodeCache::key("fn main() { }"));
+    EXPECT_NE(CodeCache::key(""), 0);
+}
+
+TEST_F(CodeCacheTests, round_trip) {
+    CodeCache cache(directory);
+    auto key = CodeCache::key(program);
+    auto object = test::compile_object(program, Compiler_x64::Mode::JIT);
+    ASSERT_TRUE(cache.store(key, object));
+    EXPECT_TRUE(std::filesystem::exists(cache.path_for(key)));
+
+    auto loaded = cache.load(key);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(cache.hits(), 1);
+    EXPECT_EQ(loaded->symbols, object.symbols);
+    EXPECT_EQ(loaded->buff._externFuncs, object.buff._externFuncs);
+    EXPECT_EQ(loaded->buff._jitImports, object.buff._jitImports);
+    EXPECT_EQ(loaded->buff._statements, object.buff._statements);
+    ASSERT_EQ(loaded->buff._cstrings.size(), object.buff._cstrings.size());
+    for (size_t i = 0; i < object.buff._cstrings.size(); i++) {
+        EXPECT_EQ(*loaded->buff._cstrings[i], *object.buff._cstrings[i]);
+    }
+
+    //identical apart from the string constant addresses
+    EXPECT_EQ(loaded->buff.buffer().size(), object.buff.buffer().size());
+    EXPECT_NE(loaded->buff.buffer(), object.buff.buffer());
+}
+
+TEST_F(CodeCacheTests, loaded_object_runs) {
+    auto key = CodeCache::key(program);
+    {
+        CodeCache cache(directory);
+        ASSERT_TRUE(cache.store(key, test::compile_object(program, Compiler_x64::Mode::JIT)));
+    }
+
+    CodeCache cache(directory);
+    auto loaded = cache.load(key);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(loaded->buff._jitImports.size(), 2);
+
+    auto module = JitModule::finalise(std::move(*loaded));
+    testing::internal::CaptureStdout();
+    module.function<void()>("main")();
+    fflush(stdout);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "3h");
+}
+
+TEST_F(CodeCacheTests, missing_entry) {
+    CodeCache cache(directory);
+    ASSERT_TRUE(cache.store(CodeCache::key(program), test::compile_object(program, Compiler_x64::Mode::JIT)));
+
+    EXPECT_FALSE(cache.load(CodeCache::key("fn main() { }")).has_value());
+    EXPECT_EQ(cache.misses(), 1);
+    EXPECT_EQ(cache.hits(), 0);
+}
+
+TEST_F(CodeCacheTests, corrupt_entry) {
+    CodeCache cache(directory);
+    auto key = CodeCache::key(program);
+    ASSERT_TRUE(cache.store(key, test::compile_object(program, Compiler_x64::Mode::JIT)));
+
+    auto path = cache.path_for(key);
+    std::filesystem::resize_file(path, std::filesystem::file_size(path) - 1);
+    EXPECT_FALSE(cache.load(key).has_value());
+
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << "not a cache entry";
+    EXPECT_FALSE(cache.load(key).has_value());
+    EXPECT_EQ(cache.misses(), 2);
+}
+
+TEST_F(CodeCacheTests, unresolved_import) {
+    CodeCache cache(directory);
+    auto key = CodeCache::key(program);
+    auto object = test::compile_object(program, Compiler_x64::Mode::JIT);
+    object.buff._jitImports.front().symbol = "ll_no_such_function";
+    ASSERT_TRUE(cache.store(key, object));
+
+    EXPECT_FALSE(cache.load(key).has_value());
+}
@@ -0,0 +1,226 @@
+//------------------------------------------------------------------------------
+// CodeHeap.cpp
+//------------------------------------------------------------------------------
+
+#include "CodeHeap.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__APPLE__) && defined(__MACH__)
+#include <libkern/OSCacheControl.h>
+#include <pthread.h>
+#endif
+
+ll::CodeAllocation::CodeAllocation(CodeHeap* heap, std::byte* address, std::size_t size)
+: _heap(heap)
+, _address(address)
+, _size(size)
+{
+}
+
+ll::CodeAllocation::CodeAllocation(CodeAllocation&& other) noexcept
+: _heap(std::exchange(other._heap, nullptr))
+, _address(std::exchange(other._address, nullptr))
+, _size(std::exchange(other._size, 0))
+{
+}
+
+ll::CodeAllocation& ll::CodeAllocation::operator=(CodeAllocation&& other) noexcept {
+    if (this != &other) {
+        reset();
+        _heap = std::exchange(other._heap, nullptr);
+        _address = std::exchange(other._address, nullptr);
+        _size = std::exchange(other._size, 0);
+    }
+    return *this;
+}
+
+ll::CodeAllocation::~CodeAllocation() {
+    reset();
+}
+
+void ll::CodeAllocation::reset() {
+    if (_heap && _address) {
+        _heap->release(_address, _size);
+    }
+    _heap = nullptr;
+    _address = nullptr;
+    _size = 0;
+}
+
+ll::CodeHeap::CodeHeap()
+: _pageSize(static_cast<std::size_t>(sysconf(_SC_PAGESIZE)))
+{
+}
+
+ll::CodeHeap::~CodeHeap() {
+    for (auto& chunk : _chunks) {
+        munmap(chunk->base, chunk->size);
+    }
+}
+
+ll::CodeHeap& ll::CodeHeap::process() {
+    static CodeHeap heap;
+    return heap;
+}
+
+ll::CodeAllocation ll::CodeHeap::allocate(std::span<const std::uint8_t> code) {
+    if (code.empty()) {
+        return {};
+    }
+
+    auto size = (code.size() + _pageSize - 1) / _pageSize * _pageSize;
+
+    std::lock_guard lock(_mutex);
+
+    //first fit across chunks
+    Chunk* chunk = nullptr;
+    std::map<std::size_t, std::size_t>::iterator block;
+    for (auto& candidate : _chunks) {
+        block = std::find_if(candidate->free.begin(), candidate->free.end(), [size] (auto& b) {
+            return b.second >= size;
+        });
+        if (block != candidate->free.end()) {
+            chunk = candidate.get();
+            break;
+        }
+    }
+
+    if (chunk == nullptr) {
+        chunk = &new_chunk(size);
+        block = chunk->free.begin();
+    }
+
+    auto [offset, length] = *block;
+    chunk->free.erase(block);
+    if (length > size) {
+        chunk->free.emplace(offset + size, length - size);
+    }
+    chunk->allocations++;
+
+    auto address = chunk->base + offset;
+
+    //give the block back if the pages can't be made writable or executable,
+    //so a failure neither leaks it nor keeps its chunk mapped forever
+    try {
+#if defined(__APPLE__) && defined(__MACH__)
+        pthread_jit_write_protect_np(0);
+        std::memcpy(address, code.data(), code.size());
+        pthread_jit_write_protect_np(1);
+        sys_icache_invalidate(address, code.size());
+#else
+        protect(address, size, PROT_READ | PROT_WRITE);
+        std::memcpy(address, code.data(), code.size());
+        protect(address, size, PROT_READ | PROT_EXEC);
+#endif
+    } catch (...) {
+        auto it = std::find_if(_chunks.begin(), _chunks.end(), [chunk] (auto& c) {
+            return c.get() == chunk;
+        });
+        free_block(it, address, size);
+        throw;
+    }
+
+    return CodeAllocation(this, address, size);
+}
+
+void ll::CodeHeap::release(std::byte* address, std::size_t size) noexcept {
+    std::lock_guard lock(_mutex);
+
+    auto it = std::find_if(_chunks.begin(), _chunks.end(), [address] (auto& chunk) {
+        return address >= chunk->base && address < chunk->base + chunk->size;
+    });
+    assert(it != _chunks.end() && "code allocation does not belong to this heap");
+    if (it == _chunks.end()) {
+        return;
+    }
+    free_block(it, address, size);
+}
+
+void ll::CodeHeap::free_block(std::vector<std::unique_ptr<Chunk>>::iterator it, std::byte* address, std::size_t size) noexcept {
+    auto& chunk = **it;
+
+#if !(defined(__APPLE__) && defined(__MACH__))
+    //a failure only leaves the freed code executable until it is reused,
+    //madvise and reuse work either way
+    mprotect(address, size, PROT_NONE);
+#endif
+    madvise(address, size, MADV_DONTNEED);
+
+    //insert and coalesce with the neighbouring free blocks
+    auto offset = static_cast<std::size_t>(address - chunk.base);
+    auto next = chunk.free.lower_bound(offset);
+    if (next != chunk.free.end() && offset + size == next->first) {
+        size += next->second;
+        next = chunk.free.erase(next);
+    }
+    if (next != chunk.free.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            prev->second += size;
+            offset = prev->first;
+            size = 0;
+        }
+    }
+    if (size != 0) {
+        chunk.free.emplace(offset, size);
+    }
+    chunk.allocations--;
+
+    //keep one chunk around so a JIT loop doesn't map and unmap every time
+    if (chunk.allocations == 0 && _chunks.size() > 1) {
+        munmap(chunk.base, chunk.size);
+        _chunks.erase(it);
+    }
+}
+
+ll::CodeHeap::Stats ll::CodeHeap::stats() const {
+    std::lock_guard lock(_mutex);
+
+    Stats stats;
+    stats.chunks = _chunks.size();
+    for (auto& chunk : _chunks) {
+        stats.reservedBytes += chunk->size;
+        stats.allocations += chunk->allocations;
+        for (auto& [offset, length] : chunk->free) {
+            stats.freeBytes += length;
+            stats.freeBlocks++;
+            stats.largestFreeBlock = std::max(stats.largestFreeBlock, length);
+        }
+    }
+    stats.usedBytes = stats.reservedBytes - stats.freeBytes;
+    return stats;
+}
+
+ll::CodeHeap::Chunk& ll::CodeHeap::new_chunk(std::size_t minimum) {
+    auto size = std::max(ChunkSize, (minimum + _pageSize - 1) / _pageSize * _pageSize);
+
+#if defined(__APPLE__) && defined(__MACH__)
+    void* memory = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_ANON | MAP_PRIVATE | MAP_JIT, -1, 0);
+#else
+    void* memory = mmap(nullptr, size, PROT_NONE, MAP_ANON | MAP_PRIVATE, -1, 0);
+#endif
+    if (memory == MAP_FAILED) {
+        throw std::runtime_error("Unable to map memory for JIT code.");
+    }
+
+    auto chunk = std::make_unique<Chunk>(Chunk{
+        .base = static_cast<std::byte*>(memory),
+        .size = size,
+        .free = {{0, size}}
+    });
+    _chunks.push_back(std::move(chunk));
+    return *_chunks.back();
+}
+
+void ll::CodeHeap::protect(std::byte* address, std::size_t size, int protection) {
+    if (mprotect(address, size, protection) != 0) {
+        throw std::runtime_error("Unable to change protection of JIT code.");
+    }
+}
@@ -0,0 +1,104 @@
+//------------------------------------------------------------------------------
+// CodeHeap.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <vector>
+
+namespace ll {
+
+class CodeHeap;
+
+//Executable memory handed out by a CodeHeap. Given back to the heap when
+//destroyed.
+class CodeAllocation {
+private:
+    CodeHeap* _heap = nullptr;
+    std::byte* _address = nullptr;
+    std::size_t _size = 0;
+
+public:
+    CodeAllocation() = default;
+    CodeAllocation(CodeHeap* heap, std::byte* address, std::size_t size);
+    CodeAllocation(CodeAllocation&& other) noexcept;
+    CodeAllocation& operator=(CodeAllocation&& other) noexcept;
+    ~CodeAllocation();
+
+    void* address() const { return _address; }
+    std::size_t size() const { return _size; }
+    explicit operator bool() const { return _address != nullptr; }
+
+    void reset();
+};
+
+//Pool of executable pages for JIT code. Memory is reserved from the OS in large
+//chunks and handed out in whole pages, so code is never writable and
+//executable at the same time: pages are made RW for the copy and then RX.
+//Freed pages go back to PROT_NONE for reuse and a chunk is unmapped once it is
+//empty, apart from the last one.
+class CodeHeap {
+public:
+    static constexpr std::size_t ChunkSize = 1024 * 1024;
+
+    struct Stats {
+        std::size_t chunks = 0;
+        std::size_t reservedBytes = 0;
+        std::size_t usedBytes = 0;
+        std::size_t allocations = 0;
+        std::size_t freeBytes = 0;
+        std::size_t freeBlocks = 0;
+        std::size_t largestFreeBlock = 0;
+
+        //0 when all free memory is one block, approaching 1 as it scatters
+        double fragmentation() const {
+            return freeBytes == 0 ? 0.0 : 1.0 - static_cast<double>(largestFreeBlock) / freeBytes;
+        }
+    };
+
+private:
+    struct Chunk {
+        std::byte* base;
+        std::size_t size;
+        std::map<std::size_t, std::size_t> free; //offset to length, coalesced
+        std::size_t allocations = 0;
+    };
+
+    std::size_t _pageSize;
+    mutable std::mutex _mutex;
+    std::vector<std::unique_ptr<Chunk>> _chunks;
+
+public:
+    CodeHeap();
+    virtual ~CodeHeap();
+    CodeHeap(const CodeHeap&) = delete;
+    CodeHeap& operator=(const CodeHeap&) = delete;
+
+    //shared by every JIT buffer in the process
+    static CodeHeap& process();
+
+    CodeAllocation allocate(std::span<const std::uint8_t> code);
+    Stats stats() const;
+    std::size_t page_size() const { return _pageSize; }
+
+private:
+    friend class CodeAllocation;
+    //runs from destructors and noexcept moves, so it never throws
+    void release(std::byte* address, std::size_t size) noexcept;
+    //returns a block to its chunk's free list, with _mutex held
+    void free_block(std::vector<std::unique_ptr<Chunk>>::iterator chunk, std::byte* address, std::size_t size) noexcept;
+
+    Chunk& new_chunk(std::size_t minimum);
+
+protected:
+    //virtual so tests can make it fail
+    virtual void protect(std::byte* address, std::size_t size, int protection);
+};
+
+}
@@ -0,0 +1,165 @@
+//------------------------------------------------------------------------------
+// CodeHeap.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "CodeHeap.hpp"
+
+#include "InstrBufferx64.hpp"
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+
+using namespace ll;
+
+namespace {
+    //mov rax, value; ret
+    InstrBufferx64 return_value(uint64_t value) {
+        InstrBufferx64 b;
+        b.mov_r64_imm64(InstrBufferx64::Register::RAX, value);
+        b.ret();
+        return b;
+    }
+
+    //throws from the nth protection change, counting from 1
+    class FailingCodeHeap : public CodeHeap {
+    public:
+        int failOn = 0;
+        int calls = 0;
+
+    private:
+        void protect(std::byte* address, std::size_t size, int protection) override {
+            if (++calls == failOn) {
+                throw std::runtime_error("Unable to change protection of JIT code.");
+            }
+            CodeHeap::protect(address, size, protection);
+        }
+    };
+
+    void expect_same_stats(const CodeHeap::Stats& a, const CodeHeap::Stats& b) {
+        EXPECT_EQ(a.chunks, b.chunks);
+        EXPECT_EQ(a.reservedBytes, b.reservedBytes);
+        EXPECT_EQ(a.usedBytes, b.usedBytes);
+        EXPECT_EQ(a.allocations, b.allocations);
+        EXPECT_EQ(a.freeBytes, b.freeBytes);
+        EXPECT_EQ(a.freeBlocks, b.freeBlocks);
+        EXPECT_EQ(a.largestFreeBlock, b.largestFreeBlock);
+    }
+}
+
+TEST(CodeHeap, allocate_and_call) {
+    CodeHeap heap;
+    auto code = heap.allocate(return_value(42).buffer());
+    ASSERT_TRUE(code);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(code.address()) % heap.page_size(), 0);
+    EXPECT_EQ(code.size(), heap.page_size());
+    EXPECT_EQ(reinterpret_cast<uint64_t(*)()>(code.address())(), 42);
+
+    auto stats = heap.stats();
+    EXPECT_EQ(stats.chunks, 1);
+    EXPECT_EQ(stats.allocations, 1);
+    EXPECT_EQ(stats.usedBytes, heap.page_size());
+    EXPECT_EQ(stats.reservedBytes, CodeHeap::ChunkSize);
+}
+
+TEST(CodeHeap, release_recycles_pages) {
+    CodeHeap heap;
+    void* first = nullptr;
+    {
+        auto code = heap.allocate(return_value(1).buffer());
+        first = code.address();
+    }
+    EXPECT_EQ(heap.stats().allocations, 0);
+    EXPECT_EQ(heap.stats().usedBytes, 0);
+    EXPECT_EQ(heap.stats().freeBlocks, 1);
+
+    auto code = heap.allocate(return_value(2).buffer());
+    EXPECT_EQ(code.address(), first);
+    EXPECT_EQ(reinterpret_cast<uint64_t(*)()>(code.address())(), 2);
+}
+
+TEST(CodeHeap, fragmentation_and_coalescing) {
+    CodeHeap heap;
+    auto a = heap.allocate(return_value(1).buffer());
+    auto b = heap.allocate(return_value(2).buffer());
+    auto c = heap.allocate(return_value(3).buffer());
+    EXPECT_EQ(heap.stats().fragmentation(), 0.0);
+
+    b.reset();
+    auto stats = heap.stats();
+    EXPECT_EQ(stats.freeBlocks, 2);
+    EXPECT_GT(stats.fragmentation(), 0.0);
+
+    a.reset();
+    c.reset();
+    stats = heap.stats();
+    EXPECT_EQ(stats.freeBlocks, 1);
+    EXPECT_EQ(stats.freeBytes, CodeHeap::ChunkSize);
+    EXPECT_EQ(stats.fragmentation(), 0.0);
+}
+
+TEST(CodeHeap, large_allocation_gets_own_chunk) {
+    CodeHeap heap;
+    auto small = heap.allocate(return_value(1).buffer());
+
+    std::vector<uint8_t> big(CodeHeap::ChunkSize + 1, 0xc3);
+    {
+        auto code = heap.allocate(big);
+        EXPECT_EQ(heap.stats().chunks, 2);
+        EXPECT_GT(code.size(), CodeHeap::ChunkSize);
+    }
+
+    //empty chunks are unmapped while another chunk remains
+    EXPECT_EQ(heap.stats().chunks, 1);
+}
+
+TEST(CodeHeap, code_is_not_writable) {
+    CodeHeap heap;
+    auto code = heap.allocate(return_value(1).buffer());
+    EXPECT_DEATH({
+        *static_cast<volatile uint8_t*>(code.address()) = 0xcc;
+    }, "");
+}
+
+TEST(CodeHeap, execute_reuses_memory) {
+    auto before = CodeHeap::process().stats();
+    for (int i = 0; i < 100; i++) {
+        auto b = return_value(i);
+        b.execute();
+    }
+    auto after = CodeHeap::process().stats();
+
+    EXPECT_EQ(after.allocations, before.allocations);
+    EXPECT_LE(after.chunks, std::max<size_t>(before.chunks, 1));
+}
+
+TEST(CodeHeap, failed_protect_returns_block) {
+    //fail making the pages writable, then making them executable
+    for (int failOn : {1, 2}) {
+        FailingCodeHeap heap;
+        auto kept = heap.allocate(return_value(1).buffer());
+        auto before = heap.stats();
+
+        heap.calls = 0;
+        heap.failOn = failOn;
+        EXPECT_THROW(heap.allocate(return_value(2).buffer()), std::runtime_error);
+        expect_same_stats(heap.stats(), before);
+
+        //the block is usable again
+        heap.failOn = 0;
+        auto code = heap.allocate(return_value(3).buffer());
+        EXPECT_EQ(reinterpret_cast<uint64_t(*)()>(code.address())(), 3);
+    }
+}
+
+TEST(CodeHeap, failed_protect_unmaps_empty_chunk) {
+    FailingCodeHeap heap;
+    auto small = heap.allocate(return_value(1).buffer());
+    auto before = heap.stats();
+
+    heap.calls = 0;
+    heap.failOn = 2;
+    std::vector<uint8_t> big(CodeHeap::ChunkSize + 1, 0xc3);
+    EXPECT_THROW(heap.allocate(big), std::runtime_error);
+    expect_same_stats(heap.stats(), before);
+}
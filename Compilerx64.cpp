@@ -8,107 +8,294 @@
 #include "Parser.hpp"
 #include "InstrBufferx64.hpp"
 
-#include <dlfcn.h>
+#include <algorithm>
+#include <array>
+#include <bit>
 #include <expected>
+#include <limits>
 #include <map>
 #include <ranges>
 #include <sstream>
 
-Compiler_x64::Compiler_x64(Block* block, InstrBufferx64* buff, Mode mode)
+Compiler_x64::Compiler_x64(Block* block, InstrBufferx64* buff, Mode mode, SymbolResolver* symbols, const ll::SourceLines* lines)
 : _block(block)
 , _buff(buff)
 , _mode(mode)
+, _symbols(symbols ? symbols : &SymbolResolver::process())
+, _lines(lines)
 {
 }
 
 void Compiler_x64::compile_function() {
+    RegisterAllocatorx64 allocator;
+    allocator.allocate(*_block);
+    _registers = &allocator;
+    _return = _buff->new_label();
+    std::uint32_t statements = 0;
+    _statementNumber = &statements;
+
     compile_function_prefix();
     compile_block();
+    _buff->bind(*_return);
     compile_function_suffix();
+    _buff->peephole();
+    _buff->relax();
+
+    _registers = nullptr;
+    _return.reset();
+    _statementNumber = nullptr;
+}
+
+Compiler_x64 Compiler_x64::nested(Block* block) const {
+    Compiler_x64 compiler(block, _buff, _mode, _symbols, _lines);
+    compiler._registers = _registers;
+    compiler._return = _return;
+    compiler._statementNumber = _statementNumber;
+    return compiler;
+}
+
+bool Compiler_x64::needs_alignment_pad() const {
+    return _registers && (_registers->used_registers().size() % 2) != 0;
+}
+
+InstrBufferx64::Register Compiler_x64::next_scratch(InstrBufferx64::Register reg) {
+    //long chains of additions walk up the registers, never into the stack ones
+    //or the callee saved ones that may hold variables the chain still reads
+    auto reserved = [] (InstrBufferx64::Register reg) {
+        return reg == InstrBufferx64::Register::RSP || reg == InstrBufferx64::Register::RBP
+            || std::ranges::find(RegisterAllocatorx64::CalleeSaved, reg) != RegisterAllocatorx64::CalleeSaved.end();
+    };
+    do {
+        reg = static_cast<InstrBufferx64::Register>((static_cast<int>(reg) + 1) % 16);
+    } while (reserved(reg));
+    return reg;
+}
+
+bool Compiler_x64::contains_call(const Param* param) {
+    auto statementParam = node_cast<const StatementParam>(param);
+    if (statementParam == nullptr) {
+        return false;
+    }
+
+    if (auto calc = node_cast<const Int64Calcuation>(statementParam->statement)) {
+        return contains_call(calc->lhs) || contains_call(calc->rhs);
+    }
+    return statementParam->statement->kind == NodeKind::FunctionCall;
 }
 
 void Compiler_x64::compile_function_prefix() {
+    //callee saved registers go above rbp so stack variable offsets are unchanged
+    if (_registers) {
+        for (auto reg : _registers->used_registers()) {
+            _buff->push(reg);
+        }
+    }
+    if (needs_alignment_pad()) {
+        _buff->sub(InstrBufferx64::Register::RSP, 8);
+    }
+
     _buff->push(InstrBufferx64::Register::RBP);
     _buff->mov_r64_r64(InstrBufferx64::Register::RBP, InstrBufferx64::Register::RSP);
 }
 
 void Compiler_x64::compile_function_suffix() {
     _buff->pop(InstrBufferx64::Register::RBP);
+
+    if (needs_alignment_pad()) {
+        _buff->add_r64_imm32(InstrBufferx64::Register::RSP, 8);
+    }
+    if (_registers) {
+        for (auto reg : std::ranges::reverse_view{_registers->used_registers()}) {
+            _buff->pop(reg);
+        }
+    }
+
     _buff->ret();
 }
 
 void Compiler_x64::compile_block() {
     compile_block_prefix();
+    if (_block->parameters != 0) {
+        compile_parameters();
+    }
 
-    for (auto& statement : _block->statements) {
-        auto call = dynamic_cast<FunctionCall*>(statement.get());
-        if (call != nullptr) {
-            compile_function_call(*call);
-            continue;
+    for (auto statement : _block->statements) {
+        if (_statementNumber) {
+            _buff->mark_statement(++*_statementNumber, _lines ? _lines->line(statement->span.offset) : 0);
         }
 
-        auto assign = dynamic_cast<VariableAssignment*>(statement.get());
-        if (assign != nullptr) {
-            compile_assignment(*assign);
-            continue;
-        }
+        switch (statement->kind) {
+            case NodeKind::FunctionCall:
+                compile_function_call(*static_cast<FunctionCall*>(statement));
+                break;
 
-        auto ifchain = dynamic_cast<IfChainStatement*>(statement.get());
-        if (ifchain != nullptr) {
-            compile_if_chain(ifchain);
-            continue;
-        }
+            case NodeKind::VariableAssignment:
+                compile_assignment(*static_cast<VariableAssignment*>(statement));
+                break;
+
+            case NodeKind::IfChainStatement:
+                compile_if_chain(static_cast<IfChainStatement*>(statement));
+                break;
 
-        auto loop = dynamic_cast<LoopStatement*>(statement.get());
-        if (loop != nullptr) {
-            compile_loop(loop);
+            case NodeKind::LoopStatement:
+                compile_loop(static_cast<LoopStatement*>(statement));
+                break;
+
+            case NodeKind::ReturnStatement:
+                compile_return(*static_cast<ReturnStatement*>(statement),
+                    _block->parent == nullptr && statement == _block->statements.back());
+                break;
+
+            default:
+                throw std::runtime_error("unknown statement");
         }
     }
 
     compile_block_suffix();
 }
 
+namespace {
+    constexpr std::array<InstrBufferx64::Register, 6> ArgumentRegisters = {
+        InstrBufferx64::Register::RDI,
+        InstrBufferx64::Register::RSI,
+        InstrBufferx64::Register::RDX,
+        InstrBufferx64::Register::RCX,
+        InstrBufferx64::Register::R8,
+        InstrBufferx64::Register::R9,
+    };
+}
+
+void Compiler_x64::compile_parameters() {
+    using Register = InstrBufferx64::Register;
+
+    //stack arguments start above the return address, saved registers and rbp
+    std::int32_t stackArguments = 16 + (needs_alignment_pad() ? 8 : 0);
+    if (_registers) {
+        stackArguments += 8 * static_cast<std::int32_t>(_registers->used_registers().size());
+    }
+
+    for (size_t i = 0; i < _block->parameters; i++) {
+        auto name = _block->vars[i].name;
+
+        auto src = Register::RAX;
+        if (i < ArgumentRegisters.size()) {
+            src = ArgumentRegisters[i];
+        } else {
+            _buff->mov_r64_stack(src, stackArguments + 8 * static_cast<std::int32_t>(i - ArgumentRegisters.size()));
+        }
+
+        if (auto reg = get_register(name)) {
+            _buff->mov_r64_r64(*reg, src);
+        } else {
+            _buff->mov_stack_r64(get_stack_location(name).value(), src);
+        }
+    }
+}
+
 void Compiler_x64::compile_function_call(const FunctionCall& call) {
-    std::map<size_t, InstrBufferx64::Register> index_to_register({
-        {0, InstrBufferx64::Register::RDI},
-        {1, InstrBufferx64::Register::RSI},
-        {2, InstrBufferx64::Register::RDX},
-        {3, InstrBufferx64::Register::RCX}
-    });
+    using Register = InstrBufferx64::Register;
+
+    auto registerArgs = std::min(call.params.size(), ArgumentRegisters.size());
+    auto stackArgs = static_cast<std::int32_t>(call.params.size() - registerArgs);
 
-    if (call.params.size() > 4) {
-        throw std::runtime_error("More than 4 function arguments not supported.");
+    //rsp must be 16 byte aligned at the call, counting stack arguments and
+    //anything pushed part way through an expression
+    std::int32_t pad = ((_pushed + 8 * stackArgs) % 16) != 0 ? 8 : 0;
+    if (pad != 0) {
+        _buff->sub(Register::RSP, pad);
+        _pushed += pad;
     }
 
-    for (size_t i = 0; i < call.params.size(); i++) {
-        compile_parameter_to_register(call.params[i].get(), index_to_register[i]);
+    for (auto i = call.params.size(); i > registerArgs; i--) {
+        compile_parameter_to_register(call.params[i - 1], Register::RAX);
+        _buff->push(Register::RAX);
+        _pushed += 8;
+    }
+
+    bool nestedCalls = std::any_of(call.params.begin(), call.params.begin() + registerArgs, contains_call);
+    if (nestedCalls) {
+        //a nested call would clobber argument registers that are already
+        //filled, so evaluate every argument first and pop them into place
+        for (auto i = registerArgs; i > 0; i--) {
+            compile_parameter_to_register(call.params[i - 1], Register::RAX);
+            _buff->push(Register::RAX);
+            _pushed += 8;
+        }
+        for (size_t i = 0; i < registerArgs; i++) {
+            _buff->pop(ArgumentRegisters[i]);
+            _pushed -= 8;
+        }
+    } else {
+        for (size_t i = 0; i < registerArgs; i++) {
+            compile_parameter_to_register(call.params[i], ArgumentRegisters[i]);
+        }
     }
 
     if (_mode == Mode::JIT) {
-        void* dlHandle = dlopen(0, RTLD_NOW);
-        void* functionAddr = dlsym(dlHandle, call.functionName.c_str());
+        void* functionAddr = _symbols->resolve(call.functionName);
         if (functionAddr) {
             _buff->mov_r64_imm64(
                 InstrBufferx64::Register::RAX,
                 reinterpret_cast<uint64_t>(functionAddr));
-    
-            _buff->call_r64(InstrBufferx64::Register::RAX);
+            _buff->_jitImports.push_back({
+                .symbol = std::string(call.functionName),
+                .location = _buff->buffer().size() - sizeof(uint64_t)
+            });
+
+            _buff->call_r64(InstrBufferx64::Register::RAX, static_cast<std::uint8_t>(registerArgs));
         } else {
-            _buff->call_rel32(0);
+            _buff->call_rel32(0, static_cast<std::uint8_t>(registerArgs));
             _buff->_externFuncs.push_back({
-                .symbol = call.functionName,
+                .symbol = std::string(call.functionName),
                 .location = _buff->buffer().size() - sizeof(int32_t)
             });
         }
     } else if (_mode == Mode::ObjectFile) {
-        _buff->call_rel32(0);
+        _buff->call_rel32(0, static_cast<std::uint8_t>(registerArgs));
         _buff->_externFuncs.push_back({
-            .symbol = call.functionName,
+            .symbol = std::string(call.functionName),
             .location = _buff->buffer().size() - sizeof(int32_t)
         });
     } else {
         throw std::runtime_error("unhandled mode");
     }
+
+    auto cleanup = 8 * stackArgs + pad;
+    if (cleanup != 0) {
+        _buff->add_r64_imm32(Register::RSP, cleanup);
+        _pushed -= cleanup;
+    }
+}
+
+void Compiler_x64::compile_call_expression(const FunctionCall& call, InstrBufferx64::Register dest) {
+    //partial results of the enclosing expression live in caller saved registers
+    auto saved = _inFlight;
+    push_many_wo(saved, dest);
+    _inFlight.clear();
+
+    compile_function_call(call);
+
+    _inFlight = saved;
+    if (dest != InstrBufferx64::Register::RAX) {
+        _buff->mov_r64_r64(dest, InstrBufferx64::Register::RAX);
+    }
+    pop_many_wo(saved, dest);
+}
+
+void Compiler_x64::compile_return(const ReturnStatement& returnStatement, bool fallsThrough) {
+    if (!_return) {
+        throw std::runtime_error("return outside of a function");
+    }
+
+    if (returnStatement.value) {
+        compile_parameter_to_register(returnStatement.value, InstrBufferx64::Register::RAX);
+    }
+
+    //the last statement of the function reaches the suffix anyway
+    if (!fallsThrough) {
+        _buff->mov_r64_r64(InstrBufferx64::Register::RSP, InstrBufferx64::Register::RBP);
+        _buff->jmp(*_return);
+    }
 }
 
 void Compiler_x64::compile_block_prefix() {
@@ -127,6 +314,46 @@ void Compiler_x64::compile_block_suffix() {
 
 namespace {
 
+struct DivisionMagic {
+    std::int64_t multiplier;
+    std::uint8_t shift;
+};
+
+//signed magic number for division by d >= 2, Hacker's Delight figure 10-1
+DivisionMagic signed_division_magic(std::uint64_t d) {
+    const std::uint64_t two63 = 1ull << 63;
+
+    std::uint64_t anc = two63 - 1 - (two63 % d);
+    std::uint64_t q1 = two63 / anc;
+    std::uint64_t r1 = two63 - q1 * anc;
+    std::uint64_t q2 = two63 / d;
+    std::uint64_t r2 = two63 - q2 * d;
+    std::uint64_t delta = 0;
+    unsigned p = 63;
+
+    do {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= d) {
+            q2++;
+            r2 -= d;
+        }
+        delta = d - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+
+    return {
+        .multiplier = static_cast<std::int64_t>(q2 + 1),
+        .shift = static_cast<std::uint8_t>(p - 64)
+    };
+}
+
 size_t preceeding_block_sizes(Block& block) {
     if (block.parent) {
         return block.stack_size_aligned() + preceeding_block_sizes(*block.parent);
@@ -135,10 +362,10 @@ size_t preceeding_block_sizes(Block& block) {
     }
 }
 
-std::expected<int8_t, std::string> search_block(Block& block, const std::string& variable) {
+std::expected<int32_t, std::string> search_block(Block& block, std::string_view variable) {
     for (size_t i = 0; i < block.vars.size(); i++) {
         if (block.vars[i].name == variable) {
-            return (i + 1) * -8 - preceeding_block_sizes(block);
+            return -static_cast<int32_t>((i + 1) * 8 + preceeding_block_sizes(block));
         }
     }
 
@@ -154,14 +381,23 @@ std::expected<int8_t, std::string> search_block(Block& block, const std::string&
 
 }
 
-std::expected<int8_t, std::string> Compiler_x64::get_stack_location(const std::string& variable) {
+std::expected<int32_t, std::string> Compiler_x64::get_stack_location(std::string_view variable) {
     return search_block(*_block, variable);
 }
 
+std::optional<InstrBufferx64::Register> Compiler_x64::get_register(std::string_view variable) {
+    if (_registers == nullptr) {
+        return std::nullopt;
+    }
+
+    return _registers->register_for(RegisterAllocatorx64::resolve(*_block, variable));
+}
+
 void Compiler_x64::push_many_wo(std::vector<InstrBufferx64::Register> list, InstrBufferx64::Register skip) {
     for (auto reg : list) {
         if (reg != skip) {
             _buff->push(reg);
+            _pushed += 8;
         }
     }
 }
@@ -170,147 +406,237 @@ void Compiler_x64::pop_many_wo(std::vector<InstrBufferx64::Register> list, Instr
     for (auto reg : std::ranges::reverse_view{list}) {
         if (reg != skip) {
             _buff->pop(reg);
+            _pushed -= 8;
         }
     }
 }
 
 void Compiler_x64::compile_parameter_to_register(Param* param, InstrBufferx64::Register dest) {
-    auto int64param = dynamic_cast<Int64Param*>(param);
-    if (int64param) {
-        _buff->mov_r64_imm64(dest, int64param->content);
-        return;
-    }
+    switch (param->kind) {
+        case NodeKind::Int64Param:
+            _buff->mov_r64_imm64(dest, static_cast<Int64Param*>(param)->content);
+            return;
+
+        case NodeKind::StackVariableParam:
+        {
+            auto stackvarparam = static_cast<StackVariableParam*>(param);
+            if (auto reg = get_register(stackvarparam->content)) {
+                _buff->mov_r64_r64(dest, *reg);
+                return;
+            }
 
-    auto stackvarparam = dynamic_cast<StackVariableParam*>(param);
-    if (stackvarparam) {
-        auto assignFromLocation = get_stack_location(stackvarparam->content).value();
-        _buff->mov_r64_stack(dest, assignFromLocation);
-        return;
-    }
+            auto assignFromLocation = get_stack_location(stackvarparam->content).value();
+            _buff->mov_r64_stack(dest, assignFromLocation);
+            return;
+        }
 
-    auto string = dynamic_cast<StringParam*>(param);
-    if (string) {
-        bool imm64 = true;
+        case NodeKind::StringParam:
+        {
+            auto string = static_cast<StringParam*>(param);
+            bool imm64 = true;
 
 #ifdef __linux__
-        imm64 = _mode == Mode::ObjectFile ? false : true;
+            imm64 = _mode == Mode::ObjectFile ? false : true;
 #endif
 
-        if (imm64) {
-            auto cstrAddr = _buff->add_cstring(string->content, _buff->buffer().size() + 2);
-            _buff->mov_r64_imm64(dest, cstrAddr);
-        } else {
-            auto cstrAddr = _buff->add_cstring(string->content, _buff->buffer().size() + 3);
-            _buff->lea_r64_riprel32(dest, 0);
+            if (imm64) {
+                auto cstrAddr = _buff->add_cstring(std::string(string->content), _buff->buffer().size() + 2);
+                _buff->mov_r64_imm64(dest, cstrAddr);
+            } else {
+                _buff->add_cstring(std::string(string->content), _buff->buffer().size() + 3);
+                _buff->lea_r64_riprel32(dest, 0);
+            }
+
+            return;
         }
-        
-        return;
+
+        case NodeKind::StatementParam:
+        {
+            auto statement = static_cast<StatementParam*>(param)->statement;
+            if (statement->kind == NodeKind::FunctionCall) {
+                compile_call_expression(*static_cast<FunctionCall*>(statement), dest);
+                return;
+            }
+            if (statement->kind != NodeKind::Int64Calcuation) {
+                throw std::runtime_error("unknown statement");
+            }
+            compile_calculation(static_cast<Int64Calcuation*>(statement), dest);
+            return;
+        }
+
+        default:
+            throw std::runtime_error("Unknown parameter type.");
     }
+}
 
-    auto statementparam = dynamic_cast<StatementParam*>(param);
-    if (statementparam) {
-        auto int64calc = dynamic_cast<Int64Calcuation*>(statementparam->statement.get());
-        if (int64calc) {
-            switch (int64calc->operation) {
-                case Int64Calcuation::Addition:
-                {
-                    auto destplus = static_cast<InstrBufferx64::Register>(static_cast<int>(dest) + 1);
-                    push_many_wo({dest, destplus}, dest);
+void Compiler_x64::compile_calculation(Int64Calcuation* int64calc, InstrBufferx64::Register dest) {
+    switch (int64calc->operation) {
+        case Int64Calcuation::Addition:
+        {
+            auto destplus = next_scratch(dest);
+            push_many_wo({dest, destplus}, dest);
 
-                    compile_parameter_to_register(int64calc->lhs.get(), dest);
-                    compile_parameter_to_register(int64calc->rhs.get(), destplus);
-                    _buff->add_r64_r64(dest, destplus);
+            compile_parameter_to_register(int64calc->lhs, dest);
+            _inFlight.push_back(dest);
+            compile_parameter_to_register(int64calc->rhs, destplus);
+            _inFlight.pop_back();
+            _buff->add_r64_r64(dest, destplus);
 
-                    pop_many_wo({dest, destplus}, dest);
-                }
-                    return;
+            pop_many_wo({dest, destplus}, dest);
+        }
+            return;
 
-                case Int64Calcuation::Modulo:
-                {
-                    push_many_wo({InstrBufferx64::Register::RAX, InstrBufferx64::Register::RDX, InstrBufferx64::Register::RCX}, dest);
+        case Int64Calcuation::Modulo:
+        {
+            auto divisor = node_cast<Int64Param>(int64calc->rhs);
+            if (divisor && compile_modulo_constant(int64calc->lhs, divisor->content, dest)) {
+                return;
+            }
 
-                    compile_parameter_to_register(int64calc->lhs.get(), InstrBufferx64::Register::RAX);
-                    compile_parameter_to_register(int64calc->rhs.get(), InstrBufferx64::Register::RCX);
+            push_many_wo({InstrBufferx64::Register::RAX, InstrBufferx64::Register::RDX, InstrBufferx64::Register::RCX}, dest);
 
-                    _buff->cqo_idiv_r64(InstrBufferx64::Register::RCX);
-                    _buff->mov_r64_r64(dest, InstrBufferx64::Register::RDX);
+            compile_parameter_to_register(int64calc->lhs, InstrBufferx64::Register::RAX);
+            _inFlight.push_back(InstrBufferx64::Register::RAX);
+            compile_parameter_to_register(int64calc->rhs, InstrBufferx64::Register::RCX);
+            _inFlight.pop_back();
 
-                    pop_many_wo({InstrBufferx64::Register::RAX, InstrBufferx64::Register::RDX, InstrBufferx64::Register::RCX}, dest);
-                }
-                    return;
+            _buff->cqo_idiv_r64(InstrBufferx64::Register::RCX);
+            _buff->mov_r64_r64(dest, InstrBufferx64::Register::RDX);
 
-                default:
-                    throw std::runtime_error("unknown operation");
-                    return;
-            }
-        } else {
-            throw std::runtime_error("unknown statement");
+            pop_many_wo({InstrBufferx64::Register::RAX, InstrBufferx64::Register::RDX, InstrBufferx64::Register::RCX}, dest);
         }
+            return;
+
+        default:
+            throw std::runtime_error("unknown operation");
+    }
+}
+
+bool Compiler_x64::compile_modulo_constant(Param* lhs, std::int64_t divisor, InstrBufferx64::Register dest) {
+    using Register = InstrBufferx64::Register;
+
+    //division by zero should still fault at runtime
+    if (divisor == 0 || divisor == std::numeric_limits<std::int64_t>::min()) {
+        return false;
+    }
+
+    //the remainder takes the sign of the dividend, so n % -d == n % d
+    std::uint64_t d = divisor < 0 ? -divisor : divisor;
+
+    if (d == 1) {
+        _buff->mov_r64_imm64(dest, 0);
+        return true;
+    }
+
+    if (std::has_single_bit(d) && d <= (1ull << 31)) {
+        //r = ((n + bias) & (d - 1)) - bias, bias is d - 1 for negative n
+        auto k = std::countr_zero(d);
+        push_many_wo({Register::RAX, Register::RCX}, dest);
+
+        compile_parameter_to_register(lhs, Register::RAX);
+        _buff->mov_r64_r64(Register::RCX, Register::RAX);
+        _buff->sar_r64_imm8(Register::RCX, 63);
+        _buff->shr_r64_imm8(Register::RCX, 64 - k);
+        _buff->add_r64_r64(Register::RAX, Register::RCX);
+        _buff->and_r64_imm32(Register::RAX, static_cast<std::int32_t>(d - 1));
+        _buff->sub_r64_r64(Register::RAX, Register::RCX);
+        if (dest != Register::RAX) {
+            _buff->mov_r64_r64(dest, Register::RAX);
+        }
+
+        pop_many_wo({Register::RAX, Register::RCX}, dest);
+        return true;
+    }
+
+    //q = n / d via multiply high, then r = n - q * d
+    auto magic = signed_division_magic(d);
+    push_many_wo({Register::RAX, Register::RDX, Register::RCX}, dest);
+
+    compile_parameter_to_register(lhs, Register::RCX);
+    _buff->mov_r64_imm64(Register::RAX, magic.multiplier);
+    _buff->imul_r64(Register::RCX);
+    if (magic.multiplier < 0) {
+        _buff->add_r64_r64(Register::RDX, Register::RCX);
+    }
+    if (magic.shift != 0) {
+        _buff->sar_r64_imm8(Register::RDX, magic.shift);
     }
+    _buff->mov_r64_r64(Register::RAX, Register::RDX);
+    _buff->shr_r64_imm8(Register::RAX, 63);
+    _buff->add_r64_r64(Register::RDX, Register::RAX);
 
-    throw std::runtime_error("Unknown parameter type.");
+    if (d <= static_cast<std::uint64_t>(std::numeric_limits<std::int32_t>::max())) {
+        _buff->imul_r64_r64_imm32(Register::RDX, Register::RDX, static_cast<std::int32_t>(d));
+    } else {
+        _buff->mov_r64_imm64(Register::RAX, d);
+        _buff->imul_r64_r64(Register::RDX, Register::RAX);
+    }
+    _buff->sub_r64_r64(Register::RCX, Register::RDX);
+    if (dest != Register::RCX) {
+        _buff->mov_r64_r64(dest, Register::RCX);
+    }
+
+    pop_many_wo({Register::RAX, Register::RDX, Register::RCX}, dest);
+    return true;
 }
 
 void Compiler_x64::compile_assignment(const VariableAssignment& assignment) {
     auto assignToLocation = get_stack_location(assignment.to.content).value();
 
-    compile_parameter_to_register(assignment.value.get(), InstrBufferx64::Register::RAX);
-    
-    _buff->mov_stack_r64(assignToLocation, InstrBufferx64::Register::RAX);
+    compile_parameter_to_register(assignment.value, InstrBufferx64::Register::RAX);
+
+    if (auto reg = get_register(assignment.to.content)) {
+        _buff->mov_r64_r64(*reg, InstrBufferx64::Register::RAX);
+    } else {
+        _buff->mov_stack_r64(assignToLocation, InstrBufferx64::Register::RAX);
+    }
 }
 
 void Compiler_x64::compile_if_chain(IfChainStatement* chain) {
-    std::vector<InstrBufferx64::JmpUpdate*> updates;
+    auto chainEnd = _buff->new_label();
 
     for (size_t i = 0; i < chain->_ifstatements.size(); i++) {
         auto& ifStatement = chain->_ifstatements[i];
-        InstrBufferx64 statementBuff;
-        Compiler_x64 statementCompiler(ifStatement->block.get(), &statementBuff, _mode);
-        statementCompiler.compile_block();
-        if (i != (chain->_ifstatements.size() - 1)) {
-            updates.push_back(statementBuff.jmp_with_update());
-        }
-        auto blockSize = statementBuff.buffer().size();
+        auto next = _buff->new_label();
 
         if (ifStatement->comparator != IfStatement::None) {
-            compile_comparator(ifStatement.get(), blockSize);
+            compile_comparator(ifStatement, next);
         }
-        
-        _buff->append_buffer(statementBuff);
-    }
 
-    auto chainEnd = _buff->buffer().size();
-    for (auto update : updates) {
-        _buff->update_jmp(update, chainEnd - update->location);
+        nested(ifStatement->block).compile_block();
+        if (i != (chain->_ifstatements.size() - 1)) {
+            _buff->jmp(chainEnd);
+        }
+        _buff->bind(next);
     }
+
+    _buff->bind(chainEnd);
 }
 
 void Compiler_x64::compile_loop(LoopStatement* loop) {
-    InstrBufferx64::JmpUpdate* update = nullptr;
     auto& ifStatement = loop->_ifStatement;
-    size_t beforeLoopStatementSize = _buff->buffer().size();
-    
-    InstrBufferx64 statementBuff;
-    Compiler_x64 statementCompiler(ifStatement->block.get(), &statementBuff, _mode);
-    statementCompiler.compile_block();
-    update = statementBuff.jmp_with_update();
-    auto blockSize = statementBuff.buffer().size();
-
-    compile_comparator(ifStatement.get(), blockSize);
-    
-    _buff->append_buffer(statementBuff);
-    _buff->update_jmp(update, beforeLoopStatementSize - _buff->buffer().size());
+    auto loopStart = _buff->new_label();
+    auto loopEnd = _buff->new_label();
+    _buff->bind(loopStart);
+
+    compile_comparator(ifStatement, loopEnd);
+    nested(ifStatement->block).compile_block();
+
+    _buff->jmp(loopStart);
+    _buff->bind(loopEnd);
 }
 
-void Compiler_x64::compile_comparator(IfStatement* comparison, int32_t offset) {
-    compile_parameter_to_register(comparison->lhs.get(), InstrBufferx64::Register::RAX);
-    compile_parameter_to_register(comparison->rhs.get(), InstrBufferx64::Register::RCX);
+void Compiler_x64::compile_comparator(IfStatement* comparison, InstrBufferx64::Label skip) {
+    compile_parameter_to_register(comparison->lhs, InstrBufferx64::Register::RAX);
+    _inFlight.push_back(InstrBufferx64::Register::RAX);
+    compile_parameter_to_register(comparison->rhs, InstrBufferx64::Register::RCX);
+    _inFlight.pop_back();
     _buff->cmp(InstrBufferx64::Register::RAX, InstrBufferx64::Register::RCX);
 
     if (comparison->comparator == IfStatement::Equal) {
-        _buff->jmp_not_equal(offset);
+        _buff->jmp_if(InstrBufferx64::Condition::NotEqual, skip);
     } else if (comparison->comparator == IfStatement::LessThan) {
-        _buff->jmp_greater_or_equal(offset);
+        _buff->jmp_if(InstrBufferx64::Condition::GreaterOrEqual, skip);
     } else {
         throw std::runtime_error("unhandled comparator");
     }
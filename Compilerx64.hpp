@@ -6,9 +6,14 @@
 #pragma once
 
 #include "InstrBufferx64.hpp"
+#include "RegisterAllocatorx64.hpp"
+#include "SourceLines.hpp"
 #include "Statement.hpp"
+#include "SymbolResolver.hpp"
 
 #include <expected>
+#include <optional>
+#include <vector>
 
 class Compiler_x64 {
 
@@ -22,9 +27,23 @@ private:
     Block* _block = nullptr;
     InstrBufferx64* _buff = nullptr;
     Mode _mode = Mode::JIT;
+    const RegisterAllocatorx64* _registers = nullptr;
+    SymbolResolver* _symbols = nullptr;
+    const ll::SourceLines* _lines = nullptr;
+    //bound ahead of the function suffix, where every return jumps to
+    std::optional<InstrBufferx64::Label> _return;
+    //bytes pushed while evaluating the current expression, so calls made in
+    //the middle of it can still align the stack
+    std::int32_t _pushed = 0;
+    //scratch registers holding partial results a nested call must preserve
+    std::vector<InstrBufferx64::Register> _inFlight;
+    //last statement number handed out in the function being compiled
+    std::uint32_t* _statementNumber = nullptr;
 
 public:
-    Compiler_x64(Block* block, InstrBufferx64* buff, Mode mode = Mode::JIT);
+    //JIT calls resolve through the process wide SymbolResolver unless one is
+    //given. Statement marks carry source lines when the block's lines are given.
+    Compiler_x64(Block* block, InstrBufferx64* buff, Mode mode = Mode::JIT, SymbolResolver* symbols = nullptr, const ll::SourceLines* lines = nullptr);
 
     void compile_function();
     void compile_block();
@@ -32,16 +51,29 @@ public:
     void compile_function_prefix();
     void compile_block_prefix();
     void compile_assignment(const VariableAssignment& assignment);
+    void compile_parameters();
     void compile_function_call(const FunctionCall& call);
+    void compile_call_expression(const FunctionCall& call, InstrBufferx64::Register dest);
+    void compile_return(const ReturnStatement& returnStatement, bool fallsThrough);
     void compile_parameter_to_register(Param* param, InstrBufferx64::Register dest);
+    void compile_calculation(Int64Calcuation* calc, InstrBufferx64::Register dest);
+    bool compile_modulo_constant(Param* lhs, std::int64_t divisor, InstrBufferx64::Register dest);
     void compile_if_chain(IfChainStatement* chain);
     void compile_loop(LoopStatement* loop);
-    void compile_comparator(IfStatement* comparison, int32_t offset);
+    void compile_comparator(IfStatement* comparison, InstrBufferx64::Label skip);
     void compile_block_suffix();
     void compile_function_suffix();
 
-    std::expected<int8_t, std::string> get_stack_location(const std::string& variable);
+    std::expected<int32_t, std::string> get_stack_location(std::string_view variable);
+    std::optional<InstrBufferx64::Register> get_register(std::string_view variable);
     
     void push_many_wo(std::vector<InstrBufferx64::Register> list, InstrBufferx64::Register skip);
     void pop_many_wo(std::vector<InstrBufferx64::Register> list, InstrBufferx64::Register skip);
+
+private:
+    //compiles a child block into the same buffer with the same allocation
+    Compiler_x64 nested(Block* block) const;
+    bool needs_alignment_pad() const;
+    static InstrBufferx64::Register next_scratch(InstrBufferx64::Register reg);
+    static bool contains_call(const Param* param);
 };
@@ -5,6 +5,8 @@
 
 #include "Compilerx64.hpp"
 
+#include "Arena.hpp"
+
 #include <gtest/gtest.h>
 
 TEST(Compilerx64ObjectTests, compile_function_call) {
@@ -32,12 +34,13 @@ TEST(Compilerx64ObjectTests, compile_function_call) {
 }
 
 TEST(Compilerx64ObjectTests, compile_function_call_intparam) {
+    ll::Arena arena;
     FunctionCall call;
     call.functionName = "puts";
 
-    auto intparam = std::make_unique<Int64Param>();
+    auto intparam = arena.make<Int64Param>();
     intparam->content = 0xaabbccddeeffaabb;
-    call.params.push_back(std::move(intparam));
+    call.params.push_back(intparam);
 
     Block block;
     InstrBufferx64 buffer;
@@ -10,15 +10,17 @@
 
 #include <dlfcn.h>
 #include <expected>
+#include <limits>
 #include <gtest/gtest.h>
 
 TEST(Compilerx64Tests, compile_function_call_with_intparam) {
+    ll::Arena arena;
     FunctionCall call;
     call.functionName = "puts";
 
-    auto intparam = std::make_unique<Int64Param>();
+    auto intparam = arena.make<Int64Param>();
     intparam->content = 0xaabbccddeeffaabb;
-    call.params.push_back(std::move(intparam));
+    call.params.push_back(intparam);
 
     Block block;
     InstrBufferx64 buffer;
@@ -41,12 +43,13 @@ TEST(Compilerx64Tests, compile_function_call_with_intparam) {
 }
 
 TEST(Compilerx64Tests, compile_function_call_jit_with_stringparam) {
+    ll::Arena arena;
     FunctionCall call;
     call.functionName = "puts";
 
-    auto stringparam = std::make_unique<StringParam>();
+    auto stringparam = arena.make<StringParam>();
     stringparam->content = "string";
-    call.params.push_back(std::move(stringparam));
+    call.params.push_back(stringparam);
 
     Block block;
     InstrBufferx64 buffer;
@@ -78,12 +81,13 @@ TEST(Compilerx64Tests, compile_function_call_jit_with_stringparam) {
 }
 
 TEST(Compilerx64Tests, compile_function_call_objectfile_with_stringparam) {
+    ll::Arena arena;
     FunctionCall call;
     call.functionName = "puts";
 
-    auto stringparam = std::make_unique<StringParam>();
+    auto stringparam = arena.make<StringParam>();
     stringparam->content = "string";
-    call.params.push_back(std::move(stringparam));
+    call.params.push_back(stringparam);
 
     Block block;
     InstrBufferx64 buffer;
@@ -110,22 +114,23 @@ TEST(Compilerx64Tests, compile_function_call_objectfile_with_stringparam) {
     EXPECT_EQ(
         buffer._externFuncs.front(),
         InstrBufferx64::ExternFunction({
-            .symbol = call.functionName,
+            .symbol = std::string(call.functionName),
             .location = 11
         }));
 }
 
 TEST(Compilerx64Tests, compile_multi_args) {
+    ll::Arena arena;
     FunctionCall call;
     call.functionName = "puts";
 
-    auto intparam1 = std::make_unique<Int64Param>();
+    auto intparam1 = arena.make<Int64Param>();
     intparam1->content = 1234;
-    call.params.push_back(std::move(intparam1));
+    call.params.push_back(intparam1);
 
-    auto intparam2 = std::make_unique<Int64Param>();
+    auto intparam2 = arena.make<Int64Param>();
     intparam2->content = 1234;
-    call.params.push_back(std::move(intparam2));
+    call.params.push_back(intparam2);
 
     Block block;
     InstrBufferx64 buffer;
@@ -167,7 +172,7 @@ TEST(Compilerx64Tests, compile_local_function_jit_no_arguments) {
     EXPECT_EQ(
         buffer._externFuncs.front(),
         InstrBufferx64::ExternFunction({
-        .symbol = call.functionName,
+        .symbol = std::string(call.functionName),
         .location = 1
         }));
 }
@@ -190,7 +195,7 @@ TEST(Compilerx64Tests, compile_local_function_objectfile_no_arguments) {
     EXPECT_EQ(
         buffer._externFuncs.front(),
         InstrBufferx64::ExternFunction({
-        .symbol = call.functionName,
+        .symbol = std::string(call.functionName),
         .location = 1
         }));
 }
@@ -340,6 +345,7 @@ TEST(Compilerx64Tests, compile_block_suffix_16byte_stack) {
 }
 
 TEST(Compilerx64Tests, compile_assignment_const_int64) {
+    ll::Arena arena;
     Block block;
 
     VariableDefinition def;
@@ -347,13 +353,13 @@ TEST(Compilerx64Tests, compile_assignment_const_int64) {
     def.type = VariableDefinition::Int64;
     block.vars.push_back(def);
 
-    auto assign = std::make_unique<VariableAssignment>();
-    VariableAssignment* rawAssign = assign.get();
+    auto assign = arena.make<VariableAssignment>();
+    VariableAssignment* rawAssign = assign;
     assign->to.content = "test";
-    auto value = std::make_unique<Int64Param>();
+    auto value = arena.make<Int64Param>();
     value->content = 1234;
-    assign->value = std::move(value);
-    block.statements.push_back(std::move(assign));
+    assign->value = value;
+    block.statements.push_back(assign);
 
     InstrBufferx64 buffer;
     auto compiler = Compiler_x64(&block, &buffer);
@@ -369,15 +375,16 @@ TEST(Compilerx64Tests, compile_assignment_const_int64) {
 }
 
 TEST(Compilerx64Tests, compile_assignment_no_var) {
+    ll::Arena arena;
     Block block;
 
-    auto assign = std::make_unique<VariableAssignment>();
-    VariableAssignment* rawAssign = assign.get();
+    auto assign = arena.make<VariableAssignment>();
+    VariableAssignment* rawAssign = assign;
     assign->to.content = "test";
-    auto value = std::make_unique<Int64Param>();
+    auto value = arena.make<Int64Param>();
     value->content = 1234;
-    assign->value = std::move(value);
-    block.statements.push_back(std::move(assign));
+    assign->value = value;
+    block.statements.push_back(assign);
 
     InstrBufferx64 buffer;
     auto compiler = Compiler_x64(&block, &buffer);
@@ -385,6 +392,7 @@ TEST(Compilerx64Tests, compile_assignment_no_var) {
 }
 
 TEST(Compilerx64Tests, compile_assignment_const_int64_by_two) {
+    ll::Arena arena;
     Block block;
 
     VariableDefinition def;
@@ -397,13 +405,13 @@ TEST(Compilerx64Tests, compile_assignment_const_int64_by_two) {
     def2.type = VariableDefinition::Int64;
     block.vars.push_back(def2);
 
-    auto assign = std::make_unique<VariableAssignment>();
-    VariableAssignment* rawAssign = assign.get();
+    auto assign = arena.make<VariableAssignment>();
+    VariableAssignment* rawAssign = assign;
     assign->to.content = "test2";
-    auto value = std::make_unique<Int64Param>();
+    auto value = arena.make<Int64Param>();
     value->content = 1234;
-    assign->value = std::move(value);
-    block.statements.push_back(std::move(assign));
+    assign->value = value;
+    block.statements.push_back(assign);
 
     InstrBufferx64 buffer;
     auto compiler = Compiler_x64(&block, &buffer);
@@ -419,6 +427,7 @@ TEST(Compilerx64Tests, compile_assignment_const_int64_by_two) {
 }
 
 TEST(Compilerx64Tests, compile_assignment_stack_var) {
+    ll::Arena arena;
     Block block;
 
     VariableDefinition def;
@@ -431,13 +440,13 @@ TEST(Compilerx64Tests, compile_assignment_stack_var) {
     def2.type = VariableDefinition::Int64;
     block.vars.push_back(def2);
 
-    auto assign = std::make_unique<VariableAssignment>();
-    VariableAssignment* rawAssign = assign.get();
+    auto assign = arena.make<VariableAssignment>();
+    VariableAssignment* rawAssign = assign;
     assign->to.content = "test";
-    auto value = std::make_unique<StackVariableParam>();
+    auto value = arena.make<StackVariableParam>();
     value->content = "another";
-    assign->value = std::move(value);
-    block.statements.push_back(std::move(assign));
+    assign->value = value;
+    block.statements.push_back(assign);
 
     InstrBufferx64 buffer;
     auto compiler = Compiler_x64(&block, &buffer);
@@ -453,6 +462,7 @@ TEST(Compilerx64Tests, compile_assignment_stack_var) {
 }
 
 TEST(Compilerx64Tests, compile_assignment_int_const_operation_addition) {
+    ll::Arena arena;
     Block block;
 
     VariableDefinition def;
@@ -460,25 +470,25 @@ TEST(Compilerx64Tests, compile_assignment_int_const_operation_addition) {
     def.type = VariableDefinition::Int64;
     block.vars.push_back(def);
 
-    auto assign = std::make_unique<VariableAssignment>();
-    VariableAssignment* rawAssign = assign.get();
+    auto assign = arena.make<VariableAssignment>();
+    VariableAssignment* rawAssign = assign;
     assign->to.content = "test";
 
-    auto statementParam = std::make_unique<StatementParam>();
-    auto int64calc = std::make_unique<Int64Calcuation>();
+    auto statementParam = arena.make<StatementParam>();
+    auto int64calc = arena.make<Int64Calcuation>();
     int64calc->set_op_from_char('+');
     
-    auto lhs = std::make_unique<Int64Param>();
+    auto lhs = arena.make<Int64Param>();
     lhs->content = 1;
-    int64calc->lhs = std::move(lhs);
+    int64calc->lhs = lhs;
 
-    auto rhs = std::make_unique<Int64Param>();
+    auto rhs = arena.make<Int64Param>();
     rhs->content = 2;
-    int64calc->rhs = std::move(rhs);
+    int64calc->rhs = rhs;
 
-    statementParam->statement = std::move(int64calc);
-    assign->value = std::move(statementParam);
-    block.statements.push_back(std::move(assign));
+    statementParam->statement = int64calc;
+    assign->value = statementParam;
+    block.statements.push_back(assign);
 
     InstrBufferx64 buffer;
     auto compiler = Compiler_x64(&block, &buffer);
@@ -498,6 +508,7 @@ TEST(Compilerx64Tests, compile_assignment_int_const_operation_addition) {
 }
 
 TEST(Compilerx64Tests, compile_assignment_operation_int_const_addition_stack_var) {
+    ll::Arena arena;
     Block block;
 
     VariableDefinition def;
@@ -510,25 +521,25 @@ TEST(Compilerx64Tests, compile_assignment_operation_int_const_addition_stack_var
     def2.type = VariableDefinition::Int64;
     block.vars.push_back(def2);
 
-    auto assign = std::make_unique<VariableAssignment>();
-    VariableAssignment* rawAssign = assign.get();
+    auto assign = arena.make<VariableAssignment>();
+    VariableAssignment* rawAssign = assign;
     assign->to.content = "test";
 
-    auto statementParam = std::make_unique<StatementParam>();
-    auto int64calc = std::make_unique<Int64Calcuation>();
+    auto statementParam = arena.make<StatementParam>();
+    auto int64calc = arena.make<Int64Calcuation>();
     int64calc->set_op_from_char('+');
     
-    auto lhs = std::make_unique<Int64Param>();
+    auto lhs = arena.make<Int64Param>();
     lhs->content = 1;
-    int64calc->lhs = std::move(lhs);
+    int64calc->lhs = lhs;
 
-    auto rhs = std::make_unique<StackVariableParam>();
+    auto rhs = arena.make<StackVariableParam>();
     rhs->content = "another";
-    int64calc->rhs = std::move(rhs);
+    int64calc->rhs = rhs;
 
-    statementParam->statement = std::move(int64calc);
-    assign->value = std::move(statementParam);
-    block.statements.push_back(std::move(assign));
+    statementParam->statement = int64calc;
+    assign->value = statementParam;
+    block.statements.push_back(assign);
 
     InstrBufferx64 buffer;
     auto compiler = Compiler_x64(&block, &buffer);
@@ -630,6 +641,7 @@ INSTANTIATE_TEST_SUITE_P(Compilex64ParamInt64Test, Compilex64ParamInt64Test, ::t
 ));
 
 TEST(Compilerx64Tests, compile_assignment_int_const_operation_modulo) {
+    ll::Arena arena;
     Block block;
 
     VariableDefinition def;
@@ -637,47 +649,173 @@ TEST(Compilerx64Tests, compile_assignment_int_const_operation_modulo) {
     def.type = VariableDefinition::Int64;
     block.vars.push_back(def);
 
-    auto assign = std::make_unique<VariableAssignment>();
-    VariableAssignment* rawAssign = assign.get();
+    auto assign = arena.make<VariableAssignment>();
+    VariableAssignment* rawAssign = assign;
     assign->to.content = "test";
 
-    auto statementParam = std::make_unique<StatementParam>();
-    auto int64calc = std::make_unique<Int64Calcuation>();
+    auto statementParam = arena.make<StatementParam>();
+    auto int64calc = arena.make<Int64Calcuation>();
     int64calc->set_op_from_char('%');
     
-    auto lhs = std::make_unique<Int64Param>();
+    auto lhs = arena.make<Int64Param>();
     lhs->content = 4;
-    int64calc->lhs = std::move(lhs);
+    int64calc->lhs = lhs;
 
-    auto rhs = std::make_unique<Int64Param>();
+    auto rhs = arena.make<Int64Param>();
     rhs->content = 3;
-    int64calc->rhs = std::move(rhs);
+    int64calc->rhs = rhs;
 
-    statementParam->statement = std::move(int64calc);
-    assign->value = std::move(statementParam);
-    block.statements.push_back(std::move(assign));
+    statementParam->statement = int64calc;
+    assign->value = statementParam;
+    block.statements.push_back(assign);
 
     InstrBufferx64 buffer;
     auto compiler = Compiler_x64(&block, &buffer);
     compiler.compile_assignment(*rawAssign);
 
+    EXPECT_EQ(
+        buffer.buffer(),
+        std::vector<uint8_t>({
+            0xff, 0xf2, //push rdx
+            0xff, 0xf1, //push rcx
+            0x48, 0xb9, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, //mov rcx, 0x4
+            0x48, 0xb8, 0x56, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, 0x55, //mov rax, magic
+            0x48, 0xf7, 0xe9, //imul rcx
+            0x48, 0x89, 0xd0, //mov rax, rdx
+            0x48, 0xc1, 0xe8, 0x3f, //shr rax, 63
+            0x48, 0x03, 0xd0, //add rdx, rax
+            0x48, 0x69, 0xd2, 0x03, 0x00, 0x00, 0x00, //imul rdx, rdx, 3
+            0x48, 0x2b, 0xca, //sub rcx, rdx
+            0x48, 0x89, 0xc8, //mov rax, rcx
+            0x59, //pop rcx
+            0x5a, //pop rdx
+            0x48, 0x89, 0x45, 0xf8 //mov [rbp - 0x8], rax
+        })
+    );
+}
+
+TEST(Compilerx64Tests, compile_assignment_int_var_operation_modulo) {
+    ll::Arena arena;
+    Block block;
+    block.vars.push_back({.name = "test", .type = VariableDefinition::Int64});
+    block.vars.push_back({.name = "divisor", .type = VariableDefinition::Int64});
+
+    auto lhs = arena.make<Int64Param>();
+    lhs->content = 4;
+    auto rhs = arena.make<StackVariableParam>();
+    rhs->content = "divisor";
+
+    auto int64calc = arena.make<Int64Calcuation>();
+    int64calc->set_op_from_char('%');
+    int64calc->lhs = lhs;
+    int64calc->rhs = rhs;
+
+    InstrBufferx64 buffer;
+    auto compiler = Compiler_x64(&block, &buffer);
+    compiler.compile_calculation(int64calc, InstrBufferx64::Register::RAX);
+
     EXPECT_EQ(
         buffer.buffer(),
         std::vector<uint8_t>({
             0xff, 0xf2, //push rdx
             0xff, 0xf1, //push rcx
             0x48, 0xb8, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, //mov rax, 0x4
-            0x48, 0xb9, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, //mov rcx, 0x3
+            0x48, 0x8b, 0x4d, 0xf0, //mov rcx, [rbp - 0x10]
             0x48, 0x99, //cqo
             0x48, 0xf7, 0xf9, //idiv rax, rcx
             0x48, 0x89, 0xd0, //mov rax, rdx
             0x59, //pop rcx
             0x5a, //pop rdx
-            0x48, 0x89, 0x45, 0xf8 //mov [rbp - 0x8], rax
         })
     );
 }
 
+TEST(Compilerx64Tests, compile_modulo_power_of_two) {
+    ll::Arena arena;
+    Block block;
+
+    auto lhs = arena.make<Int64Param>();
+    lhs->content = 13;
+
+    InstrBufferx64 buffer;
+    auto compiler = Compiler_x64(&block, &buffer);
+    EXPECT_TRUE(compiler.compile_modulo_constant(lhs, -8, InstrBufferx64::Register::RDI));
+
+    EXPECT_EQ(
+        buffer.buffer(),
+        std::vector<uint8_t>({
+            0xff, 0xf0, //push rax
+            0xff, 0xf1, //push rcx
+            0x48, 0xb8, 0x0d, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, //mov rax, 0xd
+            0x48, 0x89, 0xc1, //mov rcx, rax
+            0x48, 0xc1, 0xf9, 0x3f, //sar rcx, 63
+            0x48, 0xc1, 0xe9, 0x3d, //shr rcx, 61
+            0x48, 0x03, 0xc1, //add rax, rcx
+            0x48, 0x81, 0xe0, 0x07, 0x00, 0x00, 0x00, //and rax, 7
+            0x48, 0x2b, 0xc1, //sub rax, rcx
+            0x48, 0x89, 0xc7, //mov rdi, rax
+            0x59, //pop rcx
+            0x58, //pop rax
+        })
+    );
+
+    EXPECT_FALSE(compiler.compile_modulo_constant(lhs, 0, InstrBufferx64::Register::RAX));
+}
+
+class Compilex64ModuloConstantTest : public testing::TestWithParam<int64_t> {
+};
+
+TEST_P(Compilex64ModuloConstantTest, matches_idiv) {
+    const int64_t divisor = GetParam();
+    const std::vector<int64_t> dividends = {
+        0, 1, -1, 2, -2, 3, -3, 7, -7, 15, 16, 17, -16, -17, 99, 100, -100,
+        123456789, -123456789, 0x7fffffff, -0x80000000ll, 0x100000000ll,
+        std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::max() - 1,
+        std::numeric_limits<int64_t>::min(), std::numeric_limits<int64_t>::min() + 1,
+    };
+    std::vector<int64_t> results(dividends.size(), 0x5a5a5a5a);
+
+    ll::Arena arena;
+    Block block;
+    block.vars.push_back({.name = "n", .type = VariableDefinition::Int64});
+
+    auto lhs = arena.make<StackVariableParam>();
+    lhs->content = "n";
+    auto rhs = arena.make<Int64Param>();
+    rhs->content = divisor;
+    auto calc = arena.make<Int64Calcuation>();
+    calc->set_op_from_char('%');
+    calc->lhs = lhs;
+    calc->rhs = rhs;
+
+    InstrBufferx64 buffer;
+    auto compiler = Compiler_x64(&block, &buffer);
+    compiler.compile_function_prefix();
+    compiler.compile_block_prefix();
+    for (size_t i = 0; i < dividends.size(); i++) {
+        buffer.mov_r64_imm64(InstrBufferx64::Register::RAX, dividends[i]);
+        buffer.mov_stack_r64(-8, InstrBufferx64::Register::RAX);
+        compiler.compile_calculation(calc, InstrBufferx64::Register::RAX);
+        buffer.mov_r64_imm64(InstrBufferx64::Register::RCX, reinterpret_cast<uint64_t>(&results[i]));
+        buffer.mov_m64_r64({.base = InstrBufferx64::Register::RCX}, InstrBufferx64::Register::RAX);
+    }
+    compiler.compile_block_suffix();
+    compiler.compile_function_suffix();
+    buffer.execute();
+
+    for (size_t i = 0; i < dividends.size(); i++) {
+        auto expected = (dividends[i] == std::numeric_limits<int64_t>::min() && divisor == -1)
+            ? 0 : dividends[i] % divisor;
+        EXPECT_EQ(results[i], expected) << dividends[i] << " % " << divisor;
+    }
+}
+
+INSTANTIATE_TEST_SUITE_P(Compilex64ModuloConstantTest, Compilex64ModuloConstantTest, ::testing::Values(
+    1, -1, 2, 3, -3, 5, 6, 7, -7, 8, 10, 16, -16, 100, 641, 1000000007,
+    1ll << 31, 1ll << 40, (1ll << 40) + 1, -(1ll << 50),
+    std::numeric_limits<int64_t>::max(), std::numeric_limits<int64_t>::min() + 1
+));
+
 TEST(Compilerx64Tests, get_stack_location_one_level) {
     Block block;
 
@@ -718,7 +856,33 @@ TEST(Compilerx64Tests, get_stack_location_two_levels) {
     EXPECT_EQ(compiler_twolevel.get_stack_location("another").value(), -24);
 }
 
+TEST(Compilerx64Tests, get_stack_location_past_16_slots) {
+    Block block;
+    std::vector<std::string> names;
+    for (size_t i = 0; i < 20; i++) {
+        names.push_back("v" + std::to_string(i));
+    }
+    for (auto& name : names) {
+        block.vars.push_back({.name = name, .type = VariableDefinition::Int64});
+    }
+
+    InstrBufferx64 buffer;
+    Compiler_x64 compiler(&block, &buffer);
+    EXPECT_EQ(compiler.get_stack_location("v19").value(), -160);
+
+    StackVariableParam param;
+    param.content = "v19";
+    compiler.compile_parameter_to_register(&param, InstrBufferx64::Register::RAX);
+
+    EXPECT_EQ(
+        buffer.buffer(),
+        std::vector<uint8_t>({
+            0x48, 0x8b, 0x85, 0x60, 0xff, 0xff, 0xff //mov rax, [rbp-0xa0]
+        }));
+}
+
 TEST(Compilerx64Tests, compile_block_with_if_statement) {
+    ll::Arena arena;
     Block block;
 
     VariableDefinition def;
@@ -726,29 +890,29 @@ TEST(Compilerx64Tests, compile_block_with_if_statement) {
     def.type = VariableDefinition::Int64;
     block.vars.push_back(def);
 
-    auto ifchain = std::make_unique<IfChainStatement>();
-    auto ifchainraw = ifchain.get();
-    auto ifstatement = std::make_unique<IfStatement>();
+    auto ifchain = arena.make<IfChainStatement>();
+    auto ifchainraw = ifchain;
+    auto ifstatement = arena.make<IfStatement>();
 
     ifstatement->comparator = IfStatement::Equal;
-    auto stackLhs = std::make_unique<StackVariableParam>();
+    auto stackLhs = arena.make<StackVariableParam>();
     stackLhs->content = "test";
-    ifstatement->lhs = std::move(stackLhs);
-    auto int64Rhs = std::make_unique<Int64Param>();
+    ifstatement->lhs = stackLhs;
+    auto int64Rhs = arena.make<Int64Param>();
     int64Rhs->content = 1234;
-    ifstatement->rhs = std::move(int64Rhs);
+    ifstatement->rhs = int64Rhs;
 
-    auto assign = std::make_unique<VariableAssignment>();
+    auto assign = arena.make<VariableAssignment>();
     assign->to.content = "test";
     
-    auto valueParam = std::make_unique<Int64Param>();
+    auto valueParam = arena.make<Int64Param>();
     valueParam->content = 4;
-    assign->value = std::move(valueParam);
-    ifstatement->block = std::make_unique<Block>();
-    ifstatement->block->statements.push_back(std::move(assign));
+    assign->value = valueParam;
+    ifstatement->block = arena.make<Block>();
+    ifstatement->block->statements.push_back(assign);
     ifstatement->block->parent = &block;
-    ifchain->_ifstatements.push_back(std::move(ifstatement));
-    block.statements.push_back(std::move(ifchain));
+    ifchain->_ifstatements.push_back(ifstatement);
+    block.statements.push_back(ifchain);
 
     InstrBufferx64 buffer;
     auto compiler = Compiler_x64(&block, &buffer);
@@ -768,6 +932,7 @@ TEST(Compilerx64Tests, compile_block_with_if_statement) {
 }
 
 TEST(Compilerx64Tests, compile_block_with_if_else_if_statement) {
+    ll::Arena arena;
     Block block;
 
     VariableDefinition def;
@@ -775,46 +940,46 @@ TEST(Compilerx64Tests, compile_block_with_if_else_if_statement) {
     def.type = VariableDefinition::Int64;
     block.vars.push_back(def);
 
-    auto ifchain = std::make_unique<IfChainStatement>();
-    auto ifchainraw = ifchain.get();
+    auto ifchain = arena.make<IfChainStatement>();
+    auto ifchainraw = ifchain;
 
-    auto ifstatement = std::make_unique<IfStatement>();
+    auto ifstatement = arena.make<IfStatement>();
     ifstatement->comparator = IfStatement::Equal;
-    auto stackLhs = std::make_unique<StackVariableParam>();
+    auto stackLhs = arena.make<StackVariableParam>();
     stackLhs->content = "test";
-    ifstatement->lhs = std::move(stackLhs);
-    auto int64Rhs = std::make_unique<Int64Param>();
+    ifstatement->lhs = stackLhs;
+    auto int64Rhs = arena.make<Int64Param>();
     int64Rhs->content = 1234;
-    ifstatement->rhs = std::move(int64Rhs);
-    auto assign = std::make_unique<VariableAssignment>();
+    ifstatement->rhs = int64Rhs;
+    auto assign = arena.make<VariableAssignment>();
     assign->to.content = "test";
-    auto valueParam = std::make_unique<Int64Param>();
+    auto valueParam = arena.make<Int64Param>();
     valueParam->content = 4;
-    assign->value = std::move(valueParam);
-    ifstatement->block = std::make_unique<Block>();
-    ifstatement->block->statements.push_back(std::move(assign));
+    assign->value = valueParam;
+    ifstatement->block = arena.make<Block>();
+    ifstatement->block->statements.push_back(assign);
     ifstatement->block->parent = &block;
-    ifchain->_ifstatements.push_back(std::move(ifstatement));
+    ifchain->_ifstatements.push_back(ifstatement);
 
-    auto ifstatement2 = std::make_unique<IfStatement>();
+    auto ifstatement2 = arena.make<IfStatement>();
     ifstatement2->comparator = IfStatement::Equal;
-    auto stackLhs2 = std::make_unique<StackVariableParam>();
+    auto stackLhs2 = arena.make<StackVariableParam>();
     stackLhs2->content = "test";
-    ifstatement2->lhs = std::move(stackLhs2);
-    auto int64Rhs2 = std::make_unique<Int64Param>();
+    ifstatement2->lhs = stackLhs2;
+    auto int64Rhs2 = arena.make<Int64Param>();
     int64Rhs2->content = 1234;
-    ifstatement2->rhs = std::move(int64Rhs2);
-    auto assign2 = std::make_unique<VariableAssignment>();
+    ifstatement2->rhs = int64Rhs2;
+    auto assign2 = arena.make<VariableAssignment>();
     assign2->to.content = "test";
-    auto valueParam2 = std::make_unique<Int64Param>();
+    auto valueParam2 = arena.make<Int64Param>();
     valueParam2->content = 4;
-    assign2->value = std::move(valueParam2);
-    ifstatement2->block = std::make_unique<Block>();
-    ifstatement2->block->statements.push_back(std::move(assign2));
+    assign2->value = valueParam2;
+    ifstatement2->block = arena.make<Block>();
+    ifstatement2->block->statements.push_back(assign2);
     ifstatement2->block->parent = &block;
-    ifchain->_ifstatements.push_back(std::move(ifstatement2));
+    ifchain->_ifstatements.push_back(ifstatement2);
 
-    block.statements.push_back(std::move(ifchain));
+    block.statements.push_back(ifchain);
 
     InstrBufferx64 buffer;
     auto compiler = Compiler_x64(&block, &buffer);
@@ -843,6 +1008,7 @@ TEST(Compilerx64Tests, compile_block_with_if_else_if_statement) {
 }
 
 TEST(Compilerx64Tests, compile_block_with_if_else_statement) {
+    ll::Arena arena;
     Block block;
 
     VariableDefinition def;
@@ -850,40 +1016,40 @@ TEST(Compilerx64Tests, compile_block_with_if_else_statement) {
     def.type = VariableDefinition::Int64;
     block.vars.push_back(def);
 
-    auto ifchain = std::make_unique<IfChainStatement>();
-    auto ifchainraw = ifchain.get();
+    auto ifchain = arena.make<IfChainStatement>();
+    auto ifchainraw = ifchain;
 
-    auto ifstatement = std::make_unique<IfStatement>();
+    auto ifstatement = arena.make<IfStatement>();
     ifstatement->comparator = IfStatement::Equal;
-    auto stackLhs = std::make_unique<StackVariableParam>();
+    auto stackLhs = arena.make<StackVariableParam>();
     stackLhs->content = "test";
-    ifstatement->lhs = std::move(stackLhs);
-    auto int64Rhs = std::make_unique<Int64Param>();
+    ifstatement->lhs = stackLhs;
+    auto int64Rhs = arena.make<Int64Param>();
     int64Rhs->content = 1234;
-    ifstatement->rhs = std::move(int64Rhs);
-    auto assign = std::make_unique<VariableAssignment>();
+    ifstatement->rhs = int64Rhs;
+    auto assign = arena.make<VariableAssignment>();
     assign->to.content = "test";
-    auto valueParam = std::make_unique<Int64Param>();
+    auto valueParam = arena.make<Int64Param>();
     valueParam->content = 4;
-    assign->value = std::move(valueParam);
-    ifstatement->block = std::make_unique<Block>();
-    ifstatement->block->statements.push_back(std::move(assign));
+    assign->value = valueParam;
+    ifstatement->block = arena.make<Block>();
+    ifstatement->block->statements.push_back(assign);
     ifstatement->block->parent = &block;
-    ifchain->_ifstatements.push_back(std::move(ifstatement));
+    ifchain->_ifstatements.push_back(ifstatement);
 
-    auto ifstatement2 = std::make_unique<IfStatement>();
+    auto ifstatement2 = arena.make<IfStatement>();
     ifstatement2->comparator = IfStatement::None;
-    auto assign2 = std::make_unique<VariableAssignment>();
+    auto assign2 = arena.make<VariableAssignment>();
     assign2->to.content = "test";
-    auto valueParam2 = std::make_unique<Int64Param>();
+    auto valueParam2 = arena.make<Int64Param>();
     valueParam2->content = 4;
-    assign2->value = std::move(valueParam2);
-    ifstatement2->block = std::make_unique<Block>();
-    ifstatement2->block->statements.push_back(std::move(assign2));
+    assign2->value = valueParam2;
+    ifstatement2->block = arena.make<Block>();
+    ifstatement2->block->statements.push_back(assign2);
     ifstatement2->block->parent = &block;
-    ifchain->_ifstatements.push_back(std::move(ifstatement2));
+    ifchain->_ifstatements.push_back(ifstatement2);
 
-    block.statements.push_back(std::move(ifchain));
+    block.statements.push_back(ifchain);
 
     InstrBufferx64 buffer;
     auto compiler = Compiler_x64(&block, &buffer);
@@ -908,6 +1074,7 @@ TEST(Compilerx64Tests, compile_block_with_if_else_statement) {
 }
 
 TEST(Compilerx64Tests, compile_block_with_loop_statement) {
+    ll::Arena arena;
     Block block;
 
     VariableDefinition def;
@@ -915,29 +1082,29 @@ TEST(Compilerx64Tests, compile_block_with_loop_statement) {
     def.type = VariableDefinition::Int64;
     block.vars.push_back(def);
 
-    auto loop = std::make_unique<LoopStatement>();
-    auto loopRaw = loop.get();
-    auto ifstatement = std::make_unique<IfStatement>();
+    auto loop = arena.make<LoopStatement>();
+    auto loopRaw = loop;
+    auto ifstatement = arena.make<IfStatement>();
 
     ifstatement->comparator = IfStatement::Equal;
-    auto stackLhs = std::make_unique<StackVariableParam>();
+    auto stackLhs = arena.make<StackVariableParam>();
     stackLhs->content = "test";
-    ifstatement->lhs = std::move(stackLhs);
-    auto int64Rhs = std::make_unique<Int64Param>();
+    ifstatement->lhs = stackLhs;
+    auto int64Rhs = arena.make<Int64Param>();
     int64Rhs->content = 1234;
-    ifstatement->rhs = std::move(int64Rhs);
+    ifstatement->rhs = int64Rhs;
 
-    auto assign = std::make_unique<VariableAssignment>();
+    auto assign = arena.make<VariableAssignment>();
     assign->to.content = "test";
     
-    auto valueParam = std::make_unique<Int64Param>();
+    auto valueParam = arena.make<Int64Param>();
     valueParam->content = 4;
-    assign->value = std::move(valueParam);
-    ifstatement->block = std::make_unique<Block>();
-    ifstatement->block->statements.push_back(std::move(assign));
+    assign->value = valueParam;
+    ifstatement->block = arena.make<Block>();
+    ifstatement->block->statements.push_back(assign);
     ifstatement->block->parent = &block;
-    loop->_ifStatement = std::move(ifstatement);
-    block.statements.push_back(std::move(loop));
+    loop->_ifStatement = ifstatement;
+    block.statements.push_back(loop);
 
     InstrBufferx64 buffer;
     auto compiler = Compiler_x64(&block, &buffer);
@@ -956,3 +1123,106 @@ TEST(Compilerx64Tests, compile_block_with_loop_statement) {
         })
     );
 }
+
+TEST(Compilerx64Tests, compile_block_dispatches_on_kind) {
+    ll::Arena arena;
+    Block block;
+
+    auto call = arena.make<FunctionCall>();
+    call->functionName = "cool";
+    block.statements.push_back(call);
+
+    InstrBufferx64 buffer;
+    auto compiler = Compiler_x64(&block, &buffer, Compiler_x64::Mode::ObjectFile);
+    compiler.compile_block();
+
+    EXPECT_EQ(
+        buffer.buffer(),
+        std::vector<uint8_t>({
+            0xe8, 0x00, 0x00, 0x00, 0x00, //call rel32; with no linking
+        }));
+
+    block.statements.push_back(arena.make<IfStatement>());
+    EXPECT_THROW(compiler.compile_block(), std::runtime_error);
+}
+
+TEST(Compilerx64Tests, node_cast_checks_kind) {
+    ll::Arena arena;
+    Param* param = arena.make<Int64Param>();
+
+    EXPECT_EQ(node_cast<Int64Param>(param), param);
+    EXPECT_EQ(node_cast<StringParam>(param), nullptr);
+    EXPECT_EQ(node_cast<StackVariableParam>(static_cast<Param*>(nullptr)), nullptr);
+}
+
+TEST(Compilerx64Tests, compile_function_keeps_locals_in_registers) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    int64 a;
+    a = 5;
+    )");
+
+    InstrBufferx64 buffer;
+    auto compiler = Compiler_x64(p.block, &buffer);
+    compiler.compile_function();
+
+    EXPECT_EQ(
+        buffer.buffer(),
+        std::vector<uint8_t>({
+            0xff, 0xf3, //push rbx
+            0x48, 0x83, 0xec, 0x08, //sub rsp, 0x8
+            0xff, 0xf5, //push rbp
+            0x48, 0x89, 0xe5, //mov rbp, rsp
+            0x48, 0x83, 0xec, 0x10, //sub rsp, 0x10
+            0xb8, 0x05, 0x00, 0x00, 0x00, //mov eax, 5
+            0x48, 0x89, 0xc3, //mov rbx, rax
+            0x48, 0x83, 0xc4, 0x10, //add rsp, 0x10
+            0x5d, //pop rbp
+            0x48, 0x83, 0xc4, 0x08, //add rsp, 0x8
+            0x5b, //pop rbx
+            0xc3, //ret
+        }));
+}
+
+TEST(Compilerx64Tests, execute_fizzbuzz_with_registers) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    int64 counter;
+    counter = 1;
+    while (counter < 16) {
+        int64 mod3;
+        mod3 = counter % 3;
+
+        int64 mod5;
+        mod5 = counter % 5;
+        if (mod3 == 0) {
+            if (mod5 == 0) {
+                printf("FizzBuzz");
+            } else {
+                printf("Fizz");
+            }
+        } else if (mod5 == 0) {
+            printf("Buzz");
+        } else {
+            printf("%i", counter);
+        }
+        counter = counter + 1;
+        puts("");
+    }
+    )");
+
+    InstrBufferx64 buffer;
+    auto compiler = Compiler_x64(p.block, &buffer);
+    compiler.compile_function();
+
+    fflush(stdout);
+    testing::internal::CaptureStdout();
+    buffer.execute();
+    fflush(stdout);
+
+    EXPECT_EQ(
+        testing::internal::GetCapturedStdout(),
+        "1\n2\nFizz\n4\nBuzz\nFizz\n7\n8\nFizz\nBuzz\n11\nFizz\n13\n14\nFizzBuzz\n");
+}
@@ -0,0 +1,315 @@
+//------------------------------------------------------------------------------
+// ConstantFolder.cpp
+//------------------------------------------------------------------------------
+
+#include "ConstantFolder.hpp"
+
+#include <limits>
+
+namespace {
+
+std::optional<std::int64_t> value_of(const Block& scope, const Param* param, const ConstantFolder::Constants& constants) {
+    if (param == nullptr) {
+        return std::nullopt;
+    }
+
+    switch (param->kind) {
+        case NodeKind::Int64Param:
+            return static_cast<const Int64Param*>(param)->content;
+
+        case NodeKind::StackVariableParam:
+        {
+            auto variable = scope.find_variable(static_cast<const StackVariableParam*>(param)->content);
+            auto it = constants.find(variable);
+            if (it == constants.end()) {
+                return std::nullopt;
+            }
+            return it->second;
+        }
+
+        case NodeKind::StatementParam:
+        {
+            auto calc = node_cast<const Int64Calcuation>(static_cast<const StatementParam*>(param)->statement);
+            if (calc == nullptr) {
+                return std::nullopt;
+            }
+
+            auto lhs = value_of(scope, calc->lhs, constants);
+            auto rhs = value_of(scope, calc->rhs, constants);
+            if (!lhs || !rhs) {
+                return std::nullopt;
+            }
+            return ConstantFolder::evaluate(calc->operation, *lhs, *rhs);
+        }
+
+        default:
+            return std::nullopt;
+    }
+}
+
+}
+
+ConstantFolder::ConstantFolder(ll::Arena& arena)
+: _arena(arena)
+{
+}
+
+void ConstantFolder::fold_function(Block* block) {
+    Constants constants;
+    fold_block(block, constants);
+}
+
+void ConstantFolder::fold_block(Block* block, Constants& constants) {
+    for (size_t i = 0; i < block->statements.size();) {
+        auto statement = block->statements[i];
+
+        switch (statement->kind) {
+            case NodeKind::FunctionCall:
+                for (auto& param : static_cast<FunctionCall*>(statement)->params) {
+                    fold_param(*block, param, constants);
+                }
+                i++;
+                break;
+
+            case NodeKind::VariableAssignment:
+            {
+                auto assignment = static_cast<VariableAssignment*>(statement);
+                auto value = fold_param(*block, assignment->value, constants);
+                auto variable = block->find_variable(assignment->to.content);
+                if (value && variable) {
+                    constants[variable] = *value;
+                } else {
+                    constants.erase(variable);
+                }
+                i++;
+                break;
+            }
+
+            case NodeKind::ReturnStatement:
+                fold_param(*block, static_cast<ReturnStatement*>(statement)->value, constants);
+                i++;
+                break;
+
+            case NodeKind::IfChainStatement:
+                fold_if_chain(block, i, constants);
+                break;
+
+            case NodeKind::LoopStatement:
+                fold_loop(block, i, constants);
+                break;
+
+            default:
+                i++;
+                break;
+        }
+    }
+}
+
+std::optional<std::int64_t> ConstantFolder::fold_param(const Block& scope, Param*& param, const Constants& constants) {
+    if (param == nullptr) {
+        return std::nullopt;
+    }
+
+    std::optional<std::int64_t> value;
+
+    switch (param->kind) {
+        case NodeKind::Int64Param:
+            return static_cast<Int64Param*>(param)->content;
+
+        case NodeKind::StackVariableParam:
+            value = value_of(scope, param, constants);
+            break;
+
+        case NodeKind::StatementParam:
+        {
+            auto statement = static_cast<StatementParam*>(param)->statement;
+            if (auto call = node_cast<FunctionCall>(statement)) {
+                for (auto& callParam : call->params) {
+                    fold_param(scope, callParam, constants);
+                }
+                return std::nullopt;
+            }
+
+            auto calc = node_cast<Int64Calcuation>(statement);
+            if (calc == nullptr) {
+                return std::nullopt;
+            }
+
+            //fold both sides so a partially constant expression still shrinks
+            auto lhs = fold_param(scope, calc->lhs, constants);
+            auto rhs = fold_param(scope, calc->rhs, constants);
+            if (lhs && rhs) {
+                value = evaluate(calc->operation, *lhs, *rhs);
+            }
+            break;
+        }
+
+        default:
+            return std::nullopt;
+    }
+
+    if (value) {
+        auto constant = _arena.make<Int64Param>();
+        constant->span = param->span;
+        constant->content = *value;
+        param = constant;
+    }
+
+    return value;
+}
+
+std::optional<bool> ConstantFolder::fold_comparator(const Block& scope, IfStatement* ifStatement, const Constants& constants) {
+    auto lhs = fold_param(scope, ifStatement->lhs, constants);
+    auto rhs = fold_param(scope, ifStatement->rhs, constants);
+    if (!lhs || !rhs) {
+        return std::nullopt;
+    }
+    return evaluate(ifStatement->comparator, *lhs, *rhs);
+}
+
+std::optional<std::int64_t> ConstantFolder::evaluate(Int64Calcuation::Operation op, std::int64_t lhs, std::int64_t rhs) {
+    switch (op) {
+        case Int64Calcuation::Addition:
+            //wraps the same way add does at runtime
+            return static_cast<std::int64_t>(static_cast<std::uint64_t>(lhs) + static_cast<std::uint64_t>(rhs));
+
+        case Int64Calcuation::Modulo:
+            //idiv faults on these, leave them for runtime
+            if (rhs == 0 || (lhs == std::numeric_limits<std::int64_t>::min() && rhs == -1)) {
+                return std::nullopt;
+            }
+            return lhs % rhs;
+
+        default:
+            return std::nullopt;
+    }
+}
+
+std::optional<bool> ConstantFolder::evaluate(IfStatement::Comparator comparator, std::int64_t lhs, std::int64_t rhs) {
+    switch (comparator) {
+        case IfStatement::Equal:
+            return lhs == rhs;
+        case IfStatement::NotEqual:
+            return lhs != rhs;
+        case IfStatement::LessThan:
+            return lhs < rhs;
+        case IfStatement::LessThanOrEqual:
+            return lhs <= rhs;
+        case IfStatement::GreaterThan:
+            return lhs > rhs;
+        case IfStatement::GreaterThanOrEqual:
+            return lhs >= rhs;
+        default:
+            return std::nullopt;
+    }
+}
+
+void ConstantFolder::fold_if_chain(Block* block, size_t& index, Constants& constants) {
+    auto chain = static_cast<IfChainStatement*>(block->statements[index]);
+    auto& ifstatements = chain->_ifstatements;
+
+    std::optional<Constants> after;
+    bool exhaustive = false;
+
+    for (size_t i = 0; i < ifstatements.size();) {
+        auto ifStatement = ifstatements[i];
+
+        std::optional<bool> taken = true;
+        if (ifStatement->comparator != IfStatement::None) {
+            taken = fold_comparator(*block, ifStatement, constants);
+        }
+
+        if (taken == false) {
+            ifstatements.erase(ifstatements.begin() + i);
+            continue;
+        }
+
+        Constants branch = constants;
+        fold_block(ifStatement->block, branch);
+        if (after) {
+            merge(*after, branch);
+        } else {
+            after = std::move(branch);
+        }
+
+        if (taken == true) {
+            //always runs when reached, acts as the else of what remains
+            ifStatement->comparator = IfStatement::None;
+            ifstatements.erase(ifstatements.begin() + i + 1, ifstatements.end());
+            exhaustive = true;
+            break;
+        }
+
+        i++;
+    }
+
+    if (!exhaustive) {
+        if (after) {
+            merge(*after, constants);
+        } else {
+            after = constants;
+        }
+    }
+    constants = std::move(*after);
+
+    if (ifstatements.empty()) {
+        block->statements.erase(block->statements.begin() + index);
+    } else {
+        index++;
+    }
+}
+
+void ConstantFolder::fold_loop(Block* block, size_t& index, Constants& constants) {
+    auto ifStatement = static_cast<LoopStatement*>(block->statements[index])->_ifStatement;
+
+    auto lhs = value_of(*block, ifStatement->lhs, constants);
+    auto rhs = value_of(*block, ifStatement->rhs, constants);
+    if (lhs && rhs && evaluate(ifStatement->comparator, *lhs, *rhs) == false) {
+        block->statements.erase(block->statements.begin() + index);
+        return;
+    }
+
+    //anything written in the loop is unknown at the head and after the loop
+    std::unordered_set<const VariableDefinition*> assigned;
+    assigned_in(*ifStatement->block, assigned);
+    for (auto variable : assigned) {
+        constants.erase(variable);
+    }
+
+    fold_comparator(*block, ifStatement, constants);
+
+    Constants body = constants;
+    fold_block(ifStatement->block, body);
+
+    index++;
+}
+
+void ConstantFolder::assigned_in(const Block& block, std::unordered_set<const VariableDefinition*>& assigned) {
+    for (auto statement : block.statements) {
+        switch (statement->kind) {
+            case NodeKind::VariableAssignment:
+                assigned.insert(block.find_variable(static_cast<const VariableAssignment*>(statement)->to.content));
+                break;
+
+            case NodeKind::IfChainStatement:
+                for (auto ifStatement : static_cast<const IfChainStatement*>(statement)->_ifstatements) {
+                    assigned_in(*ifStatement->block, assigned);
+                }
+                break;
+
+            case NodeKind::LoopStatement:
+                assigned_in(*static_cast<const LoopStatement*>(statement)->_ifStatement->block, assigned);
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+void ConstantFolder::merge(Constants& into, const Constants& other) {
+    std::erase_if(into, [&other] (const auto& entry) {
+        auto it = other.find(entry.first);
+        return it == other.end() || it->second != entry.second;
+    });
+}
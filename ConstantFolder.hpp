@@ -0,0 +1,45 @@
+//------------------------------------------------------------------------------
+// ConstantFolder.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Arena.hpp"
+#include "Statement.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+//AST pass run between the Parser and Compiler_x64. Folds int64 arithmetic on
+//constants, propagates variables with a known constant value into their uses
+//and resolves if/while comparisons that are decided at compile time, removing
+//the branches that can never run. Replacement nodes come from the arena that
+//owns the tree.
+class ConstantFolder {
+public:
+    using Constants = std::unordered_map<const VariableDefinition*, std::int64_t>;
+
+private:
+    ll::Arena& _arena;
+
+public:
+    ConstantFolder(ll::Arena& arena);
+
+    void fold_function(Block* block);
+
+    void fold_block(Block* block, Constants& constants);
+    std::optional<std::int64_t> fold_param(const Block& scope, Param*& param, const Constants& constants);
+    std::optional<bool> fold_comparator(const Block& scope, IfStatement* ifStatement, const Constants& constants);
+
+    static std::optional<std::int64_t> evaluate(Int64Calcuation::Operation op, std::int64_t lhs, std::int64_t rhs);
+    static std::optional<bool> evaluate(IfStatement::Comparator comparator, std::int64_t lhs, std::int64_t rhs);
+
+private:
+    void fold_if_chain(Block* block, size_t& index, Constants& constants);
+    void fold_loop(Block* block, size_t& index, Constants& constants);
+
+    static void assigned_in(const Block& block, std::unordered_set<const VariableDefinition*>& assigned);
+    static void merge(Constants& into, const Constants& other);
+};
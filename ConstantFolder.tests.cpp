@@ -0,0 +1,195 @@
+//------------------------------------------------------------------------------
+// ConstantFolder.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "ConstantFolder.hpp"
+
+#include "Parser.hpp"
+
+#include <limits>
+
+#include <gtest/gtest.h>
+
+namespace {
+    std::optional<int64_t> constant(Param* param) {
+        auto int64param = node_cast<Int64Param>(param);
+        if (int64param == nullptr) {
+            return std::nullopt;
+        }
+        return int64param->content;
+    }
+}
+
+TEST(ConstantFolder, fold_addition) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    int64 a;
+    a = 1 + 2 + 3;
+    )");
+
+    ConstantFolder(arena).fold_function(p.block);
+
+    auto assign = node_cast<VariableAssignment>(p.block->statements[0]);
+    ASSERT_NE(assign, nullptr);
+    EXPECT_EQ(constant(assign->value), 6);
+}
+
+TEST(ConstantFolder, propagate_into_calls_and_calculations) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    int64 a;
+    int64 b;
+    a = 10;
+    b = a % 4;
+    printf("%i %i", a, b);
+    )");
+
+    ConstantFolder(arena).fold_function(p.block);
+
+    auto assign = node_cast<VariableAssignment>(p.block->statements[1]);
+    ASSERT_NE(assign, nullptr);
+    EXPECT_EQ(constant(assign->value), 2);
+
+    auto call = node_cast<FunctionCall>(p.block->statements[2]);
+    ASSERT_NE(call, nullptr);
+    EXPECT_NE(node_cast<StringParam>(call->params[0]), nullptr);
+    EXPECT_EQ(constant(call->params[1]), 10);
+    EXPECT_EQ(constant(call->params[2]), 2);
+}
+
+TEST(ConstantFolder, partial_fold_keeps_variable) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    int64 a;
+    int64 b;
+    b = a + 2 % 3;
+    )");
+
+    ConstantFolder(arena).fold_function(p.block);
+
+    auto assign = node_cast<VariableAssignment>(p.block->statements[0]);
+    ASSERT_NE(assign, nullptr);
+    auto calc = node_cast<Int64Calcuation>(node_cast<StatementParam>(assign->value)->statement);
+    ASSERT_NE(calc, nullptr);
+    EXPECT_NE(node_cast<StackVariableParam>(calc->lhs), nullptr);
+    EXPECT_EQ(constant(calc->rhs), 2);
+}
+
+TEST(ConstantFolder, drop_dead_branches) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    int64 a;
+    a = 3;
+    if (a == 1) {
+        puts("one");
+    } else if (a == 3) {
+        puts("three");
+    } else {
+        puts("other");
+    }
+    )");
+
+    ConstantFolder(arena).fold_function(p.block);
+
+    auto chain = node_cast<IfChainStatement>(p.block->statements[1]);
+    ASSERT_NE(chain, nullptr);
+    ASSERT_EQ(chain->_ifstatements.size(), 1);
+    EXPECT_EQ(chain->_ifstatements[0]->comparator, IfStatement::None);
+
+    auto call = node_cast<FunctionCall>(chain->_ifstatements[0]->block->statements[0]);
+    ASSERT_NE(call, nullptr);
+    EXPECT_EQ(node_cast<StringParam>(call->params[0])->content, "three");
+}
+
+TEST(ConstantFolder, remove_never_taken_chain_and_loop) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    int64 a;
+    a = 5;
+    if (a == 1) {
+        puts("one");
+    }
+    while (a < 5) {
+        a = a + 1;
+    }
+    puts("done");
+    )");
+
+    ConstantFolder(arena).fold_function(p.block);
+
+    ASSERT_EQ(p.block->statements.size(), 2);
+    EXPECT_NE(node_cast<VariableAssignment>(p.block->statements[0]), nullptr);
+    EXPECT_NE(node_cast<FunctionCall>(p.block->statements[1]), nullptr);
+}
+
+TEST(ConstantFolder, branch_merge) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    int64 a;
+    int64 b;
+    int64 c;
+    c = 1;
+    if (a == 1) {
+        b = 2;
+        c = 1;
+    } else {
+        b = 3;
+    }
+    printf("%i %i", b, c);
+    )");
+
+    ConstantFolder(arena).fold_function(p.block);
+
+    auto call = node_cast<FunctionCall>(p.block->statements[2]);
+    ASSERT_NE(call, nullptr);
+    EXPECT_NE(node_cast<StackVariableParam>(call->params[1]), nullptr);
+    EXPECT_EQ(constant(call->params[2]), 1);
+}
+
+TEST(ConstantFolder, loop_invalidates_assigned) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    int64 counter;
+    int64 step;
+    counter = 1;
+    step = 2;
+    while (counter < 10) {
+        counter = counter + step;
+    }
+    printf("%i", counter);
+    )");
+
+    ConstantFolder(arena).fold_function(p.block);
+
+    auto loop = node_cast<LoopStatement>(p.block->statements[2]);
+    ASSERT_NE(loop, nullptr);
+    EXPECT_NE(node_cast<StackVariableParam>(loop->_ifStatement->lhs), nullptr);
+    EXPECT_EQ(constant(loop->_ifStatement->rhs), 10);
+
+    auto assign = node_cast<VariableAssignment>(loop->_ifStatement->block->statements[0]);
+    ASSERT_NE(assign, nullptr);
+    auto calc = node_cast<Int64Calcuation>(node_cast<StatementParam>(assign->value)->statement);
+    ASSERT_NE(calc, nullptr);
+    EXPECT_NE(node_cast<StackVariableParam>(calc->lhs), nullptr);
+    EXPECT_EQ(constant(calc->rhs), 2);
+
+    auto call = node_cast<FunctionCall>(p.block->statements[3]);
+    ASSERT_NE(call, nullptr);
+    EXPECT_NE(node_cast<StackVariableParam>(call->params[1]), nullptr);
+}
+
+TEST(ConstantFolder, evaluate_leaves_faulting_modulo) {
+    EXPECT_EQ(ConstantFolder::evaluate(Int64Calcuation::Modulo, 7, 3), 1);
+    EXPECT_EQ(ConstantFolder::evaluate(Int64Calcuation::Modulo, -7, 3), -1);
+    EXPECT_FALSE(ConstantFolder::evaluate(Int64Calcuation::Modulo, 7, 0));
+    EXPECT_FALSE(ConstantFolder::evaluate(Int64Calcuation::Modulo, std::numeric_limits<int64_t>::min(), -1));
+    EXPECT_EQ(ConstantFolder::evaluate(Int64Calcuation::Addition, std::numeric_limits<int64_t>::max(), 1),
+              std::numeric_limits<int64_t>::min());
+}
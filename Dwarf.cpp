@@ -0,0 +1,171 @@
+//------------------------------------------------------------------------------
+// Dwarf.cpp
+//------------------------------------------------------------------------------
+
+#include "Dwarf.hpp"
+
+#include "Linker.hpp"
+
+#include <cstring>
+#include <string_view>
+
+namespace {
+    constexpr uint16_t Version = 4;
+    //DW_LANG_lo_user, there is no standard code for littlelang
+    constexpr uint16_t Language = 0x8000;
+    constexpr const char* Producer = "littlelang";
+
+    constexpr int8_t LineBase = -5;
+    constexpr uint8_t LineRange = 14;
+    constexpr uint8_t OpcodeBase = 13;
+
+    template<typename T>
+    void put(std::vector<uint8_t>& vec, T value) {
+        auto bytes = reinterpret_cast<const uint8_t*>(&value);
+        vec.insert(vec.end(), bytes, bytes + sizeof(T));
+    }
+
+    template<typename T>
+    void put_at(std::vector<uint8_t>& vec, size_t at, T value) {
+        std::memcpy(&vec[at], &value, sizeof(T));
+    }
+
+    void put_string(std::vector<uint8_t>& vec, std::string_view string) {
+        vec.insert(vec.end(), string.begin(), string.end());
+        vec.push_back(0x00);
+    }
+
+    void put_uleb(std::vector<uint8_t>& vec, uint64_t value) {
+        do {
+            uint8_t byte = value & 0x7f;
+            value >>= 7;
+            vec.push_back(value ? byte | 0x80 : byte);
+        } while (value);
+    }
+
+    void put_sleb(std::vector<uint8_t>& vec, int64_t value) {
+        while (true) {
+            uint8_t byte = value & 0x7f;
+            value >>= 7;
+            bool done = (value == 0 && !(byte & 0x40)) || (value == -1 && (byte & 0x40));
+            vec.push_back(done ? byte : byte | 0x80);
+            if (done) {
+                return;
+            }
+        }
+    }
+
+    //unit_length is patched once the unit is complete, it excludes itself
+    size_t begin_unit(std::vector<uint8_t>& vec) {
+        auto at = vec.size();
+        put<uint32_t>(vec, 0);
+        return at;
+    }
+
+    void end_unit(std::vector<uint8_t>& vec, size_t at) {
+        put_at<uint32_t>(vec, at, static_cast<uint32_t>(vec.size() - at - sizeof(uint32_t)));
+    }
+}
+
+dwarf::DebugSections dwarf::DebugSections::generate(const ll::Object& object, uint64_t textAddress) {
+    DebugSections ds;
+    auto codeSize = object.buff.buffer().size();
+    std::string_view fileName = object.sourceFile.empty() ? std::string_view("program.ll") : std::string_view(object.sourceFile);
+
+    //abbreviation 1, a compile unit without children
+    put_uleb(ds.abbrev, 1);
+    put_uleb(ds.abbrev, 0x11); //DW_TAG_compile_unit
+    ds.abbrev.push_back(0x00); //DW_CHILDREN_no
+    auto attribute = [&ds] (uint64_t name, uint64_t form) {
+        put_uleb(ds.abbrev, name);
+        put_uleb(ds.abbrev, form);
+    };
+    attribute(0x25, 0x08); //DW_AT_producer, DW_FORM_string
+    attribute(0x13, 0x05); //DW_AT_language, DW_FORM_data2
+    attribute(0x03, 0x08); //DW_AT_name, DW_FORM_string
+    attribute(0x10, 0x17); //DW_AT_stmt_list, DW_FORM_sec_offset
+    attribute(0x11, 0x01); //DW_AT_low_pc, DW_FORM_addr
+    attribute(0x12, 0x07); //DW_AT_high_pc, DW_FORM_data8 as the size
+    attribute(0, 0);
+    ds.abbrev.push_back(0x00);
+
+    auto info = begin_unit(ds.info);
+    put<uint16_t>(ds.info, Version);
+    ds.infoFixups.push_back({.offset = ds.info.size(), .size = 4, .target = Fixup::Target::Abbrev});
+    put<uint32_t>(ds.info, 0);
+    ds.info.push_back(8); //address size
+
+    put_uleb(ds.info, 1);
+    put_string(ds.info, Producer);
+    put<uint16_t>(ds.info, Language);
+    put_string(ds.info, fileName);
+    ds.infoFixups.push_back({.offset = ds.info.size(), .size = 4, .target = Fixup::Target::Line});
+    put<uint32_t>(ds.info, 0);
+    ds.infoFixups.push_back({.offset = ds.info.size(), .size = 8, .target = Fixup::Target::Text});
+    put<uint64_t>(ds.info, textAddress);
+    put<uint64_t>(ds.info, codeSize);
+    end_unit(ds.info, info);
+
+    auto line = begin_unit(ds.line);
+    put<uint16_t>(ds.line, Version);
+    auto headerLength = ds.line.size();
+    put<uint32_t>(ds.line, 0);
+    ds.line.push_back(1); //minimum_instruction_length
+    ds.line.push_back(1); //maximum_operations_per_instruction
+    ds.line.push_back(1); //default_is_stmt
+    ds.line.push_back(static_cast<uint8_t>(LineBase));
+    ds.line.push_back(LineRange);
+    ds.line.push_back(OpcodeBase);
+    for (uint8_t operands : {0, 1, 1, 1, 1, 0, 0, 0, 1, 0, 0, 1}) {
+        ds.line.push_back(operands);
+    }
+    ds.line.push_back(0x00); //no include_directories
+    put_string(ds.line, fileName);
+    put_uleb(ds.line, 0); //directory, the compilation directory
+    put_uleb(ds.line, 0); //modification time
+    put_uleb(ds.line, 0); //length
+    ds.line.push_back(0x00);
+    put_at<uint32_t>(ds.line, headerLength, static_cast<uint32_t>(ds.line.size() - headerLength - sizeof(uint32_t)));
+
+    //DW_LNE_set_address
+    ds.line.push_back(0x00);
+    put_uleb(ds.line, 9);
+    ds.line.push_back(0x02);
+    ds.lineFixups.push_back({.offset = ds.line.size(), .size = 8, .target = Fixup::Target::Text});
+    put<uint64_t>(ds.line, textAddress);
+
+    uint64_t address = 0;
+    int64_t row = 1;
+    auto& marks = object.buff._statements;
+    for (size_t i = 0; i < marks.size(); i++) {
+        auto& mark = marks[i];
+        //a statement without code shares its address with the next
+        if (mark.line == 0 || (i + 1 < marks.size() && marks[i + 1].location == mark.location)) {
+            continue;
+        }
+
+        if (mark.location != address) {
+            ds.line.push_back(0x02); //DW_LNS_advance_pc
+            put_uleb(ds.line, mark.location - address);
+            address = mark.location;
+        }
+        if (mark.line != row) {
+            ds.line.push_back(0x03); //DW_LNS_advance_line
+            put_sleb(ds.line, static_cast<int64_t>(mark.line) - row);
+            row = mark.line;
+        }
+        ds.line.push_back(0x01); //DW_LNS_copy
+    }
+
+    if (codeSize != address) {
+        ds.line.push_back(0x02);
+        put_uleb(ds.line, codeSize - address);
+    }
+    //DW_LNE_end_sequence
+    ds.line.push_back(0x00);
+    put_uleb(ds.line, 1);
+    ds.line.push_back(0x01);
+    end_unit(ds.line, line);
+
+    return ds;
+}
@@ -0,0 +1,43 @@
+//------------------------------------------------------------------------------
+// Dwarf.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+namespace ll {
+    struct Object;
+}
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace dwarf {
+    //value in a debug section holding an address in the code or an offset into
+    //another debug section, object files relocate these
+    struct Fixup {
+        enum class Target : uint8_t {
+            Text,
+            Abbrev,
+            Line
+        };
+
+        size_t offset;
+        uint8_t size; //4 or 8 bytes
+        Target target;
+    };
+
+    //DWARF 4 debug info for an object's code placed at textAddress. A single
+    //compile unit covers the code and the line table has a row for each
+    //statement mark with a source line, enough for debuggers and profilers to
+    //attribute addresses to lines of Object::sourceFile.
+    struct DebugSections {
+        std::vector<uint8_t> abbrev;
+        std::vector<uint8_t> info;
+        std::vector<uint8_t> line;
+        std::vector<Fixup> infoFixups;
+        std::vector<Fixup> lineFixups;
+
+        static DebugSections generate(const ll::Object& object, uint64_t textAddress);
+    };
+}
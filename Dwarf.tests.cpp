@@ -0,0 +1,144 @@
+//------------------------------------------------------------------------------
+// Dwarf.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "Dwarf.hpp"
+
+#include "Linker.hpp"
+#include "TestPrograms.hpp"
+
+#include <cstring>
+
+#include <gtest/gtest.h>
+
+namespace {
+    template<typename T>
+    T read(const std::vector<uint8_t>& vec, size_t& at) {
+        T value;
+        std::memcpy(&value, &vec[at], sizeof(T));
+        at += sizeof(T);
+        return value;
+    }
+
+    int64_t read_leb(const std::vector<uint8_t>& vec, size_t& at, bool sign) {
+        int64_t value = 0;
+        int shift = 0;
+        uint8_t byte;
+        do {
+            byte = vec[at++];
+            value |= static_cast<int64_t>(byte & 0x7f) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        if (sign && shift < 64 && (byte & 0x40)) {
+            value |= -(int64_t(1) << shift);
+        }
+        return value;
+    }
+
+    struct Row {
+        uint64_t address;
+        int64_t line;
+        bool operator==(const Row&) const = default;
+    };
+
+    //runs the opcodes the generator uses
+    std::vector<Row> run_line_program(const std::vector<uint8_t>& line, uint64_t& endAddress) {
+        size_t at = 0;
+        auto unitLength = read<uint32_t>(line, at);
+        EXPECT_EQ(unitLength + sizeof(uint32_t), line.size());
+        EXPECT_EQ(read<uint16_t>(line, at), 4);
+        auto headerLength = read<uint32_t>(line, at);
+        at += headerLength;
+
+        std::vector<Row> rows;
+        Row row{0, 1};
+        while (at < line.size()) {
+            auto opcode = line[at++];
+            switch (opcode) {
+                case 0x00:
+                {
+                    auto length = read_leb(line, at, false);
+                    auto extended = line[at++];
+                    if (extended == 0x02) {
+                        row.address = read<uint64_t>(line, at);
+                    } else if (extended == 0x01) {
+                        endAddress = row.address;
+                        return rows;
+                    } else {
+                        at += length - 1;
+                    }
+                    break;
+                }
+                case 0x01: rows.push_back(row); break;
+                case 0x02: row.address += read_leb(line, at, false); break;
+                case 0x03: row.line += read_leb(line, at, true); break;
+                default:
+                    ADD_FAILURE() << "unexpected opcode " << int(opcode);
+                    return rows;
+            }
+        }
+        ADD_FAILURE() << "no end_sequence";
+        return rows;
+    }
+}
+
+TEST(Dwarf, line_table_rows) {
+    auto object = ll::test::compile_object(R"(fn helper() {
+    puts("h");
+}
+
+fn main() {
+    int64 a;
+    a = 1;
+    if (a == 1) {
+        helper();
+    }
+    puts("m");
+}
+)");
+    auto ds = dwarf::DebugSections::generate(object, 0x1000);
+
+    uint64_t end = 0;
+    auto rows = run_line_program(ds.line, end);
+    auto mainOffset = object.symbols[1].offset;
+    auto& marks = object.buff._statements;
+    ASSERT_EQ(marks.size(), 7);
+
+    std::vector<Row> expected{
+        {0x1000, 1},
+        {0x1000 + marks[1].location, 2},
+        {0x1000 + mainOffset, 5},
+        {0x1000 + marks[3].location, 7},
+        {0x1000 + marks[4].location, 8},
+        {0x1000 + marks[5].location, 9},
+        {0x1000 + marks[6].location, 11},
+    };
+    EXPECT_EQ(rows, expected);
+    EXPECT_EQ(end, 0x1000 + object.buff.buffer().size());
+}
+
+TEST(Dwarf, compile_unit) {
+    auto object = ll::test::compile_object(R"(fn main() { puts("m"); })");
+    object.sourceFile = "/src/main.ll";
+    auto ds = dwarf::DebugSections::generate(object, 0x2000);
+
+    size_t at = 0;
+    EXPECT_EQ(read<uint32_t>(ds.info, at) + sizeof(uint32_t), ds.info.size());
+    EXPECT_EQ(read<uint16_t>(ds.info, at), 4);
+    std::string info(ds.info.begin(), ds.info.end());
+    EXPECT_NE(info.find("littlelang"), std::string::npos);
+    EXPECT_NE(info.find("/src/main.ll"), std::string::npos);
+
+    //low_pc then the code size as high_pc end the unit
+    at = ds.info.size() - 16;
+    EXPECT_EQ(read<uint64_t>(ds.info, at), 0x2000);
+    EXPECT_EQ(read<uint64_t>(ds.info, at), object.buff.buffer().size());
+
+    ASSERT_EQ(ds.infoFixups.size(), 3);
+    EXPECT_EQ(ds.infoFixups[0].target, dwarf::Fixup::Target::Abbrev);
+    EXPECT_EQ(ds.infoFixups[1].target, dwarf::Fixup::Target::Line);
+    EXPECT_EQ(ds.infoFixups[2].target, dwarf::Fixup::Target::Text);
+    EXPECT_EQ(ds.infoFixups[2].offset, ds.info.size() - 16);
+    ASSERT_EQ(ds.lineFixups.size(), 1);
+    EXPECT_EQ(ds.lineFixups[0].size, 8);
+}
@@ -5,9 +5,13 @@
 
 #include "Elf.hpp"
 
+#include "Dwarf.hpp"
 #include "InstrBufferx64.hpp"
+#include "Linker.hpp"
 
+#include <algorithm>
 #include <cstring>
+#include <stdexcept>
 
 namespace {
     template<typename T>
@@ -37,9 +41,71 @@ namespace {
         string_to_vec(vec, source);
         return offset;
     }
+
+    constexpr uint64_t ExecutableBase = 0x400000;
+    constexpr uint64_t PageSize = 0x1000;
+    constexpr const char* Interpreter = "/lib64/ld-linux-x86-64.so.2";
+    constexpr size_t ProgramHeaderCount = 7;
+    constexpr size_t PltEntrySize = 8;
+
+    //_start: xor ebp, ebp; call main; xor edi, edi; call exit; hlt
+    //the stack is 16 byte aligned on entry, the dynamic linker has already
+    //run libc's initialisers
+    constexpr uint8_t StartCode[] = {
+        0x31, 0xed,
+        0xe8, 0x00, 0x00, 0x00, 0x00,
+        0x31, 0xff,
+        0xe8, 0x00, 0x00, 0x00, 0x00,
+        0xf4
+    };
+    constexpr size_t StartCallMain = 3;
+    constexpr size_t StartCallExit = 10;
+
+    //object file symbols that debug info relocations refer to
+    constexpr uint32_t TextSymbol = 2;
+    constexpr uint32_t DebugAbbrevSymbol = 4;
+    constexpr uint32_t DebugLineSymbol = 5;
+
+    std::vector<elf::RelocationEntry> debug_relocations(const std::vector<dwarf::Fixup>& fixups) {
+        std::vector<elf::RelocationEntry> relocs;
+        for (auto& fixup : fixups) {
+            uint32_t symbol = TextSymbol;
+            if (fixup.target == dwarf::Fixup::Target::Abbrev) {
+                symbol = DebugAbbrevSymbol;
+            } else if (fixup.target == dwarf::Fixup::Target::Line) {
+                symbol = DebugLineSymbol;
+            }
+
+            relocs.push_back(elf::RelocationEntry{
+                .offset = fixup.offset,
+                .type = fixup.size == 8 ? 0x01u /* R_X86_64_64 */ : 0x0au /* R_X86_64_32 */,
+                .symbol = symbol,
+                .addend = 0
+            });
+        }
+        return relocs;
+    }
+
+    uint64_t align_to(uint64_t value, uint64_t alignment) {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    //rel32 at an offset in the image, relative to the end of the 4 bytes
+    void patch_rel32(std::vector<uint8_t>& image, size_t at, size_t target) {
+        int32_t rel = static_cast<int32_t>(static_cast<int64_t>(target) - static_cast<int64_t>(at + 4));
+        std::memcpy(&image[at], &rel, sizeof(rel));
+    }
+
+    template<typename T>
+    void copy_to(std::vector<uint8_t>& image, size_t at, const std::vector<T>& from) {
+        if (!from.empty()) {
+            std::memcpy(&image[at], from.data(), from.size() * sizeof(T));
+        }
+    }
 }
 
-elf::RelocationData elf::RelocationData::generate(InstrBufferx64& instrs) {
+elf::RelocationData elf::RelocationData::generate(const ll::Object& object) {
+    auto& instrs = object.buff;
     RelocationData rd;
     rd.strtab.push_back(0x00);
 
@@ -91,27 +157,49 @@ elf::RelocationData elf::RelocationData::generate(InstrBufferx64& instrs) {
         });
     }
 
+    //debug section symbols
+    rd.symbols.push_back(SymbolEntry{
+        .name = offset_and_insert(rd.strtab, ".debug_abbrev"),
+        .info = (0x00 << 4 /* STB_LOCAL */) | (0x03 /* STT_SECTION */),
+        .shndx = 7, // section header index
+        .value = 0,
+        .size = 0,
+    });
     rd.symbols.push_back(SymbolEntry{
-        .name = offset_and_insert(rd.strtab, "main"),
-        .info = (0x01 << 4 /* STB_GLOBAL */) | (0x02 /* STT_FUNC */),
-        .shndx = 1, // section header index
+        .name = offset_and_insert(rd.strtab, ".debug_line"),
+        .info = (0x00 << 4 /* STB_LOCAL */) | (0x03 /* STT_SECTION */),
+        .shndx = 10, // section header index
         .value = 0,
-        .size = instrs.buffer().size(),
+        .size = 0,
     });
 
-    for (auto& extReloc : instrs._externFuncs) {
+    for (auto& function : object.function_extents()) {
         rd.symbols.push_back(SymbolEntry{
-            .name = offset_and_insert(rd.strtab, extReloc.symbol),
-            .info = (0x01 << 4 /*STB_GLOBAL*/) | (0x00 /*STT_NOTYPE*/),
-            .shndx = 0,
-            .value = 0,
-            .size = 0
+            .name = offset_and_insert(rd.strtab, std::string(function.name)),
+            .info = (0x01 << 4 /* STB_GLOBAL */) | (0x02 /* STT_FUNC */),
+            .shndx = 1, // section header index
+            .value = function.offset,
+            .size = function.size,
         });
+    }
+
+    std::map<std::string, uint32_t> externSymbols;
+    for (auto& extReloc : instrs._externFuncs) {
+        auto [extSym, inserted] = externSymbols.try_emplace(extReloc.symbol, static_cast<uint32_t>(rd.symbols.size()));
+        if (inserted) {
+            rd.symbols.push_back(SymbolEntry{
+                .name = offset_and_insert(rd.strtab, extReloc.symbol),
+                .info = (0x01 << 4 /*STB_GLOBAL*/) | (0x00 /*STT_NOTYPE*/),
+                .shndx = 0,
+                .value = 0,
+                .size = 0
+            });
+        }
 
         rd.relocs.push_back(RelocationEntry{
             .offset = extReloc.location,
             .type = 0x04, /*R_X86_64_PLT32*/
-            .symbol = static_cast<uint32_t>(rd.symbols.size() - 1),
+            .symbol = extSym->second,
             .addend = -4
         });
     }
@@ -119,12 +207,13 @@ elf::RelocationData elf::RelocationData::generate(InstrBufferx64& instrs) {
     return rd;
 }
 
-void elf::write(std::ostream& out, InstrBufferx64& buff) {
+void elf::write(std::ostream& out, const ll::Object& object) {
+    auto& buff = object.buff;
     std::vector<uint8_t> data;
     std::vector<uint8_t> shstrtab_data;
     shstrtab_data.push_back(0x00);
 
-    auto relocation_data = RelocationData::generate(buff);
+    auto relocation_data = RelocationData::generate(object);
 
     elf::Header elfheader;
 
@@ -167,7 +256,7 @@ void elf::write(std::ostream& out, InstrBufferx64& buff) {
     symtab.sh_offset = data.size() + sizeof(elfheader);
     symtab.sh_size = relocation_data.symbols.size() * sizeof(SymbolEntry);
     symtab.sh_link = 5; //strtab shidx
-    symtab.sh_info = 4; //one greater than the last LOCAL symbol table index
+    symtab.sh_info = 6; //one greater than the last LOCAL symbol table index
     symtab.sh_entsize = sizeof(SymbolEntry);
     symtab.sh_addralign = 8; // 2^3 = 8
     bytes_to_vec(data, &relocation_data.symbols[0], symtab.sh_size);
@@ -181,6 +270,60 @@ void elf::write(std::ostream& out, InstrBufferx64& buff) {
     strtab.sh_addralign = 1;
     bytes_to_vec(data, &relocation_data.strtab[0], strtab.sh_size);
 
+    //debug info, its headers follow the original sections so their indices
+    //don't move
+    auto debug = dwarf::DebugSections::generate(object, 0);
+    auto debugInfoRelocs = debug_relocations(debug.infoFixups);
+    auto debugLineRelocs = debug_relocations(debug.lineFixups);
+
+    elf::SectionHeader debugabbrev;
+    debugabbrev.sh_name = offset_and_insert(shstrtab_data, ".debug_abbrev");
+    debugabbrev.sh_type = 0x1; //SHT_PROGBITS
+    debugabbrev.sh_offset = data.size() + sizeof(elfheader);
+    debugabbrev.sh_size = debug.abbrev.size();
+    debugabbrev.sh_addralign = 1;
+    bytes_to_vec(data, debug.abbrev.data(), debugabbrev.sh_size);
+
+    elf::SectionHeader debuginfo;
+    debuginfo.sh_name = offset_and_insert(shstrtab_data, ".debug_info");
+    debuginfo.sh_type = 0x1; //SHT_PROGBITS
+    debuginfo.sh_offset = data.size() + sizeof(elfheader);
+    debuginfo.sh_size = debug.info.size();
+    debuginfo.sh_addralign = 1;
+    bytes_to_vec(data, debug.info.data(), debuginfo.sh_size);
+
+    elf::SectionHeader reladebuginfo;
+    reladebuginfo.sh_name = offset_and_insert(shstrtab_data, ".rela.debug_info");
+    reladebuginfo.sh_type = 0x4; //SHT_RELA
+    reladebuginfo.sh_flags = 0x40 /* SHF_INFO_LINK */;
+    reladebuginfo.sh_offset = data.size() + sizeof(elfheader);
+    reladebuginfo.sh_size = debugInfoRelocs.size() * sizeof(RelocationEntry);
+    reladebuginfo.sh_link = 4; //symtab shidx
+    reladebuginfo.sh_info = 8; //.debug_info shidx
+    reladebuginfo.sh_addralign = 8;
+    reladebuginfo.sh_entsize = sizeof(RelocationEntry);
+    bytes_to_vec(data, debugInfoRelocs.data(), reladebuginfo.sh_size);
+
+    elf::SectionHeader debugline;
+    debugline.sh_name = offset_and_insert(shstrtab_data, ".debug_line");
+    debugline.sh_type = 0x1; //SHT_PROGBITS
+    debugline.sh_offset = data.size() + sizeof(elfheader);
+    debugline.sh_size = debug.line.size();
+    debugline.sh_addralign = 1;
+    bytes_to_vec(data, debug.line.data(), debugline.sh_size);
+
+    elf::SectionHeader reladebugline;
+    reladebugline.sh_name = offset_and_insert(shstrtab_data, ".rela.debug_line");
+    reladebugline.sh_type = 0x4; //SHT_RELA
+    reladebugline.sh_flags = 0x40 /* SHF_INFO_LINK */;
+    reladebugline.sh_offset = data.size() + sizeof(elfheader);
+    reladebugline.sh_size = debugLineRelocs.size() * sizeof(RelocationEntry);
+    reladebugline.sh_link = 4; //symtab shidx
+    reladebugline.sh_info = 10; //.debug_line shidx
+    reladebugline.sh_addralign = 8;
+    reladebugline.sh_entsize = sizeof(RelocationEntry);
+    bytes_to_vec(data, debugLineRelocs.data(), reladebugline.sh_size);
+
     elf::SectionHeader shstrtab;
     shstrtab.sh_name = offset_and_insert(shstrtab_data, ".shstrtab");
     shstrtab.sh_type = 0x3; //SHT_STRTAB
@@ -192,7 +335,7 @@ void elf::write(std::ostream& out, InstrBufferx64& buff) {
 
     elfheader.e_shoff = data.size() + sizeof(elfheader);
     elfheader.e_shentsize = sizeof(SectionHeader);
-    elfheader.e_shnum = 7;
+    elfheader.e_shnum = 12;
     elfheader.e_shstrndx = 6;
     write_os(out, &elfheader, sizeof(elfheader));
 
@@ -205,4 +348,328 @@ void elf::write(std::ostream& out, InstrBufferx64& buff) {
     write_os(out, &symtab, sizeof(SectionHeader));
     write_os(out, &strtab, sizeof(SectionHeader));
     write_os(out, &shstrtab, sizeof(SectionHeader));
-}
\ No newline at end of file
+    write_os(out, &debugabbrev, sizeof(SectionHeader));
+    write_os(out, &debuginfo, sizeof(SectionHeader));
+    write_os(out, &reladebuginfo, sizeof(SectionHeader));
+    write_os(out, &debugline, sizeof(SectionHeader));
+    write_os(out, &reladebugline, sizeof(SectionHeader));
+}
+
+void elf::write_executable(std::ostream& out, const ll::Object& object) {
+    auto mainSymbol = std::find_if(object.symbols.begin(), object.symbols.end(), [] (auto& symbol) {
+        return symbol.name == "main";
+    });
+    if (mainSymbol == object.symbols.end()) {
+        throw std::runtime_error("No main function for the executable entry point.");
+    }
+
+    auto& code = object.buff.buffer();
+
+    //every unresolved call is imported, exit is needed by _start
+    std::vector<std::string> imports;
+    std::map<std::string, size_t> importIndex;
+    auto import = [&imports, &importIndex] (const std::string& name) {
+        auto [it, inserted] = importIndex.try_emplace(name, imports.size());
+        if (inserted) {
+            imports.push_back(name);
+        }
+        return it->second;
+    };
+    for (auto& externFunc : object.buff._externFuncs) {
+        import(externFunc.symbol);
+    }
+    auto exitImport = import("exit");
+
+    std::vector<uint8_t> dynstr;
+    dynstr.push_back(0x00);
+    auto libcName = offset_and_insert(dynstr, "libc.so.6");
+
+    std::vector<SymbolEntry> dynsym;
+    dynsym.push_back(SymbolEntry{.name = 0, .info = 0, .shndx = 0, .value = 0, .size = 0});
+    for (auto& name : imports) {
+        dynsym.push_back(SymbolEntry{
+            .name = offset_and_insert(dynstr, name.c_str()),
+            .info = (0x01 << 4 /* STB_GLOBAL */) | (0x02 /* STT_FUNC */),
+            .shndx = 0,
+            .value = 0,
+            .size = 0
+        });
+    }
+
+    //a single empty bucket, nothing is looked up in the executable
+    std::vector<uint32_t> hash(3 + dynsym.size(), 0);
+    hash[0] = 1;
+    hash[1] = static_cast<uint32_t>(dynsym.size());
+
+    std::vector<uint8_t> rodata;
+    std::vector<size_t> cstringOffsets;
+    for (auto& cstr : object.buff._cstrings) {
+        cstringOffsets.push_back(offset_and_insert(rodata, cstr->string));
+    }
+
+    //file offsets match addresses less ExecutableBase so every segment is
+    //mapped straight from the file
+    auto interpOffset = sizeof(Header) + ProgramHeaderCount * sizeof(ProgramHeader);
+    auto interpSize = std::strlen(Interpreter) + 1;
+    auto dynsymOffset = align_to(interpOffset + interpSize, 8);
+    auto dynsymSize = dynsym.size() * sizeof(SymbolEntry);
+    auto dynstrOffset = dynsymOffset + dynsymSize;
+    auto hashOffset = align_to(dynstrOffset + dynstr.size(), 8);
+    auto hashSize = hash.size() * sizeof(uint32_t);
+    auto relaOffset = align_to(hashOffset + hashSize, 8);
+    auto relaSize = imports.size() * sizeof(RelocationEntry);
+    auto rodataOffset = relaOffset + relaSize;
+    auto readOnlyEnd = rodataOffset + rodata.size();
+
+    auto textOffset = align_to(readOnlyEnd, PageSize);
+    auto pltOffset = textOffset + sizeof(StartCode);
+    auto codeOffset = align_to(pltOffset + imports.size() * PltEntrySize, 16);
+    auto textEnd = codeOffset + code.size();
+
+    std::vector<DynamicEntry> dynamic{
+        {1 /* DT_NEEDED */, libcName},
+        {4 /* DT_HASH */, ExecutableBase + hashOffset},
+        {5 /* DT_STRTAB */, ExecutableBase + dynstrOffset},
+        {6 /* DT_SYMTAB */, ExecutableBase + dynsymOffset},
+        {7 /* DT_RELA */, ExecutableBase + relaOffset},
+        {8 /* DT_RELASZ */, relaSize},
+        {9 /* DT_RELAENT */, sizeof(RelocationEntry)},
+        {10 /* DT_STRSZ */, dynstr.size()},
+        {11 /* DT_SYMENT */, sizeof(SymbolEntry)},
+        {21 /* DT_DEBUG */, 0},
+        {30 /* DT_FLAGS */, 0x8 /* DF_BIND_NOW */},
+        {0 /* DT_NULL */, 0},
+    };
+
+    auto dynamicOffset = align_to(textEnd, PageSize);
+    auto dynamicSize = dynamic.size() * sizeof(DynamicEntry);
+    auto gotOffset = dynamicOffset + dynamicSize;
+    auto dataEnd = gotOffset + imports.size() * sizeof(uint64_t);
+
+    //each GOT slot is filled by the dynamic linker before _start runs
+    std::vector<RelocationEntry> rela;
+    for (size_t i = 0; i < imports.size(); i++) {
+        rela.push_back(RelocationEntry{
+            .offset = ExecutableBase + gotOffset + i * sizeof(uint64_t),
+            .type = 0x06, /* R_X86_64_GLOB_DAT */
+            .symbol = static_cast<uint32_t>(i + 1),
+            .addend = 0
+        });
+    }
+
+    std::vector<uint8_t> image(dataEnd, 0x00);
+    std::memcpy(&image[interpOffset], Interpreter, interpSize);
+    copy_to(image, dynsymOffset, dynsym);
+    copy_to(image, dynstrOffset, dynstr);
+    copy_to(image, hashOffset, hash);
+    copy_to(image, relaOffset, rela);
+    copy_to(image, rodataOffset, rodata);
+    copy_to(image, dynamicOffset, dynamic);
+
+    std::fill(image.begin() + textOffset, image.begin() + textEnd, 0xcc);
+    std::memcpy(&image[textOffset], StartCode, sizeof(StartCode));
+    patch_rel32(image, textOffset + StartCallMain, codeOffset + mainSymbol->offset);
+    patch_rel32(image, textOffset + StartCallExit, pltOffset + exitImport * PltEntrySize);
+
+    //jmp qword ptr [rip + got]; xchg ax, ax
+    for (size_t i = 0; i < imports.size(); i++) {
+        auto entry = pltOffset + i * PltEntrySize;
+        image[entry] = 0xff;
+        image[entry + 1] = 0x25;
+        patch_rel32(image, entry + 2, gotOffset + i * sizeof(uint64_t));
+        image[entry + 6] = 0x66;
+        image[entry + 7] = 0x90;
+    }
+
+    copy_to(image, codeOffset, code);
+    for (auto& externFunc : object.buff._externFuncs) {
+        patch_rel32(image, codeOffset + externFunc.location, pltOffset + importIndex[externFunc.symbol] * PltEntrySize);
+    }
+    for (size_t i = 0; i < object.buff._cstrings.size(); i++) {
+        patch_rel32(image, codeOffset + object.buff._cstrings[i]->location, rodataOffset + cstringOffsets[i]);
+    }
+
+    auto load = [] (uint32_t flags, uint64_t offset, uint64_t size) {
+        return ProgramHeader{
+            .p_type = 1, //PT_LOAD
+            .p_flags = flags,
+            .p_offset = offset,
+            .p_vaddr = ExecutableBase + offset,
+            .p_paddr = ExecutableBase + offset,
+            .p_filesz = size,
+            .p_memsz = size,
+            .p_align = PageSize
+        };
+    };
+
+    ProgramHeader programHeaders[ProgramHeaderCount] = {
+        {
+            .p_type = 6, //PT_PHDR
+            .p_flags = 0x4, //PF_R
+            .p_offset = sizeof(Header),
+            .p_vaddr = ExecutableBase + sizeof(Header),
+            .p_paddr = ExecutableBase + sizeof(Header),
+            .p_filesz = ProgramHeaderCount * sizeof(ProgramHeader),
+            .p_memsz = ProgramHeaderCount * sizeof(ProgramHeader),
+            .p_align = 8
+        },
+        {
+            .p_type = 3, //PT_INTERP
+            .p_flags = 0x4, //PF_R
+            .p_offset = interpOffset,
+            .p_vaddr = ExecutableBase + interpOffset,
+            .p_paddr = ExecutableBase + interpOffset,
+            .p_filesz = interpSize,
+            .p_memsz = interpSize,
+            .p_align = 1
+        },
+        load(0x4 /* PF_R */, 0, readOnlyEnd),
+        load(0x4 | 0x1 /* PF_R | PF_X */, textOffset, textEnd - textOffset),
+        load(0x4 | 0x2 /* PF_R | PF_W */, dynamicOffset, dataEnd - dynamicOffset),
+        {
+            .p_type = 2, //PT_DYNAMIC
+            .p_flags = 0x4 | 0x2, //PF_R | PF_W
+            .p_offset = dynamicOffset,
+            .p_vaddr = ExecutableBase + dynamicOffset,
+            .p_paddr = ExecutableBase + dynamicOffset,
+            .p_filesz = dynamicSize,
+            .p_memsz = dynamicSize,
+            .p_align = 8
+        },
+        {
+            .p_type = 0x6474e551, //PT_GNU_STACK
+            .p_flags = 0x4 | 0x2, //PF_R | PF_W, non executable stack
+        },
+    };
+
+    //section headers aren't needed to run but let the usual tools read the file
+    std::vector<uint8_t> shstrtab_data;
+    shstrtab_data.push_back(0x00);
+    std::vector<SectionHeader> sections(1);
+    auto section = [&] (const char* name, uint32_t type, uint64_t flags, uint64_t offset, uint64_t size, uint64_t align, uint64_t entsize = 0, uint32_t link = 0, uint32_t info = 0) {
+        sections.push_back(SectionHeader{
+            .sh_name = offset_and_insert(shstrtab_data, name),
+            .sh_type = type,
+            .sh_flags = flags,
+            .sh_addr = (flags & 0x2 /* SHF_ALLOC */) ? ExecutableBase + offset : 0,
+            .sh_offset = offset,
+            .sh_size = size,
+            .sh_link = link,
+            .sh_info = info,
+            .sh_addralign = align,
+            .sh_entsize = entsize
+        });
+    };
+
+    section(".interp", 0x1 /* SHT_PROGBITS */, 0x2, interpOffset, interpSize, 1);
+    section(".dynsym", 0xb /* SHT_DYNSYM */, 0x2, dynsymOffset, dynsymSize, 8, sizeof(SymbolEntry), 3, 1);
+    section(".dynstr", 0x3 /* SHT_STRTAB */, 0x2, dynstrOffset, dynstr.size(), 1);
+    section(".hash", 0x5 /* SHT_HASH */, 0x2, hashOffset, hashSize, 8, sizeof(uint32_t), 2);
+    section(".rela.dyn", 0x4 /* SHT_RELA */, 0x2, relaOffset, relaSize, 8, sizeof(RelocationEntry), 2);
+    section(".rodata", 0x1 /* SHT_PROGBITS */, 0x2, rodataOffset, rodata.size(), 1);
+    section(".text", 0x1 /* SHT_PROGBITS */, 0x2 | 0x4 /* SHF_ALLOC | SHF_EXECINSTR */, textOffset, textEnd - textOffset, 16);
+    section(".dynamic", 0x6 /* SHT_DYNAMIC */, 0x2 | 0x1 /* SHF_ALLOC | SHF_WRITE */, dynamicOffset, dynamicSize, 8, sizeof(DynamicEntry), 3);
+    section(".got", 0x1 /* SHT_PROGBITS */, 0x2 | 0x1 /* SHF_ALLOC | SHF_WRITE */, gotOffset, imports.size() * sizeof(uint64_t), 8, sizeof(uint64_t));
+
+    //addresses are final so debug info needs no relocations
+    auto debug = dwarf::DebugSections::generate(object, ExecutableBase + codeOffset);
+    for (auto [name, contents] : {std::pair{".debug_abbrev", &debug.abbrev}, {".debug_info", &debug.info}, {".debug_line", &debug.line}}) {
+        section(name, 0x1 /* SHT_PROGBITS */, 0, image.size(), contents->size(), 1);
+        image.insert(image.end(), contents->begin(), contents->end());
+    }
+    section(".shstrtab", 0x3 /* SHT_STRTAB */, 0, image.size(), 0, 1);
+    sections.back().sh_size = shstrtab_data.size();
+    image.insert(image.end(), shstrtab_data.begin(), shstrtab_data.end());
+
+    Header elfheader;
+    elfheader.type = 2; //executable file
+    elfheader.e_entry = ExecutableBase + textOffset;
+    elfheader.e_phoff = sizeof(Header);
+    elfheader.e_phentsize = sizeof(ProgramHeader);
+    elfheader.e_phnum = ProgramHeaderCount;
+    elfheader.e_shoff = align_to(image.size(), 8);
+    elfheader.e_shentsize = sizeof(SectionHeader);
+    elfheader.e_shnum = static_cast<uint16_t>(sections.size());
+    elfheader.e_shstrndx = static_cast<uint16_t>(sections.size() - 1);
+    image.resize(elfheader.e_shoff, 0x00);
+
+    std::memcpy(&image[0], &elfheader, sizeof(elfheader));
+    std::memcpy(&image[sizeof(Header)], programHeaders, sizeof(programHeaders));
+
+    write_os(out, image.data(), image.size());
+    write_os(out, sections.data(), sections.size() * sizeof(SectionHeader));
+}
+
+void elf::write_symbol_file(std::ostream& out, const ll::Object& object, uint64_t address) {
+    std::vector<uint8_t> strtab_data;
+    strtab_data.push_back(0x00);
+    std::vector<SymbolEntry> symbols;
+    symbols.push_back(SymbolEntry{.name = 0, .info = 0, .shndx = 0, .value = 0, .size = 0});
+    for (auto& function : object.function_extents()) {
+        symbols.push_back(SymbolEntry{
+            .name = offset_and_insert(strtab_data, std::string(function.name)),
+            .info = (0x01 << 4 /* STB_GLOBAL */) | (0x02 /* STT_FUNC */),
+            .shndx = 1, // .text
+            .value = function.offset,
+            .size = function.size,
+        });
+    }
+
+    std::vector<uint8_t> data;
+    std::vector<uint8_t> shstrtab_data;
+    shstrtab_data.push_back(0x00);
+    Header elfheader;
+
+    SectionHeader nullsection;
+
+    SectionHeader text;
+    text.sh_name = offset_and_insert(shstrtab_data, ".text");
+    text.sh_type = 0x8; //SHT_NOBITS
+    text.sh_flags = 0x2 /* SHF_ALLOC */ | 0x4 /* SHF_EXECINSTR */;
+    text.sh_addr = address;
+    text.sh_offset = sizeof(elfheader);
+    text.sh_size = object.buff.buffer().size();
+    text.sh_addralign = 1;
+
+    SectionHeader symtab;
+    symtab.sh_name = offset_and_insert(shstrtab_data, ".symtab");
+    symtab.sh_type = 0x2; //SHT_SYMTAB
+    symtab.sh_offset = data.size() + sizeof(elfheader);
+    symtab.sh_size = symbols.size() * sizeof(SymbolEntry);
+    symtab.sh_link = 3; //strtab shidx
+    symtab.sh_info = 1; //one greater than the last LOCAL symbol table index
+    symtab.sh_entsize = sizeof(SymbolEntry);
+    symtab.sh_addralign = 8;
+    bytes_to_vec(data, symbols.data(), symtab.sh_size);
+
+    SectionHeader strtab;
+    strtab.sh_name = offset_and_insert(shstrtab_data, ".strtab");
+    strtab.sh_type = 0x3; //SHT_STRTAB
+    strtab.sh_offset = data.size() + sizeof(elfheader);
+    strtab.sh_size = strtab_data.size();
+    strtab.sh_addralign = 1;
+    bytes_to_vec(data, strtab_data.data(), strtab.sh_size);
+
+    SectionHeader shstrtab;
+    shstrtab.sh_name = offset_and_insert(shstrtab_data, ".shstrtab");
+    shstrtab.sh_type = 0x3; //SHT_STRTAB
+    shstrtab.sh_offset = data.size() + sizeof(elfheader);
+    shstrtab.sh_size = shstrtab_data.size();
+    shstrtab.sh_addralign = 1;
+    bytes_to_vec(data, shstrtab_data.data(), shstrtab_data.size());
+
+    data.resize(align_to(data.size() + sizeof(elfheader), 8) - sizeof(elfheader), 0x00);
+    elfheader.e_shoff = data.size() + sizeof(elfheader);
+    elfheader.e_shentsize = sizeof(SectionHeader);
+    elfheader.e_shnum = 5;
+    elfheader.e_shstrndx = 4;
+    write_os(out, &elfheader, sizeof(elfheader));
+
+    write_os(out, data.data(), data.size());
+
+    write_os(out, &nullsection, sizeof(SectionHeader));
+    write_os(out, &text, sizeof(SectionHeader));
+    write_os(out, &symtab, sizeof(SectionHeader));
+    write_os(out, &strtab, sizeof(SectionHeader));
+    write_os(out, &shstrtab, sizeof(SectionHeader));
+}
@@ -7,13 +7,27 @@
 
 class InstrBufferx64;
 
+namespace ll {
+    struct Object;
+}
+
 #include <cstdint>
 #include <map>
 #include <ostream>
 #include <vector>
 
 namespace elf {
-    void write(std::ostream& out, InstrBufferx64& buff);
+    //relocatable object with a global function symbol for each function
+    void write(std::ostream& out, const ll::Object& object);
+
+    //complete dynamically linked executable, no system linker needed. The
+    //object must be compiled in object file mode and have a main function,
+    //calls left unresolved are imported from libc through a PLT.
+    void write_executable(std::ostream& out, const ll::Object& object);
+
+    //symbols only, for debuggers to name JIT compiled code already loaded at
+    //address. The .text section holds no bytes, only its address and size.
+    void write_symbol_file(std::ostream& out, const ll::Object& object, uint64_t address);
 
     struct Header {
         uint32_t magic = 0x464c457f;
@@ -52,6 +66,23 @@ namespace elf {
     };
     static_assert(sizeof(SectionHeader) == 64);
 
+    struct ProgramHeader {
+        uint32_t p_type = 0;
+        uint32_t p_flags = 0;
+        uint64_t p_offset = 0;
+        uint64_t p_vaddr = 0;
+        uint64_t p_paddr = 0;
+        uint64_t p_filesz = 0;
+        uint64_t p_memsz = 0;
+        uint64_t p_align = 0;
+    };
+    static_assert(sizeof(ProgramHeader) == 56);
+
+    struct DynamicEntry {
+        int64_t tag;
+        uint64_t value;
+    };
+
     struct RelocationEntry {
         uint64_t offset;
         uint32_t type;
@@ -74,6 +105,6 @@ namespace elf {
         std::vector<uint8_t> strtab;
         std::vector<uint8_t> rodata;
 
-        static RelocationData generate(InstrBufferx64& instrs);
+        static RelocationData generate(const ll::Object& object);
     };
 };
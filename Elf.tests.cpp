@@ -0,0 +1,115 @@
+//------------------------------------------------------------------------------
+// Elf.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "Elf.hpp"
+
+#include "Linker.hpp"
+#include "TestPrograms.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+namespace {
+    std::string run(const std::filesystem::path& exe, int& status) {
+        std::string output;
+        auto pipe = popen(exe.c_str(), "r");
+        char buffer[256];
+        while (auto read = fread(buffer, 1, sizeof(buffer), pipe)) {
+            output.append(buffer, read);
+        }
+        status = pclose(pipe);
+        return output;
+    }
+}
+
+TEST(Elf, write_executable_header) {
+    auto object = ll::test::compile_object(R"(fn main() { puts("a"); })");
+    std::stringstream ss;
+    elf::write_executable(ss, object);
+    auto data = ss.str();
+
+    ASSERT_GT(data.size(), sizeof(elf::Header));
+    elf::Header header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    EXPECT_EQ(header.magic, 0x464c457f);
+    EXPECT_EQ(header.type, 2);
+    EXPECT_EQ(header.e_phentsize, sizeof(elf::ProgramHeader));
+    EXPECT_EQ(header.e_phnum, 7);
+    EXPECT_NE(data.find("/lib64/ld-linux-x86-64.so.2"), std::string::npos);
+    EXPECT_NE(data.find("libc.so.6"), std::string::npos);
+}
+
+TEST(Elf, write_executable_needs_main) {
+    auto object = ll::test::compile_object(R"(fn other() { })");
+    std::stringstream ss;
+    EXPECT_THROW(elf::write_executable(ss, object), std::runtime_error);
+}
+
+#ifdef __linux__
+TEST(Elf, write_executable_runs) {
+    auto object = ll::test::compile_object(R"(
+    fn count() {
+        int64 i;
+        i = 0;
+        while (i < 3) {
+            printf("%i,", i);
+            i = i + 1;
+        }
+    }
+    fn main() { count(); puts("done"); }
+    )");
+
+    auto exe = std::filesystem::temp_directory_path() / ("ll_exe_" + std::to_string(::getpid()));
+    {
+        std::ofstream file(exe, std::ios::binary);
+        elf::write_executable(file, object);
+    }
+    std::filesystem::permissions(exe, std::filesystem::perms::owner_exec, std::filesystem::perm_options::add);
+
+    int status = -1;
+    auto output = run(exe, status);
+    std::filesystem::remove(exe);
+
+    EXPECT_EQ(output, "0,1,2,done\n");
+    EXPECT_EQ(status, 0);
+}
+#endif
+
+TEST(Elf, relocation_data_function_symbols) {
+    auto object = ll::test::compile_object(R"(
+    fn helper() { puts("h"); }
+    fn main() { helper(); puts("m"); printf("x"); }
+    )");
+    auto rd = elf::RelocationData::generate(object);
+
+    //null, file, .text, .rodata, .debug_abbrev, .debug_line, then helper, main,
+    //puts, printf
+    ASSERT_EQ(rd.symbols.size(), 10);
+    auto name = [&rd] (size_t i) {
+        return std::string(reinterpret_cast<const char*>(&rd.strtab[rd.symbols[i].name]));
+    };
+
+    EXPECT_EQ(name(6), "helper");
+    EXPECT_EQ(rd.symbols[6].info, 0x12);
+    EXPECT_EQ(rd.symbols[6].value, 0);
+    EXPECT_EQ(rd.symbols[6].size, object.symbols[1].offset);
+
+    EXPECT_EQ(name(7), "main");
+    EXPECT_EQ(rd.symbols[7].info, 0x12);
+    EXPECT_EQ(rd.symbols[7].value, object.symbols[1].offset);
+    EXPECT_EQ(rd.symbols[7].size, object.buff.buffer().size() - object.symbols[1].offset);
+
+    //the call to helper is resolved, puts is imported once
+    EXPECT_EQ(name(8), "puts");
+    EXPECT_EQ(rd.symbols[8].shndx, 0);
+    EXPECT_EQ(name(9), "printf");
+    EXPECT_EQ(rd.relocs.size(), 3 + 3); //three strings, three calls
+}
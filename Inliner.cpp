@@ -0,0 +1,567 @@
+//------------------------------------------------------------------------------
+// Inliner.cpp
+//------------------------------------------------------------------------------
+
+#include "Inliner.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::size_t cost_of(const Param* param) {
+    auto statementParam = node_cast<const StatementParam>(param);
+    if (statementParam == nullptr) {
+        return param ? 1 : 0;
+    }
+
+    if (auto calc = node_cast<const Int64Calcuation>(statementParam->statement)) {
+        return 1 + cost_of(calc->lhs) + cost_of(calc->rhs);
+    }
+
+    auto call = static_cast<const FunctionCall*>(statementParam->statement);
+    std::size_t cost = 1;
+    for (auto arg : call->params) {
+        cost += cost_of(arg);
+    }
+    return cost;
+}
+
+bool contains_call(const Param* param) {
+    auto statementParam = node_cast<const StatementParam>(param);
+    if (statementParam == nullptr) {
+        return false;
+    }
+
+    if (auto calc = node_cast<const Int64Calcuation>(statementParam->statement)) {
+        return contains_call(calc->lhs) || contains_call(calc->rhs);
+    }
+    return statementParam->statement->kind == NodeKind::FunctionCall;
+}
+
+std::size_t uses_of(const Param* param, std::string_view name) {
+    if (auto variable = node_cast<const StackVariableParam>(param)) {
+        return variable->content == name ? 1 : 0;
+    }
+
+    auto statementParam = node_cast<const StatementParam>(param);
+    if (statementParam == nullptr) {
+        return 0;
+    }
+
+    if (auto calc = node_cast<const Int64Calcuation>(statementParam->statement)) {
+        return uses_of(calc->lhs, name) + uses_of(calc->rhs, name);
+    }
+
+    std::size_t uses = 0;
+    for (auto arg : static_cast<const FunctionCall*>(statementParam->statement)->params) {
+        uses += uses_of(arg, name);
+    }
+    return uses;
+}
+
+//anything but the final statement of the function returning would need a jump
+//out of the spliced statements
+bool returns_early(const Block& block, const Statement* last) {
+    for (auto statement : block.statements) {
+        switch (statement->kind) {
+            case NodeKind::ReturnStatement:
+                if (statement != last) {
+                    return true;
+                }
+                break;
+
+            case NodeKind::IfChainStatement:
+                for (auto ifStatement : static_cast<const IfChainStatement*>(statement)->_ifstatements) {
+                    if (returns_early(*ifStatement->block, nullptr)) {
+                        return true;
+                    }
+                }
+                break;
+
+            case NodeKind::LoopStatement:
+                if (returns_early(*static_cast<const LoopStatement*>(statement)->_ifStatement->block, nullptr)) {
+                    return true;
+                }
+                break;
+
+            default:
+                break;
+        }
+    }
+    return false;
+}
+
+FunctionCall* call_in(Param* param) {
+    auto statementParam = node_cast<StatementParam>(param);
+    return statementParam ? node_cast<FunctionCall>(statementParam->statement) : nullptr;
+}
+
+}
+
+Inliner::Inliner(ll::Arena& arena)
+: _arena(arena)
+{
+}
+
+void Inliner::inline_translation_unit(ll::TranslationUnit& tu) {
+    for (auto function : tu.functions) {
+        _functions.emplace(function->name, function);
+        _states.emplace(function, State::Pending);
+    }
+
+    for (auto function : tu.functions) {
+        inline_function(function);
+    }
+}
+
+std::size_t Inliner::cost(const Block& block) {
+    std::size_t cost = 0;
+    for (auto statement : block.statements) {
+        cost++;
+
+        switch (statement->kind) {
+            case NodeKind::FunctionCall:
+                for (auto param : static_cast<const FunctionCall*>(statement)->params) {
+                    cost += cost_of(param);
+                }
+                break;
+
+            case NodeKind::VariableAssignment:
+                cost += 1 + cost_of(static_cast<const VariableAssignment*>(statement)->value);
+                break;
+
+            case NodeKind::ReturnStatement:
+                cost += cost_of(static_cast<const ReturnStatement*>(statement)->value);
+                break;
+
+            case NodeKind::IfChainStatement:
+                for (auto ifStatement : static_cast<const IfChainStatement*>(statement)->_ifstatements) {
+                    cost += 1 + cost_of(ifStatement->lhs) + cost_of(ifStatement->rhs) + Inliner::cost(*ifStatement->block);
+                }
+                break;
+
+            case NodeKind::LoopStatement:
+            {
+                auto ifStatement = static_cast<const LoopStatement*>(statement)->_ifStatement;
+                cost += 1 + cost_of(ifStatement->lhs) + cost_of(ifStatement->rhs) + Inliner::cost(*ifStatement->block);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+    return cost;
+}
+
+void Inliner::inline_function(ll::FunctionDefinition* function) {
+    auto& state = _states[function];
+    if (state != State::Pending) {
+        return;
+    }
+
+    state = State::Visiting;
+    inline_block(function->block, false);
+    _states[function] = State::Done;
+}
+
+void Inliner::inline_block(Block* block, bool inLoop) {
+    for (std::size_t i = 0; i < block->statements.size();) {
+        inline_nested(block->statements[i], inLoop);
+
+        if (auto spliced = splice(block, i, inLoop)) {
+            //the copy was already inlined into when its function was
+            i += *spliced;
+        } else {
+            i++;
+        }
+    }
+}
+
+void Inliner::inline_nested(Statement* statement, bool inLoop) {
+    switch (statement->kind) {
+        case NodeKind::FunctionCall:
+            for (auto& param : static_cast<FunctionCall*>(statement)->params) {
+                inline_param(param, inLoop);
+            }
+            break;
+
+        case NodeKind::VariableAssignment:
+            inline_param(static_cast<VariableAssignment*>(statement)->value, inLoop);
+            break;
+
+        case NodeKind::ReturnStatement:
+            inline_param(static_cast<ReturnStatement*>(statement)->value, inLoop);
+            break;
+
+        case NodeKind::IfChainStatement:
+            for (auto ifStatement : static_cast<IfChainStatement*>(statement)->_ifstatements) {
+                inline_param(ifStatement->lhs, inLoop);
+                inline_param(ifStatement->rhs, inLoop);
+                inline_block(ifStatement->block, inLoop);
+            }
+            break;
+
+        case NodeKind::LoopStatement:
+        {
+            auto ifStatement = static_cast<LoopStatement*>(statement)->_ifStatement;
+            inline_param(ifStatement->lhs, true);
+            inline_param(ifStatement->rhs, true);
+            inline_block(ifStatement->block, true);
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void Inliner::inline_param(Param*& param, bool inLoop) {
+    auto statementParam = node_cast<StatementParam>(param);
+    if (statementParam == nullptr) {
+        return;
+    }
+
+    if (auto calc = node_cast<Int64Calcuation>(statementParam->statement)) {
+        inline_param(calc->lhs, inLoop);
+        inline_param(calc->rhs, inLoop);
+        return;
+    }
+
+    auto call = node_cast<FunctionCall>(statementParam->statement);
+    if (call == nullptr) {
+        return;
+    }
+
+    for (auto& arg : call->params) {
+        inline_param(arg, inLoop);
+    }
+
+    auto function = callee(*call, inLoop);
+    if (function == nullptr) {
+        return;
+    }
+
+    //only a lone return of the parameters can become part of the expression
+    auto& body = *function->block;
+    if (body.vars.size() != body.parameters || body.statements.size() != 1) {
+        return;
+    }
+    auto ret = node_cast<ReturnStatement>(body.statements.front());
+    if (ret == nullptr || ret->value == nullptr) {
+        return;
+    }
+
+    //arguments must be free of side effects to be moved or dropped, and cheap
+    //to be evaluated more than once
+    Substitutions substitutions;
+    for (std::size_t i = 0; i < body.parameters; i++) {
+        auto arg = call->params[i];
+        if (contains_call(arg)) {
+            return;
+        }
+        if (arg->kind == NodeKind::StatementParam && uses_of(ret->value, body.vars[i].name) > 1) {
+            return;
+        }
+        substitutions[body.vars[i].name] = arg;
+    }
+
+    param = clone(ret->value, substitutions);
+    _inlined++;
+}
+
+std::optional<std::size_t> Inliner::splice(Block* block, std::size_t index, bool inLoop) {
+    auto statement = block->statements[index];
+
+    FunctionCall* call = nullptr;
+    switch (statement->kind) {
+        case NodeKind::FunctionCall:
+            call = static_cast<FunctionCall*>(statement);
+            break;
+
+        case NodeKind::VariableAssignment:
+            call = call_in(static_cast<VariableAssignment*>(statement)->value);
+            break;
+
+        case NodeKind::ReturnStatement:
+            call = call_in(static_cast<ReturnStatement*>(statement)->value);
+            break;
+
+        default:
+            break;
+    }
+
+    if (call == nullptr) {
+        return std::nullopt;
+    }
+
+    auto function = callee(*call, inLoop);
+    if (function == nullptr) {
+        return std::nullopt;
+    }
+
+    auto& body = *function->block;
+    ReturnStatement* ret = body.statements.empty() ? nullptr : node_cast<ReturnStatement>(body.statements.back());
+    if (returns_early(body, ret)) {
+        return std::nullopt;
+    }
+
+    auto value = ret ? ret->value : nullptr;
+    if (statement->kind != NodeKind::FunctionCall && value == nullptr) {
+        return std::nullopt;
+    }
+
+    std::vector<Statement*> spliced;
+    Substitutions substitutions;
+
+    auto add_variable = [&] (std::string_view name, VariableDefinition::Type type) {
+        auto variable = _arena.make<StackVariableParam>();
+        variable->content = rename(*function, name);
+        block->vars.push_back({.name = variable->content, .type = type});
+        return variable;
+    };
+
+    for (std::size_t i = 0; i < body.vars.size(); i++) {
+        auto& var = body.vars[i];
+        auto variable = add_variable(var.name, var.type);
+        substitutions[var.name] = variable;
+
+        if (i < body.parameters) {
+            auto assignment = _arena.make<VariableAssignment>();
+            assignment->span = statement->span;
+            assignment->to.content = variable->content;
+            assignment->value = call->params[i];
+            spliced.push_back(assignment);
+        }
+    }
+
+    for (auto bodyStatement : body.statements) {
+        if (bodyStatement != ret) {
+            spliced.push_back(clone(bodyStatement, block, substitutions));
+        }
+    }
+
+    if (value) {
+        auto result = clone(value, substitutions);
+        switch (statement->kind) {
+            case NodeKind::VariableAssignment:
+                static_cast<VariableAssignment*>(statement)->value = result;
+                spliced.push_back(statement);
+                break;
+
+            case NodeKind::ReturnStatement:
+                static_cast<ReturnStatement*>(statement)->value = result;
+                spliced.push_back(statement);
+                break;
+
+            default:
+                //an unused result only matters for the calls it makes
+                if (contains_call(result)) {
+                    auto assignment = _arena.make<VariableAssignment>();
+                    assignment->span = statement->span;
+                    assignment->to.content = add_variable("result", VariableDefinition::Int64)->content;
+                    assignment->value = result;
+                    spliced.push_back(assignment);
+                }
+                break;
+        }
+    }
+
+    block->statements.erase(block->statements.begin() + index);
+    block->statements.insert(block->statements.begin() + index, spliced.begin(), spliced.end());
+    _inlined++;
+
+    //the argument assignments are caller code, calls they make can be spliced
+    //in turn ahead of them
+    auto count = spliced.size();
+    auto end = index + body.parameters;
+    for (auto i = index; i < end; i++) {
+        if (auto more = splice(block, i, inLoop)) {
+            count += *more - 1;
+            end += *more - 1;
+            i += *more - 1;
+        }
+    }
+    return count;
+}
+
+const ll::FunctionDefinition* Inliner::callee(const FunctionCall& call, bool inLoop) {
+    auto it = _functions.find(call.functionName);
+    if (it == _functions.end()) {
+        return nullptr;
+    }
+
+    auto function = it->second;
+    inline_function(function);
+    if (_states[function] != State::Done) {
+        return nullptr;
+    }
+
+    auto& body = *function->block;
+    if (body.parameters != call.params.size()) {
+        return nullptr;
+    }
+
+    if (cost(body) > (inLoop ? MaxLoopCost : MaxCost)) {
+        return nullptr;
+    }
+
+    return function;
+}
+
+std::string_view Inliner::rename(const ll::FunctionDefinition& function, std::string_view name) {
+    //'.' can't appear in an identifier so these never clash with the source
+    std::string renamed;
+    renamed.append(function.name).append(".").append(name).append(".").append(std::to_string(_renamed++));
+    return _arena.copy(renamed);
+}
+
+Param* Inliner::clone(const Param* param, const Substitutions& substitutions) {
+    if (param == nullptr) {
+        return nullptr;
+    }
+
+    switch (param->kind) {
+        case NodeKind::StringParam:
+        {
+            auto copy = _arena.make<StringParam>();
+            copy->span = param->span;
+            copy->content = static_cast<const StringParam*>(param)->content;
+            return copy;
+        }
+
+        case NodeKind::Int64Param:
+        {
+            auto copy = _arena.make<Int64Param>();
+            copy->span = param->span;
+            copy->content = static_cast<const Int64Param*>(param)->content;
+            return copy;
+        }
+
+        case NodeKind::StackVariableParam:
+        {
+            auto name = static_cast<const StackVariableParam*>(param)->content;
+            auto it = substitutions.find(name);
+            if (it != substitutions.end()) {
+                return clone(it->second, {});
+            }
+
+            auto copy = _arena.make<StackVariableParam>();
+            copy->span = param->span;
+            copy->content = name;
+            return copy;
+        }
+
+        case NodeKind::StatementParam:
+        {
+            auto copy = _arena.make<StatementParam>();
+            copy->span = param->span;
+            copy->statement = clone(static_cast<const StatementParam*>(param)->statement, nullptr, substitutions);
+            return copy;
+        }
+
+        default:
+            throw std::runtime_error("unknown parameter");
+    }
+}
+
+Statement* Inliner::clone(const Statement* statement, Block* parent, const Substitutions& substitutions) {
+    switch (statement->kind) {
+        case NodeKind::FunctionCall:
+        {
+            auto call = static_cast<const FunctionCall*>(statement);
+            auto copy = _arena.make<FunctionCall>();
+            copy->span = call->span;
+            copy->functionName = call->functionName;
+            for (auto param : call->params) {
+                copy->params.push_back(clone(param, substitutions));
+            }
+            return copy;
+        }
+
+        case NodeKind::VariableAssignment:
+        {
+            auto assignment = static_cast<const VariableAssignment*>(statement);
+            auto copy = _arena.make<VariableAssignment>();
+            copy->span = assignment->span;
+            auto to = node_cast<StackVariableParam>(clone(&assignment->to, substitutions));
+            if (to == nullptr) {
+                throw std::runtime_error("assignment to a non variable");
+            }
+            copy->to.content = to->content;
+            copy->to.span = assignment->to.span;
+            copy->value = clone(assignment->value, substitutions);
+            return copy;
+        }
+
+        case NodeKind::Int64Calcuation:
+        {
+            auto calc = static_cast<const Int64Calcuation*>(statement);
+            auto copy = _arena.make<Int64Calcuation>();
+            copy->span = calc->span;
+            copy->operation = calc->operation;
+            copy->lhs = clone(calc->lhs, substitutions);
+            copy->rhs = clone(calc->rhs, substitutions);
+            return copy;
+        }
+
+        case NodeKind::IfChainStatement:
+        {
+            auto copy = _arena.make<IfChainStatement>();
+            copy->span = statement->span;
+            for (auto ifStatement : static_cast<const IfChainStatement*>(statement)->_ifstatements) {
+                copy->_ifstatements.push_back(clone(*ifStatement, parent, substitutions));
+            }
+            return copy;
+        }
+
+        case NodeKind::LoopStatement:
+        {
+            auto copy = _arena.make<LoopStatement>();
+            copy->span = statement->span;
+            copy->_ifStatement = clone(*static_cast<const LoopStatement*>(statement)->_ifStatement, parent, substitutions);
+            return copy;
+        }
+
+        case NodeKind::ReturnStatement:
+        {
+            auto copy = _arena.make<ReturnStatement>();
+            copy->span = statement->span;
+            copy->value = clone(static_cast<const ReturnStatement*>(statement)->value, substitutions);
+            return copy;
+        }
+
+        default:
+            throw std::runtime_error("unknown statement");
+    }
+}
+
+IfStatement* Inliner::clone(const IfStatement& ifStatement, Block* parent, const Substitutions& substitutions) {
+    auto copy = _arena.make<IfStatement>();
+    copy->span = ifStatement.span;
+    copy->comparator = ifStatement.comparator;
+    copy->lhs = clone(ifStatement.lhs, substitutions);
+    copy->rhs = clone(ifStatement.rhs, substitutions);
+    copy->block = clone(*ifStatement.block, parent, substitutions);
+    return copy;
+}
+
+Block* Inliner::clone(const Block& block, Block* parent, Substitutions substitutions) {
+    auto copy = _arena.make<Block>();
+    copy->parent = parent;
+
+    //nested callee variables are renamed too, keeping them clear of the caller
+    for (auto& var : block.vars) {
+        auto variable = _arena.make<StackVariableParam>();
+        variable->content = _arena.copy(std::string(var.name) + "." + std::to_string(_renamed++));
+        copy->vars.push_back({.name = variable->content, .type = var.type});
+        substitutions[var.name] = variable;
+    }
+
+    for (auto statement : block.statements) {
+        copy->statements.push_back(clone(statement, copy, substitutions));
+    }
+    return copy;
+}
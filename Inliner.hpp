@@ -0,0 +1,70 @@
+//------------------------------------------------------------------------------
+// Inliner.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Arena.hpp"
+#include "Statement.hpp"
+#include "TranslationUnit.hpp"
+
+#include <cstddef>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+//AST pass run between the Parser and the ConstantFolder. Calls to small
+//functions of the same translation unit are replaced with a copy of the callee.
+//A callee that only returns an expression of its parameters is substituted into
+//the calling expression. Otherwise the body is spliced in place of the call
+//statement with its parameters and locals renamed into the caller's
+//Block::vars, and the arguments assigned to the renamed parameters. Callees are
+//inlined into first so chains of helpers collapse, recursion is left as calls.
+//Copies come from the arena that owns the translation unit.
+class Inliner {
+public:
+    //size of a callee in AST nodes, calls in loops run often enough to accept
+    //larger bodies
+    static constexpr std::size_t MaxCost = 16;
+    static constexpr std::size_t MaxLoopCost = 48;
+
+    using Substitutions = std::unordered_map<std::string_view, Param*>;
+
+private:
+    enum class State {
+        Pending,
+        Visiting,
+        Done
+    };
+
+    ll::Arena& _arena;
+    std::unordered_map<std::string_view, ll::FunctionDefinition*> _functions;
+    std::unordered_map<const ll::FunctionDefinition*, State> _states;
+    std::size_t _inlined = 0;
+    std::size_t _renamed = 0;
+
+public:
+    Inliner(ll::Arena& arena);
+
+    void inline_translation_unit(ll::TranslationUnit& tu);
+
+    //call sites replaced so far
+    std::size_t inlined() const { return _inlined; }
+
+    static std::size_t cost(const Block& block);
+
+private:
+    void inline_function(ll::FunctionDefinition* function);
+    void inline_block(Block* block, bool inLoop);
+    void inline_nested(Statement* statement, bool inLoop);
+    void inline_param(Param*& param, bool inLoop);
+    //number of statements that replaced the call, nullopt if left alone
+    std::optional<std::size_t> splice(Block* block, std::size_t index, bool inLoop);
+    const ll::FunctionDefinition* callee(const FunctionCall& call, bool inLoop);
+
+    std::string_view rename(const ll::FunctionDefinition& function, std::string_view name);
+    Param* clone(const Param* param, const Substitutions& substitutions);
+    Statement* clone(const Statement* statement, Block* parent, const Substitutions& substitutions);
+    IfStatement* clone(const IfStatement& ifStatement, Block* parent, const Substitutions& substitutions);
+    Block* clone(const Block& block, Block* parent, Substitutions substitutions);
+};
@@ -0,0 +1,116 @@
+//------------------------------------------------------------------------------
+// Inliner.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "Inliner.hpp"
+
+#include "JitModule.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace ll;
+
+namespace {
+    TranslationUnitPtr inlined(std::string_view program, std::size_t expected) {
+        auto tu = TranslationUnit::parse_translation_unit(program);
+        Inliner inliner(tu->arena);
+        inliner.inline_translation_unit(*tu);
+        EXPECT_EQ(inliner.inlined(), expected);
+        return tu;
+    }
+
+    Block& body(TranslationUnit& tu, std::string_view name) {
+        for (auto function : tu.functions) {
+            if (function->name == name) {
+                return *function->block;
+            }
+        }
+        throw std::runtime_error("no function");
+    }
+
+    std::string run(TranslationUnit& tu) {
+        auto module = JitModule::finalise(Object::compile_translation_unit(tu, Compiler_x64::Mode::JIT));
+        testing::internal::CaptureStdout();
+        module.function<void()>("main")();
+        fflush(stdout);
+        return testing::internal::GetCapturedStdout();
+    }
+}
+
+TEST(Inliner, substitute_expression) {
+    auto tu = inlined(R"(
+    fn add(int64 a, int64 b) { return a + b; }
+    fn main() { int64 x; x = 1; x = add(x, 2) + add(add(x, 3), 4); printf("%i", x); }
+    )", 3);
+
+    auto& main = body(*tu, "main");
+    EXPECT_EQ(main.vars.size(), 1);
+    auto assignment = node_cast<VariableAssignment>(main.statements[1]);
+    ASSERT_NE(assignment, nullptr);
+    auto calc = node_cast<Int64Calcuation>(node_cast<StatementParam>(assignment->value)->statement);
+    ASSERT_NE(calc, nullptr);
+    auto lhs = node_cast<Int64Calcuation>(node_cast<StatementParam>(calc->lhs)->statement);
+    ASSERT_NE(lhs, nullptr);
+    EXPECT_EQ(node_cast<StackVariableParam>(lhs->lhs)->content, "x");
+    EXPECT_EQ(node_cast<Int64Param>(lhs->rhs)->content, 2);
+
+    EXPECT_EQ(run(*tu), "11");
+}
+
+TEST(Inliner, splice_renames_into_caller) {
+    auto tu = inlined(R"(
+    fn show(int64 a) { int64 b; b = a + 1; printf("%i ", b); }
+    fn twice(int64 a) { int64 c; c = a + a; if (4 < c) { c = c + 1; } return c; }
+    fn main() { int64 x; x = twice(3); show(x); show(twice(1)); }
+    )", 4);
+
+    auto& main = body(*tu, "main");
+    EXPECT_EQ(main.parameters, 0);
+    ASSERT_GT(main.vars.size(), 1);
+    EXPECT_EQ(main.vars[0].name, "x");
+    EXPECT_EQ(main.vars[1].name, "twice.a.0");
+    for (auto statement : main.statements) {
+        if (auto call = node_cast<FunctionCall>(statement)) {
+            EXPECT_EQ(call->functionName, "printf");
+        }
+    }
+
+    EXPECT_EQ(run(*tu), "8 3 ");
+}
+
+TEST(Inliner, keeps_calls_it_cannot_inline) {
+    auto tu = inlined(R"(
+    fn count(int64 n) { if (n < 5) { return count(n + 1); } return n; }
+    fn early(int64 n) { if (n < 5) { return 1; } printf("big"); return 2; }
+    fn main() { printf("%i %i %i", count(0), early(1), early(9)); }
+    )", 0);
+
+    EXPECT_EQ(run(*tu), "big5 1 2");
+}
+
+TEST(Inliner, arguments_evaluated_once) {
+    auto tu = inlined(R"(
+    fn double(int64 a) { return a + a; }
+    fn next(int64 a) { printf("n"); return a + 1; }
+    fn main() { int64 x; x = double(next(1)); printf("%i", x); }
+    )", 2);
+
+    //next prints, so its result goes through double's parameter rather than
+    //being substituted twice
+    EXPECT_EQ(run(*tu), "n4");
+}
+
+TEST(Inliner, cost_limits) {
+    std::string program = "fn big(int64 a) {";
+    for (int i = 0; i < 8; i++) {
+        program += " a = a + 1;";
+    }
+    program += R"( return a; }
+    fn main() { int64 i; i = big(0); while (i < 10) { i = big(i); } printf("%i", i); }
+    )";
+
+    auto tu = inlined(program, 1);
+    ASSERT_GT(Inliner::cost(body(*tu, "big")), Inliner::MaxCost);
+    ASSERT_LE(Inliner::cost(body(*tu, "big")), Inliner::MaxLoopCost);
+    EXPECT_EQ(run(*tu), "16");
+}
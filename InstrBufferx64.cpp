@@ -5,39 +5,161 @@
 
 #include "InstrBufferx64.hpp"
 
+#include "CodeHeap.hpp"
+
 #include <algorithm>
 #include <cstring>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
 #include <vector>
-#include <sys/mman.h>
 
-void InstrBufferx64::execute(std::size_t entrypoint) {
-    if (_buffer.empty()) {
-        return;
+namespace {
+    using Register = InstrBufferx64::Register;
+    using Op = InstrBufferx64::Instruction::Op;
+
+    constexpr std::uint32_t bit(Register reg) {
+        return 1u << static_cast<int>(reg);
+    }
+
+    std::uint32_t bits(const InstrBufferx64::Memory& mem) {
+        return bit(mem.base) | (mem.index ? bit(*mem.index) : 0);
     }
 
-    void* exememory = nullptr;
+    constexpr std::uint32_t AllBits = 0xffff | InstrBufferx64::FlagsBit;
+    constexpr std::uint32_t ArgumentBits = bit(Register::RDI) | bit(Register::RSI) | bit(Register::RDX)
+        | bit(Register::RCX) | bit(Register::R8) | bit(Register::R9);
+    constexpr std::uint32_t CallerSavedBits = ArgumentBits | bit(Register::RAX) | bit(Register::R10) | bit(Register::R11);
+    //what the caller sees after ret, the result and the callee saved registers
+    constexpr std::uint32_t ReturnBits = bit(Register::RAX) | bit(Register::RBX) | bit(Register::RSP) | bit(Register::RBP)
+        | bit(Register::R12) | bit(Register::R13) | bit(Register::R14) | bit(Register::R15);
+
+    //al counts vector registers for varargs, so rax is read too
+    std::uint32_t call_reads(std::uint8_t registerArguments) {
+        constexpr Register order[] = {Register::RDI, Register::RSI, Register::RDX, Register::RCX, Register::R8, Register::R9};
+        std::uint32_t reads = bit(Register::RAX) | bit(Register::RSP);
+        for (std::uint8_t i = 0; i < registerArguments && i < std::size(order); i++) {
+            reads |= bit(order[i]);
+        }
+        return reads;
+    }
+
+    //what peephole() knows of each recorded instruction besides the
+    //instruction itself
+    struct PeepholeState {
+        enum Flag : std::uint8_t {
+            Removed = 1,
+            Replaced = 2, //encoded at replacement in the rewrite buffer
+            Pinned = 4, //holds a relocation
+            Target = 8, //a label is bound at it
+        };
+        std::uint8_t flags = 0;
+        std::uint8_t size = 0;
+        std::uint32_t replacement = 0;
+
+        bool is(Flag flag) const {
+            return flags & flag;
+        }
+    };
+
+    //liveness gives up, and says live, after this many instructions
+    constexpr size_t MaxLivenessSteps = 256;
+
+    //Whether a register or flag in mask may be read before it is written from
+    //instruction index on, following branches. Anything unknown counts as a
+    //read. The masks already followed from each instruction are kept between
+    //queries and told apart by generation, so a query only costs the
+    //instructions it visits.
+    class Liveness {
+        const std::vector<InstrBufferx64::Instruction>& _instructions;
+        const std::vector<PeepholeState>& _states;
+        const std::vector<size_t>& _labelTargets;
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> _seen; //generation, mask
+        std::vector<std::pair<size_t, std::uint32_t>> _paths;
+        std::uint32_t _generation = 0;
 
-#if defined(__APPLE__) && defined(__MACH__)
-    exememory = mmap(NULL,
-        _buffer.size(),
-        PROT_READ | PROT_WRITE | PROT_EXEC,
-        MAP_ANON | MAP_PRIVATE | MAP_JIT,
-        -1,
-        0);
-#else
-    exememory = mmap(NULL,
-        _buffer.size(),
-        PROT_READ | PROT_WRITE | PROT_EXEC,
-        MAP_ANON | MAP_PRIVATE,
-        -1,
-        0);
-#endif
+    public:
+        Liveness(const std::vector<InstrBufferx64::Instruction>& instructions, const std::vector<PeepholeState>& states, const std::vector<size_t>& labelTargets)
+        : _instructions(instructions)
+        , _states(states)
+        , _labelTargets(labelTargets)
+        , _seen(instructions.size(), {0, 0})
+        {
+        }
 
-    memset(exememory, 0, _buffer.size());
-    memcpy(exememory, &_buffer[0], _buffer.size());
+        bool live(size_t index, std::uint32_t mask) {
+            _generation++;
+            _paths.assign(1, {index, mask});
+            size_t steps = 0;
 
-    auto exMemoryOffset = reinterpret_cast<unsigned char*>(exememory) + entrypoint;
-    reinterpret_cast<void(*)(void)>(exMemoryOffset)();
+            while (!_paths.empty()) {
+                auto [i, remaining] = _paths.back();
+                _paths.pop_back();
+
+                while (remaining != 0) {
+                    if (i >= _instructions.size() || ++steps > MaxLivenessSteps) {
+                        return true;
+                    }
+                    auto& seen = _seen[i];
+                    if (seen.first != _generation) {
+                        seen = {_generation, 0};
+                    }
+                    if ((seen.second & remaining) == remaining) {
+                        break;
+                    }
+                    seen.second |= remaining;
+
+                    if (_states[i].is(PeepholeState::Removed)) {
+                        i++;
+                        continue;
+                    }
+
+                    auto& instr = _instructions[i];
+                    if (instr.op == Op::Opaque || (instr.reads & remaining)) {
+                        return true;
+                    }
+                    remaining &= ~instr.writes;
+
+                    if (instr.op == Op::Jmp) {
+                        i = _labelTargets[instr.imm];
+                        continue;
+                    }
+                    if (instr.op == Op::Jcc) {
+                        _paths.push_back({_labelTargets[instr.imm], remaining});
+                    }
+                    i++;
+                }
+            }
+            return false;
+        }
+    };
+
+    bool fits_int32(std::uint64_t imm) {
+        auto value = static_cast<std::int64_t>(imm);
+        return value >= std::numeric_limits<std::int32_t>::min() && value <= std::numeric_limits<std::int32_t>::max();
+    }
+
+    //the /digit of the immediate form of an r64, r/m64 alu opcode
+    std::optional<std::uint8_t> immediate_digit(std::uint8_t opcode) {
+        switch (opcode) {
+            case 0x03: return 0; //add
+            case 0x2b: return 5; //sub
+            case 0x3b: return 7; //cmp
+            default: return std::nullopt;
+        }
+    }
+}
+
+void InstrBufferx64::execute(std::size_t entrypoint) {
+    if (_buffer.empty()) {
+        return;
+    }
+
+    auto code = ll::CodeHeap::process().allocate(_buffer);
+    auto entry = static_cast<unsigned char*>(code.address()) + entrypoint;
+    reinterpret_cast<void(*)(void)>(entry)();
 }
 
 const std::vector<uint8_t>& InstrBufferx64::buffer() const {
@@ -56,160 +178,758 @@ uint64_t InstrBufferx64::add_cstring(const std::string& str, size_t location) {
     return reinterpret_cast<uint64_t>(const_cast<char*>(_cstrings.back()->string.c_str()));
 }
 
+void InstrBufferx64::mark_statement(std::uint32_t statement, std::uint32_t line) {
+    _statements.push_back({.location = _buffer.size(), .statement = statement, .line = line});
+}
+
 void InstrBufferx64::mov_r64_imm64(Register dest, std::uint64_t input) {
-    push_rexw();
+    auto& instr = record(Op::MovRI, 0, bit(dest));
+    instr.reg = dest;
+    instr.imm = input;
+    push_rex(true, 0, static_cast<uint8_t>(dest));
     push_byte(0xb8 + (static_cast<int>(dest) & 0x07));
     push_qword(input);
 }
 
+void InstrBufferx64::mov_r32_imm32(Register dest, std::uint32_t value) {
+    record(Op::Other, 0, bit(dest));
+    push_rex(false, 0, static_cast<uint8_t>(dest));
+    push_byte(0xb8 + (static_cast<int>(dest) & 0x07));
+    push_dword(value);
+}
+
+void InstrBufferx64::mov_r64_imm32(Register dest, std::int32_t value) {
+    record(Op::Other, 0, bit(dest));
+    push_rex(true, 0, static_cast<uint8_t>(dest));
+    push_byte(0xc7);
+    push_modrm(3, 0, dest);
+    push_dword(static_cast<uint32_t>(value));
+}
+
+void InstrBufferx64::xor_r32_r32(Register dest, Register src) {
+    //xor of a register with itself doesn't depend on its value
+    record(Op::Other, dest == src ? 0 : bit(dest) | bit(src), bit(dest) | FlagsBit);
+    push_rex(false, src, dest);
+    push_byte(0x31);
+    push_modrm(3, src, dest);
+}
+
 void InstrBufferx64::lea_r64_riprel32(Register dest, std::int32_t input) {
-    push_rexw();
+    record(Op::Other, 0, bit(dest));
+    push_rex(true, static_cast<uint8_t>(dest), 0);
     push_byte(0x8d);
     push_modrm(0, static_cast<uint8_t>(dest), 0b101);
     push_dword(input);
 }
 
-void InstrBufferx64::mov_stack_imm64(std::int8_t adjust, std::uint64_t value) {
-    push_rexw();
-    push_byte(0xb8 + (static_cast<uint8_t>(Register::RAX) & 0x07));
-    push_qword(value);
+void InstrBufferx64::mov_stack_imm64(std::int32_t adjust, std::uint64_t value) {
+    mov_r64_imm64(Register::RAX, value);
+    mov_stack_r64(adjust, Register::RAX);
+}
 
-    push_rexw();
-    push_byte(0x89);
-    push_modrm(1, Register::RAX, Register::RBP);
-    push_byte(*reinterpret_cast<uint8_t*>(&adjust));
+void InstrBufferx64::mov_stack_r64(std::int32_t adjust, Register src) {
+    mov_m64_r64(Memory::stack(adjust), src);
 }
 
-void InstrBufferx64::mov_stack_r64(std::int8_t adjust, Register src) {
-    push_rexw();
-    push_byte(0x89);
-    push_modrm(1, src, Register::RBP);
-    push_byte(*reinterpret_cast<uint8_t*>(&adjust));
+void InstrBufferx64::mov_r64_stack(Register dest, std::int32_t adjust) {
+    mov_r64_m64(dest, Memory::stack(adjust));
+}
+
+void InstrBufferx64::mov_r64_m64(Register dest, const Memory& src) {
+    auto& instr = record(Op::MovRM, bits(src), bit(dest));
+    instr.reg = dest;
+    instr.mem = src;
+    push_r64_m64(0x8b, static_cast<uint8_t>(dest), src);
+}
+
+void InstrBufferx64::mov_m64_r64(const Memory& dest, Register src) {
+    auto& instr = record(Op::MovMR, bits(dest) | bit(src), 0);
+    instr.reg = src;
+    instr.mem = dest;
+    push_r64_m64(0x89, static_cast<uint8_t>(src), dest);
 }
 
-void InstrBufferx64::mov_r64_stack(Register dest, std::int8_t adjust) {
-    push_rexw();
-    push_byte(0x8b);
-    push_modrm(1, dest, Register::RBP);
-    push_byte(*reinterpret_cast<uint8_t*>(&adjust));
+void InstrBufferx64::mov_m64_imm32(const Memory& dest, std::int32_t value) {
+    record(Op::Other, bits(dest), 0);
+    push_r64_m64(0xc7, 0, dest);
+    push_dword(*reinterpret_cast<uint32_t*>(&value));
+}
+
+void InstrBufferx64::lea_r64_m(Register dest, const Memory& src) {
+    record(Op::Other, bits(src), bit(dest));
+    push_r64_m64(0x8d, static_cast<uint8_t>(dest), src);
 }
 
-void InstrBufferx64::call_r64(Register dest) {
+void InstrBufferx64::call_r64(Register dest, std::uint8_t registerArguments) {
+    record(Op::Call, call_reads(registerArguments) | bit(dest), CallerSavedBits | FlagsBit);
+    push_rex(false, 0, static_cast<uint8_t>(dest));
     push_byte(0xff);
     push_modrm(3, 2, static_cast<int>(dest) & 0x07);
 }
 
-void InstrBufferx64::call_rel32(int32_t op) {
+void InstrBufferx64::call_rel32(int32_t op, std::uint8_t registerArguments) {
+    record(Op::Call, call_reads(registerArguments), CallerSavedBits | FlagsBit);
     push_byte(0xe8);
     push_dword(*reinterpret_cast<uint32_t*>(&op));
 }
 
 void InstrBufferx64::add_r64_imm32(Register dest, std::int32_t value) {
-    push_rexw();
+    auto& instr = record(Op::AluRI, bit(dest), bit(dest) | FlagsBit);
+    instr.opcode = 0;
+    instr.reg = dest;
+    instr.imm = static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+    push_rex(true, 0, static_cast<uint8_t>(dest));
     push_byte(0x81);
     push_modrm(3, 0, dest);
     push_dword(*reinterpret_cast<uint32_t*>(&value));
 }
 
 void InstrBufferx64::add_r64_r64(Register dest, Register src) {
-    push_rexw();
+    auto& instr = record(Op::AluRR, bit(dest) | bit(src), bit(dest) | FlagsBit);
+    instr.opcode = 0x03;
+    instr.reg = dest;
+    instr.src = src;
+    push_rex(true, dest, src);
     push_byte(0x03);
     push_modrm(3, dest, src);
 }
 
+void InstrBufferx64::add_r64_m64(Register dest, const Memory& src) {
+    record(Op::Other, bit(dest) | bits(src), bit(dest) | FlagsBit);
+    push_r64_m64(0x03, static_cast<uint8_t>(dest), src);
+}
+
 void InstrBufferx64::ret() {
+    record(Op::Ret, ReturnBits, AllBits & ~ReturnBits);
     push_byte(0xc3);
 }
 
 void InstrBufferx64::push(Register src) {
+    record(Op::Push, bit(src) | bit(Register::RSP), bit(Register::RSP)).reg = src;
+    push_rex(false, 0, static_cast<uint8_t>(src));
     push_byte(0xff);
     push_modrm(3, 6, static_cast<int>(src) & 0x07);
 }
 
 void InstrBufferx64::pop(Register dest) {
+    record(Op::Pop, bit(Register::RSP), bit(dest) | bit(Register::RSP)).reg = dest;
+    push_rex(false, 0, static_cast<uint8_t>(dest));
     push_byte(0x58 + (static_cast<int>(dest) & 0x07));
 }
 
 void InstrBufferx64::mov_r64_r64(Register dest, Register src) {
-    push_rexw();
+    auto& instr = record(Op::MovRR, bit(src), bit(dest));
+    instr.reg = dest;
+    instr.src = src;
+    push_rex(true, src, dest);
     push_byte(0x89);
     push_modrm(3, /* regop src */ src, /* rm dest */ dest);
 }
 
 void InstrBufferx64::sub(Register dest, std::int32_t value) {
-    push_rexw();
+    auto& instr = record(Op::AluRI, bit(dest), bit(dest) | FlagsBit);
+    instr.opcode = 5;
+    instr.reg = dest;
+    instr.imm = static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+    push_rex(true, 0, static_cast<uint8_t>(dest));
     push_byte(0x81);
     push_modrm(3, 5, dest);
     push_dword(*reinterpret_cast<uint32_t*>(&value));
 }
 
+void InstrBufferx64::sub_r64_r64(Register dest, Register src) {
+    auto& instr = record(Op::AluRR, bit(dest) | bit(src), bit(dest) | FlagsBit);
+    instr.opcode = 0x2b;
+    instr.reg = dest;
+    instr.src = src;
+    push_rex(true, dest, src);
+    push_byte(0x2b);
+    push_modrm(3, dest, src);
+}
+
+void InstrBufferx64::sub_r64_m64(Register dest, const Memory& src) {
+    record(Op::Other, bit(dest) | bits(src), bit(dest) | FlagsBit);
+    push_r64_m64(0x2b, static_cast<uint8_t>(dest), src);
+}
+
+void InstrBufferx64::and_r64_imm32(Register dest, std::int32_t value) {
+    auto& instr = record(Op::AluRI, bit(dest), bit(dest) | FlagsBit);
+    instr.opcode = 4;
+    instr.reg = dest;
+    instr.imm = static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+    push_rex(true, 0, static_cast<uint8_t>(dest));
+    push_byte(0x81);
+    push_modrm(3, 4, dest);
+    push_dword(*reinterpret_cast<uint32_t*>(&value));
+}
+
+void InstrBufferx64::sar_r64_imm8(Register dest, std::uint8_t count) {
+    record(Op::Other, bit(dest), bit(dest) | FlagsBit);
+    push_rex(true, 0, static_cast<uint8_t>(dest));
+    push_byte(0xc1);
+    push_modrm(3, 7, dest);
+    push_byte(count);
+}
+
+void InstrBufferx64::shr_r64_imm8(Register dest, std::uint8_t count) {
+    record(Op::Other, bit(dest), bit(dest) | FlagsBit);
+    push_rex(true, 0, static_cast<uint8_t>(dest));
+    push_byte(0xc1);
+    push_modrm(3, 5, dest);
+    push_byte(count);
+}
+
+void InstrBufferx64::imul_r64(Register src) {
+    record(Op::Other, bit(src) | bit(Register::RAX), bit(Register::RAX) | bit(Register::RDX) | FlagsBit);
+    push_rex(true, 0, static_cast<uint8_t>(src));
+    push_byte(0xf7);
+    push_modrm(3, 5, src);
+}
+
+void InstrBufferx64::imul_r64_r64(Register dest, Register src) {
+    record(Op::Other, bit(dest) | bit(src), bit(dest) | FlagsBit);
+    push_rex(true, dest, src);
+    push_byte(0x0f);
+    push_byte(0xaf);
+    push_modrm(3, dest, src);
+}
+
+void InstrBufferx64::imul_r64_r64_imm32(Register dest, Register src, std::int32_t value) {
+    record(Op::Other, bit(src), bit(dest) | FlagsBit);
+    push_rex(true, dest, src);
+    push_byte(0x69);
+    push_modrm(3, dest, src);
+    push_dword(*reinterpret_cast<uint32_t*>(&value));
+}
+
 void InstrBufferx64::cqo_idiv_r64(Register src) {
     if (src == Register::RAX || src == Register::RDX) {
         throw std::logic_error("RAX and RDX should not be used for idiv.");
     }
 
-    push_rexw();
+    record(Op::Other, bit(src) | bit(Register::RAX), bit(Register::RAX) | bit(Register::RDX) | FlagsBit);
+
+    push_rex(true, 0, 0);
     push_byte(0x99);
-    push_rexw();
+    push_rex(true, 0, static_cast<uint8_t>(src));
     push_byte(0xf7);
     push_modrm(3, 7, src);
 }
 
+void InstrBufferx64::cqo_idiv_m64(const Memory& src) {
+    record(Op::Other, bits(src) | bit(Register::RAX), bit(Register::RAX) | bit(Register::RDX) | FlagsBit);
+    push_rex(true, 0, 0);
+    push_byte(0x99);
+    push_r64_m64(0xf7, 7, src);
+}
+
 void InstrBufferx64::cmp(Register a, Register b) {
-    push_rexw();
+    auto& instr = record(Op::AluRR, bit(a) | bit(b), FlagsBit);
+    instr.opcode = 0x3b;
+    instr.reg = a;
+    instr.src = b;
+    push_rex(true, a, b);
     push_byte(0x3b);
     push_modrm(3, a, b);
 }
 
-void InstrBufferx64::jmp_not_equal(int32_t offset) {
-    push_byte(0x0f);
-    push_byte(0x85);
-    push_dword(offset);
+void InstrBufferx64::cmp_r64_m64(Register a, const Memory& b) {
+    record(Op::Other, bit(a) | bits(b), FlagsBit);
+    push_r64_m64(0x3b, static_cast<uint8_t>(a), b);
 }
 
-void InstrBufferx64::jmp_greater_or_equal(int32_t offset) {
-    push_byte(0x0f);
-    push_byte(0x8d);
-    push_dword(offset);
+void InstrBufferx64::cmp_r64_imm(Register a, std::int32_t value) {
+    push_alu_r64_imm(7, a, value);
+}
+
+InstrBufferx64::Label InstrBufferx64::new_label() {
+    _labels.emplace_back();
+    return Label{static_cast<std::uint32_t>(_labels.size() - 1)};
+}
+
+void InstrBufferx64::bind(Label label) {
+    auto& state = _labels.at(label.id);
+    if (state.position != Unbound) {
+        throw std::logic_error("Label is already bound.");
+    }
+
+    state.position = _buffer.size();
+    for (auto index : state.pending) {
+        patch_branch(index);
+    }
+    state.pending.clear();
+}
+
+std::optional<size_t> InstrBufferx64::label_position(Label label) const {
+    auto position = _labels.at(label.id).position;
+    if (position == Unbound) {
+        return std::nullopt;
+    }
+    return position;
+}
+
+void InstrBufferx64::jmp(Label target) {
+    emit_branch(std::nullopt, target);
+}
+
+void InstrBufferx64::jmp_if(Condition condition, Label target) {
+    emit_branch(condition, target);
+}
+
+void InstrBufferx64::emit_branch(std::optional<Condition> condition, Label target) {
+    auto& state = _labels.at(target.id);
+
+    auto& instr = record(condition ? Op::Jcc : Op::Jmp, condition ? FlagsBit : 0, 0);
+    instr.imm = target.id;
+
+    _branches.push_back(Branch{
+        .location = _buffer.size(),
+        .label = target.id,
+        .condition = condition
+    });
+
+    if (condition) {
+        push_byte(0x0f);
+        push_byte(0x80 | static_cast<uint8_t>(*condition));
+    } else {
+        push_byte(0xe9);
+    }
+    push_dword(0);
+
+    if (state.position == Unbound) {
+        state.pending.push_back(_branches.size() - 1);
+    } else {
+        patch_branch(_branches.size() - 1);
+    }
 }
 
-InstrBufferx64::JmpUpdate* InstrBufferx64::jmp_with_update() {
-    push_byte(0xe9);
-    push_dword(0xdeadbeef);
-    auto update = std::make_unique<JmpUpdate>();
-    update->owner = this;
-    update->location = _buffer.size();
-    _updates.push_back(std::move(update));
-    return _updates.back().get();
+void InstrBufferx64::patch_branch(size_t index) {
+    auto& branch = _branches[index];
+    auto end = branch.location + (branch.condition ? 6 : 5);
+    int32_t offset = static_cast<int64_t>(_labels[branch.label].position) - static_cast<int64_t>(end);
+    std::memcpy(&_buffer[end - sizeof(int32_t)], &offset, sizeof(int32_t));
 }
 
-void InstrBufferx64::update_jmp(JmpUpdate* update, int32_t offset) {
-    auto it = std::find_if(_updates.begin(), _updates.end(), [update] (const auto& i) {
-        return i.get() == update;
+size_t InstrBufferx64::peephole() {
+    auto opaque = std::any_of(_instructions.begin(), _instructions.end(), [] (auto& instr) {
+        return instr.op == Op::Opaque;
     });
-    if (it == _updates.end()) {
-        throw std::runtime_error("unknow update");
+    if (_instructions.empty() || opaque) {
+        return 0;
+    }
+
+    for (auto& branch : _branches) {
+        if (_labels[branch.label].position == Unbound) {
+            throw std::runtime_error("Branch to a label that was never bound.");
+        }
+    }
+
+    //code ahead of the first recorded instruction, from an earlier function,
+    //is left as it is
+    auto& instructions = _instructions;
+    auto count = instructions.size();
+    auto first = instructions.front().location;
+    std::vector<PeepholeState> states(count);
+
+    auto end_of = [&] (size_t i) {
+        return i + 1 < count ? instructions[i + 1].location : _buffer.size();
+    };
+    //the instruction holding each byte from first on
+    std::vector<std::uint32_t> indices(_buffer.size() - first);
+    for (size_t i = 0; i < count; i++) {
+        std::fill(indices.begin() + (instructions[i].location - first), indices.begin() + (end_of(i) - first), static_cast<std::uint32_t>(i));
+    }
+    auto index_of = [&indices, first] (size_t location) -> size_t {
+        return indices[location - first];
+    };
+
+    //branches out of the recorded instructions go to count, which is unknown
+    std::vector<size_t> labelTargets(_labels.size(), count);
+    for (size_t id = 0; id < _labels.size(); id++) {
+        auto position = _labels[id].position;
+        if (position != Unbound && position >= first && position < _buffer.size()) {
+            labelTargets[id] = index_of(position);
+            states[labelTargets[id]].flags |= PeepholeState::Target;
+        }
+    }
+
+    auto pin = [&] (size_t location) {
+        if (location >= first && location < _buffer.size()) {
+            states[index_of(location)].flags |= PeepholeState::Pinned;
+        }
+    };
+    for (auto& cstr : _cstrings) {
+        pin(cstr->location);
     }
+    for (auto& externFunc : _externFuncs) {
+        pin(externFunc.location);
+    }
+    for (auto& import : _jitImports) {
+        pin(import.location);
+    }
+
+    auto next = [&states, count] (size_t i) {
+        do {
+            i++;
+        } while (i < count && states[i].is(PeepholeState::Removed));
+        return i;
+    };
+
+    Liveness liveness(instructions, states, labelTargets);
+    auto dead_after = [&] (size_t i, std::uint32_t mask) {
+        return !liveness.live(next(i), mask);
+    };
+
+    //rewritten instructions are encoded one after another here
+    InstrBufferx64 encoder;
+    auto replace = [&] (size_t i, auto encode) {
+        auto offset = encoder._buffer.size();
+        encode(encoder);
+        auto location = instructions[i].location;
+        instructions[i] = encoder._instructions.back();
+        instructions[i].location = location;
+        encoder._instructions.clear();
+
+        states[i].flags |= PeepholeState::Replaced;
+        states[i].replacement = static_cast<std::uint32_t>(offset);
+        states[i].size = static_cast<std::uint8_t>(encoder._buffer.size() - offset);
+    };
+    auto remove = [&states] (size_t i) {
+        states[i].flags |= PeepholeState::Removed;
+    };
+
+    //the pop restoring a push over straight line code that leaves rsp alone,
+    //when restoring the register is of no use
+    auto useless_pop = [&] (size_t push) -> std::optional<size_t> {
+        auto reg = instructions[push].reg;
+        std::uint32_t written = 0;
+        size_t depth = 0;
+        for (auto i = next(push); i < count; i = next(i)) {
+            if (states[i].is(PeepholeState::Target)) {
+                return std::nullopt;
+            }
+
+            auto& instr = instructions[i];
+            switch (instr.op) {
+                case Op::Pop:
+                    if (depth == 0) {
+                        if (instr.reg != reg || ((written & bit(reg)) && !dead_after(i, bit(reg)))) {
+                            return std::nullopt;
+                        }
+                        return i;
+                    }
+                    depth--;
+                    break;
+
+                case Op::Push:
+                    depth++;
+                    break;
+
+                case Op::Call:
+                case Op::Ret:
+                case Op::Jmp:
+                case Op::Jcc:
+                case Op::Opaque:
+                    return std::nullopt;
+
+                default:
+                    if ((instr.reads | instr.writes) & bit(Register::RSP)) {
+                        return std::nullopt;
+                    }
+            }
+            written |= instr.writes;
+        }
+        return std::nullopt;
+    };
+
+    //backwards, so a pair is only looked at once the pairs after it, which
+    //keep its register live by saving it again, are gone. Whatever a rewrite
+    //brings together is looked at again.
+    for (auto i = count; i-- > 0;) {
+        if (states[i].is(PeepholeState::Removed)) {
+            continue;
+        }
+        auto j = next(i);
+        if (j == count) {
+            continue;
+        }
+        auto& a = instructions[i];
+        auto& b = instructions[j];
+
+        //mov [m], r1; mov r2, [m]
+        if (a.op == Op::MovMR && b.op == Op::MovRM && a.mem == b.mem && !states[j].is(PeepholeState::Target)) {
+            if (a.reg == b.reg) {
+                remove(j);
+                i++;
+            } else {
+                replace(j, [dest = b.reg, src = a.reg] (InstrBufferx64& e) {
+                    e.mov_r64_r64(dest, src);
+                });
+            }
+            continue;
+        }
 
-    int32_t* memloc = reinterpret_cast<int32_t*>(&_buffer[(*it)->location - 4]);
+        //mov t, imm; op r, t
+        if (a.op == Op::MovRI && b.op == Op::AluRR && b.src == a.reg && b.reg != a.reg
+            && !states[i].is(PeepholeState::Pinned) && !states[j].is(PeepholeState::Target) && fits_int32(a.imm)) {
+            auto digit = immediate_digit(b.opcode);
+            if (digit && dead_after(j, bit(a.reg))) {
+                remove(i);
+                replace(j, [digit = *digit, dest = b.reg, value = static_cast<std::int32_t>(a.imm)] (InstrBufferx64& e) {
+                    e.push_alu_r64_imm(digit, dest, value);
+                });
+                continue;
+            }
+        }
 
-    if (*memloc != 0xdeadbeef) {
-        throw std::runtime_error("unexpected contents");
+        if (a.op == Op::Push) {
+            if (auto pop = useless_pop(i)) {
+                remove(i);
+                remove(*pop);
+                i = *pop;
+            }
+        }
     }
-    *memloc = offset;
 
-    _updates.erase(it);
+    //shorter immediates
+    for (size_t i = 0; i < count; i++) {
+        if (states[i].flags & (PeepholeState::Removed | PeepholeState::Replaced | PeepholeState::Pinned)) {
+            continue;
+        }
+
+        auto& instr = instructions[i];
+        auto dest = instr.reg;
+        if (instr.op == Op::MovRI) {
+            if (instr.imm == 0 && dead_after(i, FlagsBit)) {
+                replace(i, [dest] (InstrBufferx64& e) {
+                    e.xor_r32_r32(dest, dest);
+                });
+            } else if (instr.imm <= std::numeric_limits<std::uint32_t>::max()) {
+                replace(i, [dest, value = static_cast<std::uint32_t>(instr.imm)] (InstrBufferx64& e) {
+                    e.mov_r32_imm32(dest, value);
+                });
+            } else if (fits_int32(instr.imm)) {
+                replace(i, [dest, value = static_cast<std::int32_t>(instr.imm)] (InstrBufferx64& e) {
+                    e.mov_r64_imm32(dest, value);
+                });
+            }
+        } else if (instr.op == Op::AluRI) {
+            auto value = static_cast<std::int64_t>(instr.imm);
+            if (value >= INT8_MIN && value <= INT8_MAX) {
+                replace(i, [digit = instr.opcode, dest, value = static_cast<std::int32_t>(value)] (InstrBufferx64& e) {
+                    e.push_alu_r64_imm(digit, dest, value);
+                });
+            }
+        }
+    }
+
+    std::vector<uint8_t> rewritten(_buffer.begin(), _buffer.begin() + first);
+    rewritten.reserve(_buffer.size());
+    std::vector<size_t> newLocations(count);
+    //instructions left as they are are copied a run at a time
+    size_t run = first;
+    auto copy_run = [&] (size_t end) {
+        rewritten.insert(rewritten.end(), _buffer.begin() + run, _buffer.begin() + end);
+    };
+    for (size_t i = 0; i < count; i++) {
+        auto& state = states[i];
+        if (!(state.flags & (PeepholeState::Removed | PeepholeState::Replaced))) {
+            newLocations[i] = rewritten.size() + (instructions[i].location - run);
+            continue;
+        }
+
+        copy_run(instructions[i].location);
+        run = end_of(i);
+        newLocations[i] = rewritten.size();
+        if (state.is(PeepholeState::Replaced)) {
+            auto bytes = encoder._buffer.begin() + state.replacement;
+            rewritten.insert(rewritten.end(), bytes, bytes + state.size);
+        }
+    }
+    copy_run(_buffer.size());
+
+    //locations inside removed or rewritten instructions are only ever their
+    //first byte
+    auto new_position = [&] (size_t old) -> size_t {
+        if (old < first) {
+            return old;
+        }
+        if (old >= _buffer.size()) {
+            return old - _buffer.size() + rewritten.size();
+        }
+        auto i = index_of(old);
+        auto& state = states[i];
+        if (state.flags & (PeepholeState::Removed | PeepholeState::Replaced)) {
+            return newLocations[i];
+        }
+        return newLocations[i] + (old - instructions[i].location);
+    };
+
+    for (auto& branch : _branches) {
+        branch.location = new_position(branch.location);
+    }
+    for (auto& label : _labels) {
+        if (label.position != Unbound) {
+            label.position = new_position(label.position);
+        }
+    }
+    for (auto& cstr : _cstrings) {
+        cstr->location = new_position(cstr->location);
+    }
+    for (auto& externFunc : _externFuncs) {
+        externFunc.location = new_position(externFunc.location);
+    }
+    for (auto& import : _jitImports) {
+        import.location = new_position(import.location);
+    }
+    for (auto& mark : _statements) {
+        mark.location = new_position(mark.location);
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!states[i].is(PeepholeState::Removed)) {
+            instructions[kept] = instructions[i];
+            instructions[kept].location = static_cast<std::uint32_t>(newLocations[i]);
+            kept++;
+        }
+    }
+    instructions.resize(kept);
+
+    auto bytesSaved = _buffer.size() - rewritten.size();
+    _buffer = std::move(rewritten);
+    for (size_t i = 0; i < _branches.size(); i++) {
+        patch_branch(i);
+    }
+    return bytesSaved;
+}
+
+size_t InstrBufferx64::relax() {
+    if (_branches.empty()) {
+        _instructions.clear();
+        return 0;
+    }
+
+    for (auto& branch : _branches) {
+        if (_labels[branch.label].position == Unbound) {
+            throw std::runtime_error("Branch to a label that was never bound.");
+        }
+    }
+
+    auto longSize = [] (const Branch& branch) -> size_t {
+        return branch.condition ? 6 : 5;
+    };
+
+    //start with every branch short and grow the ones that don't reach until
+    //nothing changes, branches only ever grow so this terminates
+    std::vector<bool> isShort(_branches.size(), true);
+    std::vector<size_t> saved(_branches.size() + 1, 0);
+
+    auto new_position = [&] (size_t old) {
+        auto before = std::lower_bound(_branches.begin(), _branches.end(), old, [] (const Branch& b, size_t location) {
+            return b.location < location;
+        }) - _branches.begin();
+        return old - saved[before];
+    };
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t i = 0; i < _branches.size(); i++) {
+            saved[i + 1] = saved[i] + (isShort[i] ? longSize(_branches[i]) - 2 : 0);
+        }
+
+        for (size_t i = 0; i < _branches.size(); i++) {
+            if (!isShort[i]) {
+                continue;
+            }
+
+            auto& branch = _branches[i];
+            auto end = static_cast<int64_t>(new_position(branch.location) + 2);
+            auto offset = static_cast<int64_t>(new_position(_labels[branch.label].position)) - end;
+            if (offset < INT8_MIN || offset > INT8_MAX) {
+                isShort[i] = false;
+                changed = true;
+            }
+        }
+    }
+
+    std::vector<uint8_t> relaxed;
+    relaxed.reserve(_buffer.size() - saved.back());
+
+    size_t cursor = 0;
+    for (size_t i = 0; i < _branches.size(); i++) {
+        auto& branch = _branches[i];
+        relaxed.insert(relaxed.end(), _buffer.begin() + cursor, _buffer.begin() + branch.location);
+        cursor = branch.location + longSize(branch);
+
+        auto target = static_cast<int64_t>(new_position(_labels[branch.label].position));
+        if (isShort[i]) {
+            relaxed.push_back(branch.condition ? 0x70 | static_cast<uint8_t>(*branch.condition) : 0xeb);
+            relaxed.push_back(static_cast<uint8_t>(static_cast<int8_t>(target - static_cast<int64_t>(relaxed.size() + 1))));
+        } else {
+            if (branch.condition) {
+                relaxed.push_back(0x0f);
+                relaxed.push_back(0x80 | static_cast<uint8_t>(*branch.condition));
+            } else {
+                relaxed.push_back(0xe9);
+            }
+            int32_t offset = target - static_cast<int64_t>(relaxed.size() + sizeof(int32_t));
+            auto bytes = reinterpret_cast<uint8_t*>(&offset);
+            relaxed.insert(relaxed.end(), bytes, bytes + sizeof(int32_t));
+        }
+    }
+    relaxed.insert(relaxed.end(), _buffer.begin() + cursor, _buffer.end());
+
+    for (auto& label : _labels) {
+        if (label.position != Unbound) {
+            label.position = new_position(label.position);
+        }
+    }
+    for (auto& cstr : _cstrings) {
+        cstr->location = new_position(cstr->location);
+    }
+    for (auto& externFunc : _externFuncs) {
+        externFunc.location = new_position(externFunc.location);
+    }
+    for (auto& import : _jitImports) {
+        import.location = new_position(import.location);
+    }
+    for (auto& mark : _statements) {
+        mark.location = new_position(mark.location);
+    }
+
+    //every branch is final now
+    _branches.clear();
+    _instructions.clear();
+
+    auto bytesSaved = _buffer.size() - relaxed.size();
+    _buffer = std::move(relaxed);
+    return bytesSaved;
 }
 
 void InstrBufferx64::append_buffer(InstrBufferx64& buffer) {
     auto currentSize = this->_buffer.size();
+    auto labelOffset = static_cast<std::uint32_t>(this->_labels.size());
+    auto branchOffset = this->_branches.size();
     this->_buffer.insert(this->_buffer.end(), buffer._buffer.begin(), buffer._buffer.end());
 
-    for (auto& update : buffer._updates) {
-        this->_updates.push_back(std::move(update));
-        auto& adjust = this->_updates.back();
-        adjust->owner = this;
-        adjust->location += currentSize;
+    for (auto& branch : buffer._branches) {
+        this->_branches.push_back(Branch{
+            .location = branch.location + currentSize,
+            .label = branch.label + labelOffset,
+            .condition = branch.condition
+        });
+    }
+
+    for (auto& label : buffer._labels) {
+        auto& state = this->_labels.emplace_back();
+        if (label.position != Unbound) {
+            state.position = label.position + currentSize;
+        }
+        for (auto index : label.pending) {
+            state.pending.push_back(index + branchOffset);
+        }
     }
 
     for (auto& cstrptr : buffer._cstrings) {
@@ -224,15 +944,53 @@ void InstrBufferx64::append_buffer(InstrBufferx64& buffer) {
         adjust.location += currentSize;
     }
 
+    for (auto& import : buffer._jitImports) {
+        this->_jitImports.push_back(import);
+        this->_jitImports.back().location += currentSize;
+    }
+
+    for (auto& mark : buffer._statements) {
+        this->_statements.push_back({.location = mark.location + currentSize, .statement = mark.statement, .line = mark.line});
+    }
+
+    //code without instructions, like relaxed code, can't be rewritten
+    if (!buffer._buffer.empty() && (buffer._instructions.empty() || buffer._instructions.front().location != 0)) {
+        this->_instructions.push_back({.location = static_cast<std::uint32_t>(currentSize), .reads = AllBits, .writes = AllBits, .op = Instruction::Op::Opaque});
+    }
+    for (auto& instr : buffer._instructions) {
+        this->_instructions.push_back(instr);
+        this->_instructions.back().location += static_cast<std::uint32_t>(currentSize);
+    }
+
     buffer._buffer.clear();
-    buffer._updates.clear();
+    buffer._branches.clear();
+    buffer._labels.clear();
     buffer._cstrings.clear();
     buffer._externFuncs.clear();
+    buffer._jitImports.clear();
+    buffer._statements.clear();
+    buffer._instructions.clear();
 }
 
-void InstrBufferx64::push_rexw() {
-    uint8_t byte = 0b01001000;
-    push_byte(byte);
+void InstrBufferx64::push_rex(bool w, uint8_t regop, uint8_t rm, uint8_t index) {
+    uint8_t byte = 0b01000000;
+    byte |= w ? 0b1000 : 0;
+    byte |= (regop & 0x08) ? 0b0100 : 0; //REX.R
+    byte |= (index & 0x08) ? 0b0010 : 0; //REX.X
+    byte |= (rm & 0x08) ? 0b0001 : 0; //REX.B
+
+    if (byte != 0b01000000) {
+        push_byte(byte);
+    }
+}
+
+void InstrBufferx64::push_rex(bool w, Register regop, Register rm) {
+    push_rex(w, static_cast<uint8_t>(regop), static_cast<uint8_t>(rm));
+}
+
+void InstrBufferx64::push_rex(bool w, uint8_t regop, const Memory& mem) {
+    auto index = mem.index ? static_cast<uint8_t>(*mem.index) : 0;
+    push_rex(w, regop, static_cast<uint8_t>(mem.base), index);
 }
 
 void InstrBufferx64::push_modrm(uint8_t mod, uint8_t regop, uint8_t rm) {
@@ -251,6 +1009,79 @@ void InstrBufferx64::push_modrm(uint8_t mod, Register regop, Register rm) {
     push_modrm(mod, static_cast<uint8_t>(regop), static_cast<uint8_t>(rm));
 }
 
+void InstrBufferx64::push_modrm(uint8_t regop, const Memory& mem) {
+    auto base = static_cast<uint8_t>(mem.base);
+
+    //RBP and R13 have no disp-less form, mod 00 with those means rip/disp32
+    uint8_t mod = 2;
+    if (mem.disp == 0 && (base & 0x07) != 0b101) {
+        mod = 0;
+    } else if (mem.disp >= INT8_MIN && mem.disp <= INT8_MAX) {
+        mod = 1;
+    }
+
+    //RSP and R12 as rm mean a SIB byte follows
+    if (mem.index || (base & 0x07) == 0b100) {
+        uint8_t index = 0b100; //no index
+        if (mem.index) {
+            if (*mem.index == Register::RSP) {
+                throw std::logic_error("RSP cannot be used as an index.");
+            }
+            index = static_cast<uint8_t>(*mem.index);
+        }
+
+        uint8_t scale = 0;
+        switch (mem.scale) {
+            case 1: scale = 0; break;
+            case 2: scale = 1; break;
+            case 4: scale = 2; break;
+            case 8: scale = 3; break;
+            default:
+                throw std::logic_error("Scale must be 1, 2, 4 or 8.");
+        }
+
+        push_modrm(mod, regop, 0b100);
+        push_byte((scale << 6) | ((index & 0x07) << 3) | (base & 0x07));
+    } else {
+        push_modrm(mod, regop, base);
+    }
+
+    if (mod == 1) {
+        push_byte(static_cast<uint8_t>(static_cast<int8_t>(mem.disp)));
+    } else if (mod == 2) {
+        push_dword(static_cast<uint32_t>(mem.disp));
+    }
+}
+
+void InstrBufferx64::push_r64_m64(std::uint8_t opcode, uint8_t regop, const Memory& mem) {
+    push_rex(true, regop, mem);
+    push_byte(opcode);
+    push_modrm(regop, mem);
+}
+
+void InstrBufferx64::push_alu_r64_imm(std::uint8_t digit, Register dest, std::int32_t value) {
+    //cmp only sets flags
+    auto& instr = record(Op::AluRI, bit(dest), (digit == 7 ? 0 : bit(dest)) | FlagsBit);
+    instr.opcode = digit;
+    instr.reg = dest;
+    instr.imm = static_cast<std::uint64_t>(static_cast<std::int64_t>(value));
+
+    push_rex(true, 0, static_cast<uint8_t>(dest));
+    if (value >= INT8_MIN && value <= INT8_MAX) {
+        push_byte(0x83);
+        push_modrm(3, digit, dest);
+        push_byte(static_cast<uint8_t>(static_cast<int8_t>(value)));
+    } else {
+        push_byte(0x81);
+        push_modrm(3, digit, dest);
+        push_dword(static_cast<uint32_t>(value));
+    }
+}
+
+InstrBufferx64::Instruction& InstrBufferx64::record(Instruction::Op op, std::uint32_t reads, std::uint32_t writes) {
+    return _instructions.emplace_back(Instruction{.location = static_cast<std::uint32_t>(_buffer.size()), .reads = reads, .writes = writes, .op = op});
+}
+
 void InstrBufferx64::push_byte(uint8_t byte) {
     _buffer.push_back(byte);
 }
@@ -7,12 +7,13 @@
 
 #include <cstdint>
 #include <memory>
+#include <optional>
 #include <string>
 #include <vector>
 
 class InstrBufferx64 {
 public:
-    enum class Register {
+    enum class Register : std::uint8_t {
         RAX = 0,
         RCX = 1,
         RDX = 2,
@@ -20,12 +21,45 @@ public:
         RSP = 4,
         RBP = 5,
         RSI = 6,
-        RDI = 7
+        RDI = 7,
+        R8 = 8,
+        R9 = 9,
+        R10 = 10,
+        R11 = 11,
+        R12 = 12,
+        R13 = 13,
+        R14 = 14,
+        R15 = 15
     };
 
-    struct JmpUpdate {
-        InstrBufferx64* owner;
-        size_t location;
+    //[base + index * scale + disp] operand. disp8 or disp32 is picked from the
+    //value of disp and a SIB byte is added when an index or an RSP/R12 base is used.
+    struct Memory {
+        Register base;
+        std::optional<Register> index;
+        std::uint8_t scale = 1;
+        std::int32_t disp = 0;
+
+        static Memory stack(std::int32_t adjust) {
+            return {.base = Register::RBP, .disp = adjust};
+        }
+
+        bool operator==(const Memory&) const = default;
+    };
+
+    //Branch target. Branches are emitted in their rel32 form and patched when
+    //their label is bound, relax() then rewrites the ones that reach with rel8.
+    struct Label {
+        std::uint32_t id;
+    };
+
+    enum class Condition : std::uint8_t {
+        Equal = 0x4,
+        NotEqual = 0x5,
+        Less = 0xc,
+        GreaterOrEqual = 0xd,
+        LessOrEqual = 0xe,
+        Greater = 0xf,
     };
 
     struct CString {
@@ -42,9 +76,71 @@ public:
     };
     std::vector<ExternFunction> _externFuncs;
 
+    //JIT calls to process functions, location is the imm64 holding the address
+    std::vector<ExternFunction> _jitImports;
+
+    //first byte of each statement's code, statements are numbered from 1 in
+    //the order they are compiled within their function. 0 marks a function's
+    //entry. line is the statement's source line, 0 when unknown.
+    struct StatementMark {
+        size_t location;
+        std::uint32_t statement;
+        std::uint32_t line = 0;
+        auto operator<=>(const StatementMark&) const = default;
+    };
+    std::vector<StatementMark> _statements;
+
+    //What peephole() needs to know about an emitted instruction, recorded as
+    //it is encoded. reads and writes hold a bit per register and FlagsBit.
+    struct Instruction {
+        enum class Op : std::uint8_t {
+            Other, //described by reads and writes alone
+            Opaque, //nothing is known, code isn't moved across it
+            MovRR,
+            MovRI,
+            MovRM,
+            MovMR,
+            AluRR, //opcode is the r64, r/m64 form
+            AluRI, //opcode is the /digit of the imm form
+            Push,
+            Pop,
+            Call,
+            Ret,
+            Jmp,
+            Jcc,
+        };
+
+        std::uint32_t location;
+        std::uint32_t reads = 0;
+        std::uint32_t writes = 0;
+        Op op = Op::Other;
+        std::uint8_t opcode = 0;
+        Register reg = Register::RAX; //destination, or the source of stores and pushes
+        Register src = Register::RAX;
+        Memory mem{.base = Register::RBP};
+        std::uint64_t imm = 0; //immediate, or the label id of a branch
+    };
+    static constexpr std::uint32_t FlagsBit = 1u << 16;
+
 private:
+    static constexpr size_t Unbound = SIZE_MAX;
+
+    struct Branch {
+        size_t location; //first byte of the instruction
+        std::uint32_t label;
+        std::optional<Condition> condition; //unconditional jmp when empty
+    };
+
+    struct LabelState {
+        size_t position = Unbound;
+        std::vector<size_t> pending; //indices into _branches
+    };
+
     std::vector<std::uint8_t> _buffer;
-    std::vector<std::unique_ptr<JmpUpdate>> _updates;
+    std::vector<Branch> _branches;
+    std::vector<LabelState> _labels;
+    //every instruction since the buffer was last relaxed, in order
+    std::vector<Instruction> _instructions;
 
 public:
     InstrBufferx64() {}
@@ -52,44 +148,99 @@ public:
     void execute(std::size_t entrypoint = 0);
     const std::vector<std::uint8_t>& buffer() const;
     std::vector<std::uint8_t>& buffer();
+    //what peephole() may still rewrite
+    const std::vector<Instruction>& instructions() const { return _instructions; }
 
     uint64_t add_cstring(const std::string& str, size_t location);
+    void mark_statement(std::uint32_t statement, std::uint32_t line = 0);
 
     void mov_r64_r64(Register dest, Register src);
     void mov_r64_imm64(Register dest, std::uint64_t input);
+    //zero extended into the full register
+    void mov_r32_imm32(Register dest, std::uint32_t value);
+    //sign extended into the full register
+    void mov_r64_imm32(Register dest, std::int32_t value);
+    void xor_r32_r32(Register dest, Register src);
     void lea_r64_riprel32(Register dest, std::int32_t input);
-    void mov_stack_imm64(std::int8_t adjust, std::uint64_t value);
-    void mov_stack_r64(std::int8_t adjust, Register src);
-    void mov_r64_stack(Register dest, std::int8_t adjust);
+    void mov_stack_imm64(std::int32_t adjust, std::uint64_t value);
+    void mov_stack_r64(std::int32_t adjust, Register src);
+    void mov_r64_stack(Register dest, std::int32_t adjust);
+    void mov_r64_m64(Register dest, const Memory& src);
+    void mov_m64_r64(const Memory& dest, Register src);
+    void mov_m64_imm32(const Memory& dest, std::int32_t value);
+    void lea_r64_m(Register dest, const Memory& src);
 
     void add_r64_imm32(Register dest, std::int32_t value);
     void add_r64_r64(Register dest, Register src);
+    void add_r64_m64(Register dest, const Memory& src);
 
     void sub(Register dest, std::int32_t value);
+    void sub_r64_r64(Register dest, Register src);
+    void sub_r64_m64(Register dest, const Memory& src);
+
+    void and_r64_imm32(Register dest, std::int32_t value);
+    void sar_r64_imm8(Register dest, std::uint8_t count);
+    void shr_r64_imm8(Register dest, std::uint8_t count);
+
+    void imul_r64(Register src);
+    void imul_r64_r64(Register dest, Register src);
+    void imul_r64_r64_imm32(Register dest, Register src, std::int32_t value);
 
     void cqo_idiv_r64(Register src);
+    void cqo_idiv_m64(const Memory& src);
 
     void cmp(Register a, Register b);
-    void jmp_not_equal(int32_t offset);
-    void jmp_greater_or_equal(int32_t offset);
-
-    JmpUpdate* jmp_with_update();
-    void update_jmp(JmpUpdate* update, int32_t offset);
+    void cmp_r64_m64(Register a, const Memory& b);
+    //imm8 form when value fits
+    void cmp_r64_imm(Register a, std::int32_t value);
+
+    Label new_label();
+    void bind(Label label);
+    std::optional<size_t> label_position(Label label) const;
+
+    void jmp(Label target);
+    void jmp_if(Condition condition, Label target);
+
+    //Rewrites the recorded instructions ahead of relax(), returns the number of
+    //bytes saved:
+    //- a load straight after a store to the same memory uses the stored register
+    //- push/pop pairs go when the register is unchanged or dead after the pop
+    //- an immediate moved into a register only used by the next add, sub or
+    //  cmp is folded into it
+    //- mov r64, imm64 becomes xor r32, r32, mov r32, imm32 or a sign extended
+    //  mov r64, imm32, and alu immediates use their imm8 form
+    //Nothing moves across branch targets and immediates that are relocated
+    //are left alone.
+    size_t peephole();
+
+    //shrinks branches to rel8 where they reach and remaps every recorded
+    //location, returns the number of bytes saved. Instructions can no longer
+    //be rewritten by peephole() afterwards.
+    size_t relax();
 
     void append_buffer(InstrBufferx64& buffer);
     
-    void call_r64(Register dest);
-    void call_rel32(int32_t op);
+    //the callee is taken to read the first registerArguments argument registers
+    void call_r64(Register dest, std::uint8_t registerArguments = 6);
+    void call_rel32(int32_t op, std::uint8_t registerArguments = 6);
     void ret();
 
     void push(Register src);
     void pop(Register dest);
 
 private:
-    void push_rexw();
+    void push_rex(bool w, uint8_t regop, uint8_t rm, uint8_t index = 0);
+    void push_rex(bool w, Register regop, Register rm);
+    void push_rex(bool w, uint8_t regop, const Memory& mem);
     void push_modrm(uint8_t mod, uint8_t regop, uint8_t rm);
     void push_modrm(uint8_t mod, uint8_t regop, Register rm);
     void push_modrm(uint8_t mod, Register regop, Register rm);
+    void push_modrm(uint8_t regop, const Memory& mem);
+    void push_r64_m64(std::uint8_t opcode, uint8_t regop, const Memory& mem);
+    void push_alu_r64_imm(std::uint8_t digit, Register dest, std::int32_t value);
+    Instruction& record(Instruction::Op op, std::uint32_t reads, std::uint32_t writes);
+    void emit_branch(std::optional<Condition> condition, Label target);
+    void patch_branch(size_t index);
     void push_byte(uint8_t byte);
     void push_dword(uint32_t dword);
     void push_qword(uint64_t qword);
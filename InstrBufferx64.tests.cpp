@@ -1,6 +1,9 @@
 
 #include "InstrBufferx64.hpp"
 
+#include <cstring>
+#include <functional>
+
 #include <gtest/gtest.h>
 
 TEST(InstrBufferx64, call_rax) {
@@ -147,45 +150,324 @@ TEST(InstrBufferx64, cmp_rdx_rbx) {
         }));
 }
 
-TEST(InstrBufferx64, jmp_not_equal) {
+TEST(InstrBufferx64, jmp_forward_label) {
+    InstrBufferx64 b;
+    auto label = b.new_label();
+    b.jmp(label);
+    EXPECT_EQ(
+        b.buffer(),
+        std::vector<uint8_t>({
+            0xe9, 0x00, 0x00, 0x00, 0x00
+        }));
+    EXPECT_FALSE(b.label_position(label).has_value());
+
+    b.ret();
+    b.bind(label);
+    EXPECT_EQ(b.label_position(label), 6);
+    EXPECT_EQ(
+        b.buffer(),
+        std::vector<uint8_t>({
+            0xe9, 0x01, 0x00, 0x00, 0x00, //jmp +1
+            0xc3
+        }));
+}
+
+TEST(InstrBufferx64, jmp_backward_label) {
+    InstrBufferx64 b;
+    auto label = b.new_label();
+    b.bind(label);
+    b.ret();
+    b.jmp_if(InstrBufferx64::Condition::NotEqual, label);
+    EXPECT_EQ(
+        b.buffer(),
+        std::vector<uint8_t>({
+            0xc3,
+            0x0f, 0x85, 0xf9, 0xff, 0xff, 0xff //jne -7
+        }));
+}
+
+TEST(InstrBufferx64, bind_label_twice_throw) {
+    InstrBufferx64 b;
+    auto label = b.new_label();
+    b.bind(label);
+    EXPECT_ANY_THROW(b.bind(label));
+}
+
+TEST(InstrBufferx64, relax_unbound_label_throw) {
+    InstrBufferx64 b;
+    b.jmp(b.new_label());
+    EXPECT_ANY_THROW(b.relax());
+}
+
+TEST(InstrBufferx64, relax_without_branches_drops_instructions) {
+    InstrBufferx64 b;
+    b.mov_stack_r64(-8, InstrBufferx64::Register::RAX);
+    b.mov_r64_stack(InstrBufferx64::Register::RAX, -8);
+    b.ret();
+    ASSERT_EQ(b.instructions().size(), 3);
+    auto code = b.buffer();
+
+    EXPECT_EQ(b.relax(), 0);
+    EXPECT_TRUE(b.instructions().empty());
+    EXPECT_EQ(b.peephole(), 0);
+    EXPECT_EQ(b.buffer(), code);
+
+    InstrBufferx64 outer;
+    outer.append_buffer(b);
+    ASSERT_EQ(outer.instructions().size(), 1);
+    EXPECT_EQ(outer.instructions().front().op, InstrBufferx64::Instruction::Op::Opaque);
+}
+
+TEST(InstrBufferx64, relax_short_branches) {
+    InstrBufferx64 b;
+    auto top = b.new_label();
+    auto end = b.new_label();
+    b.bind(top);
+    b.cmp(InstrBufferx64::Register::RAX, InstrBufferx64::Register::RCX);
+    b.jmp_if(InstrBufferx64::Condition::GreaterOrEqual, end);
+    b.add_r64_imm32(InstrBufferx64::Register::RAX, 1);
+    b.jmp(top);
+    b.bind(end);
+    b.ret();
+
+    EXPECT_EQ(b.relax(), 7);
+    EXPECT_EQ(b.label_position(end), 14);
+    EXPECT_EQ(
+        b.buffer(),
+        std::vector<uint8_t>({
+            0x48, 0x3b, 0xc1, //cmp rax, rcx
+            0x7d, 0x09, //jge +9
+            0x48, 0x81, 0xc0, 0x01, 0x00, 0x00, 0x00, //add rax, 1
+            0xeb, 0xf2, //jmp -14
+            0xc3
+        }));
+}
+
+TEST(InstrBufferx64, relax_keeps_long_branches_and_remaps) {
+    InstrBufferx64 b;
+    auto far = b.new_label();
+    auto near = b.new_label();
+    b.jmp(near);
+    b.jmp_if(InstrBufferx64::Condition::Equal, far);
+    b.bind(near);
+    b.call_rel32(0);
+    b._externFuncs.push_back({.symbol = "puts", .location = b.buffer().size() - 4});
+    for (int i = 0; i < 20; i++) {
+        b.mov_r64_imm64(InstrBufferx64::Register::RAX, i);
+    }
+    b.bind(far);
+
+    //jmp near shrinks by 3, je far has to stay rel32 as 5 + 200 > 127
+    EXPECT_EQ(b.relax(), 3);
+    EXPECT_EQ(b.buffer()[0], 0xeb);
+    EXPECT_EQ(b.buffer()[1], 0x06);
+    EXPECT_EQ(b.buffer()[2], 0x0f);
+    EXPECT_EQ(b.buffer()[3], 0x84);
+    int32_t farOffset;
+    std::memcpy(&farOffset, &b.buffer()[4], sizeof(farOffset));
+    EXPECT_EQ(farOffset, 205);
+    EXPECT_EQ(b._externFuncs.front().location, 9);
+    EXPECT_EQ(b.label_position(far), b.buffer().size());
+}
+
+TEST(InstrBufferx64, append_buffer_moves_labels) {
+    InstrBufferx64 inner;
+    auto skip = inner.new_label();
+    inner.jmp(skip);
+    inner.ret();
+    inner.bind(skip);
+
+    InstrBufferx64 outer;
+    outer.ret();
+    auto pending = outer.new_label();
+    outer.jmp(pending);
+    outer.append_buffer(inner);
+    outer.bind(pending);
+
+    EXPECT_EQ(
+        outer.buffer(),
+        std::vector<uint8_t>({
+            0xc3,
+            0xe9, 0x06, 0x00, 0x00, 0x00, //jmp +6
+            0xe9, 0x01, 0x00, 0x00, 0x00, //jmp +1
+            0xc3
+        }));
+
+    EXPECT_EQ(outer.relax(), 6);
+    EXPECT_EQ(
+        outer.buffer(),
+        std::vector<uint8_t>({
+            0xc3,
+            0xeb, 0x03, //jmp +3
+            0xeb, 0x01, //jmp +1
+            0xc3
+        }));
+}
+
+TEST(InstrBufferx64, mov_r32_imm32) {
     InstrBufferx64 b;
-    b.jmp_not_equal(0x20);
+    b.mov_r32_imm32(InstrBufferx64::Register::RAX, 5);
+    b.mov_r32_imm32(InstrBufferx64::Register::R9, 0x80000000);
     EXPECT_EQ(
         b.buffer(),
         std::vector<uint8_t>({
-            0x0f, 0x85, 0x20, 0x00, 0x00, 0x00
+            0xb8, 0x05, 0x00, 0x00, 0x00, //mov eax, 5
+            0x41, 0xb9, 0x00, 0x00, 0x00, 0x80 //mov r9d, 0x80000000
         }));
 }
 
-TEST(InstrBufferx64, jmp_with_update) {
+TEST(InstrBufferx64, mov_r64_imm32) {
+    InstrBufferx64 b;
+    b.mov_r64_imm32(InstrBufferx64::Register::RCX, -1);
+    EXPECT_EQ(
+        b.buffer(),
+        std::vector<uint8_t>({0x48, 0xc7, 0xc1, 0xff, 0xff, 0xff, 0xff}));
+}
+
+TEST(InstrBufferx64, xor_r32_r32) {
     InstrBufferx64 b;
-    auto update = b.jmp_with_update();
+    b.xor_r32_r32(InstrBufferx64::Register::RAX, InstrBufferx64::Register::RAX);
+    b.xor_r32_r32(InstrBufferx64::Register::R8, InstrBufferx64::Register::R8);
     EXPECT_EQ(
         b.buffer(),
         std::vector<uint8_t>({
-            0xe9, 0xef, 0xbe, 0xad, 0xde
+            0x31, 0xc0, //xor eax, eax
+            0x45, 0x31, 0xc0 //xor r8d, r8d
         }));
-    EXPECT_EQ(update->location, 5);
 }
 
-TEST(InstrBufferx64, jmp_with_update_and_do_update) {
+TEST(InstrBufferx64, cmp_r64_imm) {
     InstrBufferx64 b;
-    auto update = b.jmp_with_update();
+    b.cmp_r64_imm(InstrBufferx64::Register::RAX, 100);
+    b.cmp_r64_imm(InstrBufferx64::Register::R12, 1000);
     EXPECT_EQ(
         b.buffer(),
         std::vector<uint8_t>({
-            0xe9, 0xef, 0xbe, 0xad, 0xde
+            0x48, 0x83, 0xf8, 0x64, //cmp rax, 100
+            0x49, 0x81, 0xfc, 0xe8, 0x03, 0x00, 0x00 //cmp r12, 1000
         }));
-    EXPECT_EQ(update->location, 5);
+}
 
-    b.update_jmp(update, 0xcafebabe);
+TEST(InstrBufferx64, peephole_store_then_load) {
+    using Register = InstrBufferx64::Register;
+    InstrBufferx64 b;
+    b.mov_stack_r64(-8, Register::RAX);
+    b.mov_r64_stack(Register::RAX, -8);
+    b.mov_stack_r64(-16, Register::RAX);
+    b.mov_r64_stack(Register::RCX, -16);
+    b.add_r64_r64(Register::RAX, Register::RCX);
+    b.ret();
+
+    EXPECT_EQ(b.peephole(), 5);
     EXPECT_EQ(
         b.buffer(),
         std::vector<uint8_t>({
-            0xe9, 0xbe, 0xba, 0xfe, 0xca
+            0x48, 0x89, 0x45, 0xf8, //mov [rbp - 0x8], rax
+            0x48, 0x89, 0x45, 0xf0, //mov [rbp - 0x10], rax
+            0x48, 0x89, 0xc1, //mov rcx, rax
+            0x48, 0x03, 0xc1, //add rax, rcx
+            0xc3
         }));
 }
 
+TEST(InstrBufferx64, peephole_keeps_load_at_branch_target) {
+    using Register = InstrBufferx64::Register;
+    InstrBufferx64 b;
+    auto top = b.new_label();
+    b.mov_stack_r64(-8, Register::RAX);
+    b.bind(top);
+    b.mov_r64_stack(Register::RAX, -8);
+    b.jmp(top);
+
+    EXPECT_EQ(b.peephole(), 0);
+    EXPECT_EQ(b.label_position(top), 4);
+}
+
+TEST(InstrBufferx64, peephole_useless_push_pop_and_fused_immediate) {
+    using Register = InstrBufferx64::Register;
+    InstrBufferx64 b;
+    auto end = b.new_label();
+    b.push(Register::RCX);
+    b.mov_r64_r64(Register::RAX, Register::RBX);
+    b.mov_r64_imm64(Register::RCX, 1);
+    b.add_r64_r64(Register::RAX, Register::RCX);
+    b.pop(Register::RCX);
+    b.mov_r64_imm64(Register::RCX, 100);
+    b.cmp(Register::RAX, Register::RCX);
+    b.jmp_if(InstrBufferx64::Condition::Less, end);
+    b.mov_r64_imm64(Register::RAX, 0);
+    b.bind(end);
+    b.ret();
+
+    EXPECT_EQ(b.peephole(), 29);
+    EXPECT_EQ(b.label_position(end), 19);
+    EXPECT_EQ(
+        b.buffer(),
+        std::vector<uint8_t>({
+            0x48, 0x89, 0xd8, //mov rax, rbx
+            0x48, 0x83, 0xc0, 0x01, //add rax, 1
+            0x48, 0x83, 0xf8, 0x64, //cmp rax, 100
+            0x0f, 0x8c, 0x02, 0x00, 0x00, 0x00, //jl +2
+            0x31, 0xc0, //xor eax, eax
+            0xc3
+        }));
+}
+
+TEST(InstrBufferx64, peephole_keeps_live_values) {
+    using Register = InstrBufferx64::Register;
+    InstrBufferx64 b;
+    auto end = b.new_label();
+    //rbx is callee saved, so it is read by whoever ret returns to
+    b.push(Register::RBX);
+    b.mov_r64_imm64(Register::RBX, 1);
+    b.pop(Register::RBX);
+    //the flags of cmp are read after the mov, so it can't become xor
+    b.cmp(Register::RAX, Register::RCX);
+    b.mov_r64_imm64(Register::RAX, 0);
+    b.jmp_if(InstrBufferx64::Condition::Equal, end);
+    //rcx is read after the add
+    b.mov_r64_imm64(Register::RCX, 2);
+    b.add_r64_r64(Register::RAX, Register::RCX);
+    b.mov_r64_r64(Register::RDX, Register::RCX);
+    b.bind(end);
+    b.ret();
+
+    EXPECT_EQ(b.peephole(), 15);
+    EXPECT_EQ(
+        b.buffer(),
+        std::vector<uint8_t>({
+            0xff, 0xf3, //push rbx
+            0xbb, 0x01, 0x00, 0x00, 0x00, //mov ebx, 1
+            0x5b, //pop rbx
+            0x48, 0x3b, 0xc1, //cmp rax, rcx
+            0xb8, 0x00, 0x00, 0x00, 0x00, //mov eax, 0
+            0x0f, 0x84, 0x0b, 0x00, 0x00, 0x00, //je +11
+            0xb9, 0x02, 0x00, 0x00, 0x00, //mov ecx, 2
+            0x48, 0x03, 0xc1, //add rax, rcx
+            0x48, 0x89, 0xca, //mov rdx, rcx
+            0xc3
+        }));
+}
+
+TEST(InstrBufferx64, peephole_leaves_relocated_immediates) {
+    using Register = InstrBufferx64::Register;
+    InstrBufferx64 b;
+    b.mov_r64_imm64(Register::RAX, 0);
+    b.mark_statement(1);
+    b.add_cstring("test", b.buffer().size() + 2);
+    b.mov_r64_imm64(Register::RDI, 0);
+    b.call_rel32(0, 1);
+    b._externFuncs.push_back({.symbol = "puts", .location = b.buffer().size() - 4});
+    b.ret();
+
+    //only the first mov is shortened, the string address is patched in later
+    EXPECT_EQ(b.peephole(), 8);
+    EXPECT_EQ(b._statements.front().location, 2);
+    EXPECT_EQ(b._cstrings.front()->location, 4);
+    EXPECT_EQ(b._externFuncs.front().location, 13);
+    EXPECT_EQ(b.buffer().size(), 18);
+}
+
 TEST(InstrBufferx64, add_r64_imm32) {
     InstrBufferx64 b;
     b.add_r64_imm32(InstrBufferx64::Register::RSP, 0x10);
@@ -218,3 +500,178 @@ TEST(InstrBufferx64, add_cstring) {
     );
 }
 
+
+TEST(InstrBufferx64, push_r12) {
+    InstrBufferx64 b;
+    b.push(InstrBufferx64::Register::R12);
+    EXPECT_EQ(
+        b.buffer(),
+        std::vector<uint8_t>({0x41, 0xff, 0xf4}));
+}
+
+TEST(InstrBufferx64, pop_r15) {
+    InstrBufferx64 b;
+    b.pop(InstrBufferx64::Register::R15);
+    EXPECT_EQ(
+        b.buffer(),
+        std::vector<uint8_t>({0x41, 0x5f}));
+}
+
+TEST(InstrBufferx64, mov_r12_rax) {
+    InstrBufferx64 b;
+    b.mov_r64_r64(InstrBufferx64::Register::R12, InstrBufferx64::Register::RAX);
+    EXPECT_EQ(
+        b.buffer(),
+        std::vector<uint8_t>({0x49, 0x89, 0xc4}));
+}
+
+TEST(InstrBufferx64, mov_rdi_r13) {
+    InstrBufferx64 b;
+    b.mov_r64_r64(InstrBufferx64::Register::RDI, InstrBufferx64::Register::R13);
+    EXPECT_EQ(
+        b.buffer(),
+        std::vector<uint8_t>({0x4c, 0x89, 0xef}));
+}
+
+TEST(InstrBufferx64, mov_r14_stack) {
+    InstrBufferx64 b;
+    b.mov_r64_stack(InstrBufferx64::Register::R14, -8);
+    EXPECT_EQ(
+        b.buffer(),
+        std::vector<uint8_t>({0x4c, 0x8b, 0x75, 0xf8}));
+}
+
+TEST(InstrBufferx64, mov_r8_imm64) {
+    InstrBufferx64 b;
+    b.mov_r64_imm64(InstrBufferx64::Register::R8, 0x1122334455667788);
+    EXPECT_EQ(
+        b.buffer(),
+        std::vector<uint8_t>({0x49, 0xb8, 0x88, 0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11}));
+}
+
+TEST(InstrBufferx64, cmp_r12_r15) {
+    InstrBufferx64 b;
+    b.cmp(InstrBufferx64::Register::R12, InstrBufferx64::Register::R15);
+    EXPECT_EQ(
+        b.buffer(),
+        std::vector<uint8_t>({0x4d, 0x3b, 0xe7}));
+}
+
+using Reg = InstrBufferx64::Register;
+using Mem = InstrBufferx64::Memory;
+
+class InstrBufferx64EncodingTest
+    : public testing::TestWithParam<std::tuple<std::function<void(InstrBufferx64&)>, std::vector<uint8_t>>>
+{
+};
+
+TEST_P(InstrBufferx64EncodingTest, encodes) {
+    auto [emit, check] = GetParam();
+    InstrBufferx64 b;
+    emit(b);
+    EXPECT_EQ(b.buffer(), check);
+}
+
+//expected bytes taken from GNU as
+INSTANTIATE_TEST_SUITE_P(InstrBufferx64EncodingTest, InstrBufferx64EncodingTest, ::testing::Values(
+    //mov rax, [rbp-0x8]
+    std::make_tuple([] (InstrBufferx64& b) { b.mov_r64_m64(Reg::RAX, Mem::stack(-8)); },
+                    std::vector<uint8_t>({0x48, 0x8b, 0x45, 0xf8})),
+    //mov rax, [rbp-0x200]
+    std::make_tuple([] (InstrBufferx64& b) { b.mov_r64_stack(Reg::RAX, -0x200); },
+                    std::vector<uint8_t>({0x48, 0x8b, 0x85, 0x00, 0xfe, 0xff, 0xff})),
+    //mov [rbp-0x200], r12
+    std::make_tuple([] (InstrBufferx64& b) { b.mov_stack_r64(-0x200, Reg::R12); },
+                    std::vector<uint8_t>({0x4c, 0x89, 0xa5, 0x00, 0xfe, 0xff, 0xff})),
+    //mov rcx, [rsp]
+    std::make_tuple([] (InstrBufferx64& b) { b.mov_r64_m64(Reg::RCX, {.base = Reg::RSP}); },
+                    std::vector<uint8_t>({0x48, 0x8b, 0x0c, 0x24})),
+    //mov rcx, [rsp+0x8]
+    std::make_tuple([] (InstrBufferx64& b) { b.mov_r64_m64(Reg::RCX, {.base = Reg::RSP, .disp = 8}); },
+                    std::vector<uint8_t>({0x48, 0x8b, 0x4c, 0x24, 0x08})),
+    //mov r9, [r12]
+    std::make_tuple([] (InstrBufferx64& b) { b.mov_r64_m64(Reg::R9, {.base = Reg::R12}); },
+                    std::vector<uint8_t>({0x4d, 0x8b, 0x0c, 0x24})),
+    //mov rdx, [r13+0x0]
+    std::make_tuple([] (InstrBufferx64& b) { b.mov_r64_m64(Reg::RDX, {.base = Reg::R13}); },
+                    std::vector<uint8_t>({0x49, 0x8b, 0x55, 0x00})),
+    //mov rax, [rbx]
+    std::make_tuple([] (InstrBufferx64& b) { b.mov_r64_m64(Reg::RAX, {.base = Reg::RBX}); },
+                    std::vector<uint8_t>({0x48, 0x8b, 0x03})),
+    //mov rax, [rbx+rcx*8]
+    std::make_tuple([] (InstrBufferx64& b) { b.mov_r64_m64(Reg::RAX, {.base = Reg::RBX, .index = Reg::RCX, .scale = 8}); },
+                    std::vector<uint8_t>({0x48, 0x8b, 0x04, 0xcb})),
+    //mov rax, [r15+r10*4+0x10]
+    std::make_tuple([] (InstrBufferx64& b) { b.mov_r64_m64(Reg::RAX, {.base = Reg::R15, .index = Reg::R10, .scale = 4, .disp = 0x10}); },
+                    std::vector<uint8_t>({0x4b, 0x8b, 0x44, 0x97, 0x10})),
+    //mov rax, [rdi+r9*2-0x1000]
+    std::make_tuple([] (InstrBufferx64& b) { b.mov_r64_m64(Reg::RAX, {.base = Reg::RDI, .index = Reg::R9, .scale = 2, .disp = -0x1000}); },
+                    std::vector<uint8_t>({0x4a, 0x8b, 0x84, 0x4f, 0x00, 0xf0, 0xff, 0xff})),
+    //lea rsi, [rbx+rax*8+0x20]
+    std::make_tuple([] (InstrBufferx64& b) { b.lea_r64_m(Reg::RSI, {.base = Reg::RBX, .index = Reg::RAX, .scale = 8, .disp = 0x20}); },
+                    std::vector<uint8_t>({0x48, 0x8d, 0x74, 0xc3, 0x20})),
+    //add rax, [rbp-0x8]
+    std::make_tuple([] (InstrBufferx64& b) { b.add_r64_m64(Reg::RAX, Mem::stack(-8)); },
+                    std::vector<uint8_t>({0x48, 0x03, 0x45, 0xf8})),
+    //add r11, [rsp+0x80]
+    std::make_tuple([] (InstrBufferx64& b) { b.add_r64_m64(Reg::R11, {.base = Reg::RSP, .disp = 0x80}); },
+                    std::vector<uint8_t>({0x4c, 0x03, 0x9c, 0x24, 0x80, 0x00, 0x00, 0x00})),
+    //sub rax, [rbp-0x8]
+    std::make_tuple([] (InstrBufferx64& b) { b.sub_r64_m64(Reg::RAX, Mem::stack(-8)); },
+                    std::vector<uint8_t>({0x48, 0x2b, 0x45, 0xf8})),
+    //sub rax, rcx
+    std::make_tuple([] (InstrBufferx64& b) { b.sub_r64_r64(Reg::RAX, Reg::RCX); },
+                    std::vector<uint8_t>({0x48, 0x2b, 0xc1})),
+    //sub r8, r15
+    std::make_tuple([] (InstrBufferx64& b) { b.sub_r64_r64(Reg::R8, Reg::R15); },
+                    std::vector<uint8_t>({0x4d, 0x2b, 0xc7})),
+    //cmp rax, [rbp-0x10]
+    std::make_tuple([] (InstrBufferx64& b) { b.cmp_r64_m64(Reg::RAX, Mem::stack(-0x10)); },
+                    std::vector<uint8_t>({0x48, 0x3b, 0x45, 0xf0})),
+    //cmp r14, [r13+0x0]
+    std::make_tuple([] (InstrBufferx64& b) { b.cmp_r64_m64(Reg::R14, {.base = Reg::R13}); },
+                    std::vector<uint8_t>({0x4d, 0x3b, 0x75, 0x00})),
+    //cqo; idiv qword ptr [rbp-0x8]
+    std::make_tuple([] (InstrBufferx64& b) { b.cqo_idiv_m64(Mem::stack(-8)); },
+                    std::vector<uint8_t>({0x48, 0x99, 0x48, 0xf7, 0x7d, 0xf8})),
+    //mov qword ptr [rbp-0x8], 0x5
+    std::make_tuple([] (InstrBufferx64& b) { b.mov_m64_imm32(Mem::stack(-8), 5); },
+                    std::vector<uint8_t>({0x48, 0xc7, 0x45, 0xf8, 0x05, 0x00, 0x00, 0x00})),
+    //imul rcx
+    std::make_tuple([] (InstrBufferx64& b) { b.imul_r64(Reg::RCX); },
+                    std::vector<uint8_t>({0x48, 0xf7, 0xe9})),
+    //imul r9
+    std::make_tuple([] (InstrBufferx64& b) { b.imul_r64(Reg::R9); },
+                    std::vector<uint8_t>({0x49, 0xf7, 0xe9})),
+    //imul rdx, rax
+    std::make_tuple([] (InstrBufferx64& b) { b.imul_r64_r64(Reg::RDX, Reg::RAX); },
+                    std::vector<uint8_t>({0x48, 0x0f, 0xaf, 0xd0})),
+    //imul r10, r11
+    std::make_tuple([] (InstrBufferx64& b) { b.imul_r64_r64(Reg::R10, Reg::R11); },
+                    std::vector<uint8_t>({0x4d, 0x0f, 0xaf, 0xd3})),
+    //imul rdx, r12, -3 (imm32 form)
+    std::make_tuple([] (InstrBufferx64& b) { b.imul_r64_r64_imm32(Reg::RDX, Reg::R12, -3); },
+                    std::vector<uint8_t>({0x49, 0x69, 0xd4, 0xfd, 0xff, 0xff, 0xff})),
+    //sar r8, 0x3f
+    std::make_tuple([] (InstrBufferx64& b) { b.sar_r64_imm8(Reg::R8, 63); },
+                    std::vector<uint8_t>({0x49, 0xc1, 0xf8, 0x3f})),
+    //shr rax, 0x3f
+    std::make_tuple([] (InstrBufferx64& b) { b.shr_r64_imm8(Reg::RAX, 63); },
+                    std::vector<uint8_t>({0x48, 0xc1, 0xe8, 0x3f})),
+    //and r13, 0x7fffffff
+    std::make_tuple([] (InstrBufferx64& b) { b.and_r64_imm32(Reg::R13, 0x7fffffff); },
+                    std::vector<uint8_t>({0x49, 0x81, 0xe5, 0xff, 0xff, 0xff, 0x7f})),
+    //mov qword ptr [rax], -1
+    std::make_tuple([] (InstrBufferx64& b) { b.mov_m64_imm32({.base = Reg::RAX}, -1); },
+                    std::vector<uint8_t>({0x48, 0xc7, 0x00, 0xff, 0xff, 0xff, 0xff}))
+));
+
+TEST(InstrBufferx64, memory_rsp_index_throw) {
+    InstrBufferx64 b;
+    EXPECT_ANY_THROW(b.mov_r64_m64(Reg::RAX, {.base = Reg::RBX, .index = Reg::RSP}));
+}
+
+TEST(InstrBufferx64, memory_bad_scale_throw) {
+    InstrBufferx64 b;
+    EXPECT_ANY_THROW(b.mov_r64_m64(Reg::RAX, {.base = Reg::RBX, .index = Reg::RCX, .scale = 3}));
+}
@@ -0,0 +1,128 @@
+//------------------------------------------------------------------------------
+// JitDebug.cpp
+//------------------------------------------------------------------------------
+
+#include "JitDebug.hpp"
+
+#include "Elf.hpp"
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <sstream>
+
+#include <unistd.h>
+
+extern "C" {
+    //GDB finds these by name, they must not be inlined or optimised away
+    jit_descriptor __jit_debug_descriptor = {1, 0, nullptr, nullptr};
+
+    __attribute__((noinline)) void __jit_debug_register_code() {
+        asm volatile("" ::: "memory");
+    }
+}
+
+namespace {
+    constexpr std::uint32_t JitNoAction = 0;
+    constexpr std::uint32_t JitRegister = 1;
+    constexpr std::uint32_t JitUnregister = 2;
+
+    //guards the descriptor list and writes to the perf map
+    std::mutex& registry_mutex() {
+        static std::mutex mutex;
+        return mutex;
+    }
+
+    std::atomic<bool> perfMapEnabled = false;
+
+    void write_perf_map(const ll::Object& object, const void* address) {
+        auto base = reinterpret_cast<std::uintptr_t>(address);
+        auto path = ll::JitRegistration::perf_map_path();
+        auto file = std::fopen(path.c_str(), "a");
+        if (file == nullptr) {
+            return;
+        }
+
+        for (auto& function : object.function_extents()) {
+            std::fprintf(file, "%lx %lx %.*s\n", static_cast<unsigned long>(base + function.offset), static_cast<unsigned long>(function.size),
+                static_cast<int>(function.name.size()), function.name.data());
+        }
+        std::fclose(file);
+    }
+}
+
+ll::JitRegistration::JitRegistration(const Object& object, const void* address)
+: _entry(std::make_unique<Entry>())
+{
+    std::stringstream ss;
+    elf::write_symbol_file(ss, object, reinterpret_cast<std::uint64_t>(address));
+    _entry->symfile = ss.str();
+    _entry->entry.symfile_addr = _entry->symfile.data();
+    _entry->entry.symfile_size = _entry->symfile.size();
+
+    std::lock_guard lock(registry_mutex());
+    if (perfMapEnabled) {
+        write_perf_map(object, address);
+    }
+
+    auto entry = &_entry->entry;
+    entry->next_entry = __jit_debug_descriptor.first_entry;
+    if (entry->next_entry) {
+        entry->next_entry->prev_entry = entry;
+    }
+    __jit_debug_descriptor.first_entry = entry;
+    __jit_debug_descriptor.relevant_entry = entry;
+    __jit_debug_descriptor.action_flag = JitRegister;
+    __jit_debug_register_code();
+    __jit_debug_descriptor.action_flag = JitNoAction;
+}
+
+ll::JitRegistration& ll::JitRegistration::operator=(JitRegistration&& other) noexcept {
+    if (this != &other) {
+        reset();
+        _entry = std::move(other._entry);
+    }
+    return *this;
+}
+
+ll::JitRegistration::~JitRegistration() {
+    reset();
+}
+
+void ll::JitRegistration::reset() {
+    if (!_entry) {
+        return;
+    }
+
+    {
+        std::lock_guard lock(registry_mutex());
+        auto entry = &_entry->entry;
+        if (entry->prev_entry) {
+            entry->prev_entry->next_entry = entry->next_entry;
+        } else {
+            __jit_debug_descriptor.first_entry = entry->next_entry;
+        }
+        if (entry->next_entry) {
+            entry->next_entry->prev_entry = entry->prev_entry;
+        }
+
+        __jit_debug_descriptor.relevant_entry = entry;
+        __jit_debug_descriptor.action_flag = JitUnregister;
+        __jit_debug_register_code();
+        __jit_debug_descriptor.action_flag = JitNoAction;
+        __jit_debug_descriptor.relevant_entry = nullptr;
+    }
+    _entry.reset();
+}
+
+void ll::JitRegistration::enable_perf_map(bool enable) {
+    perfMapEnabled = enable;
+}
+
+bool ll::JitRegistration::perf_map_enabled() {
+    return perfMapEnabled;
+}
+
+std::filesystem::path ll::JitRegistration::perf_map_path() {
+    return "/tmp/perf-" + std::to_string(::getpid()) + ".map";
+}
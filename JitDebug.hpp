@@ -0,0 +1,66 @@
+//------------------------------------------------------------------------------
+// JitDebug.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "Linker.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+//GDB's JIT interface. GDB breaks in __jit_debug_register_code and reads the
+//symbol file of the entry named by relevant_entry, see "JIT Interface" in the
+//GDB manual.
+extern "C" {
+    struct jit_code_entry {
+        jit_code_entry* next_entry;
+        jit_code_entry* prev_entry;
+        const char* symfile_addr;
+        std::uint64_t symfile_size;
+    };
+
+    struct jit_descriptor {
+        std::uint32_t version;
+        std::uint32_t action_flag;
+        jit_code_entry* relevant_entry;
+        jit_code_entry* first_entry;
+    };
+
+    extern jit_descriptor __jit_debug_descriptor;
+    void __jit_debug_register_code();
+}
+
+namespace ll {
+
+//Names the functions of JIT compiled code for profilers and debuggers while the
+//code is loaded. An in memory ELF symbol file is registered through the GDB JIT
+//interface and, when perf maps are enabled, a line per function is appended to
+///tmp/perf-<pid>.map for perf to read. The registration is removed from GDB on
+//destruction, perf maps are append only.
+class JitRegistration {
+private:
+    struct Entry {
+        jit_code_entry entry{};
+        std::string symfile;
+    };
+    std::unique_ptr<Entry> _entry;
+
+public:
+    JitRegistration() = default;
+    JitRegistration(const Object& object, const void* address);
+    JitRegistration(JitRegistration&& other) noexcept = default;
+    JitRegistration& operator=(JitRegistration&& other) noexcept;
+    ~JitRegistration();
+
+    void reset();
+
+    //off by default, perf only reads the map for the process id it profiled
+    static void enable_perf_map(bool enable);
+    static bool perf_map_enabled();
+    static std::filesystem::path perf_map_path();
+};
+
+}
@@ -0,0 +1,115 @@
+//------------------------------------------------------------------------------
+// JitDebug.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "JitDebug.hpp"
+
+#include "Elf.hpp"
+#include "JitModule.hpp"
+#include "TestPrograms.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+using namespace ll;
+
+namespace {
+    bool registered(const void* address) {
+        for (auto entry = __jit_debug_descriptor.first_entry; entry; entry = entry->next_entry) {
+            elf::Header header;
+            std::memcpy(&header, entry->symfile_addr, sizeof(header));
+            elf::SectionHeader text;
+            std::memcpy(&text, entry->symfile_addr + header.e_shoff + sizeof(elf::SectionHeader), sizeof(text));
+            if (text.sh_addr == reinterpret_cast<std::uint64_t>(address)) {
+                return true;
+            }
+        }
+        return false;
+    }
+}
+
+TEST(JitDebug, write_symbol_file) {
+    std::string_view program = R"(
+    fn helper() { printf("h"); }
+    fn main() { helper(); }
+    )";
+    auto object = test::compile_object(program, Compiler_x64::Mode::JIT);
+
+    std::stringstream ss;
+    elf::write_symbol_file(ss, object, 0x10000);
+    auto data = ss.str();
+
+    elf::Header header;
+    std::memcpy(&header, data.data(), sizeof(header));
+    EXPECT_EQ(header.magic, 0x464c457f);
+    ASSERT_EQ(header.e_shnum, 5);
+    ASSERT_EQ(data.size(), header.e_shoff + 5 * sizeof(elf::SectionHeader));
+
+    elf::SectionHeader sections[5];
+    std::memcpy(sections, data.data() + header.e_shoff, sizeof(sections));
+    EXPECT_EQ(sections[1].sh_type, 0x8);
+    EXPECT_EQ(sections[1].sh_addr, 0x10000);
+    EXPECT_EQ(sections[1].sh_size, object.buff.buffer().size());
+
+    auto& symtab = sections[2];
+    auto& strtab = sections[3];
+    EXPECT_EQ(symtab.sh_link, 3);
+    ASSERT_EQ(symtab.sh_size, 3 * sizeof(elf::SymbolEntry));
+    elf::SymbolEntry symbols[3];
+    std::memcpy(symbols, data.data() + symtab.sh_offset, sizeof(symbols));
+
+    EXPECT_STREQ(data.data() + strtab.sh_offset + symbols[1].name, "helper");
+    EXPECT_EQ(symbols[1].value, 0);
+    EXPECT_EQ(symbols[1].size, object.symbols[1].offset);
+    EXPECT_STREQ(data.data() + strtab.sh_offset + symbols[2].name, "main");
+    EXPECT_EQ(symbols[2].value, object.symbols[1].offset);
+    EXPECT_EQ(symbols[2].value + symbols[2].size, object.buff.buffer().size());
+}
+
+TEST(JitDebug, registered_while_module_lives) {
+    CodeHeap heap;
+    const void* address = nullptr;
+    {
+        auto module = test::compile_module(R"(fn main() { })", heap);
+        address = module.code().address();
+        EXPECT_TRUE(registered(address));
+
+        auto moved = std::move(module);
+        EXPECT_TRUE(registered(address));
+
+        auto replacement = test::compile_module(R"(fn main() { })", heap);
+        auto replacementAddress = replacement.code().address();
+        moved = std::move(replacement);
+        EXPECT_FALSE(registered(address));
+        EXPECT_TRUE(registered(replacementAddress));
+        address = replacementAddress;
+    }
+    EXPECT_FALSE(registered(address));
+}
+
+TEST(JitDebug, perf_map) {
+    auto path = JitRegistration::perf_map_path();
+    std::filesystem::remove(path);
+
+    CodeHeap heap;
+    JitRegistration::enable_perf_map(true);
+    auto module = test::compile_module(R"(
+    fn helper() { printf("h"); }
+    fn main() { helper(); }
+    )", heap);
+    JitRegistration::enable_perf_map(false);
+
+    std::ifstream file(path);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    std::filesystem::remove(path);
+
+    std::stringstream expected;
+    expected << std::hex << reinterpret_cast<std::uintptr_t>(module.address("main")) << " ";
+    EXPECT_NE(ss.str().find(expected.str()), std::string::npos);
+    EXPECT_NE(ss.str().find(" helper\n"), std::string::npos);
+    EXPECT_NE(ss.str().find(" main\n"), std::string::npos);
+}
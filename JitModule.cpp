@@ -0,0 +1,58 @@
+//------------------------------------------------------------------------------
+// JitModule.cpp
+//------------------------------------------------------------------------------
+
+#include "JitModule.hpp"
+
+#include <sstream>
+#include <stdexcept>
+
+ll::JitModule::JitModule(Object&& object, CodeAllocation&& code)
+: _object(std::move(object))
+, _code(std::move(code))
+{
+    for (auto& symbol : _object.symbols) {
+        _offsets.emplace(symbol.name, symbol.offset);
+    }
+    _registration = JitRegistration(_object, _code.address());
+}
+
+ll::JitModule& ll::JitModule::operator=(JitModule&& other) {
+    if (this == &other) {
+        return *this;
+    }
+
+    //the old code is freed by the assignment of _code
+    _registration.reset();
+    _object = std::move(other._object);
+    _code = std::move(other._code);
+    _offsets = std::move(other._offsets);
+    _registration = std::move(other._registration);
+    return *this;
+}
+
+ll::JitModule ll::JitModule::finalise(Object&& object, CodeHeap& heap) {
+    if (!object.buff._externFuncs.empty()) {
+        std::stringstream ss;
+        ss << "Unresolved function: " << object.buff._externFuncs.front().symbol;
+        throw std::runtime_error(ss.str());
+    }
+
+    auto code = heap.allocate(object.buff.buffer());
+    return JitModule(std::move(object), std::move(code));
+}
+
+bool ll::JitModule::contains(std::string_view name) const {
+    return _offsets.contains(std::string(name));
+}
+
+void* ll::JitModule::address(std::string_view name) const {
+    auto it = _offsets.find(std::string(name));
+    if (it == _offsets.end()) {
+        std::stringstream ss;
+        ss << "No function named: " << name;
+        throw std::out_of_range(ss.str());
+    }
+
+    return static_cast<std::byte*>(_code.address()) + it->second;
+}
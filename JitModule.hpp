@@ -0,0 +1,52 @@
+//------------------------------------------------------------------------------
+// JitModule.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "CodeHeap.hpp"
+#include "JitDebug.hpp"
+#include "Linker.hpp"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+namespace ll {
+
+//A JIT compiled Object copied into executable memory once. Functions are looked
+//up by symbol name and called directly as often as needed. The module keeps the
+//object's string constants alive, so it must outlive any call into it. The
+//functions are named to debuggers and profilers for as long as the module lives.
+class JitModule {
+private:
+    Object _object;
+    CodeAllocation _code;
+    std::unordered_map<std::string, std::size_t> _offsets;
+    //declared last so it is unregistered before the code is freed on
+    //destruction, move assignment unregisters it first by hand
+    JitRegistration _registration;
+
+    JitModule(Object&& object, CodeAllocation&& code);
+
+public:
+    JitModule(JitModule&&) = default;
+    JitModule& operator=(JitModule&& other);
+
+    //the object must be compiled in JIT mode with every call resolved
+    static JitModule finalise(Object&& object, CodeHeap& heap = CodeHeap::process());
+
+    bool contains(std::string_view name) const;
+    void* address(std::string_view name) const;
+
+    //typed entry point, e.g. function<void()>("main")
+    template<typename Signature>
+    Signature* function(std::string_view name) const {
+        return reinterpret_cast<Signature*>(address(name));
+    }
+
+    const Object& object() const { return _object; }
+    const CodeAllocation& code() const { return _code; }
+};
+
+}
@@ -0,0 +1,114 @@
+//------------------------------------------------------------------------------
+// JitModule.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "JitModule.hpp"
+
+#include "TestPrograms.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace ll;
+
+TEST(JitModule, call_functions_many_times) {
+    CodeHeap heap;
+    auto module = test::compile_module(R"(
+    fn helper() { printf("h"); }
+    fn main() { int64 a; a = 1 + 2; printf("%i", a); helper(); }
+    )", heap);
+
+    EXPECT_TRUE(module.contains("main"));
+    EXPECT_TRUE(module.contains("helper"));
+    EXPECT_FALSE(module.contains("missing"));
+
+    auto main = module.function<void()>("main");
+    auto helper = module.function<void()>("helper");
+    EXPECT_EQ(reinterpret_cast<std::byte*>(helper), static_cast<std::byte*>(module.code().address()));
+
+    testing::internal::CaptureStdout();
+    for (int i = 0; i < 3; i++) {
+        main();
+    }
+    helper();
+    fflush(stdout);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "3h3h3hh");
+
+    //finalised once, calls need no further memory
+    EXPECT_EQ(heap.stats().allocations, 1);
+}
+
+TEST(JitModule, parameters_and_return_values) {
+    CodeHeap heap;
+    auto module = test::compile_module(R"(
+    fn add(int64 a, int64 b) { return a + b; }
+    fn sum8(int64 a, int64 b, int64 c, int64 d, int64 e, int64 f, int64 g, int64 h) {
+        return a + b + c + d + e + f + g + h;
+    }
+    fn count(int64 n, int64 limit) {
+        if (n < limit) { return count(n + 1, limit) + 1; }
+        return 0;
+    }
+    fn nested(int64 a) { return add(add(a, 1), add(a, 2)) + sum8(1, 2, 4, 8, 16, 32, 64, a); }
+    fn main() { printf("%i %i", add(2, 3), count(0, 10)); }
+    )", heap);
+
+    EXPECT_EQ(module.function<int64_t(int64_t, int64_t)>("add")(40, 2), 42);
+    EXPECT_EQ(module.function<int64_t(int64_t, int64_t, int64_t, int64_t, int64_t, int64_t, int64_t, int64_t)>("sum8")(1, 2, 4, 8, 16, 32, 64, 128), 255);
+    EXPECT_EQ(module.function<int64_t(int64_t, int64_t)>("count")(0, 20), 20);
+    EXPECT_EQ(module.function<int64_t(int64_t)>("nested")(10), 23 + 127 + 10);
+
+    testing::internal::CaptureStdout();
+    module.function<void()>("main")();
+    fflush(stdout);
+    EXPECT_EQ(testing::internal::GetCapturedStdout(), "5 10");
+}
+
+TEST(JitModule, addition_chains_over_register_variables) {
+    //chains long enough that their scratch registers pass the ones holding
+    //the variables they read
+    CodeHeap heap;
+    auto module = test::compile_module(R"(
+    fn locals() {
+        int64 a; int64 b; int64 c; int64 d; int64 i; int64 x;
+        a = 1; b = 10; c = 100; d = 1000; i = 0;
+        while (i < 1) { i = i + 1; }
+        x = a + b + c + d + i;
+        return x;
+    }
+    fn params(int64 x, int64 y, int64 z) {
+        int64 r;
+        r = 1 + 2 + 3 + 4 + 5 + x + y + z;
+        return r;
+    }
+    fn nested(int64 x, int64 y) {
+        int64 a; int64 b;
+        a = x + 1; b = y + 2;
+        return a + b + x + y + a + b + 1 + 2 + 3 + 4 + 5 + 6 + 7 + 8 + 9 + 10 + 11;
+    }
+    )", heap);
+
+    EXPECT_EQ(module.function<int64_t()>("locals")(), 1112);
+    EXPECT_EQ(module.function<int64_t(int64_t, int64_t, int64_t)>("params")(100, 1000, 10000), 11115);
+    EXPECT_EQ(module.function<int64_t(int64_t, int64_t)>("nested")(100, 1000), 2 * 101 + 2 * 1002 + 1100 + 66);
+}
+
+TEST(JitModule, released_with_module) {
+    CodeHeap heap;
+    {
+        auto module = test::compile_module(R"(fn main() { puts(""); })", heap);
+        EXPECT_EQ(heap.stats().allocations, 1);
+    }
+    EXPECT_EQ(heap.stats().allocations, 0);
+}
+
+TEST(JitModule, unknown_function_throw) {
+    CodeHeap heap;
+    auto module = test::compile_module(R"(fn main() { })", heap);
+    EXPECT_THROW(module.address("other"), std::out_of_range);
+}
+
+TEST(JitModule, unresolved_call_throw) {
+    CodeHeap heap;
+    EXPECT_THROW(test::compile_module(R"(fn main() { no_such_function_anywhere(); })", heap), std::runtime_error);
+    EXPECT_EQ(heap.stats().allocations, 0);
+}
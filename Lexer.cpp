@@ -0,0 +1,136 @@
+//------------------------------------------------------------------------------
+// Lexer.cpp
+//------------------------------------------------------------------------------
+
+#include "Lexer.hpp"
+
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+    bool is_identifier_start(char c) {
+        return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
+    }
+
+    bool is_identifier_char(char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+    }
+}
+
+std::vector<lexer::Token> lexer::tokenise(std::string_view input) {
+    std::vector<Token> tokens;
+    tokens.reserve(input.size() / 4 + 1);
+
+    size_t i = 0;
+    auto push = [&] (Token::Kind kind, size_t start, size_t length) {
+        tokens.push_back(Token{
+            .kind = kind,
+            .text = input.substr(start, length),
+            .offset = start
+        });
+        i = start + length;
+    };
+
+    while (i < input.size()) {
+        char c = input[i];
+
+        if (std::isspace(static_cast<unsigned char>(c))) {
+            i++;
+            continue;
+        }
+
+        if (is_identifier_start(c)) {
+            size_t end = i + 1;
+            while (end < input.size() && is_identifier_char(input[end])) {
+                end++;
+            }
+            push(Token::Identifier, i, end - i);
+            continue;
+        }
+
+        if (std::isdigit(static_cast<unsigned char>(c))) {
+            size_t end = i + 1;
+            while (end < input.size() && std::isdigit(static_cast<unsigned char>(input[end]))) {
+                end++;
+            }
+            push(Token::Integer, i, end - i);
+            continue;
+        }
+
+        bool hasNext = i + 1 < input.size();
+        char next = hasNext ? input[i + 1] : '\0';
+
+        switch (c) {
+            case '"':
+            {
+                auto end = input.find('"', i + 1);
+                if (end == std::string_view::npos) {
+                    throw Error("no end to string found", i);
+                }
+                tokens.push_back(Token{
+                    .kind = Token::String,
+                    .text = input.substr(i + 1, end - i - 1),
+                    .offset = i
+                });
+                i = end + 1;
+                break;
+            }
+
+            case '(': push(Token::OpenParen, i, 1); break;
+            case ')': push(Token::CloseParen, i, 1); break;
+            case '{': push(Token::OpenBrace, i, 1); break;
+            case '}': push(Token::CloseBrace, i, 1); break;
+            case ',': push(Token::Comma, i, 1); break;
+            case ';': push(Token::Semicolon, i, 1); break;
+            case '+': push(Token::Plus, i, 1); break;
+            case '%': push(Token::Percent, i, 1); break;
+
+            case '=':
+                if (next == '=') {
+                    push(Token::Equal, i, 2);
+                } else {
+                    push(Token::Assign, i, 1);
+                }
+                break;
+
+            case '!':
+                if (next != '=') {
+                    throw Error("unknown comparator", i);
+                }
+                push(Token::NotEqual, i, 2);
+                break;
+
+            case '<':
+                if (next == '=') {
+                    push(Token::LessThanOrEqual, i, 2);
+                } else {
+                    push(Token::LessThan, i, 1);
+                }
+                break;
+
+            case '>':
+                if (next == '=') {
+                    push(Token::GreaterThanOrEqual, i, 2);
+                } else {
+                    push(Token::GreaterThan, i, 1);
+                }
+                break;
+
+            default:
+            {
+                std::stringstream ss;
+                ss << "Unexpected character '" << c << "'";
+                throw Error(ss.str(), i);
+            }
+        }
+    }
+
+    tokens.push_back(Token{
+        .kind = Token::End,
+        .text = input.substr(input.size()),
+        .offset = input.size()
+    });
+
+    return tokens;
+}
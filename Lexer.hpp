@@ -0,0 +1,58 @@
+//------------------------------------------------------------------------------
+// Lexer.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace lexer {
+
+struct Token {
+    enum Kind : uint8_t {
+        End,
+        Identifier,
+        Integer,
+        String,
+        OpenParen,
+        CloseParen,
+        OpenBrace,
+        CloseBrace,
+        Comma,
+        Semicolon,
+        Assign,
+        Plus,
+        Percent,
+        Equal,
+        NotEqual,
+        LessThan,
+        LessThanOrEqual,
+        GreaterThan,
+        GreaterThanOrEqual,
+    } kind = End;
+
+    //for strings this excludes the surrounding quotes
+    std::string_view text;
+    //offset of the first character of the token in the lexed input
+    size_t offset = 0;
+
+    bool is(Kind k) const { return kind == k; }
+    bool is(Kind k, std::string_view t) const { return kind == k && text == t; }
+};
+
+//thrown by tokenise, offset is where in the lexed input the error was found
+struct Error : std::runtime_error {
+    size_t offset;
+
+    Error(const std::string& message, size_t offset) : std::runtime_error(message), offset(offset) {}
+};
+
+//Single forward pass over the input. The returned stream always ends with an
+//End token whose offset is the size of the input.
+std::vector<Token> tokenise(std::string_view input);
+
+}
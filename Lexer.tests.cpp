@@ -0,0 +1,91 @@
+//------------------------------------------------------------------------------
+// Lexer.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "Lexer.hpp"
+
+#include <gtest/gtest.h>
+
+using lexer::Token;
+
+namespace {
+    std::vector<Token::Kind> kinds(const std::vector<Token>& tokens) {
+        std::vector<Token::Kind> out;
+        for (auto& token : tokens) {
+            out.push_back(token.kind);
+        }
+        return out;
+    }
+}
+
+TEST(Lexer, empty) {
+    auto tokens = lexer::tokenise("");
+    ASSERT_EQ(tokens.size(), 1);
+    EXPECT_EQ(tokens[0].kind, Token::End);
+    EXPECT_EQ(tokens[0].offset, 0);
+}
+
+TEST(Lexer, whitespace_only) {
+    auto tokens = lexer::tokenise(" \n\t ");
+    ASSERT_EQ(tokens.size(), 1);
+    EXPECT_EQ(tokens[0].kind, Token::End);
+    EXPECT_EQ(tokens[0].offset, 4);
+}
+
+TEST(Lexer, function_call) {
+    auto tokens = lexer::tokenise(R"(printf("%i", counter);)");
+    EXPECT_EQ(kinds(tokens), std::vector<Token::Kind>({
+        Token::Identifier, Token::OpenParen, Token::String, Token::Comma,
+        Token::Identifier, Token::CloseParen, Token::Semicolon, Token::End
+    }));
+
+    EXPECT_EQ(tokens[0].text, "printf");
+    EXPECT_EQ(tokens[2].text, "%i");
+    EXPECT_EQ(tokens[2].offset, 7);
+    EXPECT_EQ(tokens[4].text, "counter");
+    EXPECT_EQ(tokens[4].offset, 13);
+}
+
+TEST(Lexer, assignment_calculation) {
+    auto tokens = lexer::tokenise("mod3 = counter % 3 + 12;");
+    EXPECT_EQ(kinds(tokens), std::vector<Token::Kind>({
+        Token::Identifier, Token::Assign, Token::Identifier, Token::Percent,
+        Token::Integer, Token::Plus, Token::Integer, Token::Semicolon, Token::End
+    }));
+    EXPECT_EQ(tokens[0].text, "mod3");
+    EXPECT_EQ(tokens[6].text, "12");
+}
+
+TEST(Lexer, comparators) {
+    auto tokens = lexer::tokenise("== != < <= > >= =");
+    EXPECT_EQ(kinds(tokens), std::vector<Token::Kind>({
+        Token::Equal, Token::NotEqual, Token::LessThan, Token::LessThanOrEqual,
+        Token::GreaterThan, Token::GreaterThanOrEqual, Token::Assign, Token::End
+    }));
+}
+
+TEST(Lexer, string_keeps_inner_content) {
+    auto tokens = lexer::tokenise(R"(" a + b; { } ")");
+    ASSERT_EQ(tokens.size(), 2);
+    EXPECT_EQ(tokens[0].kind, Token::String);
+    EXPECT_EQ(tokens[0].text, " a + b; { } ");
+}
+
+TEST(Lexer, unterminated_string_throws) {
+    EXPECT_THROW(lexer::tokenise(R"(puts("test);)"), std::runtime_error);
+}
+
+TEST(Lexer, unknown_character_throws) {
+    EXPECT_THROW(lexer::tokenise("test = 1 * 2;"), std::runtime_error);
+}
+
+TEST(Lexer, blocks) {
+    auto tokens = lexer::tokenise("fn main() { while (a < 1) {} }");
+    EXPECT_EQ(kinds(tokens), std::vector<Token::Kind>({
+        Token::Identifier, Token::Identifier, Token::OpenParen, Token::CloseParen,
+        Token::OpenBrace, Token::Identifier, Token::OpenParen, Token::Identifier,
+        Token::LessThan, Token::Integer, Token::CloseParen, Token::OpenBrace,
+        Token::CloseBrace, Token::CloseBrace, Token::End
+    }));
+    EXPECT_EQ(tokens.back().offset, 30);
+}
@@ -7,36 +7,85 @@
 
 #include "TranslationUnit.hpp"
 
+#include <algorithm>
 #include <map>
 
-ll::Object ll::Object::compile_translation_unit(const TranslationUnit& tu, Compiler_x64::Mode mode) {
+ll::Object ll::Object::compile_translation_unit(const TranslationUnit& tu, Compiler_x64::Mode mode, SymbolResolver* resolver, ThreadPool* pool, Stats* stats) {
     ll::Object obj;
-
     std::map<std::string, std::size_t> symbols;
 
-    for (auto& func : tu.functions) {
-        obj.symbols.push_back(Symbol{
-            .name = func->name,
-            .offset = obj.buff.buffer().size()
-        });
+    {
+        auto compiling = Stats::phase(stats, "compile");
+
+        std::vector<InstrBufferx64> buffers(tu.functions.size());
+        auto compile = [&] (std::size_t i) {
+            auto compiler = Compiler_x64(tu.functions[i]->block, &buffers[i], mode, resolver, &tu.lines);
+            compiler.compile_function();
+        };
+
+        if (pool) {
+            pool->parallel_for(buffers.size(), compile);
+        } else {
+            for (std::size_t i = 0; i < buffers.size(); i++) {
+                compile(i);
+            }
+        }
+
+        std::size_t totalSize = 0;
+        for (auto& buffer : buffers) {
+            totalSize += buffer.buffer().size();
+        }
+        obj.buff.buffer().reserve(totalSize);
+
+        for (std::size_t i = 0; i < buffers.size(); i++) {
+            auto& func = tu.functions[i];
+            obj.symbols.push_back(Symbol{
+                .name = std::string(func->name),
+                .offset = obj.buff.buffer().size()
+            });
 
-        symbols.insert({func->name, obj.buff.buffer().size()});
+            symbols.insert({std::string(func->name), obj.buff.buffer().size()});
 
-        auto compiler = Compiler_x64(func->block.get(), &obj.buff, mode);
-        compiler.compile_function();
+            obj.buff.mark_statement(0, tu.lines.line(func->span.offset));
+            obj.buff.append_buffer(buffers[i]);
+        }
     }
 
+    auto relocating = Stats::phase(stats, "relocate");
+    std::size_t fixups = 0;
     decltype(obj.buff._externFuncs) filteredExternFuncs;
     for (auto& extFn : obj.buff._externFuncs) {
         auto sym = symbols.find(extFn.symbol);
         if (sym != symbols.end()) {
             int32_t* relocationAddr = reinterpret_cast<int32_t*>(&obj.buff.buffer()[extFn.location]);
             *relocationAddr = sym->second - (extFn.location + 4);
+            fixups++;
         } else {
             filteredExternFuncs.push_back(extFn);
         }
     }
     obj.buff._externFuncs = filteredExternFuncs;
 
+    if (stats) {
+        stats->count("fixups", fixups);
+    }
+
     return obj;
-}
\ No newline at end of file
+}
+
+std::vector<ll::FunctionExtent> ll::Object::function_extents() const {
+    std::vector<FunctionExtent> extents;
+    extents.reserve(symbols.size());
+    for (auto& symbol : symbols) {
+        extents.push_back({.name = symbol.name, .offset = symbol.offset, .size = 0});
+    }
+    std::stable_sort(extents.begin(), extents.end(), [] (auto& a, auto& b) {
+        return a.offset < b.offset;
+    });
+
+    for (std::size_t i = 0; i < extents.size(); i++) {
+        auto end = i + 1 < extents.size() ? extents[i + 1].offset : buff.buffer().size();
+        extents[i].size = end - extents[i].offset;
+    }
+    return extents;
+}
@@ -8,6 +8,8 @@
 #include "InstrBufferx64.hpp"
 
 #include "Compilerx64.hpp"
+#include "Stats.hpp"
+#include "ThreadPool.hpp"
 
 namespace ll {
 
@@ -19,11 +21,27 @@ struct Symbol {
     auto operator<=>(const Symbol&) const = default;
 };
 
+struct FunctionExtent {
+    std::string_view name;
+    std::size_t offset;
+    std::size_t size;
+};
+
 struct Object {
     InstrBufferx64 buff;
     std::vector<Symbol> symbols;
-
-    static Object compile_translation_unit(const TranslationUnit& tu, Compiler_x64::Mode mode);
+    //program the object was compiled from, named in debug info
+    std::string sourceFile;
+
+    //functions are compiled concurrently on the pool, or serially without one.
+    //Either way the output is the same, laid out in source order. Given stats,
+    //compiling and resolving calls between the functions are timed as the
+    //compile and relocate phases and the resolved calls counted as fixups.
+    static Object compile_translation_unit(const TranslationUnit& tu, Compiler_x64::Mode mode, SymbolResolver* resolver = nullptr, ThreadPool* pool = &ThreadPool::process(), Stats* stats = nullptr);
+
+    //functions in address order, each runs up to the next and the last to the
+    //end of the code. Names point into symbols.
+    std::vector<FunctionExtent> function_extents() const;
 };
 
 }
\ No newline at end of file
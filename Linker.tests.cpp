@@ -13,9 +13,9 @@
 
 TEST(LinkerTests, link_local_jit) {
     ll::TranslationUnit tu;
-    tu.functions.push_back(std::make_unique<ll::FunctionDefinition>());
+    tu.functions.push_back(tu.arena.make<ll::FunctionDefinition>());
     tu.functions.front()->name = "cool";
-    tu.functions.front()->block = std::make_unique<Block>();
+    tu.functions.front()->block = tu.arena.make<Block>();
 
     auto obj = ll::Object::compile_translation_unit(tu, Compiler_x64::Mode::JIT);
 
@@ -32,9 +32,9 @@ TEST(LinkerTests, link_local_jit) {
 
 TEST(LinkerTests, link_local_object_file) {
     ll::TranslationUnit tu;
-    tu.functions.push_back(std::make_unique<ll::FunctionDefinition>());
+    tu.functions.push_back(tu.arena.make<ll::FunctionDefinition>());
     tu.functions.front()->name = "cool";
-    tu.functions.front()->block = std::make_unique<Block>();
+    tu.functions.front()->block = tu.arena.make<Block>();
 
     auto obj = ll::Object::compile_translation_unit(tu, Compiler_x64::Mode::ObjectFile);
 
@@ -50,13 +50,13 @@ TEST(LinkerTests, link_local_object_file) {
 }
 
 TEST(LinkerTests, link_local_with_external_jit) {
-    Parser p;
+    ll::TranslationUnit tu;
+    Parser p(tu.arena);
     p.parse_block(std::string_view{"printf(\"test\");"});
 
-    ll::TranslationUnit tu;
-    tu.functions.push_back(std::make_unique<ll::FunctionDefinition>());
+    tu.functions.push_back(tu.arena.make<ll::FunctionDefinition>());
     tu.functions.front()->name = "main";
-    tu.functions.front()->block = std::move(p.block);
+    tu.functions.front()->block = p.block;
 
     auto obj = ll::Object::compile_translation_unit(tu, Compiler_x64::Mode::JIT);
 
@@ -72,13 +72,13 @@ TEST(LinkerTests, link_local_with_external_jit) {
 }
 
 TEST(LinkerTests, link_local_with_external_object_file) {
-    Parser p;
+    ll::TranslationUnit tu;
+    Parser p(tu.arena);
     p.parse_block(std::string_view{"printf(\"test\");"});
 
-    ll::TranslationUnit tu;
-    tu.functions.push_back(std::make_unique<ll::FunctionDefinition>());
+    tu.functions.push_back(tu.arena.make<ll::FunctionDefinition>());
     tu.functions.front()->name = "main";
-    tu.functions.front()->block = std::move(p.block);
+    tu.functions.front()->block = p.block;
 
     auto obj = ll::Object::compile_translation_unit(tu, Compiler_x64::Mode::ObjectFile);
 
@@ -181,3 +181,44 @@ TEST(LinkerTests, link_local_functions_object_file) {
             })
     );
 }
+
+TEST(LinkerTests, parallel_matches_serial) {
+    std::string program;
+    for (int i = 0; i < 64; i++) {
+        auto n = std::to_string(i);
+        program += "fn f" + n + "() { int64 a; a = " + n + ";\n";
+        program += "while (a < 100) { if (a == 7) { printf(\"%i\", a); } a = a + 3; }\n";
+        program += "puts(\"" + n + "\");\n";
+        if (i > 0) {
+            program += "f" + std::to_string(i - 1) + "();\n";
+        }
+        program += "undefined_fn(); }\n";
+    }
+    std::string_view sv = program;
+    auto tu = ll::TranslationUnit::parse_translation_unit(sv);
+
+    for (auto mode : {Compiler_x64::Mode::JIT, Compiler_x64::Mode::ObjectFile}) {
+        ll::ThreadPool pool(4);
+        auto serial = ll::Object::compile_translation_unit(*tu, mode, nullptr, nullptr);
+        auto parallel = ll::Object::compile_translation_unit(*tu, mode, nullptr, &pool);
+
+        EXPECT_EQ(parallel.symbols, serial.symbols);
+        EXPECT_EQ(parallel.buff._externFuncs, serial.buff._externFuncs);
+        EXPECT_EQ(parallel.buff._jitImports, serial.buff._jitImports);
+        ASSERT_EQ(parallel.buff._cstrings.size(), serial.buff._cstrings.size());
+
+        //JIT string constants are addressed absolutely so only compare the
+        //bytes around them
+        auto serialBytes = serial.buff.buffer();
+        auto parallelBytes = parallel.buff.buffer();
+        for (size_t i = 0; i < serial.buff._cstrings.size(); i++) {
+            EXPECT_EQ(*parallel.buff._cstrings[i], *serial.buff._cstrings[i]);
+            if (mode == Compiler_x64::Mode::JIT) {
+                auto location = serial.buff._cstrings[i]->location;
+                std::fill_n(serialBytes.begin() + location, 8, 0);
+                std::fill_n(parallelBytes.begin() + location, 8, 0);
+            }
+        }
+        EXPECT_EQ(parallelBytes, serialBytes);
+    }
+}
@@ -0,0 +1,216 @@
+//------------------------------------------------------------------------------
+// LittleLang.bench.cpp
+//------------------------------------------------------------------------------
+
+#include "Compilerx64.hpp"
+#include "ConstantFolder.hpp"
+#include "Elf.hpp"
+#include "Inliner.hpp"
+#include "JitModule.hpp"
+#include "MachO.hpp"
+#include "Parser.hpp"
+#include "ProgramGenerator.hpp"
+#include "TranslationUnit.hpp"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <benchmark/benchmark.h>
+
+using namespace ll;
+
+namespace {
+    std::string generated(std::size_t functions, std::size_t statements, std::size_t depth) {
+        return ProgramGenerator({.functions = functions, .statements = statements, .depth = depth}).translation_unit();
+    }
+
+    TranslationUnitPtr parse(std::string_view source, ThreadPool* pool = &ThreadPool::process()) {
+        auto tu = TranslationUnit::parse_program(source, pool);
+        Inliner inliner(tu->arena);
+        inliner.inline_translation_unit(*tu);
+        ConstantFolder folder(tu->arena);
+        for (auto function : tu->functions) {
+            folder.fold_function(function->block);
+        }
+        return tu;
+    }
+
+    //programs print, keep that out of the benchmark output
+    class SilenceStdout {
+        int _saved;
+
+    public:
+        SilenceStdout() {
+            fflush(stdout);
+            _saved = ::dup(STDOUT_FILENO);
+            int null = ::open("/dev/null", O_WRONLY);
+            ::dup2(null, STDOUT_FILENO);
+            ::close(null);
+        }
+
+        ~SilenceStdout() {
+            fflush(stdout);
+            ::dup2(_saved, STDOUT_FILENO);
+            ::close(_saved);
+        }
+    };
+
+    void set_bytes(benchmark::State& state, std::size_t bytes) {
+        state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations() * bytes));
+    }
+}
+
+//statements in one block
+static void BM_ParseBlock(benchmark::State& state) {
+    auto source = ProgramGenerator({.statements = static_cast<std::size_t>(state.range(0)), .depth = 2}).block();
+
+    for (auto _ : state) {
+        ll::Arena arena;
+        Parser p(arena);
+        p.parse_block(source);
+        benchmark::DoNotOptimize(p.block);
+    }
+    set_bytes(state, source.size());
+}
+BENCHMARK(BM_ParseBlock)->RangeMultiplier(8)->Range(8, 4096);
+
+//functions in the translation unit, parsed on the thread pool and serially
+static void BM_ParseTranslationUnit(benchmark::State& state) {
+    auto source = generated(static_cast<std::size_t>(state.range(0)), 32, 2);
+    auto pool = state.range(1) ? &ThreadPool::process() : nullptr;
+
+    for (auto _ : state) {
+        std::string_view sv = source;
+        auto tu = TranslationUnit::parse_translation_unit(sv, pool);
+        benchmark::DoNotOptimize(tu.get());
+    }
+    set_bytes(state, source.size());
+}
+BENCHMARK(BM_ParseTranslationUnit)->ArgsProduct({{16, 128, 1024}, {0, 1}})->ArgNames({"functions", "pool"});
+
+//statements and nesting depth of a single function
+static void BM_CompileFunction(benchmark::State& state) {
+    auto source = generated(1, static_cast<std::size_t>(state.range(0)), static_cast<std::size_t>(state.range(1)));
+    auto tu = parse(source);
+    auto block = tu->functions.front()->block;
+
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        InstrBufferx64 buffer;
+        Compiler_x64 compiler(block, &buffer, Compiler_x64::Mode::JIT);
+        compiler.compile_function();
+        bytes = buffer.buffer().size();
+        benchmark::DoNotOptimize(buffer.buffer().data());
+    }
+    state.counters["code_bytes"] = static_cast<double>(bytes);
+}
+BENCHMARK(BM_CompileFunction)->ArgsProduct({{16, 256, 4096}, {1, 3, 6}})->ArgNames({"statements", "depth"});
+
+static void BM_CompileTranslationUnit(benchmark::State& state) {
+    auto source = generated(static_cast<std::size_t>(state.range(0)), 32, 2);
+    auto tu = parse(source);
+
+    for (auto _ : state) {
+        auto object = Object::compile_translation_unit(*tu, Compiler_x64::Mode::JIT);
+        benchmark::DoNotOptimize(object.buff.buffer().data());
+    }
+}
+BENCHMARK(BM_CompileTranslationUnit)->RangeMultiplier(8)->Range(16, 1024)->ArgName("functions");
+
+template<void (*Write)(std::ostream&, const Object&)>
+static void BM_WriteObject(benchmark::State& state) {
+    auto source = generated(static_cast<std::size_t>(state.range(0)), 32, 2);
+    auto object = Object::compile_translation_unit(*parse(source), Compiler_x64::Mode::ObjectFile);
+
+    std::size_t bytes = 0;
+    for (auto _ : state) {
+        std::ostringstream out;
+        Write(out, object);
+        bytes = out.view().size();
+        benchmark::DoNotOptimize(out.view().data());
+    }
+    set_bytes(state, bytes);
+}
+BENCHMARK(BM_WriteObject<elf::write>)->Name("BM_ElfWrite")->RangeMultiplier(8)->Range(16, 1024)->ArgName("functions");
+BENCHMARK(BM_WriteObject<macho::write>)->Name("BM_MachOWrite")->RangeMultiplier(8)->Range(16, 1024)->ArgName("functions");
+
+//speed of the generated code rather than the compiler
+static void BM_RunGenerated(benchmark::State& state) {
+    auto source = generated(64, 32, static_cast<std::size_t>(state.range(0)));
+    auto module = JitModule::finalise(Object::compile_translation_unit(*parse(source), Compiler_x64::Mode::JIT));
+    auto main = module.function<void()>("main");
+
+    SilenceStdout silence;
+    for (auto _ : state) {
+        main();
+    }
+}
+BENCHMARK(BM_RunGenerated)->DenseRange(1, 5, 2)->ArgName("depth");
+
+//the same loop with a divisor only known at runtime, which takes idiv, and
+//with a constant one, which compiles to a multiply by a magic number
+static void BM_Modulo(benchmark::State& state) {
+    constexpr std::int64_t count = 4096;
+    auto divisor = state.range(0);
+    auto operand = state.range(1) ? std::to_string(divisor) : std::string("d");
+    auto source = "fn run(int64 d) {\n"
+        "    int64 i; int64 s;\n"
+        "    i = 0; s = 0;\n"
+        "    while (i < " + std::to_string(count) + ") { s = s + i % " + operand + "; i = i + 1; }\n"
+        "    return s;\n"
+        "}\n";
+    auto module = JitModule::finalise(Object::compile_translation_unit(*parse(source), Compiler_x64::Mode::JIT));
+    auto run = module.function<std::int64_t(std::int64_t)>("run");
+
+    std::int64_t expected = 0;
+    for (std::int64_t i = 0; i < count; i++) {
+        expected += i % divisor;
+    }
+    if (run(divisor) != expected) {
+        state.SkipWithError("wrong result");
+        return;
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(run(divisor));
+    }
+    state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_Modulo)->ArgsProduct({{7, 8}, {0, 1}})->ArgNames({"divisor", "constant"});
+
+static void BM_RunExample(benchmark::State& state, const std::filesystem::path& path) {
+    std::ifstream file(path);
+    std::stringstream ss;
+    ss << file.rdbuf();
+    auto source = ss.str();
+
+    auto module = JitModule::finalise(Object::compile_translation_unit(*parse(source), Compiler_x64::Mode::JIT));
+    auto main = module.function<void()>("main");
+
+    SilenceStdout silence;
+    for (auto _ : state) {
+        main();
+    }
+}
+
+int main(int argc, char** argv) {
+    for (auto& entry : std::filesystem::directory_iterator(LL_EXAMPLE_PROGRAMS_DIR)) {
+        if (entry.path().extension() == ".ll") {
+            auto name = "BM_RunExample/" + entry.path().stem().string();
+            benchmark::RegisterBenchmark(name.c_str(), BM_RunExample, entry.path());
+        }
+    }
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -6,6 +6,7 @@
 #include "MachO.hpp"
 
 #include "InstrBufferx64.hpp"
+#include "Linker.hpp"
 
 #include <cstring>
 
@@ -43,29 +44,38 @@ macho::SymbolTable macho::SymbolData::symbol_table(size_t symbols_offset) const
 macho::DynamicSymbolTable macho::SymbolData::dynamic_symbol_table() const {
     return macho::DynamicSymbolTable{
         .iextdefsym = 0,
-        .nextdefsym = 1, //referencing main
-        .iundefsym = static_cast<uint32_t>(this->_name_to_index.size() - 1),
+        .nextdefsym = this->_defined_count,
+        .iundefsym = this->_defined_count,
+        .nundefsym = static_cast<uint32_t>(this->_name_to_index.size() - this->_defined_count),
     };
 }
 
-macho::SymbolData macho::SymbolData::generate(InstrBufferx64& buff) {
+macho::SymbolData macho::SymbolData::generate(const ll::Object& object) {
+    auto& buff = object.buff;
     SymbolData data;
     std::vector<uint8_t> symbols;
     std::vector<uint8_t> strings;
     strings.push_back(0x00);
 
-    //start with main
-    Symbol main_sym{
-        .nameoffset = static_cast<uint32_t>(strings.size()),
-        .symboltype = 0x0f,
-        .sectionno = 1,
-        .datainfo = 0x0000,
-        .symboladdress = 0x0000
-    };
-    const char* main_name = "_main";
-    bytes_to_vec(strings, main_name, strlen(main_name) + 1);
-    bytes_to_vec(symbols, &main_sym, sizeof(main_sym));
-    data._name_to_index[main_name] = 0;
+    //defined functions first
+    for (auto& function : object.symbols) {
+        if (data._name_to_index.contains(function.name)) {
+            continue;
+        }
+
+        Symbol sym{
+            .nameoffset = static_cast<uint32_t>(strings.size()),
+            .symboltype = 0x0f,
+            .sectionno = 1,
+            .datainfo = 0x0000,
+            .symboladdress = function.offset
+        };
+        data._name_to_index[function.name] = data._name_to_index.size();
+        std::string functionString = "_" + function.name;
+        bytes_to_vec(strings, functionString.c_str(), functionString.size() + 1);
+        bytes_to_vec(symbols, &sym, sizeof(sym));
+    }
+    data._defined_count = data._name_to_index.size();
 
     for (auto ext : buff._externFuncs) {
         if (data._name_to_index.contains(ext.symbol)) {
@@ -94,7 +104,7 @@ macho::SymbolData macho::SymbolData::generate(InstrBufferx64& buff) {
     return data;
 }
 
-macho::CStringData macho::CStringData::generate(InstrBufferx64& buff) {
+macho::CStringData macho::CStringData::generate(const InstrBufferx64& buff) {
     CStringData data;
 
     for (auto& cstr : buff._cstrings) {
@@ -110,7 +120,7 @@ macho::CStringData macho::CStringData::generate(InstrBufferx64& buff) {
 }
 
 macho::RelocationData macho::RelocationData::generate(
-    InstrBufferx64& instrs,
+    const InstrBufferx64& instrs,
     std::vector<uint8_t>& buff,
     const CStringData& cstrings,
     const SymbolData& symbols) {
@@ -159,9 +169,10 @@ macho::RelocationData macho::RelocationData::generate(
     return relocations;
 }
 
-void macho::write(std::ostream& out, InstrBufferx64& buff) {
+void macho::write(std::ostream& out, const ll::Object& object) {
+    auto& buff = object.buff;
     auto cstrings = CStringData::generate(buff);
-    auto symbols = SymbolData::generate(buff);
+    auto symbols = SymbolData::generate(object);
     std::vector<uint8_t> instruction_data = buff.buffer();
     auto relocations = RelocationData::generate(buff, instruction_data, cstrings, symbols);
 
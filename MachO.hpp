@@ -7,13 +7,18 @@
 
 class InstrBufferx64;
 
+namespace ll {
+    struct Object;
+}
+
 #include <cstdint>
 #include <map>
 #include <ostream>
 #include <vector>
 
 namespace macho {
-    void write(std::ostream& out, InstrBufferx64& buff);
+    //relocatable object with an external symbol for each function
+    void write(std::ostream& out, const ll::Object& object);
 
     struct Header {
         uint32_t magic = 0xfeedfacf;
@@ -110,25 +115,26 @@ namespace macho {
         std::vector<uint8_t> _data;
         size_t _string_table_size;
         size_t _string_table_offset;
+        uint32_t _defined_count = 0; //functions come first, then undefined externs
 
         SymbolTable symbol_table(size_t symbols_offset) const;
         DynamicSymbolTable dynamic_symbol_table() const;
 
-        static SymbolData generate(InstrBufferx64& buff);
+        static SymbolData generate(const ll::Object& object);
     };
 
     struct CStringData {
         std::map<std::string, uint32_t> _string_to_offset;
         std::vector<uint8_t> _data;
 
-        static CStringData generate(InstrBufferx64& buff);
+        static CStringData generate(const InstrBufferx64& buff);
     };
 
     struct RelocationData {
         size_t _count;
         std::vector<uint8_t> _data;
 
-        static RelocationData generate(InstrBufferx64& instrs,
+        static RelocationData generate(const InstrBufferx64& instrs,
             std::vector<uint8_t>& buff,
             const CStringData& cstrings,
             const SymbolData& symbols);
@@ -6,6 +6,7 @@
 #include "MachO.hpp"
 
 #include "InstrBufferx64.hpp"
+#include "Linker.hpp"
 
 #include <gtest/gtest.h>
 
@@ -29,8 +30,10 @@ namespace {
 }
 
 TEST(MachOTests, symbol_table_only_main) {
-    InstrBufferx64 buffer;
-    auto symtable = macho::SymbolData::generate(buffer);
+    ll::Object object;
+    object.symbols.push_back({.name = "main", .offset = 0});
+    auto& buffer = object.buff;
+    auto symtable = macho::SymbolData::generate(object);
 
     ASSERT_EQ(symtable._name_to_index.size(), 1);
     ASSERT_FALSE(symtable._data.empty());
@@ -45,13 +48,15 @@ TEST(MachOTests, symbol_table_only_main) {
 }
 
 TEST(MachOTests, symbol_table_main_and_extern) {
-    InstrBufferx64 buffer;
+    ll::Object object;
+    object.symbols.push_back({.name = "main", .offset = 0});
+    auto& buffer = object.buff;
     buffer._externFuncs.push_back(InstrBufferx64::ExternFunction{
         .symbol = "puts",
         .location = 10
     });
 
-    auto symtable = macho::SymbolData::generate(buffer);
+    auto symtable = macho::SymbolData::generate(object);
 
     ASSERT_EQ(symtable._name_to_index.size(), 2);
     ASSERT_FALSE(symtable._data.empty());
@@ -70,7 +75,9 @@ TEST(MachOTests, symbol_table_main_and_extern) {
 }
 
 TEST(MachOTests, symbol_table_main_and_extern_duplicated) {
-    InstrBufferx64 buffer;
+    ll::Object object;
+    object.symbols.push_back({.name = "main", .offset = 0});
+    auto& buffer = object.buff;
     buffer._externFuncs.push_back(InstrBufferx64::ExternFunction{
         .symbol = "puts",
         .location = 10
@@ -84,7 +91,7 @@ TEST(MachOTests, symbol_table_main_and_extern_duplicated) {
         .location = 20
     });
 
-    auto symtable = macho::SymbolData::generate(buffer);
+    auto symtable = macho::SymbolData::generate(object);
 
     ASSERT_EQ(symtable._name_to_index.size(), 2);
     ASSERT_FALSE(symtable._data.empty());
@@ -102,6 +109,34 @@ TEST(MachOTests, symbol_table_main_and_extern_duplicated) {
     EXPECT_TRUE(compare_data_to_cstr(&symtable._data[sizeof(macho::Symbol) * 2 + 7], 5, "_puts"));
 }
 
+TEST(MachOTests, symbol_table_functions_then_externs) {
+    ll::Object object;
+    object.symbols.push_back({.name = "helper", .offset = 0});
+    object.symbols.push_back({.name = "main", .offset = 24});
+    object.buff._externFuncs.push_back({
+        .symbol = "puts",
+        .location = 30
+    });
+
+    auto symtable = macho::SymbolData::generate(object);
+
+    ASSERT_EQ(symtable._name_to_index.size(), 3);
+    EXPECT_EQ(symtable._defined_count, 2);
+    EXPECT_EQ(symtable._name_to_index["puts"], 2);
+
+    EXPECT_EQ(symtable._data[4], 0x0f); //_helper symbol type
+    EXPECT_TRUE(compare_data_to<uint64_t>(&symtable._data[8], 0)); //_helper address
+    EXPECT_EQ(symtable._data[sizeof(macho::Symbol) + 4], 0x0f); //_main symbol type
+    EXPECT_TRUE(compare_data_to<uint64_t>(&symtable._data[sizeof(macho::Symbol) + 8], 24)); //_main address
+    EXPECT_EQ(symtable._data[sizeof(macho::Symbol) * 2 + 5], 0); //_puts section number, undefined
+    EXPECT_TRUE(compare_data_to_cstr(&symtable._data[sizeof(macho::Symbol) * 3 + 1], 8, "_helper"));
+
+    auto dsymtab = symtable.dynamic_symbol_table();
+    EXPECT_EQ(dsymtab.nextdefsym, 2);
+    EXPECT_EQ(dsymtab.iundefsym, 2);
+    EXPECT_EQ(dsymtab.nundefsym, 1);
+}
+
 TEST(MachOTests, cstrings_empty) {
     InstrBufferx64 buffer;
     auto cstrings = macho::CStringData::generate(buffer);
@@ -203,12 +238,14 @@ TEST(MachOTests, relocations_cstring_three) {
 
 
 TEST(MachOTests, relocations_externs_one) {
-    InstrBufferx64 buffer;
+    ll::Object object;
+    object.symbols.push_back({.name = "main", .offset = 0});
+    auto& buffer = object.buff;
     buffer._externFuncs.push_back({
         .symbol = "puts",
         .location = 0
     });
-    auto symbols = macho::SymbolData::generate(buffer);
+    auto symbols = macho::SymbolData::generate(object);
 
     std::vector<uint8_t> bufferCopy = buffer.buffer();
     auto relocs = macho::RelocationData::generate(buffer, bufferCopy, macho::CStringData(), symbols);
@@ -219,7 +256,9 @@ TEST(MachOTests, relocations_externs_one) {
 }
 
 TEST(MachOTests, relocations_externs_three) {
-    InstrBufferx64 buffer;
+    ll::Object object;
+    object.symbols.push_back({.name = "main", .offset = 0});
+    auto& buffer = object.buff;
     buffer._externFuncs.push_back({
         .symbol = "puts",
         .location = 0
@@ -232,7 +271,7 @@ TEST(MachOTests, relocations_externs_three) {
         .symbol = "itoa",
         .location = 20
     });
-    auto symbols = macho::SymbolData::generate(buffer);
+    auto symbols = macho::SymbolData::generate(object);
 
     std::vector<uint8_t> bufferCopy = buffer.buffer();
     auto relocs = macho::RelocationData::generate(buffer, bufferCopy, macho::CStringData(), symbols);
@@ -250,7 +289,9 @@ TEST(MachOTests, relocations_externs_three) {
 }
 
 TEST(MachOTests, relocations_combined_one_each) {
-    InstrBufferx64 buffer;
+    ll::Object object;
+    object.symbols.push_back({.name = "main", .offset = 0});
+    auto& buffer = object.buff;
     buffer.add_cstring("test", 2);
     buffer.mov_r64_imm64(InstrBufferx64::Register::RAX, 0); // on heap
     buffer._externFuncs.push_back({
@@ -258,7 +299,7 @@ TEST(MachOTests, relocations_combined_one_each) {
         .location = 10
     });
     auto cstrings = macho::CStringData::generate(buffer);
-    auto symbols = macho::SymbolData::generate(buffer);
+    auto symbols = macho::SymbolData::generate(object);
 
     std::vector<uint8_t> bufferCopy = buffer.buffer();
     auto relocs = macho::RelocationData::generate(buffer, bufferCopy, cstrings, symbols);
@@ -11,9 +11,10 @@
 #include <gtest/gtest.h>
 
 TEST(ParserBlock, parse_many) {
+    ll::Arena arena;
     std::string_view view(R"(int64 test;test = 123;)");
 
-    Parser parser;
+    Parser parser(arena);
     parser.parse_block(view);
 
     auto& block = *parser.block;
@@ -24,21 +25,22 @@ TEST(ParserBlock, parse_many) {
 
     EXPECT_EQ(block.statements.size(), 1);
 
-    auto assign = dynamic_cast<VariableAssignment*>(block.statements.front().get());
+    auto assign = node_cast<VariableAssignment>(block.statements.front());
     ASSERT_NE(assign, nullptr);
 
     EXPECT_EQ(assign->to.content, "test");
 
-    auto value = dynamic_cast<Int64Param*>(assign->value.get());
+    auto value = node_cast<Int64Param>(assign->value);
     ASSERT_NE(value, nullptr);
     EXPECT_EQ(value->content, 123);
 }
 
 TEST(ParserBlock, parse_many2) {
+    ll::Arena arena;
     std::string eg = R"(int64 test;int64 another;test = 123;another = 1111;)";
     std::string_view view(eg);
 
-    Parser parser;
+    Parser parser(arena);
     parser.parse_block(view);
 
     auto& block = *parser.block;
@@ -51,26 +53,27 @@ TEST(ParserBlock, parse_many2) {
 
     EXPECT_EQ(block.statements.size(), 2);
 
-    auto assign1 = dynamic_cast<VariableAssignment*>(block.statements[0].get());
+    auto assign1 = node_cast<VariableAssignment>(block.statements[0]);
     ASSERT_NE(assign1, nullptr);
     EXPECT_EQ(assign1->to.content, "test");
-    auto value1 = dynamic_cast<Int64Param*>(assign1->value.get());
+    auto value1 = node_cast<Int64Param>(assign1->value);
     ASSERT_NE(value1, nullptr);
     EXPECT_EQ(value1->content, 123);
 
-    auto assign2 = dynamic_cast<VariableAssignment*>(block.statements[1].get());
+    auto assign2 = node_cast<VariableAssignment>(block.statements[1]);
     ASSERT_NE(assign2, nullptr);
     EXPECT_EQ(assign2->to.content, "another");
-    auto value2 = dynamic_cast<Int64Param*>(assign1->value.get());
+    auto value2 = node_cast<Int64Param>(assign1->value);
     ASSERT_NE(value2, nullptr);
     EXPECT_EQ(value2->content, 123);
 }
 
 TEST(ParserBlock, parse_many3) {
+    ll::Arena arena;
     std::string eg = R"(int64 test;test = 123;int64 another;another = 1111;)";
     std::string_view view(eg);
 
-    Parser parser;
+    Parser parser(arena);
     auto& block = *parser.block;
     parser.parse_block(view);
 
@@ -82,26 +85,27 @@ TEST(ParserBlock, parse_many3) {
 
     EXPECT_EQ(block.statements.size(), 2);
 
-    auto assign1 = dynamic_cast<VariableAssignment*>(block.statements[0].get());
+    auto assign1 = node_cast<VariableAssignment>(block.statements[0]);
     ASSERT_NE(assign1, nullptr);
     EXPECT_EQ(assign1->to.content, "test");
-    auto value1 = dynamic_cast<Int64Param*>(assign1->value.get());
+    auto value1 = node_cast<Int64Param>(assign1->value);
     ASSERT_NE(value1, nullptr);
     EXPECT_EQ(value1->content, 123);
 
-    auto assign2 = dynamic_cast<VariableAssignment*>(block.statements[1].get());
+    auto assign2 = node_cast<VariableAssignment>(block.statements[1]);
     ASSERT_NE(assign2, nullptr);
     EXPECT_EQ(assign2->to.content, "another");
-    auto value2 = dynamic_cast<Int64Param*>(assign2->value.get());
+    auto value2 = node_cast<Int64Param>(assign2->value);
     ASSERT_NE(value2, nullptr);
     EXPECT_EQ(value2->content, 1111);
 }
 
 TEST(ParserBlock, parse_many4) {
+    ll::Arena arena;
     std::string eg = R"(int64 test;puts("test");int64 another;)";
     std::string_view view(eg);
 
-    Parser parser;
+    Parser parser(arena);
     parser.parse_block(view);
 
     auto& block = *parser.block;
@@ -114,19 +118,20 @@ TEST(ParserBlock, parse_many4) {
 
     EXPECT_EQ(block.statements.size(), 1);
 
-    auto assign1 = dynamic_cast<FunctionCall*>(block.statements[0].get());
+    auto assign1 = node_cast<FunctionCall>(block.statements[0]);
     ASSERT_NE(assign1, nullptr);
     EXPECT_EQ(assign1->functionName, "puts");
     EXPECT_EQ(assign1->params.size(), 1);
 }
 
 TEST(ParserBlock, parse_whitespace1) {
+    ll::Arena arena;
     std::string eg =
         R"(int64 test;
         test = 123;)";
     std::string_view view(eg);
 
-    Parser parser;
+    Parser parser(arena);
     parser.parse_block(view);
 
     auto& block = *parser.block;
@@ -137,15 +142,16 @@ TEST(ParserBlock, parse_whitespace1) {
 
     EXPECT_EQ(block.statements.size(), 1);
 
-    auto assign = dynamic_cast<VariableAssignment*>(block.statements.front().get());
+    auto assign = node_cast<VariableAssignment>(block.statements.front());
     ASSERT_NE(assign, nullptr);
     EXPECT_EQ(assign->to.content, "test");
-    auto value = dynamic_cast<Int64Param*>(assign->value.get());
+    auto value = node_cast<Int64Param>(assign->value);
     ASSERT_NE(value, nullptr);
     EXPECT_EQ(value->content, 123);
 }
 
 TEST(ParserBlock, parse_whitespace2) {
+    ll::Arena arena;
     std::string eg = R"(
     int64 test;
     test = 123;
@@ -153,7 +159,7 @@ TEST(ParserBlock, parse_whitespace2) {
     another = 1111;)";
     std::string_view view(eg);
 
-    Parser parser;
+    Parser parser(arena);
     parser.parse_block(view);
 
     auto& block = *parser.block;
@@ -166,22 +172,23 @@ TEST(ParserBlock, parse_whitespace2) {
 
     EXPECT_EQ(block.statements.size(), 2);
 
-    auto assign1 = dynamic_cast<VariableAssignment*>(block.statements[0].get());
+    auto assign1 = node_cast<VariableAssignment>(block.statements[0]);
     ASSERT_NE(assign1, nullptr);
     EXPECT_EQ(assign1->to.content, "test");
-    auto value1 = dynamic_cast<Int64Param*>(assign1->value.get());
+    auto value1 = node_cast<Int64Param>(assign1->value);
     ASSERT_NE(value1, nullptr);
     EXPECT_EQ(value1->content, 123);
 
-    auto assign2 = dynamic_cast<VariableAssignment*>(block.statements[1].get());
+    auto assign2 = node_cast<VariableAssignment>(block.statements[1]);
     ASSERT_NE(assign2, nullptr);
     EXPECT_EQ(assign2->to.content, "another");
-    auto value2 = dynamic_cast<Int64Param*>(assign2->value.get());
+    auto value2 = node_cast<Int64Param>(assign2->value);
     ASSERT_NE(value2, nullptr);
     EXPECT_EQ(value2->content, 1111);
 }
 
 TEST(ParserBlock, parse_if_block) {
+    ll::Arena arena;
     std::string eg = R"(
     int64 test;
     test = 123;
@@ -191,7 +198,7 @@ TEST(ParserBlock, parse_if_block) {
     )";
     std::string_view view(eg);
 
-    Parser parser;
+    Parser parser(arena);
     parser.parse_block(view);
 
     auto& block = *parser.block;
@@ -202,36 +209,37 @@ TEST(ParserBlock, parse_if_block) {
 
     EXPECT_EQ(block.statements.size(), 2);
 
-    auto assign1 = dynamic_cast<VariableAssignment*>(block.statements[0].get());
+    auto assign1 = node_cast<VariableAssignment>(block.statements[0]);
     ASSERT_NE(assign1, nullptr);
     EXPECT_EQ(assign1->to.content, "test");
-    auto value1 = dynamic_cast<Int64Param*>(assign1->value.get());
+    auto value1 = node_cast<Int64Param>(assign1->value);
     ASSERT_NE(value1, nullptr);
     EXPECT_EQ(value1->content, 123);
 
-    auto ifchain = dynamic_cast<IfChainStatement*>(block.statements[1].get());
+    auto ifchain = node_cast<IfChainStatement>(block.statements[1]);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 1);
 
-    auto ifstatement = ifchain->_ifstatements.front().get();
+    auto ifstatement = ifchain->_ifstatements.front();
 
-    auto lhs = dynamic_cast<StackVariableParam*>(ifstatement->lhs.get());
+    auto lhs = node_cast<StackVariableParam>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, "test");
-    auto rhs = dynamic_cast<Int64Param*>(ifstatement->rhs.get());
+    auto rhs = node_cast<Int64Param>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 123);
 
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_EQ(ifstatement->block->statements.size(), 1);
-    EXPECT_EQ(ifstatement->block->parent, parser.block.get());
+    EXPECT_EQ(ifstatement->block->parent, parser.block);
 
-    auto statement = dynamic_cast<FunctionCall*>(ifstatement->block->statements.front().get());
+    auto statement = node_cast<FunctionCall>(ifstatement->block->statements.front());
     ASSERT_NE(statement, nullptr);
 }
 
 TEST(ParserBlock, parse_if_block_two_statements) {
+    ll::Arena arena;
     std::string eg = R"(
     int64 test;
     test = 123;
@@ -242,7 +250,7 @@ TEST(ParserBlock, parse_if_block_two_statements) {
     )";
     std::string_view view(eg);
 
-    Parser parser;
+    Parser parser(arena);
     parser.parse_block(view);
 
     auto& block = *parser.block;
@@ -253,39 +261,40 @@ TEST(ParserBlock, parse_if_block_two_statements) {
 
     EXPECT_EQ(block.statements.size(), 2);
 
-    auto assign1 = dynamic_cast<VariableAssignment*>(block.statements[0].get());
+    auto assign1 = node_cast<VariableAssignment>(block.statements[0]);
     ASSERT_NE(assign1, nullptr);
     EXPECT_EQ(assign1->to.content, "test");
-    auto value1 = dynamic_cast<Int64Param*>(assign1->value.get());
+    auto value1 = node_cast<Int64Param>(assign1->value);
     ASSERT_NE(value1, nullptr);
     EXPECT_EQ(value1->content, 123);
 
-    auto ifchain = dynamic_cast<IfChainStatement*>(block.statements[1].get());
+    auto ifchain = node_cast<IfChainStatement>(block.statements[1]);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 1);
 
-    auto ifstatement = ifchain->_ifstatements.front().get();
+    auto ifstatement = ifchain->_ifstatements.front();
 
-    auto lhs = dynamic_cast<StackVariableParam*>(ifstatement->lhs.get());
+    auto lhs = node_cast<StackVariableParam>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, "test");
-    auto rhs = dynamic_cast<Int64Param*>(ifstatement->rhs.get());
+    auto rhs = node_cast<Int64Param>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 123);
 
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_EQ(ifstatement->block->statements.size(), 2);
-    EXPECT_EQ(ifstatement->block->parent, parser.block.get());
+    EXPECT_EQ(ifstatement->block->parent, parser.block);
 
-    auto statement1 = dynamic_cast<VariableAssignment*>(ifstatement->block->statements[0].get());
+    auto statement1 = node_cast<VariableAssignment>(ifstatement->block->statements[0]);
     ASSERT_NE(statement1, nullptr);
 
-    auto statement2 = dynamic_cast<FunctionCall*>(ifstatement->block->statements[1].get());
+    auto statement2 = node_cast<FunctionCall>(ifstatement->block->statements[1]);
     ASSERT_NE(statement2, nullptr);
 }
 
 TEST(ParserBlock, parse_multiple_if_blocks) {
+    ll::Arena arena;
     std::string eg = R"(
     int64 test;
     test = 123;
@@ -298,7 +307,7 @@ TEST(ParserBlock, parse_multiple_if_blocks) {
     )";
     std::string_view view(eg);
 
-    Parser parser;
+    Parser parser(arena);
     parser.parse_block(view);
 
     auto& block = *parser.block;
@@ -309,57 +318,58 @@ TEST(ParserBlock, parse_multiple_if_blocks) {
 
     EXPECT_EQ(block.statements.size(), 3);
 
-    auto assign1 = dynamic_cast<VariableAssignment*>(block.statements[0].get());
+    auto assign1 = node_cast<VariableAssignment>(block.statements[0]);
     ASSERT_NE(assign1, nullptr);
     EXPECT_EQ(assign1->to.content, "test");
-    auto value1 = dynamic_cast<Int64Param*>(assign1->value.get());
+    auto value1 = node_cast<Int64Param>(assign1->value);
     ASSERT_NE(value1, nullptr);
     EXPECT_EQ(value1->content, 123);
 
-    auto ifchain = dynamic_cast<IfChainStatement*>(block.statements[1].get());
+    auto ifchain = node_cast<IfChainStatement>(block.statements[1]);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 1);
 
-    auto ifstatement = ifchain->_ifstatements.front().get();
+    auto ifstatement = ifchain->_ifstatements.front();
 
-    auto lhs = dynamic_cast<StackVariableParam*>(ifstatement->lhs.get());
+    auto lhs = node_cast<StackVariableParam>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, "test");
-    auto rhs = dynamic_cast<Int64Param*>(ifstatement->rhs.get());
+    auto rhs = node_cast<Int64Param>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 123);
 
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_EQ(ifstatement->block->statements.size(), 1);
-    EXPECT_EQ(ifstatement->block->parent, parser.block.get());
+    EXPECT_EQ(ifstatement->block->parent, parser.block);
 
-    auto statement = dynamic_cast<FunctionCall*>(ifstatement->block->statements.front().get());
+    auto statement = node_cast<FunctionCall>(ifstatement->block->statements.front());
     ASSERT_NE(statement, nullptr);
 
-    auto ifchain2 = dynamic_cast<IfChainStatement*>(block.statements[2].get());
+    auto ifchain2 = node_cast<IfChainStatement>(block.statements[2]);
     ASSERT_NE(ifchain2, nullptr);
     ASSERT_FALSE(ifchain2->_ifstatements.empty());
     EXPECT_EQ(ifchain2->_ifstatements.size(), 1);
 
-    auto ifstatement2 = ifchain2->_ifstatements.front().get();
+    auto ifstatement2 = ifchain2->_ifstatements.front();
 
-    auto lhs2 = dynamic_cast<StackVariableParam*>(ifstatement2->lhs.get());
+    auto lhs2 = node_cast<StackVariableParam>(ifstatement2->lhs);
     ASSERT_NE(lhs2, nullptr);
     EXPECT_EQ(lhs2->content, "test");
-    auto rhs2 = dynamic_cast<Int64Param*>(ifstatement2->rhs.get());
+    auto rhs2 = node_cast<Int64Param>(ifstatement2->rhs);
     ASSERT_NE(rhs2, nullptr);
     EXPECT_EQ(rhs2->content, 444);
 
     EXPECT_TRUE(ifstatement2->block->vars.empty());
     EXPECT_EQ(ifstatement2->block->statements.size(), 1);
-    EXPECT_EQ(ifstatement2->block->parent, parser.block.get());
+    EXPECT_EQ(ifstatement2->block->parent, parser.block);
 
-    auto statement2 = dynamic_cast<FunctionCall*>(ifstatement2->block->statements.front().get());
+    auto statement2 = node_cast<FunctionCall>(ifstatement2->block->statements.front());
     ASSERT_NE(statement2, nullptr);
 }
 
 TEST(ParserBlock, parse_nested_if_blocks) {
+    ll::Arena arena;
     std::string eg = R"(
     int64 test;
     test = 123;
@@ -372,7 +382,7 @@ TEST(ParserBlock, parse_nested_if_blocks) {
     )";
     std::string_view view(eg);
 
-    Parser parser;
+    Parser parser(arena);
     parser.parse_block(view);
 
     auto& block = *parser.block;
@@ -383,57 +393,58 @@ TEST(ParserBlock, parse_nested_if_blocks) {
 
     EXPECT_EQ(block.statements.size(), 2);
 
-    auto assign1 = dynamic_cast<VariableAssignment*>(block.statements[0].get());
+    auto assign1 = node_cast<VariableAssignment>(block.statements[0]);
     ASSERT_NE(assign1, nullptr);
     EXPECT_EQ(assign1->to.content, "test");
-    auto value1 = dynamic_cast<Int64Param*>(assign1->value.get());
+    auto value1 = node_cast<Int64Param>(assign1->value);
     ASSERT_NE(value1, nullptr);
     EXPECT_EQ(value1->content, 123);
 
-    auto ifchain = dynamic_cast<IfChainStatement*>(block.statements[1].get());
+    auto ifchain = node_cast<IfChainStatement>(block.statements[1]);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 1);
 
-    auto ifstatement = ifchain->_ifstatements.front().get();
+    auto ifstatement = ifchain->_ifstatements.front();
 
-    auto lhs = dynamic_cast<StackVariableParam*>(ifstatement->lhs.get());
+    auto lhs = node_cast<StackVariableParam>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, "test");
-    auto rhs = dynamic_cast<Int64Param*>(ifstatement->rhs.get());
+    auto rhs = node_cast<Int64Param>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 123);
 
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_EQ(ifstatement->block->statements.size(), 2);
-    EXPECT_EQ(ifstatement->block->parent, parser.block.get());
+    EXPECT_EQ(ifstatement->block->parent, parser.block);
 
-    auto statement = dynamic_cast<FunctionCall*>(ifstatement->block->statements.front().get());
+    auto statement = node_cast<FunctionCall>(ifstatement->block->statements.front());
     ASSERT_NE(statement, nullptr);
 
-    auto ifchain2 = dynamic_cast<IfChainStatement*>(ifstatement->block->statements[1].get());
+    auto ifchain2 = node_cast<IfChainStatement>(ifstatement->block->statements[1]);
     ASSERT_NE(ifchain2, nullptr);
     ASSERT_FALSE(ifchain2->_ifstatements.empty());
     EXPECT_EQ(ifchain2->_ifstatements.size(), 1);
 
-    auto ifstatement2 = ifchain2->_ifstatements.front().get();
+    auto ifstatement2 = ifchain2->_ifstatements.front();
 
-    auto lhs2 = dynamic_cast<StackVariableParam*>(ifstatement2->lhs.get());
+    auto lhs2 = node_cast<StackVariableParam>(ifstatement2->lhs);
     ASSERT_NE(lhs2, nullptr);
     EXPECT_EQ(lhs2->content, "test");
-    auto rhs2 = dynamic_cast<Int64Param*>(ifstatement2->rhs.get());
+    auto rhs2 = node_cast<Int64Param>(ifstatement2->rhs);
     ASSERT_NE(rhs2, nullptr);
     EXPECT_EQ(rhs2->content, 444);
 
     EXPECT_TRUE(ifstatement2->block->vars.empty());
     EXPECT_EQ(ifstatement2->block->statements.size(), 1);
-    EXPECT_EQ(ifstatement2->block->parent, ifstatement->block.get());
+    EXPECT_EQ(ifstatement2->block->parent, ifstatement->block);
 
-    auto statement2 = dynamic_cast<FunctionCall*>(ifstatement2->block->statements.front().get());
+    auto statement2 = node_cast<FunctionCall>(ifstatement2->block->statements.front());
     ASSERT_NE(statement2, nullptr);
 }
 
 TEST(ParserBlock, parse_nested_if_while_blocks) {
+    ll::Arena arena;
     std::string eg = R"(
     int64 test;
     test = 1;
@@ -446,7 +457,7 @@ TEST(ParserBlock, parse_nested_if_while_blocks) {
     )";
     std::string_view view(eg);
 
-    Parser parser;
+    Parser parser(arena);
     parser.parse_block(view);
 
     auto& block = *parser.block;
@@ -457,56 +468,57 @@ TEST(ParserBlock, parse_nested_if_while_blocks) {
 
     EXPECT_EQ(block.statements.size(), 2);
 
-    auto assign1 = dynamic_cast<VariableAssignment*>(block.statements[0].get());
+    auto assign1 = node_cast<VariableAssignment>(block.statements[0]);
     ASSERT_NE(assign1, nullptr);
     EXPECT_EQ(assign1->to.content, "test");
-    auto value1 = dynamic_cast<Int64Param*>(assign1->value.get());
+    auto value1 = node_cast<Int64Param>(assign1->value);
     ASSERT_NE(value1, nullptr);
     EXPECT_EQ(value1->content, 1);
 
-    auto ifchain = dynamic_cast<IfChainStatement*>(block.statements[1].get());
+    auto ifchain = node_cast<IfChainStatement>(block.statements[1]);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 1);
 
-    auto ifstatement = ifchain->_ifstatements.front().get();
+    auto ifstatement = ifchain->_ifstatements.front();
     EXPECT_EQ(ifstatement->comparator, IfStatement::Equal);
-    auto lhs = dynamic_cast<StackVariableParam*>(ifstatement->lhs.get());
+    auto lhs = node_cast<StackVariableParam>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, "test");
-    auto rhs = dynamic_cast<Int64Param*>(ifstatement->rhs.get());
+    auto rhs = node_cast<Int64Param>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 1);
 
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_EQ(ifstatement->block->statements.size(), 1);
-    EXPECT_EQ(ifstatement->block->parent, parser.block.get());
+    EXPECT_EQ(ifstatement->block->parent, parser.block);
 
-    auto loop = dynamic_cast<LoopStatement*>(ifstatement->block->statements[0].get());
+    auto loop = node_cast<LoopStatement>(ifstatement->block->statements[0]);
     ASSERT_NE(loop, nullptr);
     ASSERT_NE(loop->_ifStatement, nullptr);
 
-    auto ifstatement2 = loop->_ifStatement.get();
+    auto ifstatement2 = loop->_ifStatement;
     EXPECT_EQ(ifstatement2->comparator, IfStatement::LessThan);
-    auto lhs2 = dynamic_cast<StackVariableParam*>(ifstatement2->lhs.get());
+    auto lhs2 = node_cast<StackVariableParam>(ifstatement2->lhs);
     ASSERT_NE(lhs2, nullptr);
     EXPECT_EQ(lhs2->content, "test");
-    auto rhs2 = dynamic_cast<Int64Param*>(ifstatement2->rhs.get());
+    auto rhs2 = node_cast<Int64Param>(ifstatement2->rhs);
     ASSERT_NE(rhs2, nullptr);
     EXPECT_EQ(rhs2->content, 5);
 
     EXPECT_TRUE(ifstatement2->block->vars.empty());
     EXPECT_EQ(ifstatement2->block->statements.size(), 2);
-    EXPECT_EQ(ifstatement2->block->parent, ifstatement->block.get());
+    EXPECT_EQ(ifstatement2->block->parent, ifstatement->block);
 
-    auto statement1 = dynamic_cast<FunctionCall*>(ifstatement2->block->statements[0].get());
+    auto statement1 = node_cast<FunctionCall>(ifstatement2->block->statements[0]);
     ASSERT_NE(statement1, nullptr);
 
-    auto statement2 = dynamic_cast<VariableAssignment*>(ifstatement2->block->statements[1].get());
+    auto statement2 = node_cast<VariableAssignment>(ifstatement2->block->statements[1]);
     ASSERT_NE(statement2, nullptr);
 }
 
 TEST(ParserBlock, parse_nested_while_if_blocks) {
+    ll::Arena arena;
     std::string eg = R"(
     int64 test;
     test = 1;
@@ -519,7 +531,7 @@ TEST(ParserBlock, parse_nested_while_if_blocks) {
     )";
     std::string_view view(eg);
 
-    Parser parser;
+    Parser parser(arena);
     parser.parse_block(view);
 
     auto& block = *parser.block;
@@ -530,23 +542,23 @@ TEST(ParserBlock, parse_nested_while_if_blocks) {
 
     EXPECT_EQ(block.statements.size(), 2);
 
-    auto assign1 = dynamic_cast<VariableAssignment*>(block.statements[0].get());
+    auto assign1 = node_cast<VariableAssignment>(block.statements[0]);
     ASSERT_NE(assign1, nullptr);
     EXPECT_EQ(assign1->to.content, "test");
-    auto value1 = dynamic_cast<Int64Param*>(assign1->value.get());
+    auto value1 = node_cast<Int64Param>(assign1->value);
     ASSERT_NE(value1, nullptr);
     EXPECT_EQ(value1->content, 1);
 
-    auto loop = dynamic_cast<LoopStatement*>(block.statements[1].get());
+    auto loop = node_cast<LoopStatement>(block.statements[1]);
     ASSERT_NE(loop, nullptr);
     ASSERT_NE(loop->_ifStatement, nullptr);
 
-    auto ifstatement = loop->_ifStatement.get();
+    auto ifstatement = loop->_ifStatement;
     EXPECT_EQ(ifstatement->comparator, IfStatement::LessThan);
-    auto lhs2 = dynamic_cast<StackVariableParam*>(ifstatement->lhs.get());
+    auto lhs2 = node_cast<StackVariableParam>(ifstatement->lhs);
     ASSERT_NE(lhs2, nullptr);
     EXPECT_EQ(lhs2->content, "test");
-    auto rhs2 = dynamic_cast<Int64Param*>(ifstatement->rhs.get());
+    auto rhs2 = node_cast<Int64Param>(ifstatement->rhs);
     ASSERT_NE(rhs2, nullptr);
     EXPECT_EQ(rhs2->content, 5);
 
@@ -554,24 +566,24 @@ TEST(ParserBlock, parse_nested_while_if_blocks) {
     EXPECT_EQ(ifstatement->block->statements.size(), 2);
     EXPECT_EQ(ifstatement->block->parent, &block);
 
-    auto ifchain = dynamic_cast<IfChainStatement*>(ifstatement->block->statements[0].get());
+    auto ifchain = node_cast<IfChainStatement>(ifstatement->block->statements[0]);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 1);
 
-    auto ifstatement2 = ifchain->_ifstatements.front().get();
+    auto ifstatement2 = ifchain->_ifstatements.front();
     EXPECT_EQ(ifstatement2->comparator, IfStatement::Equal);
-    auto lhs = dynamic_cast<StackVariableParam*>(ifstatement2->lhs.get());
+    auto lhs = node_cast<StackVariableParam>(ifstatement2->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, "test");
-    auto rhs = dynamic_cast<Int64Param*>(ifstatement2->rhs.get());
+    auto rhs = node_cast<Int64Param>(ifstatement2->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 4);
 
     EXPECT_TRUE(ifstatement2->block->vars.empty());
     EXPECT_EQ(ifstatement2->block->statements.size(), 1);
-    EXPECT_EQ(ifstatement2->block->parent, ifstatement->block.get());
+    EXPECT_EQ(ifstatement2->block->parent, ifstatement->block);
 
-    auto statement2 = dynamic_cast<VariableAssignment*>(ifstatement->block->statements[1].get());
+    auto statement2 = node_cast<VariableAssignment>(ifstatement->block->statements[1]);
     ASSERT_NE(statement2, nullptr);
 }
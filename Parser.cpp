@@ -1,4 +1,3 @@
-
 //------------------------------------------------------------------------------
 // Parser.cpp
 //------------------------------------------------------------------------------
@@ -6,301 +5,507 @@
 
 #include "Parser.hpp"
 
-#include "ParserUtils.hpp"
-
 #include <algorithm>
-#include <array>
+#include <charconv>
+
+using lexer::Token;
+
+Parser::Parser(ll::Arena& arena)
+: block(arena.make<Block>())
+, _arena(arena)
+{
+}
 
-Parser::Parser()
-: block(std::make_unique<Block>())
+Parser::Parser(ll::Arena& arena, std::span<const lexer::Token> tokens, std::uint32_t base)
+: block(arena.make<Block>())
+, _arena(arena)
+, _tokens(tokens)
+, _base(base)
 {
 }
 
+void Parser::lex(std::string_view input) {
+    _ownedTokens = lexer::tokenise(input);
+    _tokens = _ownedTokens;
+    _pos = 0;
+}
+
+void Parser::consume_lexed(std::string_view& input) const {
+    input.remove_prefix(offset());
+}
+
+bool Parser::at_end() const {
+    return peek().is(Token::End);
+}
+
+bool Parser::at_keyword(std::string_view keyword) const {
+    return peek().is(Token::Identifier, keyword);
+}
+
+size_t Parser::offset() const {
+    return peek().offset;
+}
+
+const lexer::Token& Parser::peek(size_t ahead) const {
+    auto index = std::min(_pos + ahead, _tokens.size() - 1);
+    return _tokens[index];
+}
+
+const lexer::Token& Parser::next() {
+    auto& token = peek();
+    if (!token.is(Token::End)) {
+        _pos++;
+    }
+    return token;
+}
+
+const lexer::Token& Parser::expect(lexer::Token::Kind kind, const char* error) {
+    if (!peek().is(kind)) {
+        throw std::runtime_error(error);
+    }
+    return next();
+}
+
+ll::SourceSpan Parser::span_from(size_t start) const {
+    size_t end = start;
+    if (_pos > 0) {
+        auto& last = _tokens[_pos - 1];
+        //strings exclude their quotes
+        end = last.offset + last.text.size() + (last.is(Token::String) ? 2 : 0);
+    }
+    return {
+        .offset = static_cast<std::uint32_t>(_base + start),
+        .length = static_cast<std::uint32_t>(std::max(end, start) - start)
+    };
+}
+
 void Parser::parse_block(std::string_view input) {
-    while (!input.empty()) {
-        auto step = input.find_first_of("(=;");
-        if (step == std::string_view::npos) {
-            break;
-        } else if (input[step] == '(') {
-            auto token = input.substr(0, step);
-            trim_sides(token);
-            if (token == "if") {
-                //if statement
-                auto ifchain = parse_if_chain(input);
-                block->statements.push_back(std::move(ifchain));
-            } else if (token == "while") {
-                auto whileStatement = parse_loop(input);
-                block->statements.push_back(std::move(whileStatement));
+    lex(input);
+    read_statements(*block);
+
+    if (!at_end()) {
+        throw std::runtime_error("unknown section");
+    }
+}
+
+FunctionCallPtr Parser::parse_function_call(std::string_view& input) {
+    lex(input);
+    auto call = read_function_call();
+    consume_lexed(input);
+    return call;
+}
+
+VariableDefinition Parser::parse_variable_definition(std::string_view& input) {
+    lex(input);
+    auto def = read_variable_definition();
+    consume_lexed(input);
+    return def;
+}
+
+VariableAssignmentPtr Parser::parse_variable_assignment(std::string_view& input) {
+    lex(input);
+    auto assign = read_variable_assignment();
+    consume_lexed(input);
+    return assign;
+}
+
+ParamPtr Parser::parse_parameter(std::string_view input) {
+    lex(input);
+    if (at_end()) {
+        return nullptr;
+    }
+
+    auto param = read_parameter();
+    if (!at_end()) {
+        throw std::runtime_error("unexpected whitespace");
+    }
+    return param;
+}
+
+IfChainStatementPtr Parser::parse_if_chain(std::string_view& input) {
+    lex(input);
+    auto ifchain = read_if_chain(block);
+    consume_lexed(input);
+    return ifchain;
+}
+
+LoopStatementPtr Parser::parse_loop(std::string_view& input) {
+    lex(input);
+    auto loop = read_loop(block);
+    consume_lexed(input);
+    return loop;
+}
+
+std::expected<IfStatementPtr, std::string> Parser::parse_comparator(std::string_view& input) {
+    lex(input);
+    auto ifStatement = read_comparator();
+    consume_lexed(input);
+    return ifStatement;
+}
+
+void Parser::read_statements(Block& into) {
+    while (!peek().is(Token::CloseBrace) && !at_end()) {
+        auto& token = peek();
+        if (!token.is(Token::Identifier)) {
+            throw std::runtime_error("unknown section");
+        }
+
+        if (token.text == "return") {
+            into.statements.push_back(read_return());
+            continue;
+        }
+
+        auto& following = peek(1);
+        if (following.is(Token::OpenParen)) {
+            if (token.text == "if") {
+                into.statements.push_back(read_if_chain(&into));
+            } else if (token.text == "while") {
+                into.statements.push_back(read_loop(&into));
             } else {
-                //function call
-                auto call = parse_function_call(input);
-                block->statements.push_back(std::move(call));
+                into.statements.push_back(read_function_call());
             }
-        } else if (input[step] == '=') {
-            //assignment
-            auto assignment = parse_variable_assignment(input);
-            block->statements.push_back(std::move(assignment));
-        } else if (input[step] == ';') {
-            //variable definition
-            auto def = parse_variable_definition(input);
-            block->vars.push_back(def);
+        } else if (following.is(Token::Assign)) {
+            into.statements.push_back(read_variable_assignment());
+        } else if (following.is(Token::Identifier)) {
+            into.vars.push_back(read_variable_definition());
         } else {
             throw std::runtime_error("unknown section");
         }
     }
 }
 
-FunctionCallPtr Parser::parse_function_call(std::string_view& input) {
-    auto call = std::make_unique<FunctionCall>();
+Block* Parser::read_nested_block(Block* parent) {
+    expect(Token::OpenBrace, "couldn't find block delimiters");
 
-    auto nameEnd = input.find_first_of("(");
-    if (nameEnd == std::string_view::npos) {
-        throw std::runtime_error("Not a function call.");
-    }
+    auto nested = _arena.make<Block>();
+    nested->parent = parent;
+    read_statements(*nested);
 
-    auto name = input.substr(0, nameEnd);
-    trim_sides(name);
-    call->functionName = name;
-    input.remove_prefix(nameEnd + 1);
-
-    while (!input.empty()) {
-        auto tokenEnd = input.find_first_of(",)");
-        auto token = input.substr(0, tokenEnd);
-        auto param = parse_parameter(token);
-        if (param) {
-            call->params.push_back(std::move(param));
+    expect(Token::CloseBrace, "couldn't find block delimiters");
+    return nested;
+}
+
+FunctionCallPtr Parser::read_function_call() {
+    auto start = offset();
+    auto call = read_call_expression();
+    expect(Token::Semicolon, "Unexpected character.");
+    call->span = span_from(start);
+    return call;
+}
+
+FunctionCallPtr Parser::read_call_expression() {
+    auto start = offset();
+    auto call = _arena.make<FunctionCall>();
+
+    call->functionName = _arena.copy(expect(Token::Identifier, "Not a function call.").text);
+    expect(Token::OpenParen, "Not a function call.");
+
+    while (!peek().is(Token::CloseParen)) {
+        if (peek().is(Token::Comma)) {
+            next();
+            continue;
         }
-        
-        input.remove_prefix(tokenEnd);
-        
-        bool finalParam = input[0] == ')';
-        input.remove_prefix(1);
 
-        if (finalParam) {
-            break;
+        call->params.push_back(read_parameter());
+
+        if (!peek().is(Token::Comma) && !peek().is(Token::CloseParen)) {
+            throw std::runtime_error("Unexpected character.");
         }
     }
+    next();
 
-    trim_left(input);
-    if (input[0] != ';') {
-        throw std::runtime_error("Unexpected character.");
+    call->span = span_from(start);
+    return call;
+}
+
+ReturnStatementPtr Parser::read_return() {
+    auto start = offset();
+    auto returnStatement = _arena.make<ReturnStatement>();
+
+    if (!at_keyword("return")) {
+        throw std::runtime_error("expected return statement");
     }
+    next();
 
-    input.remove_prefix(1);
+    if (!peek().is(Token::Semicolon)) {
+        returnStatement->value = read_parameter();
+    }
+    expect(Token::Semicolon, "Unexpected character.");
 
-    return call;
+    returnStatement->span = span_from(start);
+    return returnStatement;
 }
 
-VariableDefinition Parser::parse_variable_definition(std::string_view& input) {
+VariableDefinition Parser::read_variable_definition() {
     VariableDefinition def;
 
-    trim_left(input);
-    auto splitter = input.find_first_of(' ');
-    auto type = input.substr(0, splitter);
-
-    if (type != "int64") {
+    auto& type = expect(Token::Identifier, "unexpected type");
+    if (type.text != "int64") {
         throw std::runtime_error("unexpected type");
     }
     def.type = VariableDefinition::Int64;
-    input.remove_prefix(splitter + 1);
 
-    splitter = input.find_first_of(';');
-    auto name = input.substr(0, splitter);
-    trim_sides(name);
-
-    if (haswhitespace(name)) {
-        throw std::runtime_error("Unexpected whitespace.");
-    }
-    def.name = name;
-
-    input.remove_prefix(splitter + 1);
+    def.name = _arena.copy(expect(Token::Identifier, "Unexpected whitespace.").text);
+    expect(Token::Semicolon, "Unexpected whitespace.");
 
     return def;
 }
 
-VariableAssignmentPtr Parser::parse_variable_assignment(std::string_view& input) {
-    auto assign = std::make_unique<VariableAssignment>();
-
-    auto splitter = input.find_first_of('=');
-    auto assignTo = input.substr(0, splitter);
-    trim_sides(assignTo);
-    if (haswhitespace(assignTo)) {
-        throw std::runtime_error("Unexpected whitespace.");
-    }
-    assign->to.content = assignTo;
+VariableAssignmentPtr Parser::read_variable_assignment() {
+    auto start = offset();
+    auto assign = _arena.make<VariableAssignment>();
 
-    input.remove_prefix(splitter + 1);
+    assign->to.content = _arena.copy(expect(Token::Identifier, "Unexpected whitespace.").text);
+    assign->to.span = span_from(start);
+    expect(Token::Assign, "Unexpected whitespace.");
+    assign->value = read_parameter();
+    expect(Token::Semicolon, "Unexpected whitespace.");
 
-    auto end = input.find_first_of(';');
-    auto value = input.substr(0, end);
-    assign->value = parse_parameter(value);
-    input.remove_prefix(end + 1);
+    assign->span = span_from(start);
     return assign;
 }
 
-ParamPtr Parser::parse_parameter(std::string_view input) {
-    trim_sides(input);
+ParamPtr Parser::read_parameter() {
+    auto start = offset();
+    auto operand = read_operand();
 
-    if (input.empty()) {
-        return nullptr;
+    char op = 0;
+    if (peek().is(Token::Plus)) {
+        op = '+';
+    } else if (peek().is(Token::Percent)) {
+        op = '%';
+    } else {
+        return operand;
     }
+    next();
+
+    auto calc = _arena.make<Int64Calcuation>();
+    calc->set_op_from_char(op);
+    calc->lhs = operand;
+    calc->rhs = read_parameter();
+    calc->span = span_from(start);
+
+    auto statementParam = _arena.make<StatementParam>();
+    statementParam->statement = calc;
+    statementParam->span = calc->span;
+    return statementParam;
+}
 
-    if (input[0] == '"') {
-        if (input.back() != '"') {
-            throw std::runtime_error("no end to string found");
+ParamPtr Parser::read_operand() {
+    if (peek().is(Token::Identifier) && peek(1).is(Token::OpenParen)) {
+        auto statementParam = _arena.make<StatementParam>();
+        statementParam->statement = read_call_expression();
+        statementParam->span = statementParam->statement->span;
+        return statementParam;
+    }
+
+    auto start = offset();
+    auto& token = next();
+
+    switch (token.kind) {
+        case Token::String:
+        {
+            auto param = _arena.make<StringParam>();
+            param->content = _arena.copy(token.text);
+            param->span = span_from(start);
+            return param;
         }
 
-        auto param = std::make_unique<StringParam>();
-        param->content = std::string(input.substr(1, input.size() - 2));
-        return param;
-    }
-    
-    auto opSymbol = input.find_first_of(Int64Calcuation::operatorSymbols);
-    if (opSymbol != std::string_view::npos) {
-        auto calc = std::make_unique<Int64Calcuation>();
-        calc->set_op_from_char(input[opSymbol]);
-        auto lhs = input.substr(0, opSymbol);
-        calc->lhs = parse_parameter(lhs);
-        input.remove_prefix(opSymbol + 1);
-        calc->rhs = parse_parameter(input);
-
-        auto statementParam = std::make_unique<StatementParam>();
-        statementParam->statement = std::move(calc);
-        return statementParam;
-    } else if (haswhitespace(input)) {
-        throw std::runtime_error("unexpected whitespace");
-    } else if (std::isdigit(input[0])) {
-        auto int64param = std::make_unique<Int64Param>();
-        int64param->content = std::atoi(&input[0]);
-        return int64param;
-    } else {
-        auto param = std::make_unique<StackVariableParam>();
-        param->content = input;
-        return param;
+        case Token::Integer:
+        {
+            auto param = _arena.make<Int64Param>();
+            auto [ptr, ec] = std::from_chars(token.text.data(), token.text.data() + token.text.size(), param->content);
+            if (ec != std::errc()) {
+                throw std::runtime_error("integer out of range");
+            }
+            param->span = span_from(start);
+            return param;
+        }
+
+        case Token::Identifier:
+        {
+            auto param = _arena.make<StackVariableParam>();
+            param->content = _arena.copy(token.text);
+            param->span = span_from(start);
+            return param;
+        }
+
+        default:
+            throw std::runtime_error("unexpected token in parameter");
     }
 }
 
-IfChainStatementPtr Parser::parse_if_chain(std::string_view& input) {
-    auto ifchain = std::make_unique<IfChainStatement>();
+IfChainStatementPtr Parser::read_if_chain(Block* parent) {
+    auto chainStart = offset();
+    auto ifchain = _arena.make<IfChainStatement>();
 
-    trim_left(input);
-    while (!input.empty()) {
+    while (!at_end()) {
+        auto start = offset();
         bool closingElse = false;
-        if (input.starts_with("if")) {
+        if (at_keyword("if")) {
             if (!ifchain->_ifstatements.empty()) {
                 break;
             }
-            input.remove_prefix(2);
-        } else if (input.starts_with("else")) {
+            next();
+        } else if (at_keyword("else")) {
             if (ifchain->_ifstatements.empty()) {
                 throw std::runtime_error("unexpected else / else if statement");
             }
+            next();
 
-            if (!input.starts_with("else if")) {
-                closingElse = true;
-                input.remove_prefix(4);
+            if (at_keyword("if")) {
+                next();
             } else {
-                input.remove_prefix(7);
+                closingElse = true;
             }
         } else {
             //no longer an if statement
             break;
         }
-        
-        std::unique_ptr<IfStatement> ifStatement;
-        auto ifStatementExpected = parse_comparator(input);
+
+        IfStatement* ifStatement = nullptr;
+        auto ifStatementExpected = read_comparator();
         if (ifStatementExpected.has_value()) {
             if (closingElse) {
                 throw std::runtime_error("unexpected comparator");
             } else {
-                ifStatement = std::move(ifStatementExpected.value());
+                ifStatement = ifStatementExpected.value();
             }
+        } else if (!closingElse) {
+            throw std::runtime_error(ifStatementExpected.error());
         } else {
-            ifStatement = std::make_unique<IfStatement>();
+            ifStatement = _arena.make<IfStatement>();
             ifStatement->comparator = IfStatement::None;
         }
 
-        trim_left(input);
-        auto blockStart = input.find_first_of('{');
-        auto blockEnd = find_block_end(input);
-        if (blockStart == std::string_view::npos || blockEnd == std::string_view::npos) {
-            throw std::runtime_error("couldn't find block delimiters");
-        }
-        auto block = input.substr(blockStart + 1, blockEnd - blockStart - 1);
-
-        Parser parser;
-        parser.parse_block(block);
-        ifStatement->block = std::move(parser.block);
-        ifStatement->block->parent = this->block.get();
-        input.remove_prefix(blockEnd + 1);
-        trim_left(input);
-
-        ifchain->_ifstatements.push_back(std::move(ifStatement));
+        ifStatement->block = read_nested_block(parent);
+        ifStatement->span = span_from(start);
+        ifchain->_ifstatements.push_back(ifStatement);
 
         if (closingElse) {
             break;
         }
     }
 
+    ifchain->span = span_from(chainStart);
     return ifchain;
 }
 
-LoopStatementPtr Parser::parse_loop(std::string_view& input) {
-    auto loopStatement = std::make_unique<LoopStatement>();
+LoopStatementPtr Parser::read_loop(Block* parent) {
+    auto start = offset();
+    auto loopStatement = _arena.make<LoopStatement>();
 
-    trim_left(input);
-    if (!input.starts_with("while")) {
+    if (!at_keyword("while")) {
         throw std::runtime_error("expected while statement");
     }
-    input.remove_prefix(5);
+    next();
 
-    auto ifStatementExpected = parse_comparator(input);
+    auto ifStatementExpected = read_comparator();
     if (!ifStatementExpected.has_value()) {
-        throw ifStatementExpected.error();
-    }
-    auto ifStatement = std::move(ifStatementExpected.value());
-
-    trim_left(input);
-    auto blockStart = input.find_first_of('{');
-    auto blockEnd = find_block_end(input);
-    if (blockStart == std::string_view::npos || blockEnd == std::string_view::npos) {
-        throw std::runtime_error("couldn't find block delimiters");
+        throw std::runtime_error(ifStatementExpected.error());
     }
-    auto block = input.substr(blockStart + 1, blockEnd - blockStart - 1);
+    auto ifStatement = ifStatementExpected.value();
 
-    Parser parser;
-    parser.parse_block(block);
-    ifStatement->block = std::move(parser.block);
-    ifStatement->block->parent = this->block.get();
-    loopStatement->_ifStatement = std::move(ifStatement);
-    input.remove_prefix(blockEnd + 1);
+    ifStatement->block = read_nested_block(parent);
+    ifStatement->span = span_from(start);
+    loopStatement->_ifStatement = ifStatement;
 
+    loopStatement->span = span_from(start);
     return loopStatement;
 }
 
-std::expected<IfStatementPtr, std::string> Parser::parse_comparator(std::string_view& input) {
-    auto ifStatement = std::make_unique<IfStatement>();
+std::expected<IfStatementPtr, std::string> Parser::read_comparator() {
+    auto start = offset();
+    auto ifStatement = _arena.make<IfStatement>();
 
-    trim_left(input);
-    if (input[0] != '(') {
+    if (!peek().is(Token::OpenParen)) {
         return std::unexpected("Expected opening bracket");
     }
-    input.remove_prefix(1);
+    next();
+
+    ifStatement->lhs = read_parameter();
+
+    switch (next().kind) {
+        case Token::Equal: ifStatement->comparator = IfStatement::Equal; break;
+        case Token::NotEqual: ifStatement->comparator = IfStatement::NotEqual; break;
+        case Token::LessThan: ifStatement->comparator = IfStatement::LessThan; break;
+        case Token::LessThanOrEqual: ifStatement->comparator = IfStatement::LessThanOrEqual; break;
+        case Token::GreaterThan: ifStatement->comparator = IfStatement::GreaterThan; break;
+        case Token::GreaterThanOrEqual: ifStatement->comparator = IfStatement::GreaterThanOrEqual; break;
+        default:
+            throw std::runtime_error("unknown comparator");
+    }
+
+    ifStatement->rhs = read_parameter();
 
-    auto comparatorEnd = input.find_first_of(')');
-    if (comparatorEnd == std::string_view::npos) {
+    if (!peek().is(Token::CloseParen)) {
         return std::unexpected("expected closing bracket");
     }
+    next();
 
-    auto comparison = input.substr(0, comparatorEnd);
-    auto comparator = comparison.find_first_of(IfStatement::comparatorSymbols);
-    ifStatement->lhs = parse_parameter(comparison.substr(0, comparator));
-    comparison.remove_prefix(comparator);
-    auto cmpSize = ifStatement->set_cmp_from_sv(comparison.substr(0, 2));
-    comparison.remove_prefix(cmpSize);
-    ifStatement->rhs = parse_parameter(comparison.substr(0));
+    ifStatement->span = span_from(start);
+    return ifStatement;
+}
 
-    input.remove_prefix(comparatorEnd + 1);
+ll::FunctionDefinitionPtr Parser::read_function_definition() {
+    auto start = offset();
+    auto def = _arena.make<ll::FunctionDefinition>();
 
-    return ifStatement;
+    if (!at_keyword("fn")) {
+        throw std::runtime_error("expected function definition");
+    }
+    next();
+
+    def->name = _arena.copy(expect(Token::Identifier, "expected function name").text);
+
+    expect(Token::OpenParen, "expected function parameter definition");
+
+    //parameters become the first variables of the function block
+    auto block = _arena.make<Block>();
+    while (!peek().is(Token::CloseParen)) {
+        auto& type = expect(Token::Identifier, "expected function parameter definition");
+        if (type.text != "int64") {
+            throw std::runtime_error("unexpected type");
+        }
+
+        auto name = _arena.copy(expect(Token::Identifier, "expected function parameter name").text);
+        if (block->find_variable(name)) {
+            throw std::runtime_error("duplicate function parameter name");
+        }
+        block->vars.push_back(VariableDefinition{.name = name, .type = VariableDefinition::Int64});
+
+        if (peek().is(Token::Comma) && !peek(1).is(Token::CloseParen)) {
+            next();
+        } else if (!peek().is(Token::CloseParen)) {
+            throw std::runtime_error("expected function parameter definition");
+        }
+    }
+    next();
+    block->parameters = block->vars.size();
+
+    expect(Token::OpenBrace, "couldn't find block delimiters");
+    read_statements(*block);
+    expect(Token::CloseBrace, "couldn't find block delimiters");
+
+    def->block = block;
+    def->span = span_from(start);
+
+    return def;
+}
+
+ll::FunctionDefinitionPtr Parser::read_implicit_main() {
+    auto start = offset();
+    auto def = _arena.make<ll::FunctionDefinition>();
+    def->name = "main";
+
+    auto block = _arena.make<Block>();
+    read_statements(*block);
+    if (!at_end()) {
+        throw std::runtime_error("unknown section");
+    }
+
+    def->block = block;
+    def->span = span_from(start);
+
+    return def;
 }
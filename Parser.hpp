@@ -1,24 +1,36 @@
-
 //------------------------------------------------------------------------------
 // Parser.hpp
 //------------------------------------------------------------------------------
 
 #pragma once
 
+#include "Arena.hpp"
+#include "Lexer.hpp"
 #include "Statement.hpp"
+#include "TranslationUnitTypes.hpp"
 #include "Variables.hpp"
 
 #include <cstdint>
 #include <expected>
+#include <span>
 #include <string>
 #include <vector>
 
 class Parser {
 public:
-    std::unique_ptr<Block> block;
+    Block* block;
+
+private:
+    ll::Arena& _arena;
+    std::vector<lexer::Token> _ownedTokens;
+    std::span<const lexer::Token> _tokens;
+    size_t _pos = 0;
+    //offset of the lexed input in the translation unit, added to node spans
+    std::uint32_t _base = 0;
 
 public:
-    Parser();
+    Parser(ll::Arena& arena);
+    Parser(ll::Arena& arena, std::span<const lexer::Token> tokens, std::uint32_t base = 0);
 
     void parse_block(std::string_view input);
 
@@ -31,4 +43,35 @@ public:
     LoopStatementPtr parse_loop(std::string_view& input);
 
     std::expected<IfStatementPtr, std::string> parse_comparator(std::string_view& input);
+
+    //token stream interface, reads from the current position onwards
+    bool at_end() const;
+    bool at_keyword(std::string_view keyword) const;
+    size_t offset() const;
+    ll::FunctionDefinitionPtr read_function_definition();
+    //the remaining statements as the body of a function named main
+    ll::FunctionDefinitionPtr read_implicit_main();
+
+private:
+    void lex(std::string_view input);
+    void consume_lexed(std::string_view& input) const;
+
+    const lexer::Token& peek(size_t ahead = 0) const;
+    const lexer::Token& next();
+    const lexer::Token& expect(lexer::Token::Kind kind, const char* error);
+    //from the token at start up to the end of the last one read
+    ll::SourceSpan span_from(size_t start) const;
+
+    void read_statements(Block& into);
+    Block* read_nested_block(Block* parent);
+    VariableDefinition read_variable_definition();
+    FunctionCallPtr read_function_call();
+    FunctionCallPtr read_call_expression();
+    ReturnStatementPtr read_return();
+    VariableAssignmentPtr read_variable_assignment();
+    ParamPtr read_parameter();
+    ParamPtr read_operand();
+    IfChainStatementPtr read_if_chain(Block* parent);
+    LoopStatementPtr read_loop(Block* parent);
+    std::expected<IfStatementPtr, std::string> read_comparator();
 };
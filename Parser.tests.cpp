@@ -8,8 +8,9 @@
 #include <gtest/gtest.h>
 
 TEST(Parser, parse_function_call_no_args) {
+    ll::Arena arena;
     std::string_view eg = R"(cool();)";
-    Parser p;
+    Parser p(arena);
     auto call = p.parse_function_call(eg);
     EXPECT_EQ(call->functionName, "cool");
 
@@ -17,53 +18,94 @@ TEST(Parser, parse_function_call_no_args) {
 }
 
 TEST(Parser, parse_function_call_one_arg) {
+    ll::Arena arena;
     std::string_view eg = R"(puts("test");)";
-    Parser p;
+    Parser p(arena);
     auto call = p.parse_function_call(eg);
     EXPECT_EQ(call->functionName, "puts");
 
-    auto stringparam = dynamic_cast<StringParam*>(call->params[0].get());
+    auto stringparam = node_cast<StringParam>(call->params[0]);
     ASSERT_NE(stringparam, nullptr);
     EXPECT_EQ(stringparam->content, "test");
 }
 
 TEST(Parser, printf_two_args) {
+    ll::Arena arena;
     std::string_view eg = "printf(\"test %i \n\",123);";
-    Parser p;
+    Parser p(arena);
     auto call = p.parse_function_call(eg);
     EXPECT_EQ(call->functionName, "printf");
 
     EXPECT_EQ(call->params.size(), 2);
 
-    auto stringparam = dynamic_cast<StringParam*>(call->params[0].get());
+    auto stringparam = node_cast<StringParam>(call->params[0]);
     ASSERT_NE(stringparam, nullptr);
     EXPECT_EQ(stringparam->content, "test %i \n");
 
-    auto intparam = dynamic_cast<Int64Param*>(call->params[1].get());
+    auto intparam = node_cast<Int64Param>(call->params[1]);
     ASSERT_NE(intparam, nullptr);
     EXPECT_EQ(intparam->content, 123);
 }
 
 TEST(Parser, parse_function_call_stack_argument) {
+    ll::Arena arena;
     std::string_view eg = "printf(\"test %i \n\",intarg);";
-    Parser p;
+    Parser p(arena);
     auto call = p.parse_function_call(eg);
     EXPECT_EQ(call->functionName, "printf");
 
     EXPECT_EQ(call->params.size(), 2);
 
-    auto stringparam = dynamic_cast<StringParam*>(call->params[0].get());
+    auto stringparam = node_cast<StringParam>(call->params[0]);
     ASSERT_NE(stringparam, nullptr);
     EXPECT_EQ(stringparam->content, "test %i \n");
 
-    auto stackparam = dynamic_cast<StackVariableParam*>(call->params[1].get());
+    auto stackparam = node_cast<StackVariableParam>(call->params[1]);
     ASSERT_NE(stackparam, nullptr);
     EXPECT_EQ(stackparam->content, "intarg");
 }
 
+TEST(Parser, parse_call_expression_operand) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block("int64 a; a = add(1, a) + 2;");
+
+    ASSERT_EQ(p.block->statements.size(), 1);
+    auto assignment = node_cast<VariableAssignment>(p.block->statements[0]);
+    ASSERT_NE(assignment, nullptr);
+    auto calc = node_cast<Int64Calcuation>(node_cast<StatementParam>(assignment->value)->statement);
+    ASSERT_NE(calc, nullptr);
+
+    auto lhs = node_cast<StatementParam>(calc->lhs);
+    ASSERT_NE(lhs, nullptr);
+    auto call = node_cast<FunctionCall>(lhs->statement);
+    ASSERT_NE(call, nullptr);
+    EXPECT_EQ(call->functionName, "add");
+    ASSERT_EQ(call->params.size(), 2);
+    EXPECT_NE(node_cast<StackVariableParam>(call->params[1]), nullptr);
+}
+
+TEST(Parser, parse_return) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block("return 1 + 2; return;");
+
+    ASSERT_EQ(p.block->statements.size(), 2);
+    auto value = node_cast<ReturnStatement>(p.block->statements[0]);
+    ASSERT_NE(value, nullptr);
+    EXPECT_NE(node_cast<StatementParam>(value->value), nullptr);
+
+    auto empty = node_cast<ReturnStatement>(p.block->statements[1]);
+    ASSERT_NE(empty, nullptr);
+    EXPECT_EQ(empty->value, nullptr);
+
+    EXPECT_THROW(p.parse_block("return 1"), std::runtime_error);
+}
+
 TEST(Parser, parse_variable_definition) {
+    ll::Arena arena;
     std::string_view eg = R"(int64 test;)";
-    Parser p;
+    Parser p(arena);
     auto definition = p.parse_variable_definition(eg);
 
     EXPECT_EQ(definition.name, "test");
@@ -71,77 +113,81 @@ TEST(Parser, parse_variable_definition) {
 }
 
 TEST(Parser, parse_variable_assignment_to_const) {
+    ll::Arena arena;
     std::string_view eg = R"(test = 123;)";
-    Parser p;
+    Parser p(arena);
     auto assign = p.parse_variable_assignment(eg);
 
     EXPECT_EQ(assign->to.content, "test");
 
-    auto value = dynamic_cast<Int64Param*>(assign->value.get());
+    auto value = node_cast<Int64Param>(assign->value);
     ASSERT_NE(value, nullptr);
     EXPECT_EQ(value->content, 123);
 }
 
 TEST(Parser, parse_variable_assignment_to_variable) {
+    ll::Arena arena;
     std::string_view eg = R"(test = another;)";
-    Parser p;
+    Parser p(arena);
     auto assign = p.parse_variable_assignment(eg);
 
     EXPECT_EQ(assign->to.content, "test");
 
-    auto value = dynamic_cast<StackVariableParam*>(assign->value.get());
+    auto value = node_cast<StackVariableParam>(assign->value);
     ASSERT_NE(value, nullptr);
     EXPECT_EQ(value->content, "another");
 }
 
 TEST(Parser, parse_variable_assignment_to_int64_const_addition) {
+    ll::Arena arena;
     std::string_view eg = R"(test = 1 + 2;)";
-    Parser p;
+    Parser p(arena);
     auto assign = p.parse_variable_assignment(eg);
 
     EXPECT_EQ(assign->to.content, "test");
 
-    auto value = dynamic_cast<StatementParam*>(assign->value.get());
+    auto value = node_cast<StatementParam>(assign->value);
     ASSERT_NE(value, nullptr);
 
-    auto statement = dynamic_cast<Statement*>(value->statement.get());
+    auto statement = value->statement;
     ASSERT_NE(statement, nullptr);
 
-    auto int64calc = dynamic_cast<Int64Calcuation*>(statement);
+    auto int64calc = node_cast<Int64Calcuation>(statement);
     ASSERT_NE(int64calc, nullptr);
     EXPECT_EQ(int64calc->operation, Int64Calcuation::Addition);
 
-    auto lhs = dynamic_cast<Int64Param*>(int64calc->lhs.get());
+    auto lhs = node_cast<Int64Param>(int64calc->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, 1);
 
-    auto rhs = dynamic_cast<Int64Param*>(int64calc->rhs.get());
+    auto rhs = node_cast<Int64Param>(int64calc->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 2);
 }
 
 TEST(Parser, parse_variable_assignment_to_int64_const_modulo) {
+    ll::Arena arena;
     std::string_view eg = R"(test = 4 % 3;)";
-    Parser p;
+    Parser p(arena);
     auto assign = p.parse_variable_assignment(eg);
 
     EXPECT_EQ(assign->to.content, "test");
 
-    auto value = dynamic_cast<StatementParam*>(assign->value.get());
+    auto value = node_cast<StatementParam>(assign->value);
     ASSERT_NE(value, nullptr);
 
-    auto statement = dynamic_cast<Statement*>(value->statement.get());
+    auto statement = value->statement;
     ASSERT_NE(statement, nullptr);
 
-    auto int64calc = dynamic_cast<Int64Calcuation*>(statement);
+    auto int64calc = node_cast<Int64Calcuation>(statement);
     ASSERT_NE(int64calc, nullptr);
     EXPECT_EQ(int64calc->operation, Int64Calcuation::Modulo);
 
-    auto lhs = dynamic_cast<Int64Param*>(int64calc->lhs.get());
+    auto lhs = node_cast<Int64Param>(int64calc->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, 4);
 
-    auto rhs = dynamic_cast<Int64Param*>(int64calc->rhs.get());
+    auto rhs = node_cast<Int64Param>(int64calc->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 3);
 }
@@ -149,19 +195,20 @@ TEST(Parser, parse_variable_assignment_to_int64_const_modulo) {
 class ParamParseIntTest
     : public testing::TestWithParam<std::tuple<std::string_view, int64_t>> {
 public:
-    std::unique_ptr<Param> param;
+    ll::Arena arena;
+    Param* param;
     int64_t result;
 
     void SetUp() override {
         auto [input, r] = GetParam();
         result = r;
-        Parser p;
+        Parser p(arena);
         param = p.parse_parameter(input);
     }
 };
 
 TEST_P(ParamParseIntTest, parse_parameter_integer) {
-    auto int64param = dynamic_cast<Int64Param*>(param.get());
+    auto int64param = node_cast<Int64Param>(param);
     ASSERT_NE(int64param, nullptr);
     EXPECT_EQ(int64param->content, result);
 }
@@ -176,19 +223,20 @@ INSTANTIATE_TEST_SUITE_P(IntegerParameterParse, ParamParseIntTest, ::testing::Va
 class ParamParseStringTest
     : public testing::TestWithParam<std::tuple<std::string_view, std::string_view>> {
 public:
-    std::unique_ptr<Param> param;
+    ll::Arena arena;
+    Param* param;
     std::string_view result;
 
     void SetUp() override {
         auto [input, r] = GetParam();
         result = r;
-        Parser p;
+        Parser p(arena);
         param = p.parse_parameter(input);
     }
 };
 
 TEST_P(ParamParseStringTest, parse_parameter_string) {
-    auto stringParam = dynamic_cast<StringParam*>(param.get());
+    auto stringParam = node_cast<StringParam>(param);
     ASSERT_NE(stringParam, nullptr);
     EXPECT_EQ(stringParam->content, result);
 }
@@ -201,19 +249,20 @@ INSTANTIATE_TEST_SUITE_P(StringParameterParse, ParamParseStringTest, ::testing::
 class ParamParseVariableTest
     : public testing::TestWithParam<std::tuple<std::string_view, std::string_view>> {
 public:
-    std::unique_ptr<Param> param;
+    ll::Arena arena;
+    Param* param;
     std::string_view result;
 
     void SetUp() override {
         auto [input, r] = GetParam();
         result = r;
-        Parser p;
+        Parser p(arena);
         param = p.parse_parameter(input);
     }
 };
 
 TEST_P(ParamParseVariableTest, parse_parameter_variable) {
-    auto stackParam = dynamic_cast<StackVariableParam*>(param.get());
+    auto stackParam = node_cast<StackVariableParam>(param);
     ASSERT_NE(stackParam, nullptr);
     EXPECT_EQ(stackParam->content, result);
 }
@@ -225,302 +274,356 @@ INSTANTIATE_TEST_SUITE_P(VariableParameterParse, ParamParseVariableTest, ::testi
 ));
 
 TEST(Parser, parse_if_statement_const_parameters) {
+    ll::Arena arena;
     std::string_view eg = R"(if ( 1 == 1) {})";
-    Parser p;
+    Parser p(arena);
     auto ifchain = p.parse_if_chain(eg);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 1);
 
-    auto ifstatement = ifchain->_ifstatements.front().get();
+    auto ifstatement = ifchain->_ifstatements.front();
     EXPECT_EQ(ifstatement->comparator, IfStatement::Equal);
 
-    auto lhs = dynamic_cast<Int64Param*>(ifstatement->lhs.get());
+    auto lhs = node_cast<Int64Param>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, 1);
 
-    auto rhs = dynamic_cast<Int64Param*>(ifstatement->rhs.get());
+    auto rhs = node_cast<Int64Param>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 1);
 
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_TRUE(ifstatement->block->statements.empty());
-    EXPECT_EQ(ifstatement->block->parent, p.block.get());
+    EXPECT_EQ(ifstatement->block->parent, p.block);
 }
 
 TEST(Parser, parse_if_statement_const_and_stack_parameters) {
+    ll::Arena arena;
     std::string_view eg = R"(if ( 1 == another) {})";
-    Parser p;
+    Parser p(arena);
     auto ifchain = p.parse_if_chain(eg);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 1);
 
-    auto ifstatement = ifchain->_ifstatements.front().get();
+    auto ifstatement = ifchain->_ifstatements.front();
     EXPECT_EQ(ifstatement->comparator, IfStatement::Equal);
 
-    auto lhs = dynamic_cast<Int64Param*>(ifstatement->lhs.get());
+    auto lhs = node_cast<Int64Param>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, 1);
 
-    auto rhs = dynamic_cast<StackVariableParam*>(ifstatement->rhs.get());
+    auto rhs = node_cast<StackVariableParam>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, "another");
 
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_TRUE(ifstatement->block->statements.empty());
-    EXPECT_EQ(ifstatement->block->parent, p.block.get());
+    EXPECT_EQ(ifstatement->block->parent, p.block);
 }
 
 TEST(Parser, parse_if_statement_stack_and_const_parameters) {
+    ll::Arena arena;
     std::string_view eg = R"(if ( another == 1) {})";
-    Parser p;
+    Parser p(arena);
     auto ifchain = p.parse_if_chain(eg);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 1);
 
-    auto ifstatement = ifchain->_ifstatements.front().get();
+    auto ifstatement = ifchain->_ifstatements.front();
     EXPECT_EQ(ifstatement->comparator, IfStatement::Equal);
 
-    auto lhs = dynamic_cast<StackVariableParam*>(ifstatement->lhs.get());
+    auto lhs = node_cast<StackVariableParam>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, "another");
 
-    auto rhs = dynamic_cast<Int64Param*>(ifstatement->rhs.get());
+    auto rhs = node_cast<Int64Param>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 1);
 
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_TRUE(ifstatement->block->statements.empty());
-    EXPECT_EQ(ifstatement->block->parent, p.block.get());
+    EXPECT_EQ(ifstatement->block->parent, p.block);
 }
 
 TEST(Parser, parse_if_statement_stack_and_stack_parameters) {
+    ll::Arena arena;
     std::string_view eg = R"(if ( another == test ) {})";
-    Parser p;
+    Parser p(arena);
     auto ifchain = p.parse_if_chain(eg);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 1);
 
-    auto ifstatement = ifchain->_ifstatements.front().get();
+    auto ifstatement = ifchain->_ifstatements.front();
     EXPECT_EQ(ifstatement->comparator, IfStatement::Equal);
 
-    auto lhs = dynamic_cast<StackVariableParam*>(ifstatement->lhs.get());
+    auto lhs = node_cast<StackVariableParam>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, "another");
 
-    auto rhs = dynamic_cast<StackVariableParam*>(ifstatement->rhs.get());
+    auto rhs = node_cast<StackVariableParam>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, "test");
 
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_TRUE(ifstatement->block->statements.empty());
-    EXPECT_EQ(ifstatement->block->parent, p.block.get());
+    EXPECT_EQ(ifstatement->block->parent, p.block);
 }
 
 TEST(Parser, parse_if_statement_stack_and_const_parameters_with_block_contents) {
+    ll::Arena arena;
     std::string_view eg = R"(if ( another == 1) { another = 2; })";
-    Parser p;
+    Parser p(arena);
     auto ifchain = p.parse_if_chain(eg);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 1);
 
-    auto ifstatement = ifchain->_ifstatements.front().get();
+    auto ifstatement = ifchain->_ifstatements.front();
     EXPECT_EQ(ifstatement->comparator, IfStatement::Equal);
 
-    auto lhs = dynamic_cast<StackVariableParam*>(ifstatement->lhs.get());
+    auto lhs = node_cast<StackVariableParam>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, "another");
 
-    auto rhs = dynamic_cast<Int64Param*>(ifstatement->rhs.get());
+    auto rhs = node_cast<Int64Param>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 1);
 
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_EQ(ifstatement->block->statements.size(), 1);
-    EXPECT_EQ(ifstatement->block->parent, p.block.get());
+    EXPECT_EQ(ifstatement->block->parent, p.block);
 
-    auto statement = dynamic_cast<VariableAssignment*>(ifstatement->block->statements.front().get());
+    auto statement = node_cast<VariableAssignment>(ifstatement->block->statements.front());
     ASSERT_NE(statement, nullptr);
 }
 
 TEST(Parser, parse_if_else_if_statement_const_parameters) {
+    ll::Arena arena;
     std::string_view eg = R"(if ( 1 == 1) {} else if ( 2 == 2 ) {})";
-    Parser p;
+    Parser p(arena);
     auto ifchain = p.parse_if_chain(eg);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 2);
 
-    auto ifstatement = ifchain->_ifstatements.front().get();
+    auto ifstatement = ifchain->_ifstatements.front();
     EXPECT_EQ(ifstatement->comparator, IfStatement::Equal);
 
-    auto lhs = dynamic_cast<Int64Param*>(ifstatement->lhs.get());
+    auto lhs = node_cast<Int64Param>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, 1);
 
-    auto rhs = dynamic_cast<Int64Param*>(ifstatement->rhs.get());
+    auto rhs = node_cast<Int64Param>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 1);
 
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_TRUE(ifstatement->block->statements.empty());
-    EXPECT_EQ(ifstatement->block->parent, p.block.get());
+    EXPECT_EQ(ifstatement->block->parent, p.block);
 
-    auto ifstatement2 = ifchain->_ifstatements.back().get();
+    auto ifstatement2 = ifchain->_ifstatements.back();
     EXPECT_EQ(ifstatement2->comparator, IfStatement::Equal);
 
-    auto lhs2 = dynamic_cast<Int64Param*>(ifstatement2->lhs.get());
+    auto lhs2 = node_cast<Int64Param>(ifstatement2->lhs);
     ASSERT_NE(lhs2, nullptr);
     EXPECT_EQ(lhs2->content, 2);
 
-    auto rhs2 = dynamic_cast<Int64Param*>(ifstatement2->rhs.get());
+    auto rhs2 = node_cast<Int64Param>(ifstatement2->rhs);
     ASSERT_NE(rhs2, nullptr);
     EXPECT_EQ(rhs2->content, 2);
 
     EXPECT_TRUE(ifstatement2->block->vars.empty());
     EXPECT_TRUE(ifstatement2->block->statements.empty());
-    EXPECT_EQ(ifstatement2->block->parent, p.block.get());
+    EXPECT_EQ(ifstatement2->block->parent, p.block);
 }
 
 TEST(Parser, parse_else_if_errors) {
+    ll::Arena arena;
     std::string_view eg = R"(else if ( 1 == 1) {})";
-    Parser p;
+    Parser p(arena);
     EXPECT_ANY_THROW(p.parse_if_chain(eg));
 }
 
 TEST(Parser, parse_if_else_statement_const_parameters) {
+    ll::Arena arena;
     std::string_view eg = R"(if ( 1 == 1) {} else {})";
-    Parser p;
+    Parser p(arena);
     auto ifchain = p.parse_if_chain(eg);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 2);
 
-    auto ifstatement = ifchain->_ifstatements.front().get();
+    auto ifstatement = ifchain->_ifstatements.front();
     EXPECT_EQ(ifstatement->comparator, IfStatement::Equal);
 
-    auto lhs = dynamic_cast<Int64Param*>(ifstatement->lhs.get());
+    auto lhs = node_cast<Int64Param>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, 1);
 
-    auto rhs = dynamic_cast<Int64Param*>(ifstatement->rhs.get());
+    auto rhs = node_cast<Int64Param>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 1);
 
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_TRUE(ifstatement->block->statements.empty());
-    EXPECT_EQ(ifstatement->block->parent, p.block.get());
+    EXPECT_EQ(ifstatement->block->parent, p.block);
 
-    auto ifstatement2 = ifchain->_ifstatements.back().get();
+    auto ifstatement2 = ifchain->_ifstatements.back();
     EXPECT_EQ(ifstatement2->comparator, IfStatement::None);
-    EXPECT_EQ(ifstatement2->lhs.get(), nullptr);
-    EXPECT_EQ(ifstatement2->rhs.get(), nullptr);
+    EXPECT_EQ(ifstatement2->lhs, nullptr);
+    EXPECT_EQ(ifstatement2->rhs, nullptr);
     EXPECT_TRUE(ifstatement2->block->vars.empty());
     EXPECT_TRUE(ifstatement2->block->statements.empty());
-    EXPECT_EQ(ifstatement2->block->parent, p.block.get());
+    EXPECT_EQ(ifstatement2->block->parent, p.block);
 }
 
 TEST(Parser, parse_if_else_if_else_statement_const_parameters) {
+    ll::Arena arena;
     std::string_view eg = R"(if ( 1 == 1) {} else if ( 2 == 2 ) {} else {})";
-    Parser p;
+    Parser p(arena);
     auto ifchain = p.parse_if_chain(eg);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 3);
 
-    auto ifstatement = ifchain->_ifstatements[0].get();
+    auto ifstatement = ifchain->_ifstatements[0];
     EXPECT_EQ(ifstatement->comparator, IfStatement::Equal);
-    auto lhs = dynamic_cast<Int64Param*>(ifstatement->lhs.get());
+    auto lhs = node_cast<Int64Param>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, 1);
-    auto rhs = dynamic_cast<Int64Param*>(ifstatement->rhs.get());
+    auto rhs = node_cast<Int64Param>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 1);
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_TRUE(ifstatement->block->statements.empty());
-    EXPECT_EQ(ifstatement->block->parent, p.block.get());
+    EXPECT_EQ(ifstatement->block->parent, p.block);
 
-    auto ifstatement2 = ifchain->_ifstatements[1].get();
+    auto ifstatement2 = ifchain->_ifstatements[1];
     EXPECT_EQ(ifstatement2->comparator, IfStatement::Equal);
-    auto lhs2 = dynamic_cast<Int64Param*>(ifstatement2->lhs.get());
+    auto lhs2 = node_cast<Int64Param>(ifstatement2->lhs);
     ASSERT_NE(lhs2, nullptr);
     EXPECT_EQ(lhs2->content, 2);
-    auto rhs2 = dynamic_cast<Int64Param*>(ifstatement2->rhs.get());
+    auto rhs2 = node_cast<Int64Param>(ifstatement2->rhs);
     ASSERT_NE(rhs2, nullptr);
     EXPECT_EQ(rhs2->content, 2);
     EXPECT_TRUE(ifstatement2->block->vars.empty());
     EXPECT_TRUE(ifstatement2->block->statements.empty());
-    EXPECT_EQ(ifstatement2->block->parent, p.block.get());
+    EXPECT_EQ(ifstatement2->block->parent, p.block);
 
-    auto ifstatement3 = ifchain->_ifstatements[2].get();
+    auto ifstatement3 = ifchain->_ifstatements[2];
     EXPECT_EQ(ifstatement3->comparator, IfStatement::None);
-    EXPECT_EQ(ifstatement3->lhs.get(), nullptr);
-    EXPECT_EQ(ifstatement3->rhs.get(), nullptr);
+    EXPECT_EQ(ifstatement3->lhs, nullptr);
+    EXPECT_EQ(ifstatement3->rhs, nullptr);
     EXPECT_TRUE(ifstatement3->block->vars.empty());
     EXPECT_TRUE(ifstatement3->block->statements.empty());
-    EXPECT_EQ(ifstatement3->block->parent, p.block.get());
+    EXPECT_EQ(ifstatement3->block->parent, p.block);
 }
 
 TEST(Parser, parse_if_else_else_if_error) {
+    ll::Arena arena;
     std::string_view eg = R"(if ( 1 == 1) {} else {} else if (2 == 2) {})";
-    Parser p;
+    Parser p(arena);
     EXPECT_NO_THROW(p.parse_if_chain(eg));
     EXPECT_ANY_THROW(p.parse_if_chain(eg));
 }
 
 TEST(Parser, parse_if_else_comparator_error) {
+    ll::Arena arena;
     std::string_view eg = R"(if ( 1 == 1) {} else (2 == 2) {})";
-    Parser p;
+    Parser p(arena);
     EXPECT_ANY_THROW(p.parse_if_chain(eg));
 }
 
 TEST(Parser, parse_if_statement_and_following) {
+    ll::Arena arena;
     std::string_view eg = R"(if ( 1 == 1) {} printf("");)";
-    Parser p;
+    Parser p(arena);
     auto ifchain = p.parse_if_chain(eg);
     ASSERT_NE(ifchain, nullptr);
     ASSERT_FALSE(ifchain->_ifstatements.empty());
     EXPECT_EQ(ifchain->_ifstatements.size(), 1);
 
-    auto ifstatement = ifchain->_ifstatements.front().get();
+    auto ifstatement = ifchain->_ifstatements.front();
     EXPECT_EQ(ifstatement->comparator, IfStatement::Equal);
 
-    auto lhs = dynamic_cast<Int64Param*>(ifstatement->lhs.get());
+    auto lhs = node_cast<Int64Param>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, 1);
 
-    auto rhs = dynamic_cast<Int64Param*>(ifstatement->rhs.get());
+    auto rhs = node_cast<Int64Param>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 1);
 
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_TRUE(ifstatement->block->statements.empty());
-    EXPECT_EQ(ifstatement->block->parent, p.block.get());
+    EXPECT_EQ(ifstatement->block->parent, p.block);
 }
 
 TEST(Parser, parse_while_statement_const_parameters) {
+    ll::Arena arena;
     std::string_view eg = R"(while ( 1 == 1) {})";
-    Parser p;
+    Parser p(arena);
     auto loop = p.parse_loop(eg);
     ASSERT_NE(loop, nullptr);
     ASSERT_NE(loop->_ifStatement, nullptr);
 
-    auto ifstatement = loop->_ifStatement.get();
+    auto ifstatement = loop->_ifStatement;
     EXPECT_EQ(ifstatement->comparator, IfStatement::Equal);
 
-    auto lhs = dynamic_cast<Int64Param*>(ifstatement->lhs.get());
+    auto lhs = node_cast<Int64Param>(ifstatement->lhs);
     ASSERT_NE(lhs, nullptr);
     EXPECT_EQ(lhs->content, 1);
 
-    auto rhs = dynamic_cast<Int64Param*>(ifstatement->rhs.get());
+    auto rhs = node_cast<Int64Param>(ifstatement->rhs);
     ASSERT_NE(rhs, nullptr);
     EXPECT_EQ(rhs->content, 1);
 
     EXPECT_TRUE(ifstatement->block->vars.empty());
     EXPECT_TRUE(ifstatement->block->statements.empty());
-    EXPECT_EQ(ifstatement->block->parent, p.block.get());
+    EXPECT_EQ(ifstatement->block->parent, p.block);
+}
+
+TEST(Parser, parse_while_statement_less_than_or_equal) {
+    ll::Arena arena;
+    std::string_view eg = R"(while (counter <= 100) {} puts("");)";
+    Parser p(arena);
+    auto loop = p.parse_loop(eg);
+    ASSERT_NE(loop, nullptr);
+    ASSERT_NE(loop->_ifStatement, nullptr);
+    EXPECT_EQ(loop->_ifStatement->comparator, IfStatement::LessThanOrEqual);
+    EXPECT_EQ(eg, R"(puts("");)");
+}
+
+TEST(Parser, parse_block_unbalanced_braces_error) {
+    ll::Arena arena;
+    Parser p(arena);
+    EXPECT_ANY_THROW(p.parse_block(R"(if (1 == 1) { puts(""); )"));
+    Parser p2(arena);
+    EXPECT_ANY_THROW(p2.parse_block(R"(puts(""); })"));
+}
+
+TEST(Parser, statement_spans) {
+    ll::Arena arena;
+    std::string_view eg = R"(a = 1 + b; if (a == 2) { puts("x"); })";
+    Parser p(arena);
+    p.parse_block(eg);
+    ASSERT_EQ(p.block->statements.size(), 2);
+
+    auto assignment = p.block->statements[0];
+    EXPECT_EQ(assignment->span.offset, 0);
+    EXPECT_EQ(assignment->span.length, 10);
+
+    auto chain = node_cast<IfChainStatement>(p.block->statements[1]);
+    ASSERT_NE(chain, nullptr);
+    EXPECT_EQ(chain->span.offset, 11);
+    EXPECT_EQ(chain->span.end(), eg.size());
+
+    auto call = node_cast<FunctionCall>(chain->_ifstatements[0]->block->statements[0]);
+    ASSERT_NE(call, nullptr);
+    EXPECT_EQ(eg.substr(call->span.offset, call->span.length), R"(puts("x");)");
+    EXPECT_EQ(eg.substr(call->params[0]->span.offset, call->params[0]->span.length), R"("x")");
 }
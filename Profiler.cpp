@@ -0,0 +1,218 @@
+//------------------------------------------------------------------------------
+// Profiler.cpp
+//------------------------------------------------------------------------------
+
+#include "Profiler.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+#include <thread>
+
+#include <sys/time.h>
+#include <ucontext.h>
+
+namespace {
+    std::atomic<ll::Profiler*> active = nullptr;
+    //handlers between loading active and finishing their record
+    std::atomic<int> handling = 0;
+
+    std::uintptr_t interrupted_address(void* context) {
+        auto uc = static_cast<ucontext_t*>(context);
+#if defined(__APPLE__)
+        return static_cast<std::uintptr_t>(uc->uc_mcontext->__ss.__rip);
+#else
+        return static_cast<std::uintptr_t>(uc->uc_mcontext.gregs[REG_RIP]);
+#endif
+    }
+
+    std::vector<ll::Profiler::Hotspot> sorted(const std::map<std::string, std::size_t>& counts) {
+        std::vector<ll::Profiler::Hotspot> hotspots;
+        for (auto& [name, samples] : counts) {
+            hotspots.push_back({.name = name, .samples = samples});
+        }
+        std::stable_sort(hotspots.begin(), hotspots.end(), [] (auto& a, auto& b) {
+            return a.samples > b.samples;
+        });
+        return hotspots;
+    }
+}
+
+ll::Profiler::Profiler(const JitModule& module, std::chrono::microseconds interval)
+: _module(module)
+, _interval(interval)
+, _functions(module.object().function_extents())
+, _samples(MaxSamples)
+{
+}
+
+ll::Profiler::~Profiler() {
+    stop();
+}
+
+void ll::Profiler::handle_signal(int, siginfo_t*, void* context) {
+    //only lock free atomics and a store into memory reserved up front, anything
+    //else isn't safe in a signal handler.
+    //SIGPROF can land on any thread, so stop() shuts down in order: disarm the
+    //timer, clear active, wait for handlers counted in handling to finish,
+    //then ignore SIGPROF so a pending one is discarded before the previous
+    //action, possibly the default that terminates, is restored. After that
+    //no handler can touch the profiler and it can be destroyed.
+    handling.fetch_add(1);
+    auto profiler = active.load();
+    if (profiler) {
+        profiler->record(reinterpret_cast<const void*>(interrupted_address(context)));
+    }
+    handling.fetch_sub(1);
+}
+
+void ll::Profiler::start() {
+    if (_running) {
+        return;
+    }
+
+    Profiler* expected = nullptr;
+    if (!active.compare_exchange_strong(expected, this)) {
+        throw std::runtime_error("A profiler is already running.");
+    }
+
+    struct sigaction action {};
+    action.sa_sigaction = handle_signal;
+    action.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, &_previous);
+
+    auto usec = static_cast<suseconds_t>(_interval.count());
+    itimerval timer{};
+    timer.it_interval.tv_sec = usec / 1000000;
+    timer.it_interval.tv_usec = usec % 1000000;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    _running = true;
+}
+
+void ll::Profiler::stop() {
+    if (!_running) {
+        return;
+    }
+
+    //in the order described in handle_signal
+    itimerval timer{};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    active.store(nullptr);
+    while (handling.load() != 0) {
+        std::this_thread::yield();
+    }
+
+    struct sigaction ignore {};
+    ignore.sa_handler = SIG_IGN;
+    sigemptyset(&ignore.sa_mask);
+    sigaction(SIGPROF, &ignore, nullptr);
+    sigaction(SIGPROF, &_previous, nullptr);
+    _running = false;
+}
+
+void ll::Profiler::record(const void* address) {
+    auto index = _taken.fetch_add(1, std::memory_order_relaxed);
+    if (index < MaxSamples) {
+        _samples[index] = reinterpret_cast<std::uintptr_t>(address);
+    }
+}
+
+std::size_t ll::Profiler::samples() const {
+    return std::min(_taken.load(), MaxSamples);
+}
+
+std::size_t ll::Profiler::dropped() const {
+    return _taken.load() - samples();
+}
+
+std::optional<ll::Profiler::Location> ll::Profiler::locate(const void* address) const {
+    auto base = reinterpret_cast<std::uintptr_t>(_module.code().address());
+    auto pc = reinterpret_cast<std::uintptr_t>(address);
+    auto codeSize = _module.object().buff.buffer().size();
+    if (pc < base || pc - base >= codeSize) {
+        return std::nullopt;
+    }
+    auto offset = pc - base;
+
+    auto function = std::upper_bound(_functions.begin(), _functions.end(), offset, [] (std::size_t offset, auto& extent) {
+        return offset < extent.offset;
+    });
+    if (function == _functions.begin()) {
+        return std::nullopt;
+    }
+    function--;
+
+    Location location{.function = function->name};
+    auto& marks = _module.object().buff._statements;
+    auto mark = std::upper_bound(marks.begin(), marks.end(), offset, [] (std::size_t offset, auto& mark) {
+        return offset < mark.location;
+    });
+    if (mark != marks.begin() && std::prev(mark)->location >= function->offset) {
+        location.statement = std::prev(mark)->statement;
+        location.line = std::prev(mark)->line;
+    }
+    return location;
+}
+
+std::vector<ll::Profiler::Hotspot> ll::Profiler::functions() const {
+    std::map<std::string, std::size_t> counts;
+    for (std::size_t i = 0; i < samples(); i++) {
+        if (auto location = locate(reinterpret_cast<const void*>(_samples[i]))) {
+            counts[std::string(location->function)]++;
+        }
+    }
+    return sorted(counts);
+}
+
+std::vector<ll::Profiler::Hotspot> ll::Profiler::statements() const {
+    std::map<std::string, std::size_t> counts;
+    for (std::size_t i = 0; i < samples(); i++) {
+        if (auto location = locate(reinterpret_cast<const void*>(_samples[i]))) {
+            auto name = std::string(location->function);
+            if (location->line) {
+                name += ":" + std::to_string(location->line);
+            } else {
+                name += location->statement ? "#" + std::to_string(location->statement) : " (entry)";
+            }
+            counts[name]++;
+        }
+    }
+    return sorted(counts);
+}
+
+void ll::Profiler::write_report(std::ostream& os) const {
+    auto flags = os.flags();
+    auto total = samples();
+
+    std::size_t attributed = 0;
+    auto functionHotspots = functions();
+    for (auto& hotspot : functionHotspots) {
+        attributed += hotspot.samples;
+    }
+
+    os << "profile: " << total << " samples every " << _interval.count() << "us, "
+       << (total - attributed) << " outside JIT code";
+    if (dropped()) {
+        os << ", " << dropped() << " dropped";
+    }
+    os << "\n";
+
+    auto table = [&os, total] (std::string_view heading, const std::vector<Hotspot>& hotspots) {
+        os << std::left << std::setw(24) << heading << std::right
+           << std::setw(10) << "samples"
+           << std::setw(10) << "percent" << "\n";
+        for (auto& hotspot : hotspots) {
+            os << std::left << std::setw(24) << hotspot.name << std::right
+               << std::setw(10) << hotspot.samples
+               << std::setw(9) << std::fixed << std::setprecision(1) << 100.0 * hotspot.samples / total << "%\n";
+        }
+    };
+
+    table("function", functionHotspots);
+    table("line", statements());
+
+    os.flags(flags);
+}
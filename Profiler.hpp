@@ -0,0 +1,83 @@
+//------------------------------------------------------------------------------
+// Profiler.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "JitModule.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <signal.h>
+
+namespace ll {
+
+//Sampling profiler for the code of a JitModule, used by --profile. While
+//running, SIGPROF is raised every interval of CPU time and the handler only
+//records the interrupted instruction pointer. Samples are attributed to a
+//function and to the source line of the statement whose code holds the
+//address afterwards, from the statement marks the compiler leaves in the
+//object. Samples outside the module, like time spent in printf, are counted
+//but not attributed. Only one profiler can run at a time.
+class Profiler {
+public:
+    //every sample is kept, later ones are dropped once this many are taken
+    static constexpr std::size_t MaxSamples = 1 << 18;
+
+    struct Location {
+        std::string_view function;
+        //0 for code ahead of the first statement
+        std::uint32_t statement = 0;
+        //0 when the object has no line information
+        std::uint32_t line = 0;
+    };
+
+    struct Hotspot {
+        std::string name;
+        std::size_t samples = 0;
+    };
+
+private:
+    const JitModule& _module;
+    std::chrono::microseconds _interval;
+    std::vector<FunctionExtent> _functions;
+    std::vector<std::uintptr_t> _samples;
+    std::atomic<std::size_t> _taken = 0;
+    bool _running = false;
+    struct sigaction _previous {};
+
+    static void handle_signal(int signal, siginfo_t* info, void* context);
+
+public:
+    explicit Profiler(const JitModule& module, std::chrono::microseconds interval = std::chrono::milliseconds(1));
+    ~Profiler();
+    Profiler(const Profiler&) = delete;
+    Profiler& operator=(const Profiler&) = delete;
+
+    void start();
+    void stop();
+    //for code that isn't run by a signal, like tests
+    void record(const void* address);
+
+    std::size_t samples() const;
+    std::size_t dropped() const;
+    //nullopt when the address is outside the module
+    std::optional<Location> locate(const void* address) const;
+
+    //most samples first. Statements are named function:line, or
+    //function#statement without line information.
+    std::vector<Hotspot> functions() const;
+    std::vector<Hotspot> statements() const;
+
+    void write_report(std::ostream& os) const;
+};
+
+}
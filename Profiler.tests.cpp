@@ -0,0 +1,140 @@
+//------------------------------------------------------------------------------
+// Profiler.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "Profiler.hpp"
+
+#include "TestPrograms.hpp"
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+using namespace ll;
+
+namespace {
+    const void* at(const JitModule& module, std::size_t offset) {
+        return static_cast<const std::byte*>(module.code().address()) + offset;
+    }
+}
+
+TEST(Profiler, locate_functions_and_statements) {
+    CodeHeap heap;
+    auto module = test::compile_module(R"(
+    fn helper() { printf("h"); }
+    fn main() {
+        int64 a;
+        a = 1;
+        if (a == 1) { helper(); }
+        helper();
+    }
+    )", heap);
+    Profiler profiler(module);
+
+    auto entry = profiler.locate(module.address("main"));
+    ASSERT_TRUE(entry.has_value());
+    EXPECT_EQ(entry->function, "main");
+    EXPECT_EQ(entry->statement, 0);
+
+    //entry marks carry the line of the function definition
+    auto& marks = module.object().buff._statements;
+    ASSERT_EQ(marks.size(), 7);
+    struct Expected {
+        std::string_view function;
+        std::uint32_t statement;
+        std::uint32_t line;
+    };
+    std::vector<Expected> expected{
+        {"helper", 0, 2}, {"helper", 1, 2},
+        {"main", 0, 3}, {"main", 1, 5}, {"main", 2, 6}, {"main", 3, 6}, {"main", 4, 7}
+    };
+    for (std::size_t i = 0; i < marks.size(); i++) {
+        EXPECT_EQ(marks[i].statement, expected[i].statement);
+        EXPECT_EQ(marks[i].line, expected[i].line);
+        std::vector<std::size_t> offsets{marks[i].location};
+        //a statement runs up to the next one in the same function
+        if (i + 1 < marks.size() && expected[i + 1].function == expected[i].function
+            && marks[i + 1].location > marks[i].location) {
+            offsets.push_back(marks[i + 1].location - 1);
+        }
+
+        for (auto offset : offsets) {
+            auto location = profiler.locate(at(module, offset));
+            ASSERT_TRUE(location.has_value());
+            EXPECT_EQ(location->function, expected[i].function);
+            EXPECT_EQ(location->line, expected[i].line);
+        }
+    }
+
+    EXPECT_FALSE(profiler.locate(nullptr).has_value());
+    EXPECT_FALSE(profiler.locate(at(module, module.object().buff.buffer().size())).has_value());
+}
+
+TEST(Profiler, report_recorded_samples) {
+    CodeHeap heap;
+    auto module = test::compile_module(R"(
+    fn helper() { printf("h"); }
+    fn main() {
+        helper();
+        helper();
+    }
+    )", heap);
+    Profiler profiler(module);
+
+    auto& marks = module.object().buff._statements;
+    ASSERT_EQ(marks.size(), 5);
+    profiler.record(at(module, marks[1].location));
+    profiler.record(at(module, marks[4].location));
+    profiler.record(at(module, marks[4].location));
+    profiler.record(nullptr);
+
+    EXPECT_EQ(profiler.samples(), 4);
+    EXPECT_EQ(profiler.dropped(), 0);
+
+    auto functions = profiler.functions();
+    ASSERT_EQ(functions.size(), 2);
+    EXPECT_EQ(functions[0].name, "main");
+    EXPECT_EQ(functions[0].samples, 2);
+    EXPECT_EQ(functions[1].name, "helper");
+
+    auto statements = profiler.statements();
+    ASSERT_EQ(statements.size(), 2);
+    EXPECT_EQ(statements[0].name, "main:5");
+    EXPECT_EQ(statements[1].name, "helper:2");
+
+    std::stringstream ss;
+    profiler.write_report(ss);
+    EXPECT_NE(ss.str().find("4 samples"), std::string::npos);
+    EXPECT_NE(ss.str().find("1 outside JIT code"), std::string::npos);
+    EXPECT_NE(ss.str().find("main:5"), std::string::npos);
+    EXPECT_NE(ss.str().find("50.0%"), std::string::npos);
+}
+
+TEST(Profiler, samples_running_code) {
+    CodeHeap heap;
+    auto module = test::compile_module(R"(
+    fn spin() {
+        int64 i;
+        i = 0;
+        while (i < 2000000) {
+            i = i + 1;
+        }
+    }
+    fn main() { spin(); }
+    )", heap);
+    auto main = module.function<void()>("main");
+
+    Profiler profiler(module);
+    Profiler other(module);
+    profiler.start();
+    EXPECT_THROW(other.start(), std::runtime_error);
+    for (int i = 0; i < 10000 && profiler.samples() < 20; i++) {
+        main();
+    }
+    profiler.stop();
+
+    ASSERT_GE(profiler.samples(), 20);
+    auto functions = profiler.functions();
+    ASSERT_FALSE(functions.empty());
+    EXPECT_EQ(functions.front().name, "spin");
+}
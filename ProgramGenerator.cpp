@@ -0,0 +1,139 @@
+//------------------------------------------------------------------------------
+// ProgramGenerator.cpp
+//------------------------------------------------------------------------------
+
+#include "ProgramGenerator.hpp"
+
+ll::ProgramGenerator::ProgramGenerator(ProgramShape shape)
+: _shape(shape)
+, _random(shape.seed)
+{
+}
+
+std::string ll::ProgramGenerator::translation_unit() {
+    _out.clear();
+
+    for (std::size_t i = 0; i < _shape.functions; i++) {
+        //odd functions call even ones and even ones call nothing, so the work
+        //of a call stays bounded however many functions there are
+        _callable = (i % 2) ? (i + 1) / 2 : 0;
+        function(i);
+    }
+
+    _out += "fn main() {\n    int64 r;\n    r = 0;\n";
+    for (std::size_t i = 0; i < _shape.functions; i++) {
+        _out += "    r = f" + std::to_string(i) + "(" + std::to_string(i) + ", r) % 1000003;\n";
+    }
+    _out += "    printf(\"%i\", r);\n    puts(\"\");\n}\n";
+
+    return std::move(_out);
+}
+
+std::string ll::ProgramGenerator::block() {
+    _out.clear();
+    _callable = 0;
+    _hasParameters = false;
+
+    locals();
+    statements(_shape.statements, 0);
+    return std::move(_out);
+}
+
+void ll::ProgramGenerator::function(std::size_t index) {
+    _hasParameters = true;
+
+    _out += "fn f" + std::to_string(index) + "(int64 a, int64 b) {\n";
+    locals();
+    statements(_shape.statements, 0);
+    _out += "    return v0 + v1 % 1000003;\n}\n\n";
+}
+
+void ll::ProgramGenerator::locals() {
+    for (std::size_t i = 0; i < Locals; i++) {
+        auto name = "v" + std::to_string(i);
+        _out += "    int64 " + name + ";\n    " + name + " = " + (_hasParameters ? (i % 2 ? "b" : "a") : std::to_string(i)) + ";\n";
+    }
+
+    //loop counters are only written by their own loop
+    for (std::size_t i = 0; i < _shape.depth; i++) {
+        _out += "    int64 c" + std::to_string(i) + ";\n";
+    }
+}
+
+void ll::ProgramGenerator::statements(std::size_t count, std::size_t depth) {
+    for (std::size_t i = 0; i < count; i++) {
+        statement(depth);
+    }
+}
+
+void ll::ProgramGenerator::statement(std::size_t depth) {
+    auto choices = depth < _shape.depth ? 4 : 2;
+
+    switch (pick(choices)) {
+        case 0:
+            indent(depth);
+            _out += local() + " = " + operand() + " + " + operand() + ";\n";
+            return;
+
+        case 1:
+            indent(depth);
+            if (_callable != 0 && depth == 0) {
+                auto callee = 2 * pick(_callable);
+                _out += local() + " = f" + std::to_string(callee) + "(" + operand() + ", " + operand() + ") % 1000003;\n";
+                return;
+            }
+            _out += local() + " = " + operand() + " % " + std::to_string(pick(9) + 2) + ";\n";
+            return;
+
+        case 2:
+            indent(depth);
+            _out += "if (" + operand() + " < " + operand() + ") {\n";
+            statements(NestedStatements, depth + 1);
+            indent(depth);
+            _out += "} else {\n";
+            statements(NestedStatements, depth + 1);
+            indent(depth);
+            _out += "}\n";
+            return;
+
+        default:
+        {
+            auto counter = "c" + std::to_string(depth);
+            indent(depth);
+            _out += counter + " = 0;\n";
+            indent(depth);
+            _out += "while (" + counter + " < " + std::to_string(LoopIterations) + ") {\n";
+            statements(NestedStatements, depth + 1);
+            indent(depth + 1);
+            _out += counter + " = " + counter + " + 1;\n";
+            indent(depth);
+            _out += "}\n";
+            return;
+        }
+    }
+}
+
+void ll::ProgramGenerator::indent(std::size_t depth) {
+    _out.append(4 * (depth + 1), ' ');
+}
+
+std::string ll::ProgramGenerator::operand() {
+    switch (pick(_hasParameters ? 3 : 2)) {
+        case 0:
+            return local();
+        case 1:
+            return std::to_string(pick(100));
+        default:
+            return pick(2) ? "a" : "b";
+    }
+}
+
+std::string ll::ProgramGenerator::local() {
+    return "v" + std::to_string(pick(Locals));
+}
+
+std::size_t ll::ProgramGenerator::pick(std::size_t count) {
+    //plain modulo rather than a distribution, those differ between standard
+    //libraries
+    return static_cast<std::size_t>(_random() % count);
+}
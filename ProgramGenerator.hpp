@@ -0,0 +1,63 @@
+//------------------------------------------------------------------------------
+// ProgramGenerator.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <random>
+#include <string>
+
+namespace ll {
+
+struct ProgramShape {
+    std::size_t functions = 1;
+    //statements in a function body
+    std::size_t statements = 16;
+    //deepest if/while nesting
+    std::size_t depth = 2;
+    std::uint64_t seed = 1;
+};
+
+//Writes synthetic littlelang programs for benchmarking. Output only depends on
+//the shape, the same seed always gives the same program. Every program
+//terminates, loops run a fixed few iterations and calls only go from the top
+//level of odd numbered functions to even numbered ones defined before them.
+class ProgramGenerator {
+public:
+    static constexpr std::size_t Locals = 4;
+    static constexpr std::size_t LoopIterations = 3;
+    //kept small so program size grows with statements rather than with depth
+    static constexpr std::size_t NestedStatements = 2;
+
+private:
+    ProgramShape _shape;
+    std::mt19937_64 _random;
+    std::string _out;
+    //even numbered functions the current body may call
+    std::size_t _callable = 0;
+    bool _hasParameters = false;
+
+public:
+    explicit ProgramGenerator(ProgramShape shape);
+
+    //functions f0..fN taking two parameters, then a main that prints a
+    //checksum of calling each of them
+    std::string translation_unit();
+    //statements of a function body without parameters or calls, declaring
+    //every variable they use
+    std::string block();
+
+private:
+    void function(std::size_t index);
+    void locals();
+    void statements(std::size_t count, std::size_t depth);
+    void statement(std::size_t depth);
+    void indent(std::size_t depth);
+    std::string operand();
+    std::string local();
+    std::size_t pick(std::size_t count);
+};
+
+}
@@ -0,0 +1,68 @@
+//------------------------------------------------------------------------------
+// ProgramGenerator.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "ProgramGenerator.hpp"
+
+#include "JitModule.hpp"
+#include "Parser.hpp"
+#include "TranslationUnit.hpp"
+
+#include <algorithm>
+
+#include <gtest/gtest.h>
+
+using namespace ll;
+
+namespace {
+    std::size_t deepest(std::string_view program) {
+        std::size_t depth = 0;
+        std::size_t deepest = 0;
+        for (auto c : program) {
+            if (c == '{') {
+                deepest = std::max(deepest, ++depth);
+            } else if (c == '}') {
+                depth--;
+            }
+        }
+        return deepest;
+    }
+}
+
+TEST(ProgramGenerator, same_seed_same_program) {
+    ProgramShape shape{.functions = 4, .statements = 32, .depth = 3, .seed = 7};
+    EXPECT_EQ(ProgramGenerator(shape).translation_unit(), ProgramGenerator(shape).translation_unit());
+
+    auto other = shape;
+    other.seed = 8;
+    EXPECT_NE(ProgramGenerator(shape).translation_unit(), ProgramGenerator(other).translation_unit());
+}
+
+TEST(ProgramGenerator, translation_unit_runs) {
+    auto program = ProgramGenerator({.functions = 16, .statements = 24, .depth = 3}).translation_unit();
+    std::string_view sv = program;
+    auto tu = TranslationUnit::parse_translation_unit(sv);
+    ASSERT_EQ(tu->functions.size(), 17);
+    EXPECT_LE(deepest(program), 4);
+
+    auto module = JitModule::finalise(Object::compile_translation_unit(*tu, Compiler_x64::Mode::JIT));
+    testing::internal::CaptureStdout();
+    module.function<void()>("main")();
+    fflush(stdout);
+    auto output = testing::internal::GetCapturedStdout();
+    EXPECT_FALSE(output.empty());
+    EXPECT_EQ(output.back(), '\n');
+}
+
+TEST(ProgramGenerator, block_parses) {
+    ProgramShape shape{.statements = 64, .depth = 4};
+    auto block = ProgramGenerator(shape).block();
+
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(block);
+    EXPECT_EQ(p.block->vars.size(), ProgramGenerator::Locals + shape.depth);
+    EXPECT_GE(p.block->statements.size(), shape.statements);
+    EXPECT_LE(deepest(block), shape.depth);
+    EXPECT_EQ(block.find("= f"), std::string::npos);
+}
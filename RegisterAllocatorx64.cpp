@@ -0,0 +1,207 @@
+//------------------------------------------------------------------------------
+// RegisterAllocatorx64.cpp
+//------------------------------------------------------------------------------
+
+#include "RegisterAllocatorx64.hpp"
+
+#include <algorithm>
+
+void RegisterAllocatorx64::allocate(const Block& function) {
+    _position = 0;
+    _loops.clear();
+    _declared.clear();
+    _liveness.clear();
+    _intervals.clear();
+    _assigned.clear();
+    _used.clear();
+
+    //parameters are live from the moment the function is entered
+    for (size_t i = 0; i < function.parameters; i++) {
+        use(function, function.vars[i].name);
+    }
+
+    visit_block(function);
+    build_intervals();
+    linear_scan();
+}
+
+std::optional<InstrBufferx64::Register> RegisterAllocatorx64::register_for(const VariableDefinition* variable) const {
+    auto it = _assigned.find(variable);
+    if (it == _assigned.end()) {
+        return std::nullopt;
+    }
+    return it->second;
+}
+
+const VariableDefinition* RegisterAllocatorx64::resolve(const Block& block, std::string_view name) {
+    return block.find_variable(name);
+}
+
+void RegisterAllocatorx64::visit_block(const Block& block) {
+    for (auto& var : block.vars) {
+        _declared[&var] = _position;
+    }
+
+    for (auto statement : block.statements) {
+        _position++;
+
+        switch (statement->kind) {
+            case NodeKind::FunctionCall:
+                for (auto param : static_cast<const FunctionCall*>(statement)->params) {
+                    visit_param(block, param);
+                }
+                break;
+
+            case NodeKind::VariableAssignment:
+            {
+                auto assign = static_cast<const VariableAssignment*>(statement);
+                visit_param(block, assign->value);
+                use(block, assign->to.content);
+                break;
+            }
+
+            case NodeKind::IfChainStatement:
+                for (auto ifStatement : static_cast<const IfChainStatement*>(statement)->_ifstatements) {
+                    visit_if(block, *ifStatement);
+                }
+                break;
+
+            case NodeKind::ReturnStatement:
+                visit_param(block, static_cast<const ReturnStatement*>(statement)->value);
+                break;
+
+            case NodeKind::LoopStatement:
+            {
+                Loop loop{.start = _position, .end = 0};
+                visit_if(block, *static_cast<const LoopStatement*>(statement)->_ifStatement);
+                loop.end = ++_position;
+                _loops.push_back(loop);
+                break;
+            }
+
+            default:
+                break;
+        }
+    }
+}
+
+void RegisterAllocatorx64::visit_if(const Block& scope, const IfStatement& ifStatement) {
+    visit_param(scope, ifStatement.lhs);
+    visit_param(scope, ifStatement.rhs);
+    _position++;
+    visit_block(*ifStatement.block);
+}
+
+void RegisterAllocatorx64::visit_param(const Block& scope, const Param* param) {
+    if (param == nullptr) {
+        return;
+    }
+
+    switch (param->kind) {
+        case NodeKind::StackVariableParam:
+            use(scope, static_cast<const StackVariableParam*>(param)->content);
+            break;
+
+        case NodeKind::StatementParam:
+        {
+            auto statement = static_cast<const StatementParam*>(param)->statement;
+            if (auto calc = node_cast<const Int64Calcuation>(statement)) {
+                visit_param(scope, calc->lhs);
+                visit_param(scope, calc->rhs);
+            } else if (auto call = node_cast<const FunctionCall>(statement)) {
+                for (auto callParam : call->params) {
+                    visit_param(scope, callParam);
+                }
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+void RegisterAllocatorx64::use(const Block& scope, std::string_view name) {
+    auto variable = resolve(scope, name);
+    if (variable == nullptr) {
+        //reported by the compiler when it looks up the stack location
+        return;
+    }
+
+    auto [it, inserted] = _liveness.try_emplace(variable, Interval{
+        .variable = variable,
+        .start = _position,
+        .end = _position
+    });
+
+    if (!inserted) {
+        it->second.start = std::min(it->second.start, _position);
+        it->second.end = std::max(it->second.end, _position);
+    }
+}
+
+void RegisterAllocatorx64::build_intervals() {
+    for (auto& [variable, interval] : _liveness) {
+        auto declared = _declared[variable];
+        for (auto& loop : _loops) {
+            bool overlaps = interval.start <= loop.end && interval.end >= loop.start;
+            if (overlaps && declared < loop.start) {
+                interval.start = std::min(interval.start, loop.start);
+                interval.end = std::max(interval.end, loop.end);
+            }
+        }
+        _intervals.push_back(interval);
+    }
+
+    std::sort(_intervals.begin(), _intervals.end(), [this] (const Interval& a, const Interval& b) {
+        if (a.start != b.start) {
+            return a.start < b.start;
+        }
+        //keep the order stable across runs for identical starts
+        return _declared[a.variable] != _declared[b.variable]
+            ? _declared[a.variable] < _declared[b.variable]
+            : a.variable < b.variable;
+    });
+}
+
+void RegisterAllocatorx64::linear_scan() {
+    std::vector<InstrBufferx64::Register> free(CalleeSaved.rbegin(), CalleeSaved.rend());
+    std::vector<const Interval*> active;
+
+    for (auto& interval : _intervals) {
+        //expire intervals that finished before this one starts
+        std::erase_if(active, [&] (const Interval* a) {
+            if (a->end < interval.start) {
+                free.push_back(_assigned[a->variable]);
+                return true;
+            }
+            return false;
+        });
+
+        if (!free.empty()) {
+            _assigned[interval.variable] = free.back();
+            free.pop_back();
+            active.push_back(&interval);
+            continue;
+        }
+
+        //no register left, spill whichever interval ends last
+        auto furthest = std::max_element(active.begin(), active.end(), [] (auto a, auto b) {
+            return a->end < b->end;
+        });
+        if ((*furthest)->end > interval.end) {
+            _assigned[interval.variable] = _assigned[(*furthest)->variable];
+            _assigned.erase((*furthest)->variable);
+            *furthest = &interval;
+        }
+    }
+
+    for (auto reg : CalleeSaved) {
+        bool used = std::any_of(_assigned.begin(), _assigned.end(), [reg] (auto& a) {
+            return a.second == reg;
+        });
+        if (used) {
+            _used.push_back(reg);
+        }
+    }
+}
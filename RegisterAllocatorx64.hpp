@@ -0,0 +1,68 @@
+//------------------------------------------------------------------------------
+// RegisterAllocatorx64.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "InstrBufferx64.hpp"
+#include "Statement.hpp"
+
+#include <array>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+//Linear scan allocation of int64 variables to callee saved registers. Positions
+//are statement numbers in a pre-order walk of a function body. Variables that
+//are live across a loop have their interval stretched over the whole loop so
+//the back edge keeps them in the same register.
+class RegisterAllocatorx64 {
+public:
+    static constexpr std::array<InstrBufferx64::Register, 5> CalleeSaved = {
+        InstrBufferx64::Register::RBX,
+        InstrBufferx64::Register::R12,
+        InstrBufferx64::Register::R13,
+        InstrBufferx64::Register::R14,
+        InstrBufferx64::Register::R15,
+    };
+
+    struct Interval {
+        const VariableDefinition* variable;
+        size_t start;
+        size_t end;
+    };
+
+private:
+    struct Loop {
+        size_t start;
+        size_t end;
+    };
+
+    size_t _position = 0;
+    std::vector<Loop> _loops;
+    std::unordered_map<const VariableDefinition*, size_t> _declared;
+    std::unordered_map<const VariableDefinition*, Interval> _liveness;
+    std::vector<Interval> _intervals;
+    std::unordered_map<const VariableDefinition*, InstrBufferx64::Register> _assigned;
+    std::vector<InstrBufferx64::Register> _used;
+
+public:
+    void allocate(const Block& function);
+
+    std::optional<InstrBufferx64::Register> register_for(const VariableDefinition* variable) const;
+    const std::vector<Interval>& intervals() const { return _intervals; }
+
+    //callee saved registers that were handed out, in CalleeSaved order
+    const std::vector<InstrBufferx64::Register>& used_registers() const { return _used; }
+
+    static const VariableDefinition* resolve(const Block& block, std::string_view name);
+
+private:
+    void visit_block(const Block& block);
+    void visit_if(const Block& scope, const IfStatement& ifStatement);
+    void visit_param(const Block& scope, const Param* param);
+    void use(const Block& scope, std::string_view name);
+
+    void build_intervals();
+    void linear_scan();
+};
@@ -0,0 +1,167 @@
+//------------------------------------------------------------------------------
+// RegisterAllocatorx64.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "RegisterAllocatorx64.hpp"
+
+#include "Parser.hpp"
+
+#include <algorithm>
+#include <set>
+
+#include <gtest/gtest.h>
+
+namespace {
+    const RegisterAllocatorx64::Interval* find_interval(const RegisterAllocatorx64& allocator, std::string_view name) {
+        auto& intervals = allocator.intervals();
+        auto it = std::find_if(intervals.begin(), intervals.end(), [name] (auto& i) {
+            return i.variable->name == name;
+        });
+        return it == intervals.end() ? nullptr : &*it;
+    }
+}
+
+TEST(RegisterAllocatorx64, straight_line_reuses_register) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    int64 a;
+    a = 1;
+    printf("%i", a);
+    int64 b;
+    b = 2;
+    printf("%i", b);
+    )");
+
+    RegisterAllocatorx64 allocator;
+    allocator.allocate(*p.block);
+
+    auto a = allocator.register_for(&p.block->vars[0]);
+    auto b = allocator.register_for(&p.block->vars[1]);
+    ASSERT_TRUE(a.has_value());
+    ASSERT_TRUE(b.has_value());
+    EXPECT_EQ(*a, InstrBufferx64::Register::RBX);
+    EXPECT_EQ(*a, *b);
+    EXPECT_EQ(allocator.used_registers(), std::vector<InstrBufferx64::Register>({InstrBufferx64::Register::RBX}));
+}
+
+TEST(RegisterAllocatorx64, loop_extends_outer_variable) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    int64 counter;
+    counter = 1;
+    while (counter < 10) {
+        int64 inner;
+        inner = counter % 3;
+        printf("%i", inner);
+        counter = counter + 1;
+    }
+    )");
+
+    RegisterAllocatorx64 allocator;
+    allocator.allocate(*p.block);
+
+    auto counter = find_interval(allocator, "counter");
+    auto inner = find_interval(allocator, "inner");
+    ASSERT_NE(counter, nullptr);
+    ASSERT_NE(inner, nullptr);
+
+    //the loop body ends after the last statement that uses counter
+    EXPECT_GT(counter->end, inner->end);
+    EXPECT_LE(counter->start, inner->start);
+
+    auto counterReg = allocator.register_for(counter->variable);
+    auto innerReg = allocator.register_for(inner->variable);
+    ASSERT_TRUE(counterReg.has_value());
+    ASSERT_TRUE(innerReg.has_value());
+    EXPECT_NE(*counterReg, *innerReg);
+}
+
+TEST(RegisterAllocatorx64, resolve_through_parent) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    int64 a;
+    a = 1;
+    if (a == 1) {
+        int64 b;
+        b = a;
+    }
+    )");
+
+    auto chain = node_cast<IfChainStatement>(p.block->statements[1]);
+    ASSERT_NE(chain, nullptr);
+    auto inner = chain->_ifstatements[0]->block;
+
+    EXPECT_EQ(RegisterAllocatorx64::resolve(*inner, "a"), &p.block->vars[0]);
+    EXPECT_EQ(RegisterAllocatorx64::resolve(*inner, "b"), &inner->vars[0]);
+    EXPECT_EQ(RegisterAllocatorx64::resolve(*p.block, "b"), nullptr);
+}
+
+TEST(RegisterAllocatorx64, spills_when_out_of_registers) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    int64 a;
+    int64 b;
+    int64 c;
+    int64 d;
+    int64 e;
+    int64 f;
+    a = 1;
+    b = 2;
+    c = 3;
+    d = 4;
+    e = 5;
+    f = 6;
+    printf("%i", f);
+    printf("%i", e);
+    printf("%i", d);
+    printf("%i", c);
+    printf("%i", b);
+    printf("%i", a);
+    )");
+
+    RegisterAllocatorx64 allocator;
+    allocator.allocate(*p.block);
+
+    std::set<InstrBufferx64::Register> registers;
+    size_t spilled = 0;
+    for (auto& var : p.block->vars) {
+        if (auto reg = allocator.register_for(&var)) {
+            registers.insert(*reg);
+        } else {
+            spilled++;
+        }
+    }
+
+    //a lives the longest so it gives up its register
+    EXPECT_EQ(spilled, 1);
+    EXPECT_FALSE(allocator.register_for(&p.block->vars[0]).has_value());
+    EXPECT_EQ(registers.size(), RegisterAllocatorx64::CalleeSaved.size());
+    EXPECT_EQ(allocator.used_registers().size(), RegisterAllocatorx64::CalleeSaved.size());
+}
+
+TEST(RegisterAllocatorx64, parameters_live_from_entry) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    int64 a;
+    int64 b;
+    b = 1;
+    printf("%i", b);
+    printf("%i", a);
+    )");
+    p.block->parameters = 1;
+
+    RegisterAllocatorx64 allocator;
+    allocator.allocate(*p.block);
+
+    //a arrives in a register so it can't share with b
+    auto a = allocator.register_for(&p.block->vars[0]);
+    auto b = allocator.register_for(&p.block->vars[1]);
+    ASSERT_TRUE(a.has_value());
+    ASSERT_TRUE(b.has_value());
+    EXPECT_NE(*a, *b);
+}
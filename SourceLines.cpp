@@ -0,0 +1,28 @@
+//------------------------------------------------------------------------------
+// SourceLines.cpp
+//------------------------------------------------------------------------------
+
+#include "SourceLines.hpp"
+
+#include <algorithm>
+
+ll::SourceLines::SourceLines(std::string_view source) {
+    _starts.push_back(0);
+    for (std::size_t i = 0; i < source.size(); i++) {
+        if (source[i] == '\n') {
+            _starts.push_back(static_cast<std::uint32_t>(i + 1));
+        }
+    }
+}
+
+std::uint32_t ll::SourceLines::line(std::uint32_t offset) const {
+    if (_starts.empty()) {
+        return 0;
+    }
+    return static_cast<std::uint32_t>(std::upper_bound(_starts.begin(), _starts.end(), offset) - _starts.begin());
+}
+
+std::uint32_t ll::SourceLines::column(std::uint32_t offset) const {
+    auto at = line(offset);
+    return at == 0 ? 0 : offset - _starts[at - 1] + 1;
+}
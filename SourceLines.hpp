@@ -0,0 +1,37 @@
+//------------------------------------------------------------------------------
+// SourceLines.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace ll {
+
+//Bytes of the source an AST node was parsed from, counted from the start of
+//the translation unit.
+struct SourceSpan {
+    std::uint32_t offset = 0;
+    std::uint32_t length = 0;
+
+    std::uint32_t end() const { return offset + length; }
+};
+
+//Start of every line of a source text, maps offsets to 1 based lines and
+//columns.
+class SourceLines {
+private:
+    std::vector<std::uint32_t> _starts;
+
+public:
+    SourceLines() = default;
+    explicit SourceLines(std::string_view source);
+
+    std::uint32_t line(std::uint32_t offset) const;
+    std::uint32_t column(std::uint32_t offset) const;
+    std::size_t size() const { return _starts.size(); }
+};
+
+}
@@ -0,0 +1,34 @@
+//------------------------------------------------------------------------------
+// SourceLines.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "SourceLines.hpp"
+
+#include <gtest/gtest.h>
+
+using namespace ll;
+
+TEST(SourceLines, lines_and_columns) {
+    SourceLines lines("ab\ncd\n\nef");
+    EXPECT_EQ(lines.size(), 4);
+
+    EXPECT_EQ(lines.line(0), 1);
+    EXPECT_EQ(lines.column(0), 1);
+    EXPECT_EQ(lines.line(2), 1);
+    EXPECT_EQ(lines.column(2), 3);
+    EXPECT_EQ(lines.line(3), 2);
+    EXPECT_EQ(lines.column(4), 2);
+    EXPECT_EQ(lines.line(6), 3);
+    EXPECT_EQ(lines.line(8), 4);
+    EXPECT_EQ(lines.column(8), 2);
+}
+
+TEST(SourceLines, empty) {
+    SourceLines none;
+    EXPECT_EQ(none.line(5), 0);
+    EXPECT_EQ(none.column(5), 0);
+
+    SourceLines empty("");
+    EXPECT_EQ(empty.size(), 1);
+    EXPECT_EQ(empty.line(0), 1);
+}
@@ -1,23 +1,62 @@
-
 //------------------------------------------------------------------------------
 // Statement.hpp
 //------------------------------------------------------------------------------
 
 #pragma once
 
+#include "SourceLines.hpp"
 #include "Variables.hpp"
 
 #include <cstdint>
-#include <memory>
-#include <string>
+#include <memory_resource>
+#include <string_view>
 #include <vector>
 
+// AST nodes are allocated from an ll::Arena and are never individually freed.
+// Ownership is held by the arena, links between nodes are plain pointers.
+// Node types form a closed set identified by NodeKind; dispatch is a switch on
+// the kind and node_cast<T> is the checked downcast. Every node records the
+// span of source it was parsed from.
+
+enum class NodeKind : std::uint8_t {
+    StringParam,
+    Int64Param,
+    StatementParam,
+    StackVariableParam,
+    FunctionCall,
+    VariableAssignment,
+    Int64Calcuation,
+    IfStatement,
+    IfChainStatement,
+    LoopStatement,
+    ReturnStatement,
+};
+
 struct Statement;
 
 struct Block {
-    std::vector<VariableDefinition> vars;
-    std::vector<std::unique_ptr<Statement>> statements;
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    std::pmr::vector<VariableDefinition> vars;
+    std::pmr::vector<Statement*> statements;
     Block* parent = nullptr;
+    //function blocks only, the leading vars are the parameters in call order
+    size_t parameters = 0;
+
+    Block(const allocator_type& alloc = {})
+    : vars(alloc)
+    , statements(alloc)
+    {}
+
+    //searches this block then its parents, innermost definition wins
+    const VariableDefinition* find_variable(std::string_view name) const {
+        for (auto& var : vars) {
+            if (var.name == name) {
+                return &var;
+            }
+        }
+        return parent ? parent->find_variable(name) : nullptr;
+    }
 
     size_t stack_size_aligned() const {
         size_t size = vars.size() * 8;
@@ -28,64 +67,96 @@ struct Block {
 
 
 struct Statement {
-    virtual ~Statement() = default;
+    const NodeKind kind;
+    ll::SourceSpan span;
+
+protected:
+    Statement(NodeKind k) : kind(k) {}
 };
 
 struct Param {
-    virtual ~Param() = default;
+    const NodeKind kind;
+    ll::SourceSpan span;
+
+protected:
+    Param(NodeKind k) : kind(k) {}
 };
-typedef std::unique_ptr<Param> ParamPtr;
+typedef Param* ParamPtr;
+
+template<typename T, typename Node>
+T* node_cast(Node* node) {
+    return (node != nullptr && node->kind == T::Kind) ? static_cast<T*>(node) : nullptr;
+}
 
 struct StringParam : public Param {
-    virtual ~StringParam() = default;
+    static constexpr NodeKind Kind = NodeKind::StringParam;
+
+    StringParam() : Param(Kind) {}
 
-    std::string content;
+    std::string_view content;
 };
 
 struct Int64Param : public Param {
-    virtual ~Int64Param() = default;
+    static constexpr NodeKind Kind = NodeKind::Int64Param;
 
-    std::int64_t content;
+    Int64Param() : Param(Kind) {}
+
+    std::int64_t content = 0;
 };
 
+//an Int64Calcuation or a FunctionCall whose result is used as a value
 struct StatementParam : public Param {
-    virtual ~StatementParam() = default;
+    static constexpr NodeKind Kind = NodeKind::StatementParam;
+
+    StatementParam() : Param(Kind) {}
 
-    std::unique_ptr<Statement> statement;
+    Statement* statement = nullptr;
 };
 
 struct StackVariableParam : public Param {
-    virtual ~StackVariableParam() = default;
-    std::string content;
+    static constexpr NodeKind Kind = NodeKind::StackVariableParam;
+
+    StackVariableParam() : Param(Kind) {}
+
+    std::string_view content;
 };
 
 struct FunctionCall : public Statement {
-    virtual ~FunctionCall() = default;
+    static constexpr NodeKind Kind = NodeKind::FunctionCall;
+
+    using allocator_type = std::pmr::polymorphic_allocator<>;
 
-    std::string functionName;
-    std::vector<std::unique_ptr<Param>> params;
+    FunctionCall(const allocator_type& alloc = {})
+    : Statement(Kind)
+    , params(alloc)
+    {}
+
+    std::string_view functionName;
+    std::pmr::vector<Param*> params;
 };
-typedef std::unique_ptr<FunctionCall> FunctionCallPtr;
+typedef FunctionCall* FunctionCallPtr;
 
 struct VariableAssignment : public Statement {
-    virtual ~VariableAssignment() = default;
+    static constexpr NodeKind Kind = NodeKind::VariableAssignment;
+
+    VariableAssignment() : Statement(Kind) {}
 
     StackVariableParam to;
-    std::unique_ptr<Param> value;
+    Param* value = nullptr;
 };
-typedef std::unique_ptr<VariableAssignment> VariableAssignmentPtr;
+typedef VariableAssignment* VariableAssignmentPtr;
 
 struct Int64Calcuation : public Statement {
-    virtual ~Int64Calcuation() = default;
+    static constexpr NodeKind Kind = NodeKind::Int64Calcuation;
 
-    enum Operation {
+    Int64Calcuation() : Statement(Kind) {}
+
+    enum Operation : std::uint8_t {
         Unknown,
         Addition,
         Modulo
     } operation = Unknown;
 
-    static constexpr std::string_view operatorSymbols = "+%";
-
     inline void set_op_from_char(char op) {
         switch (op) {
             case '+':
@@ -100,14 +171,16 @@ struct Int64Calcuation : public Statement {
         }
     }
 
-    std::unique_ptr<Param> lhs;
-    std::unique_ptr<Param> rhs;
+    Param* lhs = nullptr;
+    Param* rhs = nullptr;
 };
 
 struct IfStatement : public Statement {
-    virtual ~IfStatement() = default;
+    static constexpr NodeKind Kind = NodeKind::IfStatement;
 
-    enum Comparator {
+    IfStatement() : Statement(Kind) {}
+
+    enum Comparator : std::uint8_t {
         None,
         Equal,
         NotEqual,
@@ -116,49 +189,41 @@ struct IfStatement : public Statement {
         GreaterThan,
         GreaterThanOrEqual,
     } comparator = None;
-    std::unique_ptr<Param> lhs;
-    std::unique_ptr<Param> rhs;
-    std::unique_ptr<Block> block;
-
-    static constexpr std::string_view comparatorSymbols = "=!<>";
-
-    inline size_t set_cmp_from_sv(std::string_view op) {
-        if (op.starts_with("==")) {
-            comparator = Equal;
-            return 2;
-        } else if (op.starts_with("!=")) {
-            comparator = NotEqual;
-            return 2;
-        } else if (op.starts_with("<")) {
-            comparator = LessThan;
-            return 1;
-        } else if (op.starts_with("<=")) {
-            comparator = LessThanOrEqual;
-            return 2;
-        } else if (op.starts_with(">")) {
-            comparator = GreaterThan;
-            return 1;
-        } else if (op.starts_with(">=")) {
-            comparator = GreaterThanOrEqual;
-            return 2;
-        } else {
-            throw std::runtime_error("unknown comparator");
-            return 0;
-        }
-    }
+    Param* lhs = nullptr;
+    Param* rhs = nullptr;
+    Block* block = nullptr;
 };
-typedef std::unique_ptr<IfStatement> IfStatementPtr;
+typedef IfStatement* IfStatementPtr;
 
 struct IfChainStatement : public Statement {
-    virtual ~IfChainStatement() = default;
+    static constexpr NodeKind Kind = NodeKind::IfChainStatement;
 
-    std::vector<std::unique_ptr<IfStatement>> _ifstatements;
+    using allocator_type = std::pmr::polymorphic_allocator<>;
+
+    IfChainStatement(const allocator_type& alloc = {})
+    : Statement(Kind)
+    , _ifstatements(alloc)
+    {}
+
+    std::pmr::vector<IfStatement*> _ifstatements;
 };
-typedef std::unique_ptr<IfChainStatement> IfChainStatementPtr;
+typedef IfChainStatement* IfChainStatementPtr;
 
 struct LoopStatement : public Statement {
-    virtual ~LoopStatement() = default;
+    static constexpr NodeKind Kind = NodeKind::LoopStatement;
+
+    LoopStatement() : Statement(Kind) {}
+
+    IfStatement* _ifStatement = nullptr;
+};
+typedef LoopStatement* LoopStatementPtr;
+
+struct ReturnStatement : public Statement {
+    static constexpr NodeKind Kind = NodeKind::ReturnStatement;
+
+    ReturnStatement() : Statement(Kind) {}
 
-    std::unique_ptr<IfStatement> _ifStatement;
+    //returned in rax, nullptr when nothing is returned
+    Param* value = nullptr;
 };
-typedef std::unique_ptr<LoopStatement> LoopStatementPtr;
\ No newline at end of file
+typedef ReturnStatement* ReturnStatementPtr;
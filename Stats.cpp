@@ -0,0 +1,128 @@
+//------------------------------------------------------------------------------
+// Stats.cpp
+//------------------------------------------------------------------------------
+
+#include "Stats.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+
+namespace {
+    std::atomic<bool> tracking = false;
+    std::atomic<std::uint64_t> allocations = 0;
+    std::atomic<std::int64_t> liveBytes = 0;
+    std::atomic<std::int64_t> peakBytes = 0;
+}
+
+ll::Stats::Scope::Scope(Stats* stats, std::string_view name)
+: _stats(stats)
+{
+    if (_stats == nullptr) {
+        return;
+    }
+
+    _phase.name = name;
+    _allocations = allocations.load(std::memory_order_relaxed);
+    _live = liveBytes.load(std::memory_order_relaxed);
+    peakBytes.store(_live, std::memory_order_relaxed);
+    _start = std::chrono::steady_clock::now();
+}
+
+ll::Stats::Scope::~Scope() {
+    if (_stats == nullptr) {
+        return;
+    }
+
+    _phase.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+    _phase.allocations = allocations.load(std::memory_order_relaxed) - _allocations;
+    _phase.peakBytes = static_cast<std::size_t>(std::max<std::int64_t>(0, peakBytes.load(std::memory_order_relaxed) - _live));
+    _stats->_phases.push_back(std::move(_phase));
+}
+
+void ll::Stats::count(std::string_view name, std::uint64_t value) {
+    auto it = std::find_if(_counters.begin(), _counters.end(), [name] (auto& counter) {
+        return counter.first == name;
+    });
+
+    if (it == _counters.end()) {
+        _counters.emplace_back(name, value);
+    } else {
+        it->second = value;
+    }
+}
+
+std::optional<std::uint64_t> ll::Stats::counter(std::string_view name) const {
+    for (auto& counter : _counters) {
+        if (counter.first == name) {
+            return counter.second;
+        }
+    }
+    return std::nullopt;
+}
+
+void ll::Stats::write_text(std::ostream& os) const {
+    auto flags = os.flags();
+
+    os << std::left << std::setw(16) << "phase" << std::right
+       << std::setw(12) << "time (ms)"
+       << std::setw(14) << "allocations"
+       << std::setw(14) << "peak bytes" << "\n";
+
+    for (auto& phase : _phases) {
+        os << std::left << std::setw(16) << phase.name << std::right
+           << std::setw(12) << std::fixed << std::setprecision(3) << phase.seconds * 1000.0
+           << std::setw(14) << phase.allocations
+           << std::setw(14) << phase.peakBytes << "\n";
+    }
+
+    for (auto& [name, value] : _counters) {
+        os << std::left << std::setw(16) << name << std::right << std::setw(12) << value << "\n";
+    }
+
+    os.flags(flags);
+}
+
+void ll::Stats::write_json(std::ostream& os) const {
+    //names are plain identifiers so nothing needs escaping
+    auto flags = os.flags();
+
+    os << "{\"phases\":[";
+    for (std::size_t i = 0; i < _phases.size(); i++) {
+        auto& phase = _phases[i];
+        os << (i ? "," : "")
+           << "{\"name\":\"" << phase.name << "\""
+           << ",\"seconds\":" << std::scientific << std::setprecision(6) << phase.seconds
+           << ",\"allocations\":" << phase.allocations
+           << ",\"peak_bytes\":" << phase.peakBytes << "}";
+    }
+
+    os << "],\"counters\":{";
+    for (std::size_t i = 0; i < _counters.size(); i++) {
+        os << (i ? "," : "") << "\"" << _counters[i].first << "\":" << _counters[i].second;
+    }
+    os << "}}\n";
+
+    os.flags(flags);
+}
+
+void ll::Stats::track_allocations(bool enable) {
+    tracking.store(enable, std::memory_order_relaxed);
+}
+
+bool ll::Stats::tracking_allocations() {
+    return tracking.load(std::memory_order_relaxed);
+}
+
+void ll::Stats::allocated(std::size_t bytes) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    auto live = liveBytes.fetch_add(static_cast<std::int64_t>(bytes), std::memory_order_relaxed) + static_cast<std::int64_t>(bytes);
+
+    auto peak = peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+void ll::Stats::freed(std::size_t bytes) {
+    liveBytes.fetch_sub(static_cast<std::int64_t>(bytes), std::memory_order_relaxed);
+}
@@ -0,0 +1,70 @@
+//------------------------------------------------------------------------------
+// Stats.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ll {
+
+//Wall time, heap allocations and peak heap growth of each compiler phase plus
+//named counts, reported by --stats. Heap figures rely on the executable's
+//global operator new and delete reporting to allocated() and freed() while
+//tracking is on, without that they stay at zero. Phases don't nest.
+class Stats {
+public:
+    struct Phase {
+        std::string name;
+        double seconds = 0;
+        std::size_t allocations = 0;
+        //largest growth of live heap bytes over the phase
+        std::size_t peakBytes = 0;
+    };
+
+    //records its phase when destroyed
+    class Scope {
+        Stats* _stats;
+        Phase _phase;
+        std::chrono::steady_clock::time_point _start;
+        std::uint64_t _allocations;
+        std::int64_t _live;
+
+    public:
+        Scope(Stats* stats, std::string_view name);
+        ~Scope();
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+    };
+
+private:
+    std::vector<Phase> _phases;
+    std::vector<std::pair<std::string, std::uint64_t>> _counters;
+
+public:
+    //a null stats gives a scope that records nothing, so callers can time
+    //phases unconditionally
+    static Scope phase(Stats* stats, std::string_view name) { return Scope(stats, name); }
+
+    //sets a counter, kept in the order first set
+    void count(std::string_view name, std::uint64_t value);
+    std::optional<std::uint64_t> counter(std::string_view name) const;
+    const std::vector<Phase>& phases() const { return _phases; }
+
+    void write_text(std::ostream& os) const;
+    void write_json(std::ostream& os) const;
+
+    static void track_allocations(bool enable);
+    static bool tracking_allocations();
+    static void allocated(std::size_t bytes);
+    static void freed(std::size_t bytes);
+};
+
+}
@@ -0,0 +1,92 @@
+//------------------------------------------------------------------------------
+// Stats.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "Stats.hpp"
+
+#include "Linker.hpp"
+#include "TranslationUnit.hpp"
+
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+using namespace ll;
+
+TEST(Stats, phase_records_allocations) {
+    Stats stats;
+    Stats::track_allocations(true);
+    {
+        auto phase = Stats::phase(&stats, "parse");
+        //the test binary's operator new doesn't report, so feed it directly
+        Stats::allocated(100);
+        Stats::allocated(50);
+        Stats::freed(100);
+        Stats::allocated(20);
+    }
+    Stats::freed(70);
+    Stats::track_allocations(false);
+
+    ASSERT_EQ(stats.phases().size(), 1);
+    auto& phase = stats.phases().front();
+    EXPECT_EQ(phase.name, "parse");
+    EXPECT_GE(phase.seconds, 0.0);
+    EXPECT_EQ(phase.allocations, 3);
+    EXPECT_EQ(phase.peakBytes, 150);
+}
+
+TEST(Stats, null_stats_records_nothing) {
+    auto phase = Stats::phase(nullptr, "parse");
+    SUCCEED();
+}
+
+TEST(Stats, counters_keep_first_set_order) {
+    Stats stats;
+    stats.count("statements", 10);
+    stats.count("fixups", 2);
+    stats.count("statements", 12);
+
+    EXPECT_EQ(stats.counter("statements"), 12);
+    EXPECT_EQ(stats.counter("fixups"), 2);
+    EXPECT_FALSE(stats.counter("missing").has_value());
+
+    std::stringstream json;
+    stats.write_json(json);
+    EXPECT_EQ(json.str(), "{\"phases\":[],\"counters\":{\"statements\":12,\"fixups\":2}}\n");
+}
+
+TEST(Stats, text_and_json_reports) {
+    Stats stats;
+    {
+        auto phase = Stats::phase(&stats, "compile");
+    }
+    stats.count("emitted_bytes", 64);
+
+    std::stringstream text;
+    stats.write_text(text);
+    EXPECT_NE(text.str().find("compile"), std::string::npos);
+    EXPECT_NE(text.str().find("emitted_bytes"), std::string::npos);
+
+    std::stringstream json;
+    stats.write_json(json);
+    EXPECT_EQ(json.str().rfind("{\"phases\":[{\"name\":\"compile\",\"seconds\":", 0), 0);
+    EXPECT_NE(json.str().find("\"allocations\":0,\"peak_bytes\":0}],\"counters\":{\"emitted_bytes\":64}}"), std::string::npos);
+}
+
+TEST(Stats, compile_translation_unit_phases) {
+    std::string_view program = R"(
+    fn helper() { printf("h"); }
+    fn main() { helper(); helper(); }
+    )";
+    auto tu = TranslationUnit::parse_translation_unit(program);
+    EXPECT_EQ(tu->statement_count(), 3);
+
+    Stats stats;
+    auto object = Object::compile_translation_unit(*tu, Compiler_x64::Mode::ObjectFile, nullptr, nullptr, &stats);
+
+    ASSERT_EQ(stats.phases().size(), 2);
+    EXPECT_EQ(stats.phases()[0].name, "compile");
+    EXPECT_EQ(stats.phases()[1].name, "relocate");
+    EXPECT_EQ(stats.counter("fixups"), 2);
+    EXPECT_EQ(object.buff._externFuncs.size(), 1);
+}
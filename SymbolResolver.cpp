@@ -0,0 +1,49 @@
+//------------------------------------------------------------------------------
+// SymbolResolver.cpp
+//------------------------------------------------------------------------------
+
+#include "SymbolResolver.hpp"
+
+#include <dlfcn.h>
+#include <stdexcept>
+
+SymbolResolver::SymbolResolver() {
+    _handle = dlopen(nullptr, RTLD_NOW);
+    if (_handle == nullptr) {
+        throw std::runtime_error("Unable to open process for symbol lookup.");
+    }
+}
+
+SymbolResolver::~SymbolResolver() {
+    dlclose(_handle);
+}
+
+SymbolResolver& SymbolResolver::process() {
+    static SymbolResolver resolver;
+    return resolver;
+}
+
+void* SymbolResolver::resolve(std::string_view name) {
+    std::lock_guard lock(_mutex);
+
+    auto it = _symbols.find(name);
+    if (it != _symbols.end()) {
+        return it->second;
+    }
+
+    _lookups++;
+    std::string symbol(name);
+    void* address = dlsym(_handle, symbol.c_str());
+    _symbols.emplace(std::move(symbol), address);
+    return address;
+}
+
+size_t SymbolResolver::lookup_count() {
+    std::lock_guard lock(_mutex);
+    return _lookups;
+}
+
+size_t SymbolResolver::cached_count() {
+    std::lock_guard lock(_mutex);
+    return _symbols.size();
+}
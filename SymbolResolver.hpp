@@ -0,0 +1,43 @@
+//------------------------------------------------------------------------------
+// SymbolResolver.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+//Looks up the address of functions in the running process for JIT calls. The
+//process handle is opened once and every name is resolved with dlsym at most
+//once, misses included. Safe to share between threads.
+class SymbolResolver {
+private:
+    struct Hash {
+        using is_transparent = void;
+        size_t operator()(std::string_view sv) const { return std::hash<std::string_view>{}(sv); }
+    };
+
+    void* _handle = nullptr;
+    std::mutex _mutex;
+    std::unordered_map<std::string, void*, Hash, std::equal_to<>> _symbols;
+    size_t _lookups = 0;
+
+public:
+    SymbolResolver();
+    ~SymbolResolver();
+    SymbolResolver(const SymbolResolver&) = delete;
+    SymbolResolver& operator=(const SymbolResolver&) = delete;
+
+    //shared by every compiler in the process
+    static SymbolResolver& process();
+
+    //nullptr when the process has no such symbol
+    void* resolve(std::string_view name);
+
+    //number of dlsym calls made, not the number of resolve calls
+    size_t lookup_count();
+    size_t cached_count();
+};
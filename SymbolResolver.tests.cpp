@@ -0,0 +1,72 @@
+//------------------------------------------------------------------------------
+// SymbolResolver.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "SymbolResolver.hpp"
+
+#include "Compilerx64.hpp"
+#include "Linker.hpp"
+#include "Parser.hpp"
+#include "TranslationUnit.hpp"
+
+#include <dlfcn.h>
+
+#include <gtest/gtest.h>
+
+TEST(SymbolResolver, resolve_matches_dlsym) {
+    SymbolResolver resolver;
+    void* handle = dlopen(0, RTLD_NOW);
+
+    EXPECT_EQ(resolver.resolve("puts"), dlsym(handle, "puts"));
+    EXPECT_EQ(resolver.resolve("not_a_symbol_in_this_process"), nullptr);
+    dlclose(handle);
+}
+
+TEST(SymbolResolver, lookups_are_cached) {
+    SymbolResolver resolver;
+    resolver.resolve("puts");
+    resolver.resolve("puts");
+    resolver.resolve("printf");
+    resolver.resolve("missing_symbol");
+    resolver.resolve("missing_symbol");
+
+    EXPECT_EQ(resolver.lookup_count(), 3);
+    EXPECT_EQ(resolver.cached_count(), 3);
+}
+
+TEST(SymbolResolver, shared_across_compilers) {
+    ll::Arena arena;
+    Parser p(arena);
+    p.parse_block(R"(
+    puts("a");
+    printf("b");
+    puts("c");
+    if (1 == 1) {
+        puts("d");
+    }
+    )");
+
+    SymbolResolver resolver;
+    InstrBufferx64 first;
+    Compiler_x64(p.block, &first, Compiler_x64::Mode::JIT, &resolver).compile_function();
+    InstrBufferx64 second;
+    Compiler_x64(p.block, &second, Compiler_x64::Mode::JIT, &resolver).compile_function();
+
+    EXPECT_EQ(resolver.lookup_count(), 2);
+    EXPECT_EQ(first.buffer().size(), second.buffer().size());
+}
+
+TEST(SymbolResolver, shared_with_translation_unit) {
+    std::string_view program = R"(
+    fn first() { puts("a"); printf("b"); }
+    fn second() { puts("c"); first(); }
+    )";
+    auto tu = ll::TranslationUnit::parse_translation_unit(program);
+
+    SymbolResolver resolver;
+    auto obj = ll::Object::compile_translation_unit(*tu, Compiler_x64::Mode::JIT, &resolver);
+
+    //puts, printf and first, the local function misses once
+    EXPECT_EQ(resolver.lookup_count(), 3);
+    EXPECT_EQ(obj.symbols.size(), 2);
+}
@@ -0,0 +1,24 @@
+//------------------------------------------------------------------------------
+// TestPrograms.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include "JitModule.hpp"
+#include "TranslationUnit.hpp"
+
+#include <string_view>
+
+//Whole programs compiled for tests, shared by the test files that need them.
+namespace ll::test {
+
+inline Object compile_object(std::string_view program, Compiler_x64::Mode mode = Compiler_x64::Mode::ObjectFile) {
+    auto tu = TranslationUnit::parse_translation_unit(program);
+    return Object::compile_translation_unit(*tu, mode);
+}
+
+inline JitModule compile_module(std::string_view program, CodeHeap& heap) {
+    return JitModule::finalise(compile_object(program, Compiler_x64::Mode::JIT), heap);
+}
+
+}
@@ -0,0 +1,120 @@
+//------------------------------------------------------------------------------
+// ThreadPool.cpp
+//------------------------------------------------------------------------------
+
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
+
+namespace {
+    struct ParallelFor {
+        const std::function<void(std::size_t)>* body;
+        std::size_t count;
+        std::atomic<std::size_t> next = 0;
+        std::atomic<std::size_t> completed = 0;
+
+        std::mutex mutex;
+        std::condition_variable finished;
+        std::size_t failedIndex = SIZE_MAX;
+        std::exception_ptr failure;
+
+        //claims indices until none are left, body is only touched while an
+        //index is claimed so helpers that start late never see it dangle
+        void work() {
+            for (auto i = next++; i < count; i = next++) {
+                try {
+                    (*body)(i);
+                } catch (...) {
+                    std::lock_guard lock(mutex);
+                    if (i < failedIndex) {
+                        failedIndex = i;
+                        failure = std::current_exception();
+                    }
+                }
+
+                if (++completed == count) {
+                    std::lock_guard lock(mutex);
+                    finished.notify_all();
+                }
+            }
+        }
+    };
+}
+
+ll::ThreadPool::ThreadPool(std::size_t threads) {
+    _workers.reserve(threads);
+    for (std::size_t i = 0; i < threads; i++) {
+        _workers.emplace_back([this] { run(); });
+    }
+}
+
+ll::ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard lock(_mutex);
+        _stopping = true;
+    }
+    _wake.notify_all();
+
+    for (auto& worker : _workers) {
+        worker.join();
+    }
+}
+
+ll::ThreadPool& ll::ThreadPool::process() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ll::ThreadPool::parallel_for(std::size_t count, const std::function<void(std::size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+
+    if (count == 1 || _workers.empty()) {
+        for (std::size_t i = 0; i < count; i++) {
+            body(i);
+        }
+        return;
+    }
+
+    auto state = std::make_shared<ParallelFor>();
+    state->body = &body;
+    state->count = count;
+
+    auto helpers = std::min(count - 1, _workers.size());
+    {
+        std::lock_guard lock(_mutex);
+        for (std::size_t i = 0; i < helpers; i++) {
+            _queue.emplace_back([state] { state->work(); });
+        }
+    }
+    _wake.notify_all();
+
+    state->work();
+
+    std::unique_lock lock(state->mutex);
+    state->finished.wait(lock, [&state] { return state->completed == state->count; });
+    if (state->failure) {
+        std::rethrow_exception(state->failure);
+    }
+}
+
+void ll::ThreadPool::run() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock lock(_mutex);
+            _wake.wait(lock, [this] { return _stopping || !_queue.empty(); });
+            if (_stopping && _queue.empty()) {
+                return;
+            }
+            task = std::move(_queue.front());
+            _queue.pop_front();
+        }
+        task();
+    }
+}
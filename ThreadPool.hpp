@@ -0,0 +1,48 @@
+//------------------------------------------------------------------------------
+// ThreadPool.hpp
+//------------------------------------------------------------------------------
+
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ll {
+
+//Fixed set of worker threads for compiler passes that split into independent
+//pieces of work.
+class ThreadPool {
+private:
+    std::vector<std::thread> _workers;
+    std::mutex _mutex;
+    std::condition_variable _wake;
+    std::deque<std::function<void()>> _queue;
+    bool _stopping = false;
+
+public:
+    explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    //shared by every pass in the process
+    static ThreadPool& process();
+
+    std::size_t size() const { return _workers.size(); }
+
+    //calls body(i) for every i in [0, count) and returns once all have run.
+    //The calling thread takes indices too, so nested calls from a worker can't
+    //deadlock. If any call throws, the exception from the lowest index is
+    //rethrown once the others have finished.
+    void parallel_for(std::size_t count, const std::function<void(std::size_t)>& body);
+
+private:
+    void run();
+};
+
+}
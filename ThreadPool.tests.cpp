@@ -0,0 +1,52 @@
+//------------------------------------------------------------------------------
+// ThreadPool.tests.cpp
+//------------------------------------------------------------------------------
+
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <stdexcept>
+
+#include <gtest/gtest.h>
+
+using namespace ll;
+
+TEST(ThreadPool, parallel_for_visits_every_index_once) {
+    ThreadPool pool(4);
+    std::vector<std::atomic<int>> visits(1000);
+    pool.parallel_for(visits.size(), [&visits] (size_t i) { visits[i]++; });
+
+    for (auto& count : visits) {
+        EXPECT_EQ(count, 1);
+    }
+}
+
+TEST(ThreadPool, parallel_for_without_workers) {
+    ThreadPool pool(0);
+    std::vector<size_t> order;
+    pool.parallel_for(3, [&order] (size_t i) { order.push_back(i); });
+    EXPECT_EQ(order, std::vector<size_t>({0, 1, 2}));
+}
+
+TEST(ThreadPool, parallel_for_nested) {
+    ThreadPool pool(2);
+    std::atomic<int> total = 0;
+    pool.parallel_for(8, [&] (size_t) {
+        pool.parallel_for(8, [&] (size_t) { total++; });
+    });
+    EXPECT_EQ(total, 64);
+}
+
+TEST(ThreadPool, parallel_for_rethrows_lowest_index) {
+    ThreadPool pool(4);
+    try {
+        pool.parallel_for(100, [] (size_t i) {
+            if (i % 10 == 3) {
+                throw std::runtime_error(std::to_string(i));
+            }
+        });
+        FAIL();
+    } catch (const std::runtime_error& e) {
+        EXPECT_STREQ(e.what(), "3");
+    }
+}
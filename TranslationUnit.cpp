@@ -5,60 +5,203 @@
 
 #include "TranslationUnit.hpp"
 
+#include "Lexer.hpp"
 #include "Parser.hpp"
-#include "ParserUtils.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+#include <stdexcept>
 
 ll::TranslationUnit::TranslationUnit() {
 
 }
 
-ll::TranslationUnitPtr ll::TranslationUnit::parse_translation_unit(std::string_view& input) {
-    auto tu = std::make_unique<TranslationUnit>();
+namespace {
+    //fewer functions than this per piece aren't worth a trip to another thread
+    constexpr size_t MinFunctionsPerSpan = 64;
 
-    trim_left(input);
-    while (!input.empty()) {
-        if (input.substr(0, 3) == "fn ") {
-            auto function = TranslationUnit::parse_function_definition(input);
-            tu->functions.push_back(std::move(function));
-        } else {
-            throw std::runtime_error("Couldn't find function definition.");
+    std::runtime_error located(const ll::SourceLines& lines, std::uint32_t at, const std::runtime_error& e) {
+        std::stringstream ss;
+        ss << lines.line(at) << ":" << lines.column(at) << ": " << e.what();
+        return std::runtime_error(ss.str());
+    }
+
+    //input starts base bytes into the translation unit, errors are reported
+    //with the line and column they were found at
+    std::vector<lexer::Token> tokenise(std::string_view input, std::uint32_t base, const ll::SourceLines& lines) {
+        try {
+            return lexer::tokenise(input);
+        } catch (const lexer::Error& e) {
+            throw located(lines, static_cast<std::uint32_t>(base + e.offset), e);
         }
     }
 
+    void parse_functions(std::string_view input, std::uint32_t base, const ll::SourceLines& lines, ll::Arena& arena, std::vector<ll::FunctionDefinitionPtr>& functions) {
+        auto tokens = tokenise(input, base, lines);
+        Parser parser(arena, tokens, base);
+        try {
+            while (!parser.at_end()) {
+                if (parser.at_keyword("fn")) {
+                    auto function = parser.read_function_definition();
+                    functions.push_back(function);
+                } else {
+                    throw std::runtime_error("Couldn't find function definition.");
+                }
+            }
+        } catch (const std::runtime_error& e) {
+            throw located(lines, static_cast<std::uint32_t>(base + parser.offset()), e);
+        }
+    }
+
+    //programs that are only statements, like fizzbuzz.ll, don't start with fn
+    bool statements_only(std::string_view input) {
+        auto start = std::find_if(input.begin(), input.end(), [] (char c) {
+            return !std::isspace(static_cast<unsigned char>(c));
+        });
+        input.remove_prefix(start - input.begin());
+        if (input.empty()) {
+            return false;
+        }
+        bool fn = input.starts_with("fn") && (input.size() == 2
+            || !(std::isalnum(static_cast<unsigned char>(input[2])) || input[2] == '_'));
+        return !fn;
+    }
+
+    std::size_t count_statements(const Block& block) {
+        auto count = block.statements.size();
+        for (auto statement : block.statements) {
+            if (auto chain = node_cast<const IfChainStatement>(statement)) {
+                for (auto ifStatement : chain->_ifstatements) {
+                    count += count_statements(*ifStatement->block);
+                }
+            } else if (auto loop = node_cast<const LoopStatement>(statement)) {
+                count += count_statements(*loop->_ifStatement->block);
+            }
+        }
+        return count;
+    }
+}
+
+ll::TranslationUnitPtr ll::TranslationUnit::parse_translation_unit(std::string_view& input, ThreadPool* pool) {
+    auto tu = std::make_unique<TranslationUnit>();
+    tu->lines = SourceLines(input);
+
+    auto spans = pool && pool->size() > 0 ? split_functions(input) : std::vector<std::string_view>{};
+    auto pieces = std::min(spans.size() / MinFunctionsPerSpan, pool ? pool->size() * 4 : 0);
+
+    if (pieces <= 1) {
+        parse_functions(input, 0, tu->lines, tu->arena, tu->functions);
+        input.remove_prefix(input.size());
+        return tu;
+    }
+
+    //contiguous runs of spans so every piece is one slice of the input
+    std::vector<std::vector<FunctionDefinitionPtr>> results(pieces);
+    for (size_t i = 0; i < pieces; i++) {
+        tu->spanArenas.push_back(std::make_unique<Arena>());
+    }
+
+    pool->parallel_for(pieces, [&] (size_t i) {
+        auto first = spans.size() * i / pieces;
+        auto last = spans.size() * (i + 1) / pieces;
+        auto begin = spans[first].data();
+        auto end = spans[last - 1].data() + spans[last - 1].size();
+        auto base = static_cast<std::uint32_t>(begin - input.data());
+        parse_functions(std::string_view(begin, end), base, tu->lines, *tu->spanArenas[i], results[i]);
+    });
+
+    tu->functions.reserve(spans.size());
+    for (auto& result : results) {
+        tu->functions.insert(tu->functions.end(), result.begin(), result.end());
+    }
+    input.remove_prefix(input.size());
+
     return tu;
 }
 
-ll::FunctionDefinitionPtr ll::TranslationUnit::parse_function_definition(std::string_view& input) {
-    auto def = std::make_unique<FunctionDefinition>();
+ll::TranslationUnitPtr ll::TranslationUnit::parse_program(std::string_view& input, ThreadPool* pool) {
+    if (!statements_only(input)) {
+        return parse_translation_unit(input, pool);
+    }
+
+    auto tu = std::make_unique<TranslationUnit>();
+    tu->lines = SourceLines(input);
+
+    auto tokens = tokenise(input, 0, tu->lines);
+    Parser parser(tu->arena, tokens);
+    try {
+        tu->functions.push_back(parser.read_implicit_main());
+    } catch (const std::runtime_error& e) {
+        throw located(tu->lines, static_cast<std::uint32_t>(parser.offset()), e);
+    }
+    input.remove_prefix(input.size());
+
+    return tu;
+}
+
+std::vector<std::string_view> ll::TranslationUnit::split_functions(std::string_view input) {
+    std::vector<std::string_view> spans;
+    size_t start = 0;
+    size_t depth = 0;
+
+    for (size_t i = 0; i < input.size(); i++) {
+        switch (input[i]) {
+            case '"':
+            {
+                auto end = input.find('"', i + 1);
+                i = end == std::string_view::npos ? input.size() : end;
+                break;
+            }
+
+            case '{':
+                depth++;
+                break;
+
+            case '}':
+                if (depth > 0 && --depth == 0) {
+                    spans.push_back(input.substr(start, i + 1 - start));
+                    start = i + 1;
+                }
+                break;
+        }
+    }
 
-    trim_left(input);
-    if (input.substr(0, 3) != "fn ") {
-        throw std::runtime_error("expected function definition");
+    //trailing text stays with the last span so the parser sees and reports it
+    if (start < input.size()) {
+        if (spans.empty()) {
+            spans.push_back(input.substr(start));
+        } else {
+            auto& last = spans.back();
+            last = std::string_view(last.data(), input.data() + input.size());
+        }
     }
 
-    input.remove_prefix(3);
-    auto splitter = input.find_first_of(" (");
-    def->name = input.substr(0, splitter);
-    
-    input.remove_prefix(splitter);
-    trim_left(input);
-    if (input.substr(0, 2) != "()") {
-        throw std::runtime_error("expected empty function parameter definition");
+    return spans;
+}
+
+ll::FunctionDefinitionPtr ll::TranslationUnit::parse_function_definition(std::string_view& input, Arena& arena) {
+    auto tokens = lexer::tokenise(input);
+    Parser parser(arena, tokens);
+    auto def = parser.read_function_definition();
+
+    input.remove_prefix(parser.offset());
+
+    return def;
+}
+
+std::size_t ll::TranslationUnit::statement_count() const {
+    std::size_t count = 0;
+    for (auto function : functions) {
+        count += count_statements(*function->block);
     }
-    input.remove_prefix(2);
-    trim_left(input);
+    return count;
+}
 
-    auto blockStart = input.find_first_of('{');
-    auto blockEnd = find_block_end(input);
-    if (blockStart == std::string_view::npos || blockEnd == std::string_view::npos) {
-        throw std::runtime_error("couldn't find block delimiters");
+std::size_t ll::TranslationUnit::arena_bytes() const {
+    auto bytes = arena.bytes_allocated();
+    for (auto& spanArena : spanArenas) {
+        bytes += spanArena->bytes_allocated();
     }
-    auto block = input.substr(blockStart + 1, blockEnd - blockStart - 1);
-    Parser parser;
-    parser.parse_block(block);
-    def->block = std::move(parser.block);
-    input.remove_prefix(blockEnd + 1);
-    trim_left(input);
-
-    return std::move(def);
-}
\ No newline at end of file
+    return bytes;
+}
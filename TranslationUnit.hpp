@@ -5,8 +5,12 @@
 
 #pragma once
 
+#include "Arena.hpp"
+#include "SourceLines.hpp"
+#include "ThreadPool.hpp"
 #include "TranslationUnitTypes.hpp"
 
+#include <memory>
 #include <string_view>
 #include <vector>
 
@@ -17,13 +21,31 @@ typedef std::unique_ptr<TranslationUnit> TranslationUnitPtr;
 
 class TranslationUnit {
 public:
+    //owns every AST node of the translation unit, released in one go with it
+    Arena arena;
+    //large units are parsed in pieces on the thread pool, each into its own arena
+    std::vector<std::unique_ptr<Arena>> spanArenas;
     std::vector<FunctionDefinitionPtr> functions;
+    //lines of the parsed input, node spans are offsets into it
+    SourceLines lines;
 
 public:
     TranslationUnit();
 
-    static TranslationUnitPtr parse_translation_unit(std::string_view& input);
-    static FunctionDefinitionPtr parse_function_definition(std::string_view& input);
+    //functions end up in source order whether parsed serially or not. Parse
+    //errors are prefixed with line:column.
+    static TranslationUnitPtr parse_translation_unit(std::string_view& input, ThreadPool* pool = &ThreadPool::process());
+    //a translation unit, or a program that is only statements as the body of
+    //an implicit main
+    static TranslationUnitPtr parse_program(std::string_view& input, ThreadPool* pool = &ThreadPool::process());
+    //splits after each top level closing brace, trailing text joins the last span
+    static std::vector<std::string_view> split_functions(std::string_view input);
+    static FunctionDefinitionPtr parse_function_definition(std::string_view& input, Arena& arena);
+
+    //statements of every function, counting those in nested blocks
+    std::size_t statement_count() const;
+    //AST bytes across the unit's arenas
+    std::size_t arena_bytes() const;
 };
 
 }
\ No newline at end of file
@@ -26,7 +26,7 @@ TEST(TranslationUnit, parse_translation_unit_one_function) {
     ASSERT_TRUE(tu);
     ASSERT_EQ(tu->functions.size(), 1);
 
-    auto funcDef = tu->functions.front().get();
+    auto funcDef = tu->functions.front();
     ASSERT_TRUE(funcDef);
     EXPECT_EQ(funcDef->name, "main");
 }
@@ -38,11 +38,11 @@ TEST(TranslationUnit, parse_translation_unit_two_function) {
     ASSERT_TRUE(tu);
     ASSERT_EQ(tu->functions.size(), 2);
 
-    auto funcDef = tu->functions.front().get();
+    auto funcDef = tu->functions.front();
     ASSERT_TRUE(funcDef);
     EXPECT_EQ(funcDef->name, "main");
 
-    auto funcDef2 = tu->functions.back().get();
+    auto funcDef2 = tu->functions.back();
     ASSERT_TRUE(funcDef2);
     EXPECT_EQ(funcDef2->name, "test");
 }
@@ -53,9 +53,10 @@ TEST(TranslationUnit, parse_translation_unit_parse_error) {
 }
 
 TEST(TranslationUnit, parse_function_definition) {
+    ll::Arena arena;
     std::string_view eg = R"(fn main() {})";
 
-    auto funcDef = TranslationUnit::parse_function_definition(eg);
+    auto funcDef = TranslationUnit::parse_function_definition(eg, arena);
     ASSERT_TRUE(funcDef);
     ASSERT_TRUE(funcDef->block);
 
@@ -63,9 +64,10 @@ TEST(TranslationUnit, parse_function_definition) {
 }
 
 TEST(TranslationUnit, parse_function_definition_whitespace) {
+    ll::Arena arena;
     std::string_view eg = R"( fn test () {})";
 
-    auto funcDef = TranslationUnit::parse_function_definition(eg);
+    auto funcDef = TranslationUnit::parse_function_definition(eg, arena);
     ASSERT_TRUE(funcDef);
     ASSERT_TRUE(funcDef->block);
 
@@ -73,9 +75,10 @@ TEST(TranslationUnit, parse_function_definition_whitespace) {
 }
 
 TEST(TranslationUnit, parse_function_definition_content) {
+    ll::Arena arena;
     std::string_view eg = R"( fn test () { printf("asdf"); })";
 
-    auto funcDef = TranslationUnit::parse_function_definition(eg);
+    auto funcDef = TranslationUnit::parse_function_definition(eg, arena);
     ASSERT_TRUE(funcDef);
     ASSERT_TRUE(funcDef->block);
     EXPECT_EQ(funcDef->name, "test");
@@ -84,9 +87,158 @@ TEST(TranslationUnit, parse_function_definition_content) {
     EXPECT_EQ(funcDef->block->parent, nullptr);
 
     ASSERT_EQ(funcDef->block->statements.size(), 1);
-    auto call = dynamic_cast<FunctionCall*>(funcDef->block->statements.front().get());
+    auto call = node_cast<FunctionCall>(funcDef->block->statements.front());
     ASSERT_TRUE(call);
 
     EXPECT_EQ(call->functionName, "printf");
     EXPECT_EQ(call->params.size(), 1);
 }
+
+TEST(TranslationUnit, parse_function_definition_parameters) {
+    ll::Arena arena;
+    std::string_view eg = R"(fn add(int64 a, int64 b) { int64 c; c = a + b; return c; })";
+
+    auto funcDef = TranslationUnit::parse_function_definition(eg, arena);
+    ASSERT_TRUE(funcDef);
+    EXPECT_EQ(funcDef->name, "add");
+
+    auto& block = *funcDef->block;
+    EXPECT_EQ(block.parameters, 2);
+    ASSERT_EQ(block.vars.size(), 3);
+    EXPECT_EQ(block.vars[0].name, "a");
+    EXPECT_EQ(block.vars[1].name, "b");
+    EXPECT_EQ(block.vars[2].name, "c");
+
+    ASSERT_EQ(block.statements.size(), 2);
+    auto ret = node_cast<ReturnStatement>(block.statements.back());
+    ASSERT_TRUE(ret);
+    auto value = node_cast<StackVariableParam>(ret->value);
+    ASSERT_TRUE(value);
+    EXPECT_EQ(value->content, "c");
+}
+
+TEST(TranslationUnit, parse_function_definition_parameter_errors) {
+    ll::Arena arena;
+    std::string_view duplicate = R"(fn f(int64 a, int64 a) {})";
+    EXPECT_THROW(TranslationUnit::parse_function_definition(duplicate, arena), std::runtime_error);
+    std::string_view trailing = R"(fn f(int64 a,) {})";
+    EXPECT_THROW(TranslationUnit::parse_function_definition(trailing, arena), std::runtime_error);
+    std::string_view untyped = R"(fn f(a) {})";
+    EXPECT_THROW(TranslationUnit::parse_function_definition(untyped, arena), std::runtime_error);
+}
+
+TEST(TranslationUnit, split_functions) {
+    std::string_view eg = R"(fn a() { if (1 == 1) { puts("}"); } } fn b() {}
+    )";
+
+    auto spans = TranslationUnit::split_functions(eg);
+    ASSERT_EQ(spans.size(), 2);
+    EXPECT_EQ(spans[0], R"(fn a() { if (1 == 1) { puts("}"); } })");
+    EXPECT_EQ(spans[1], " fn b() {}\n    ");
+
+    EXPECT_TRUE(TranslationUnit::split_functions("").empty());
+    EXPECT_EQ(TranslationUnit::split_functions("fn a() {").size(), 1);
+}
+
+namespace {
+    std::string many_functions(size_t count) {
+        std::string program;
+        for (size_t i = 0; i < count; i++) {
+            auto n = std::to_string(i);
+            program += "fn f" + n + "() { int64 a; a = " + n + "; if (a == 1) { puts(\"{\"); } }\n";
+        }
+        return program;
+    }
+}
+
+TEST(TranslationUnit, parse_translation_unit_parallel) {
+    auto program = many_functions(1000);
+    ThreadPool pool(4);
+
+    std::string_view serialInput = program;
+    auto serial = TranslationUnit::parse_translation_unit(serialInput, nullptr);
+    std::string_view parallelInput = program;
+    auto parallel = TranslationUnit::parse_translation_unit(parallelInput, &pool);
+
+    EXPECT_TRUE(parallelInput.empty());
+    EXPECT_TRUE(serial->spanArenas.empty());
+    EXPECT_FALSE(parallel->spanArenas.empty());
+    ASSERT_EQ(parallel->functions.size(), serial->functions.size());
+    for (size_t i = 0; i < serial->functions.size(); i++) {
+        EXPECT_EQ(parallel->functions[i]->name, serial->functions[i]->name);
+        EXPECT_EQ(parallel->functions[i]->block->statements.size(), serial->functions[i]->block->statements.size());
+    }
+}
+
+TEST(TranslationUnit, parse_translation_unit_parallel_parse_error) {
+    auto program = many_functions(1000) + "test() {}" + many_functions(10);
+    ThreadPool pool(4);
+
+    std::string_view eg = program;
+    EXPECT_THROW(TranslationUnit::parse_translation_unit(eg, &pool), std::runtime_error);
+}
+
+TEST(TranslationUnit, parse_error_line_and_column) {
+    std::string_view eg = "fn main() {\n    puts(\"a\");\n    puts(\"b\"\n}\n";
+    try {
+        TranslationUnit::parse_translation_unit(eg);
+        FAIL() << "expected a parse error";
+    } catch (const std::runtime_error& e) {
+        EXPECT_EQ(std::string_view(e.what()).substr(0, 4), "4:1:");
+    }
+}
+
+TEST(TranslationUnit, lexer_error_line_and_column) {
+    auto expect_error = [] (std::string_view eg, ThreadPool* pool, std::string_view expected) {
+        try {
+            TranslationUnit::parse_translation_unit(eg, pool);
+            FAIL() << "expected a lexer error";
+        } catch (const std::runtime_error& e) {
+            EXPECT_EQ(std::string_view(e.what()), expected);
+        }
+    };
+
+    expect_error("fn main() {\n    int64 a;\n    a = 1 - 2;\n}\n", nullptr, "3:11: Unexpected character '-'");
+
+    //in a piece that starts part way into the input
+    ThreadPool pool(4);
+    auto program = many_functions(1000) + "fn g() {\n  puts(\"a\" ! 1);\n}\n";
+    expect_error(program, &pool, "1002:12: unknown comparator");
+}
+
+TEST(TranslationUnit, parse_program_statements_as_main) {
+    std::string_view eg = "int64 a;\na = 1;\nwhile (a < 3) { a = a + 1; }\nprintf(\"%i\", a);\n";
+    auto source = eg;
+
+    auto tu = TranslationUnit::parse_program(eg);
+    ASSERT_EQ(tu->functions.size(), 1);
+    auto main = tu->functions.front();
+    EXPECT_EQ(main->name, "main");
+    EXPECT_EQ(main->block->vars.size(), 1);
+    ASSERT_EQ(main->block->statements.size(), 3);
+    EXPECT_EQ(main->span.offset, 0);
+    EXPECT_EQ(main->span.length, source.size() - 1);
+    EXPECT_EQ(tu->lines.line(main->block->statements.back()->span.offset), 4);
+}
+
+TEST(TranslationUnit, parse_program_functions) {
+    std::string_view eg = "\n  fn main() { helper(); }\nfn helper() {}\n";
+    auto tu = TranslationUnit::parse_program(eg);
+    ASSERT_EQ(tu->functions.size(), 2);
+    EXPECT_EQ(tu->functions.front()->name, "main");
+
+    std::string_view named = "fnord = 1;";
+    tu = TranslationUnit::parse_program(named);
+    ASSERT_EQ(tu->functions.size(), 1);
+    EXPECT_EQ(tu->functions.front()->name, "main");
+}
+
+TEST(TranslationUnit, parse_program_error_line_and_column) {
+    std::string_view eg = "int64 a;\na = 1;\n  );\n";
+    try {
+        TranslationUnit::parse_program(eg);
+        FAIL() << "expected a parse error";
+    } catch (const std::runtime_error& e) {
+        EXPECT_EQ(std::string_view(e.what()).substr(0, 4), "3:3:");
+    }
+}
@@ -5,19 +5,20 @@
 
 #pragma once
 
+#include "SourceLines.hpp"
 #include "Variables.hpp"
 
-#include <vector>
-#include <memory>
+#include <string_view>
 
 struct Block;
 
 namespace ll {
 
 struct FunctionDefinition {
-    std::string name;
-    std::unique_ptr<Block> block;
+    std::string_view name;
+    Block* block = nullptr;
+    ll::SourceSpan span;
 };
-typedef std::unique_ptr<FunctionDefinition> FunctionDefinitionPtr;
+typedef FunctionDefinition* FunctionDefinitionPtr;
 
 }
@@ -4,13 +4,13 @@
 
 #pragma once
 
-#include <string>
+#include <string_view>
 
 struct VariableDefinition {
     enum Type {
         Int64
     };
 
-    std::string name;
+    std::string_view name;
     Type type;
 };
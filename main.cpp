@@ -1,18 +1,38 @@
 
+#include "CodeCache.hpp"
 #include "Compilerx64.hpp"
+#include "ConstantFolder.hpp"
 #include "Elf.hpp"
+#include "Inliner.hpp"
 #include "InstrBufferx64.hpp"
+#include "JitModule.hpp"
 #include "MachO.hpp"
 #include "Parser.hpp"
+#include "Profiler.hpp"
+#include "Stats.hpp"
 #include "TranslationUnit.hpp"
 #include "Linker.hpp"
 
 #include "vendor/cli11/CLI11.hpp"
 
+#include <cctype>
+#include <cstdlib>
+#include <expected>
+#include <filesystem>
 #include <iostream>
 #include <fstream>
+#include <new>
+#include <optional>
 #include <string>
 
+#ifdef __APPLE__
+#include <malloc/malloc.h>
+#define ll_usable_size malloc_size
+#else
+#include <malloc.h>
+#define ll_usable_size malloc_usable_size
+#endif
+
 namespace {
     const std::string fizzbuzz_program = R"(
     int64 counter;
@@ -40,21 +60,47 @@ namespace {
     )";
 }
 
+//heap use feeds ll::Stats for --stats, only measured once tracking is turned on
+void* operator new(std::size_t size) {
+    auto p = std::malloc(size == 0 ? 1 : size);
+    if (p == nullptr) {
+        throw std::bad_alloc();
+    }
+    if (ll::Stats::tracking_allocations()) {
+        ll::Stats::allocated(ll_usable_size(p));
+    }
+    return p;
+}
+
+void operator delete(void* p) noexcept {
+    if (p != nullptr && ll::Stats::tracking_allocations()) {
+        ll::Stats::freed(ll_usable_size(p));
+    }
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    operator delete(p);
+}
+
 void fizzbuzz_jit() {
-    Parser p;
+    ll::Arena arena;
+    Parser p(arena);
     p.parse_block(fizzbuzz_program);
     InstrBufferx64 i;
-    auto compiler = Compiler_x64(p.block.get(), &i, Compiler_x64::Mode::JIT);
+    auto compiler = Compiler_x64(p.block, &i, Compiler_x64::Mode::JIT);
     compiler.compile_function();
     i.execute(0);
 }
 
 void fizzbuzz_bin() {
-    Parser p;
+    ll::Arena arena;
+    Parser p(arena);
     p.parse_block(fizzbuzz_program);
-    InstrBufferx64 i;
-    auto compiler = Compiler_x64(p.block.get(), &i, Compiler_x64::Mode::ObjectFile);
+    ll::Object object;
+    auto compiler = Compiler_x64(p.block, &object.buff, Compiler_x64::Mode::ObjectFile);
     compiler.compile_function();
+    object.symbols.push_back({.name = "main", .offset = 0});
 
     std::fstream f("./out.o", f.binary | f.out);
     if (!f.is_open()) {
@@ -62,10 +108,10 @@ void fizzbuzz_bin() {
     }
 
 #ifdef __APPLE__
-    macho::write(f, i);
+    macho::write(f, object);
     f.close();
 #elif __linux__
-    elf::write(f, i);
+    elf::write(f, object);
     f.close();
 #endif
 }
@@ -73,15 +119,22 @@ void fizzbuzz_bin() {
 
 int main(int argc, char** argv) {
     enum class ObjectFileType { Macho, ELF };
+    enum class Emit { Object, Exe };
 
     std::map<std::string, Compiler_x64::Mode> compilerModeMap{{"jit", Compiler_x64::Mode::JIT}, {"object", Compiler_x64::Mode::ObjectFile}};
     std::map<std::string, ObjectFileType> objectFileTypeMap{{"macho", ObjectFileType::Macho}, {"elf", ObjectFileType::ELF}};
+    std::map<std::string, Emit> emitMap{{"object", Emit::Object}, {"exe", Emit::Exe}};
 
     std::string file;
     Compiler_x64::Mode mode{Compiler_x64::Mode::JIT};
     ObjectFileType objectFileType;
     std::string outputFile;
     bool linkExe = false;
+    std::string cacheDir;
+    Emit emit{Emit::Object};
+    std::string statsFormat;
+    bool perfMap = false;
+    bool profile = false;
 
     CLI::App app{"Littlelang is a simple programming language that is compiled to machine code for either executables or run in-memory.", "littlelang"};
 
@@ -90,6 +143,11 @@ int main(int argc, char** argv) {
     auto optObj = app.add_option("-t,--object-type", objectFileType, "Object file type to ouput.")->transform(CLI::CheckedTransformer(objectFileTypeMap, CLI::ignore_case));
     app.add_option("-o,--output", outputFile, "Output file.")->needs(optObj);
     app.add_flag("-L, --link", linkExe, "Link output to an exe utilising the system linker.")->needs(optObj);
+    app.add_option("--cache-dir", cacheDir, "Directory to cache JIT compiled code in.");
+    app.add_option("--emit", emit, "Output an object file or a complete executable without the system linker.")->transform(CLI::CheckedTransformer(emitMap, CLI::ignore_case))->needs(optObj);
+    app.add_flag("--stats{text}", statsFormat, "Report time, allocations and peak heap growth of each phase to stderr, --stats=json for JSON.")->check(CLI::IsMember({"text", "json"}));
+    app.add_flag("--perf-map", perfMap, "Name JIT compiled functions to perf in /tmp/perf-<pid>.map.");
+    app.add_flag("--profile", profile, "Sample the JIT compiled program and report its hottest functions and statements to stderr.");
 
     try {
         app.parse(argc, argv);
@@ -97,39 +155,189 @@ int main(int argc, char** argv) {
         return app.exit(e);
     }
 
-    std::ifstream program_file(file);
-    if (!program_file.is_open()) {
-        std::cout << "Unable to open file: " << file << std::endl;
+    if (profile && mode != Compiler_x64::Mode::JIT) {
+        std::cout << "Only JIT compiled programs can be profiled." << std::endl;
         return 1;
     }
 
-    std::stringstream program_text_stream;
-    program_text_stream << program_file.rdbuf();
-    auto program_text = program_text_stream.str();
+    ll::JitRegistration::enable_perf_map(perfMap);
+
+    ll::Stats statsData;
+    ll::Stats* stats = statsFormat.empty() ? nullptr : &statsData;
+    ll::Stats::track_allocations(stats != nullptr);
+
+    auto report = [&] () {
+        if (stats == nullptr) {
+            return;
+        }
+        if (statsFormat == "json") {
+            stats->write_json(std::cerr);
+        } else {
+            stats->write_text(std::cerr);
+        }
+    };
+
+    std::string program_text;
+    {
+        auto reading = ll::Stats::phase(stats, "read");
+        std::ifstream program_file(file);
+        if (!program_file.is_open()) {
+            std::cout << "Unable to open file: " << file << std::endl;
+            return 1;
+        }
+
+        std::stringstream program_text_stream;
+        program_text_stream << program_file.rdbuf();
+        program_text = program_text_stream.str();
+    }
+
+    //parse errors already start with line:column
+    auto diagnose = [&file] (std::string_view what) {
+        auto located = !what.empty() && std::isdigit(static_cast<unsigned char>(what.front()));
+        std::cout << file << (located ? ":" : ": ") << what << std::endl;
+    };
+
+    auto compile = [&] () {
+        ll::TranslationUnitPtr tu;
+        {
+            auto parsing = ll::Stats::phase(stats, "parse");
+            auto sv = std::string_view{program_text};
+            tu = ll::TranslationUnit::parse_program(sv);
+        }
+
+        std::size_t inlined = 0;
+        {
+            auto optimising = ll::Stats::phase(stats, "optimise");
+            Inliner inliner(tu->arena);
+            inliner.inline_translation_unit(*tu);
+            inlined = inliner.inlined();
+
+            ConstantFolder folder(tu->arena);
+            for (auto& func : tu->functions) {
+                folder.fold_function(func->block);
+            }
+        }
 
-    InstrBufferx64 instrbuff;
+        auto object = ll::Object::compile_translation_unit(*tu, mode, nullptr, &ll::ThreadPool::process(), stats);
+        object.sourceFile = std::filesystem::absolute(file).string();
+
+        if (stats) {
+            stats->count("source_bytes", program_text.size());
+            stats->count("functions", tu->functions.size());
+            stats->count("statements", tu->statement_count());
+            stats->count("ast_bytes", tu->arena_bytes());
+            stats->count("inlined_calls", inlined);
+            stats->count("emitted_bytes", object.buff.buffer().size());
+            stats->count("extern_calls", object.buff._externFuncs.size());
+            stats->count("jit_imports", object.buff._jitImports.size());
+            stats->count("cstrings", object.buff._cstrings.size());
+        }
+        return object;
+    };
 
     if (mode == Compiler_x64::Mode::JIT) {
-        struct FunctionSymbol {
-            std::string name;
-            std::size_t offset;
-        };
-        std::vector<FunctionSymbol> symbols;
-    
-        auto sv = std::string_view{program_text};
-        auto tu = ll::TranslationUnit::parse_translation_unit(sv);
-        auto obj = ll::Object::compile_translation_unit(*tu, mode);
-    
-        auto entryPoint = std::find_if(obj.symbols.begin(), obj.symbols.end(), [] (auto& v) {
-            return v.name == "main";
-        });
-
-        obj.buff.execute(entryPoint->offset);
+        std::optional<ll::CodeCache> cache;
+        std::optional<ll::Object> object;
+        auto key = ll::CodeCache::key(program_text);
+        if (!cacheDir.empty()) {
+            auto loading = ll::Stats::phase(stats, "cache_load");
+            cache.emplace(cacheDir);
+            object = cache->load(key);
+        }
+
+        if (!object) {
+            try {
+                object = compile();
+            } catch (const std::runtime_error& e) {
+                diagnose(e.what());
+                return 1;
+            } catch (const std::bad_expected_access<std::string>& e) {
+                //unknown variables
+                diagnose(e.error());
+                return 1;
+            }
+
+            if (cache) {
+                auto storing = ll::Stats::phase(stats, "cache_store");
+                if (!cache->store(key, *object)) {
+                    std::cout << "Unable to write to cache directory: " << cacheDir << std::endl;
+                }
+            }
+        }
+
+        if (stats && cache) {
+            stats->count("cache_hits", cache->hits());
+        }
+
+        auto module = [&] () {
+            auto finalising = ll::Stats::phase(stats, "finalise");
+            return ll::JitModule::finalise(std::move(*object));
+        }();
+        if (!module.contains("main")) {
+            std::cout << "No main function in: " << file << std::endl;
+            return 1;
+        }
+
+        {
+            auto executing = ll::Stats::phase(stats, "execute");
+            std::optional<ll::Profiler> profiler;
+            if (profile) {
+                profiler.emplace(module);
+                profiler->start();
+            }
+
+            module.function<void()>("main")();
+            fflush(stdout);
+
+            if (profiler) {
+                profiler->stop();
+                profiler->write_report(std::cerr);
+            }
+        }
     } else if (mode == Compiler_x64::Mode::ObjectFile) {
-        Parser parser;
-        parser.parse_block(program_text);
-        auto compiler = Compiler_x64(parser.block.get(), &instrbuff, mode);
-        compiler.compile_function();
+        std::optional<ll::Object> compiled;
+        try {
+            compiled = compile();
+        } catch (const std::runtime_error& e) {
+            diagnose(e.what());
+            return 1;
+        } catch (const std::bad_expected_access<std::string>& e) {
+            //unknown variables
+            diagnose(e.error());
+            return 1;
+        }
+        auto& object = *compiled;
+
+        if (emit == Emit::Exe) {
+            if (objectFileType != ObjectFileType::ELF) {
+                std::cout << "Executables can only be emitted as ELF." << std::endl;
+                return 1;
+            }
+
+            std::fstream exeFile(outputFile, std::fstream::binary | std::fstream::out | std::fstream::trunc);
+            if (!exeFile.is_open()) {
+                std::cout << "Couldn't open file path for writing out executable: " << outputFile << std::endl;
+                return 1;
+            }
+
+            try {
+                auto writing = ll::Stats::phase(stats, "write");
+                elf::write_executable(exeFile, object);
+            } catch (const std::runtime_error& e) {
+                std::cout << e.what() << std::endl;
+                return 1;
+            }
+            if (stats) {
+                stats->count("output_bytes", static_cast<std::uint64_t>(exeFile.tellp()));
+            }
+            exeFile.close();
+
+            std::filesystem::permissions(outputFile,
+                std::filesystem::perms::owner_exec | std::filesystem::perms::group_exec | std::filesystem::perms::others_exec,
+                std::filesystem::perm_options::add);
+            report();
+            return 0;
+        }
 
         std::fstream objectFile(outputFile, std::fstream::binary | std::fstream::out);
         if (!objectFile.is_open()) {
@@ -140,7 +348,13 @@ int main(int argc, char** argv) {
         switch (objectFileType) {
             case ObjectFileType::Macho:
             {
-                macho::write(objectFile, instrbuff);
+                {
+                    auto writing = ll::Stats::phase(stats, "write");
+                    macho::write(objectFile, object);
+                }
+                if (stats) {
+                    stats->count("output_bytes", static_cast<std::uint64_t>(objectFile.tellp()));
+                }
                 objectFile.close();
 
                 if (linkExe) {
@@ -148,6 +362,7 @@ int main(int argc, char** argv) {
                     ss << "ld -ld_classic -arch x86_64 -o ll_bin -syslibroot /Library/Developer/CommandLineTools/SDKs/MacOSX.sdk -lSystem ";
                     ss << outputFile;
 
+                    auto linking = ll::Stats::phase(stats, "link");
                     auto linkres = system(ss.str().c_str());
 
                     if (linkres != 0) {
@@ -160,7 +375,13 @@ int main(int argc, char** argv) {
 
             case ObjectFileType::ELF:
             {
-                elf::write(objectFile, instrbuff);
+                {
+                    auto writing = ll::Stats::phase(stats, "write");
+                    elf::write(objectFile, object);
+                }
+                if (stats) {
+                    stats->count("output_bytes", static_cast<std::uint64_t>(objectFile.tellp()));
+                }
                 objectFile.close();
 
                 if (linkExe) {
@@ -168,6 +389,7 @@ int main(int argc, char** argv) {
                     ss << "ld -o ll_bin -dynamic-linker /lib64/ld-linux-x86-64.so.2 -lc /usr/lib/gcc/x86_64-linux-gnu/13/../../../x86_64-linux-gnu/crti.o /usr/lib/gcc/x86_64-linux-gnu/13/../../../x86_64-linux-gnu/Scrt1.o /usr/lib/gcc/x86_64-linux-gnu/13/crtbeginS.o /usr/lib/gcc/x86_64-linux-gnu/13/crtendS.o /usr/lib/gcc/x86_64-linux-gnu/13/../../../x86_64-linux-gnu/crtn.o ";
                     ss << outputFile;
 
+                    auto linking = ll::Stats::phase(stats, "link");
                     auto linkres = system(ss.str().c_str());
 
                     if (linkres != 0) {
@@ -186,5 +408,6 @@ int main(int argc, char** argv) {
         }
     }
 
+    report();
     return 0;
 }